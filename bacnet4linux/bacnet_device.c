@@ -36,15 +36,32 @@
 #include "bacnet_object.h"
 #include "bacnet_text.h"
 #include "keylist.h"
+#include "object_index.h"
+#include "slab.h"
+#include "intern.h"
 #include "debug.h"
 
 static OS_Keylist Device_List = NULL;   // handle to the list of devices
 
+// device records, and the totals for every device's object pool
+#define DEVICE_SLAB_RECORDS 32
+#define OBJECT_SLAB_RECORDS 32
+static struct slab_pool Device_Pool;
+static struct slab_stats Device_Slab_Stats = { "Devices" };
+static struct slab_stats Object_Slab_Stats = { "Objects" };
+
+static void address_index_forget(struct BACnet_Device_Info *dev_ptr);
+
 static void check_device_list(void)
 {
     // is the list created yet?
-    if (!Device_List)
+    if (!Device_List) {
+        slab_pool_init(&Device_Pool, &Device_Slab_Stats,
+            sizeof(struct BACnet_Device_Info), DEVICE_SLAB_RECORDS);
         Device_List = Keylist_Create();
+        // every request looks its device up, so keep a read index
+        Keylist_Index_Enable(Device_List, true);
+    }
     // did it get created?
     if (!Device_List)
         error_printf("BACnet_Device: Unable to create list.\n");
@@ -64,6 +81,24 @@ struct BACnet_Device_Info *device_record(int device_index)
     return Keylist_Data_Index(Device_List, device_index);
 }
 
+/* walks the devices in instance order, keeping its place while
+   devices are added and removed */
+struct BACnet_Device_Info *device_cursor_data(struct Keylist_Cursor
+    *cursor)
+{
+    check_device_list();
+
+    return Keylist_Cursor_Data(Device_List, cursor);
+}
+
+struct BACnet_Device_Info *device_cursor_next(struct Keylist_Cursor
+    *cursor)
+{
+    check_device_list();
+
+    return Keylist_Cursor_Next(Device_List, cursor);
+}
+
 struct BACnet_Device_Info *device_get(int device_id)    // device instance number
 {
     check_device_list();
@@ -78,12 +113,18 @@ struct BACnet_Device_Info *device_new(int device_id)    // device instance numbe
     check_device_list();
     // does this device already exist?
     dev_ptr = Keylist_Data(Device_List, device_id);
-    if (dev_ptr)
+    if (dev_ptr) {
+        address_index_forget(dev_ptr);
         memset(dev_ptr, 0, sizeof(struct BACnet_Device_Info));
+    }
     else {
-        dev_ptr = calloc(1, sizeof(struct BACnet_Device_Info));
+        dev_ptr = slab_alloc(&Device_Pool);
         if (dev_ptr) {
+            slab_pool_init(&dev_ptr->object_pool, &Object_Slab_Stats,
+                sizeof(struct ObjectRef_Struct), OBJECT_SLAB_RECORDS);
             dev_ptr->object_list = Keylist_Create();
+            // object_find() runs several times per request
+            Keylist_Index_Enable(dev_ptr->object_list, true);
             Keylist_Data_Add(Device_List, device_id, dev_ptr);
         } else
             error_printf("Device: Unable to allocate device %d buffer\n",
@@ -113,38 +154,187 @@ struct BACnet_Device_Info *device_add(int device_id)    // device instance numbe
 }
 
 
+/* the source address index - an open addressing hash from the address
+   a device sends from to its instance, so a packet is matched to its
+   device without a scan of the device list.  Every address a device
+   record gets is set through device_set_address(), which keeps the
+   index up to date, so the index is the whole answer and a packet
+   from an unknown source costs one probe. */
+#define ADDRESS_INDEX_MIN_SLOTS 64
+
+struct address_key {
+    uint8_t mac[MAX_MAC_LEN];
+    uint8_t adr[MAX_MAC_LEN];
+    int net;                    /* -1 for a device on our own network */
+    struct in_addr ip;          /* B/IP devices share the empty MAC */
+};
+
+struct address_slot {
+    struct address_key key;
+    int device_id;              /* -1 if the slot is empty */
+};
+
+static struct address_slot *Address_Slots = NULL;
+static unsigned Address_Mask = 0;       /* slots - 1 */
+static int Address_Count = 0;   /* slots in use */
+
+/* the key a packet from this address is looked up with - a local
+   device is known by its MAC and IP address alone */
+static void address_key_from(struct address_key *key,
+    struct BACnet_Device_Address *src, bool local)
+{
+    memset(key, 0, sizeof(*key));
+    memcpy(key->mac, src->mac, MAX_MAC_LEN);
+    key->ip = src->ip;
+    if (local)
+        key->net = -1;
+    else {
+        memcpy(key->adr, src->adr, MAX_MAC_LEN);
+        key->net = src->net;
+    }
+}
+
+/* FNV-1a over the key */
+static unsigned address_key_hash(const struct address_key *key)
+{
+    const uint8_t *bytes = (const uint8_t *) key;
+    uint32_t hash = 2166136261u;
+    size_t i;
+
+    for (i = 0; i < sizeof(*key); i++) {
+        hash ^= bytes[i];
+        hash *= 16777619u;
+    }
+
+    return hash;
+}
+
+/* finds the slot holding key, or the empty slot that ends its run */
+static unsigned address_index_probe(const struct address_key *key)
+{
+    unsigned slot = address_key_hash(key) & Address_Mask;
+
+    while ((Address_Slots[slot].device_id != -1) &&
+        memcmp(&Address_Slots[slot].key, key, sizeof(*key)))
+        slot = (slot + 1) & Address_Mask;
+
+    return slot;
+}
+
+static bool address_index_resize(unsigned slot_count)
+{
+    struct address_slot *old_slots = Address_Slots;
+    unsigned old_slot_count = Address_Slots ? Address_Mask + 1 : 0;
+    struct address_slot *slots;
+    unsigned i;
+
+    slots = malloc(slot_count * sizeof(*slots));
+    if (!slots) {
+        error_printf("Device: Unable to allocate address index\n");
+        return false;
+    }
+    for (i = 0; i < slot_count; i++)
+        slots[i].device_id = -1;
+    Address_Slots = slots;
+    Address_Mask = slot_count - 1;
+    for (i = 0; i < old_slot_count; i++) {
+        if (old_slots[i].device_id != -1)
+            Address_Slots[address_index_probe(&old_slots[i].key)] =
+                old_slots[i];
+    }
+    free(old_slots);
+
+    return true;
+}
+
+static void address_index_add(const struct address_key *key, int device_id)
+{
+    unsigned slot;
+
+    /* no more than half full */
+    if (!Address_Slots ||
+        ((unsigned) (Address_Count + 1) * 2 > Address_Mask + 1)) {
+        if (!address_index_resize(Address_Slots ?
+                (Address_Mask + 1) * 2 : ADDRESS_INDEX_MIN_SLOTS))
+            return;
+    }
+    slot = address_index_probe(key);
+    if (Address_Slots[slot].device_id == -1)
+        Address_Count++;
+    Address_Slots[slot].key = *key;
+    Address_Slots[slot].device_id = device_id;
+}
+
+/* drops the entry for key, if it is for device_id */
+static void address_index_remove(const struct address_key *key,
+    int device_id)
+{
+    unsigned hole, slot, home;
+
+    if (!Address_Slots)
+        return;
+    hole = address_index_probe(key);
+    if ((Address_Slots[hole].device_id == -1) ||
+        (Address_Slots[hole].device_id != device_id))
+        return;
+    Address_Slots[hole].device_id = -1;
+    Address_Count--;
+    /* pull back any later entry of the run that the hole now cuts off
+       from its home slot */
+    for (slot = (hole + 1) & Address_Mask;
+        Address_Slots[slot].device_id != -1;
+        slot = (slot + 1) & Address_Mask) {
+        home = address_key_hash(&Address_Slots[slot].key) & Address_Mask;
+        if (((slot - home) & Address_Mask) >=
+            ((slot - hole) & Address_Mask)) {
+            Address_Slots[hole] = Address_Slots[slot];
+            Address_Slots[slot].device_id = -1;
+            hole = slot;
+        }
+    }
+}
+
+/* indexes a device under the address it sends from */
+static void address_index_device(struct BACnet_Device_Info *dev_ptr)
+{
+    struct address_key key;
+
+    address_key_from(&key, &dev_ptr->src, dev_ptr->src.local);
+    address_index_add(&key, dev_ptr->device);
+}
+
+/* drops a device's current address from the index - unless another
+   device has taken that address since */
+static void address_index_forget(struct BACnet_Device_Info *dev_ptr)
+{
+    struct address_key key;
+
+    address_key_from(&key, &dev_ptr->src, dev_ptr->src.local);
+    address_index_remove(&key, dev_ptr->device);
+}
+
 /* returns the device instance for a given npdu */
 int device_which_sent(struct BACnet_Device_Address *src)
 {
-    int device_id = -1;         // return value, -1 if not found
-    struct BACnet_Device_Info *dev_ptr;
-    int device_count;           // how many are in our device list
-    int i;                      // counter 
+    struct address_key key;
 
     check_device_list();
-    /* an NPDU is passed in, and an attempt to match it to known devices is done */
-    device_count = Keylist_Count(Device_List);
-    for (i = 0; i < device_count; i++) {
-        dev_ptr = Keylist_Data_Index(Device_List, i);
-        /* correct source MAC */
-        if (memcmp(src->mac, dev_ptr->src.mac, MAX_MAC_LEN) == 0) {
-            /* a local device, since no source was given */
-            // FIXME: inconsistent
-            if ((src->net == -1) && (dev_ptr->src.local)) {
-                device_id = dev_ptr->device;
-                break;
-            }
-            /* a routed device */
-            else {
-                if ((memcmp(src->adr, dev_ptr->src.adr, MAX_MAC_LEN) == 0)
-                    && (src->net == dev_ptr->src.net)) {
-                    device_id = dev_ptr->device;
-                    break;
-                }
-            }
-        }
-    }
-    return device_id;
+    if (!Address_Slots)
+        return -1;
+    address_key_from(&key, src, src->net == -1);
+
+    return Address_Slots[address_index_probe(&key)].device_id;
+}
+
+/* sets the address a device sends from, and indexes it */
+void device_set_address(struct BACnet_Device_Info *dev_ptr,
+    struct BACnet_Device_Address *src)
+{
+    if (!dev_ptr || !src)
+        return;
+    address_index_forget(dev_ptr);
+    dev_ptr->src = *src;
+    address_index_device(dev_ptr);
 }
 
 void device_init(void)
@@ -152,70 +342,71 @@ void device_init(void)
     check_device_list();
 }
 
-/* function to remove a known device and free all allocated memory */
+/* function to free a device taken off the list, and all its memory */
 // note: since we remove the device out of the list, we can't use
 // the device_ and object_ functions here since it is no longer on
 // the list.  Just use Keylist functions directly.
-void device_record_remove(int device_record)
+static void device_free(struct BACnet_Device_Info *dev_ptr)
 {
     struct ObjectRef_Struct *obj_ptr;
+    int count, i;               // objects in the device, counter
+
+    debug_printf(2, "Device: Removing %d\n", dev_ptr->device);
+    address_index_forget(dev_ptr);
+    intern_release(dev_ptr->device_name);
+    if (dev_ptr->object_list) {
+        debug_printf(3, "Device: Has an object list %d\n", dev_ptr->device);
+        // the objects go back with their pool, so only the
+        // strings they hold are released one by one
+        count = Keylist_Count(dev_ptr->object_list);
+        for (i = 0; i < count; i++) {
+            obj_ptr = Keylist_Data_Index(dev_ptr->object_list, i);
+            debug_printf(4, "Device: Removing Device %d %s %d\n",
+                dev_ptr->device,
+                enum_to_text_object(object_type(obj_ptr)),
+                object_instance(obj_ptr));
+            (void) object_index_remove(dev_ptr->device,
+                object_type(obj_ptr), object_instance(obj_ptr));
+            // cleanup any names created
+            object_release(obj_ptr);
+        }
+        Keylist_Delete(dev_ptr->object_list);
+    } else {
+        debug_printf(3, "Device: no object list for Device %d.\n",
+            dev_ptr->device);
+    }
+    slab_pool_release(&dev_ptr->object_pool);
+    slab_free(&Device_Pool, dev_ptr);
+}
+
+/* function to remove a known device and free all allocated memory */
+void device_record_remove(int device_record)
+{
     struct BACnet_Device_Info *dev_ptr;
 
     check_device_list();
     dev_ptr = Keylist_Data_Delete_By_Index(Device_List, device_record);
-    if (dev_ptr) {
-        debug_printf(2, "Device: Removing %d\n", dev_ptr->device);
-        if (dev_ptr->device_name)
-            free(dev_ptr->device_name);
-        if (dev_ptr->object_list) {
-            debug_printf(3, "Device: Has an object list %d\n",
-                dev_ptr->device);
-            // pull first one off list until there are no more.
-            while ((obj_ptr =
-                    Keylist_Data_Delete_By_Index(dev_ptr->object_list,
-                        0))) {
-                debug_printf(4, "Device: Removing Device %d %s %d\n",
-                    dev_ptr->device, enum_to_text_object(obj_ptr->type),
-                    obj_ptr->instance);
-                // cleanup any names created
-                if (obj_ptr->name) {
-                    /* free the memory to store the object name */
-                    free(obj_ptr->name);
-                    /* guarantee that the same memory isn't freed twice */
-                    obj_ptr->name = NULL;
-                }
-                if ((obj_ptr->type == OBJECT_BINARY_INPUT) ||
-                    (obj_ptr->type == OBJECT_BINARY_OUTPUT) ||
-                    (obj_ptr->type == OBJECT_BINARY_VALUE) ||
-                    (obj_ptr->type == OBJECT_CALENDAR) ||
-                    (obj_ptr->type == OBJECT_SCHEDULE)) {
-                    if (obj_ptr->units.states.active) {
-                        /* free the memory to store the object name */
-                        free(obj_ptr->units.states.active);
-                        /* guarantee that the same memory isn't freed twice */
-                        obj_ptr->units.states.active = NULL;
-                    }
-                    if (obj_ptr->units.states.inactive) {
-                        /* free the memory to store the object name */
-                        free(obj_ptr->units.states.inactive);
-                        /* guarantee that the same memory isn't freed twice */
-                        obj_ptr->units.states.inactive = NULL;
-                    }
-                }
-                free(obj_ptr);
-            }
-            Keylist_Delete(dev_ptr->object_list);
-        } else {
-            debug_printf(3, "Device: no object list for Device %d.\n",
-                dev_ptr->device);
-        }
-        free(dev_ptr);
-    } else {
+    if (dev_ptr)
+        device_free(dev_ptr);
+    else {
         debug_printf(2, "Device: no data to remove for index %d.\n",
             device_record);
     }
 }
 
+/* the same, by device instance */
+void device_remove(int device_id)
+{
+    struct BACnet_Device_Info *dev_ptr;
+
+    check_device_list();
+    dev_ptr = Keylist_Data_Delete(Device_List, device_id);
+    if (dev_ptr)
+        device_free(dev_ptr);
+    else
+        debug_printf(2, "Device: %d is not known to remove.\n", device_id);
+}
+
 // used at the end of the run to clean up resources
 void device_cleanup(void)
 {
@@ -228,7 +419,266 @@ void device_cleanup(void)
         device_record_remove(0);
     }
     Keylist_Delete(Device_List);
+    // a later device_init() starts a fresh list
+    Device_List = NULL;
+    slab_pool_release(&Device_Pool);
+    object_index_cleanup();
+    free(Address_Slots);
+    Address_Slots = NULL;
+    Address_Mask = 0;
+    Address_Count = 0;
     debug_printf(1, "Device: Removed %d devices\n", num_devices);
 
     return;
 }
+
+#ifdef TEST
+#include <assert.h>
+#include <time.h>
+
+#include "ctest.h"
+
+static double DeviceElapsed(struct timespec *start)
+{
+    struct timespec end;
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    return (end.tv_sec - start->tv_sec) +
+        (end.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+/* the address of test device i - half behind five routers, and the
+   rest on our network, on 802.2 or on B/IP with no MAC */
+static void test_device_address(int i, struct BACnet_Device_Address *src)
+{
+    memset(src, 0, sizeof(*src));
+    if (i & 1) {
+        src->mac[0] = 0x0A;
+        src->mac[5] = (uint8_t) (i % 5);
+        src->net = 100 + i % 5;
+        src->len = MAX_MAC_LEN;
+        src->adr[4] = (char) (i >> 8);
+        src->adr[5] = (char) i;
+    } else if (i & 2) {
+        src->ip.s_addr = htonl(0xC0A80000 | (i & 0xFFFF));
+        src->local = true;
+    } else {
+        src->mac[0] = 0xC0;
+        src->mac[4] = (uint8_t) (i >> 8);
+        src->mac[5] = (uint8_t) i;
+        src->local = true;
+    }
+}
+
+/* the address a packet from test device i arrives with */
+static void test_packet_address(int i, struct BACnet_Device_Address *src)
+{
+    test_device_address(i, src);
+    if (src->local)
+        src->net = -1;
+    src->local = false;
+}
+
+/* the scan of every device that the address index replaced - kept
+   to time the index against */
+static int test_which_sent_scan(struct BACnet_Device_Address *src)
+{
+    struct BACnet_Device_Info *dev_ptr;
+    int i;
+
+    for (i = 0; i < Keylist_Count(Device_List); i++) {
+        dev_ptr = Keylist_Data_Index(Device_List, i);
+        if (memcmp(src->mac, dev_ptr->src.mac, MAX_MAC_LEN) ||
+            (src->ip.s_addr != dev_ptr->src.ip.s_addr))
+            continue;
+        if ((src->net == -1) && dev_ptr->src.local)
+            return dev_ptr->device;
+        if (!memcmp(src->adr, dev_ptr->src.adr, MAX_MAC_LEN) &&
+            (src->net == dev_ptr->src.net))
+            return dev_ptr->device;
+    }
+
+    return -1;
+}
+
+void testDeviceWhichSent(Test * pTest)
+{
+    struct BACnet_Device_Info *dev_ptr;
+    struct BACnet_Device_Address src;
+    const int num_devices = 1000;
+    const unsigned num_packets = 1000000;
+    unsigned errors = 0;
+    unsigned n;
+    int i;
+    struct timespec start;
+    double scan_time, index_time;
+
+    device_init();
+    for (i = 0; i < num_devices; i++) {
+        dev_ptr = device_add(i);
+        if (!dev_ptr) {
+            errors++;
+            continue;
+        }
+        test_device_address(i, &src);
+        device_set_address(dev_ptr, &src);
+    }
+    ct_test(pTest, errors == 0);
+    for (i = 0; i < num_devices; i++) {
+        test_packet_address(i, &src);
+        if (device_which_sent(&src) != i)
+            errors++;
+    }
+    ct_test(pTest, errors == 0);
+
+    // a stranger is nobody
+    test_packet_address(num_devices + 2, &src);
+    ct_test(pTest, device_which_sent(&src) == -1);
+
+    // moving a device moves its index entry
+    dev_ptr = device_get(4);
+    test_device_address(num_devices + 4, &src);
+    device_set_address(dev_ptr, &src);
+    test_packet_address(num_devices + 4, &src);
+    ct_test(pTest, device_which_sent(&src) == 4);
+    test_packet_address(4, &src);
+    ct_test(pTest, device_which_sent(&src) == -1);
+
+    // B/IP devices with no MAC are told apart by their IP address
+    test_packet_address(2, &src);
+    ct_test(pTest, device_which_sent(&src) == 2);
+    test_packet_address(6, &src);
+    ct_test(pTest, device_which_sent(&src) == 6);
+    src.ip.s_addr = htonl(0xC0A8FFFF);
+    ct_test(pTest, device_which_sent(&src) == -1);
+
+    // a device that takes over an address keeps it when the device
+    // that had it before moves on
+    dev_ptr = device_get(7);
+    test_device_address(6, &src);
+    device_set_address(dev_ptr, &src);
+    dev_ptr = device_get(6);
+    test_device_address(num_devices + 6, &src);
+    device_set_address(dev_ptr, &src);
+    test_packet_address(6, &src);
+    ct_test(pTest, device_which_sent(&src) == 7);
+    test_device_address(6, &src);
+    device_set_address(dev_ptr, &src);
+    dev_ptr = device_get(7);
+    test_device_address(7, &src);
+    device_set_address(dev_ptr, &src);
+    dev_ptr = device_get(4);
+    test_device_address(4, &src);
+    device_set_address(dev_ptr, &src);
+    for (i = 0; i < num_devices; i++) {
+        test_packet_address(i, &src);
+        if (device_which_sent(&src) != i)
+            errors++;
+    }
+    ct_test(pTest, errors == 0);
+
+    // replay packets by scan and through the index - one in four from
+    // a source that is not a known device, which the scan has to look
+    // at every device for
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (n = 0; n < num_packets / 100; n++) {
+        i = (n * 7919) % (num_devices + num_devices / 3);
+        test_packet_address(i, &src);
+        if (test_which_sent_scan(&src) != (i < num_devices ? i : -1))
+            errors++;
+    }
+    scan_time = DeviceElapsed(&start);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (n = 0; n < num_packets; n++) {
+        i = (n * 7919) % (num_devices + num_devices / 3);
+        test_packet_address(i, &src);
+        if (device_which_sent(&src) != (i < num_devices ? i : -1))
+            errors++;
+    }
+    index_time = DeviceElapsed(&start);
+    ct_test(pTest, errors == 0);
+    printf("device: %d devices, 1/4 unknown sources - scan %6.3f M/s, "
+        "address index %5.1f M/s\n",
+        num_devices, num_packets / 100 / scan_time / 1e6,
+        num_packets / index_time / 1e6);
+
+    // a removed device stops matching
+    device_record_remove(0);
+    test_packet_address(0, &src);
+    ct_test(pTest, device_which_sent(&src) == -1);
+    test_packet_address(1, &src);
+    ct_test(pTest, device_which_sent(&src) == 1);
+    device_cleanup();
+    ct_test(pTest, device_which_sent(&src) == -1);
+
+    return;
+}
+
+/* a sweep that removes devices as it goes still visits each once */
+void testDeviceCursor(Test * pTest)
+{
+    struct BACnet_Device_Info *dev_ptr;
+    struct Keylist_Cursor cursor = { 0 };
+    int visited[32];
+    int count = 0, removed = 0;
+    unsigned errors = 0;
+    int i;
+
+    device_init();
+    for (i = 0; i < 20; i++)
+        (void) device_add(i * 10);
+    dev_ptr = device_cursor_data(&cursor);
+    while (dev_ptr && (count < 32)) {
+        visited[count++] = dev_ptr->device;
+        // one found part way through the sweep
+        if (dev_ptr->device == 100)
+            (void) device_add(105);
+        if ((dev_ptr->device % 30) == 0) {
+            device_remove(dev_ptr->device);
+            removed++;
+            dev_ptr = device_cursor_data(&cursor);
+        } else
+            dev_ptr = device_cursor_next(&cursor);
+    }
+    ct_test(pTest, count == 21);
+    for (i = 1; i < count; i++) {
+        if (visited[i] <= visited[i - 1])
+            errors++;
+    }
+    ct_test(pTest, errors == 0);
+    ct_test(pTest, removed == 7);
+    ct_test(pTest, device_count() == 21 - 7);
+    ct_test(pTest, device_get(30) == NULL);
+    ct_test(pTest, device_get(105) != NULL);
+    device_remove(30);
+    ct_test(pTest, device_count() == 14);
+    device_cleanup();
+
+    return;
+}
+
+#ifdef TEST_DEVICE
+int main(void)
+{
+    Test *pTest;
+    bool rc;
+
+    pTest = ct_create("device", NULL);
+
+    /* individual tests */
+    rc = ct_addTestFunction(pTest, testDeviceWhichSent);
+    assert(rc);
+    rc = ct_addTestFunction(pTest, testDeviceCursor);
+    assert(rc);
+
+    ct_setStream(pTest, stdout);
+    ct_run(pTest);
+    (void) ct_report(pTest);
+
+    ct_destroy(pTest);
+
+    return 0;
+}
+#endif                          /* TEST_DEVICE */
+#endif                          /* TEST */
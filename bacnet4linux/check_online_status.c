@@ -42,7 +42,8 @@ int check_online_status(void)
     time_t duration = 0;        /* time_h storage for time */
     int sent_packet = 0;        /* have we sent a packet this time? */
     struct BACnet_Device_Info *dev_ptr = NULL;
-    static int device_index = 0;        /* we only want to send one packet each time this is entered */
+    /* we only want to send one packet each time this is entered */
+    static struct Keylist_Cursor device_cursor = { 0 };
     static time_t last_verify_t = 0;
 
     /* find current time */
@@ -55,14 +56,19 @@ int check_online_status(void)
         last_verify_t = t;
         sent_packet = 0;
 
-        dev_ptr = device_record(device_index);
-        if (dev_ptr && (dev_ptr->device != BACnet_Device_Instance)) {
+        dev_ptr = device_cursor_data(&device_cursor);
+        // skip over ourself
+        if (dev_ptr && (dev_ptr->device == BACnet_Device_Instance))
+            dev_ptr = device_cursor_next(&device_cursor);
+        if (dev_ptr) {
             duration = t - dev_ptr->last_found;
             if (duration > (60 * 60 * 24)) {
                 debug_printf(3,
                     "CS: Removing %d - she's been too quiet.\n",
                     dev_ptr->device);
-                device_record_remove(device_index);
+                device_remove(dev_ptr->device);
+                /* the cursor has moved on to the next device */
+                dev_ptr = NULL;
             } else if (duration > (60 * 5)) {
                 /* no other traffic in a reasonable time */
                 debug_printf(3,
@@ -79,9 +85,10 @@ int check_online_status(void)
 #endif
             }
             /* we only want to send one packet each time this is entered */
-            device_index++;
+            if (dev_ptr)
+                (void) device_cursor_next(&device_cursor);
         } else {
-            device_index = 0;
+            Keylist_Cursor_Reset(&device_cursor);
         }
     }
     /* end sweep of known devices */
@@ -138,20 +138,99 @@ bool ethernet_init(char *interface_name)
     return ethernet_valid();
 }
 
+/* the 802.2 header in front of the NPDU - MACs, length and LLC */
+#define ETHERNET_HEADER_LEN 17
+
+/* puts the 802.2 header for pdu_len bytes of NPDU from src to dest */
+/* into header.  Returns false if an address is missing. */
+static bool ethernet_header(uint8_t * header, const uint8_t * dest,
+    const uint8_t * src, int pdu_len)
+{
+    int packet_len = 0;
+
+    /* encode destination ethernet mac if destination mac exists */
+    if (memcmp(dest, Ethernet_Empty_MAC, MAX_MAC_LEN) != 0)
+        memcpy(&header[0], dest, MAX_MAC_LEN);
+    else {
+        error_printf("Panic!: No destination MAC address given!\n");
+        return false;
+    }
+    /* encode source ethernet mac if source mac exists */
+    if (memcmp(src, Ethernet_Empty_MAC, MAX_MAC_LEN) != 0)
+        memcpy(&header[6], src, MAX_MAC_LEN);
+    else {
+        error_printf("Panic!: No source MAC address given!\n");
+        return false;
+    }
+    /* packet length excluding the MACs and the length itself */
+    packet_len = ETHERNET_HEADER_LEN + pdu_len - 14;
+    header[12] = (int) (packet_len / 256);      /* upper 8 bits */
+    header[13] = packet_len - header[12] * 256; /* lower 8 bits */
+    header[14] = 0x82;          /* DSAP for BACnet */
+    header[15] = 0x82;          /* SSAP for BACnet */
+    header[16] = 0x03;          /* Control byte in header */
+
+    return true;
+}
+
+/* sends the 802.2 header and the encoded NPDU behind it as one packet */
+static int ethernet_send_mtu(uint8_t * header, uint8_t * pdu, int pdu_len)
+{
+    struct iovec iov[2];
+    struct msghdr msg;
+    int mtu_len = ETHERNET_HEADER_LEN + pdu_len;
+    int bytes = 0;
+
+    /* quick sanity check */
+    if (mtu_len > DEFAULT_MTU) {        /* the maximum number of bytes in one shot */
+        error_printf
+            ("Attempted (and failed) to send a packet larger than %d bytes.\n",
+            DEFAULT_MTU);
+        return 0;
+    }
+    if (pdu_len < 2) {          /* the minimum number of bytes in one shot */
+        error_printf
+            ("Attempted (and failed) to send a packet smaller than %d bytes.\n",
+            ETHERNET_HEADER_LEN + 2);
+        return 0;
+    }
+
+    debug_printf(4, "send_packet: sending to %s\n", hwaddrtoa(&header[0]));
+    debug_dump_data(4, header, ETHERNET_HEADER_LEN);
+    debug_dump_data(4, pdu, pdu_len);
+    /* Send the packet */
+    iov[0].iov_base = header;
+    iov[0].iov_len = ETHERNET_HEADER_LEN;
+    iov[1].iov_base = pdu;
+    iov[1].iov_len = pdu_len;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_name = &eth_addr;
+    msg.msg_namelen = sizeof(struct sockaddr);
+    msg.msg_iov = iov;
+    msg.msg_iovlen = 2;
+    bytes = sendmsg(eth802_sockfd, &msg, 0);
+
+    /* Now, make sure we sent correctly */
+    if (bytes < 0) {            /* Error has occurred */
+        error_printf("Error sending packet: %s\n", strerror(errno));
+        return 0;
+    }
+    // got this far - must be good!
+
+    return 1;
+}
+
 /* function to send a packet out the 802.2 socket */
 /* returns 1 on success, 0 on failure */
 int ethernet_send(struct BACnet_NPDU *npdu, uint8_t * apdu, int apdu_len)
 {
     int status = 0;
-    int bytes = 0;
 #ifdef SEND_PACKET_DYN_MEM
     uint8_t *mtu = NULL;
 #else
     uint8_t mtu[DEFAULT_MTU] = { 0 };
 #endif
-    int mtu_len = 0;
-    int packet_len = 0;
-    int i = 0;
+    int pdu_len = 0;
 
     debug_printf(5, "ethernet: send\n");
 #ifdef SEND_PACKET_DYN_MEM
@@ -166,82 +245,16 @@ int ethernet_send(struct BACnet_NPDU *npdu, uint8_t * apdu, int apdu_len)
         debug_printf(4, "ethernet: 802.2 socket is invalid!\n");
         goto free_packet;
     }
-
-    /* encode destination ethernet mac if destination mac exists */
-    if (memcmp(npdu->dest.mac, Ethernet_Empty_MAC,
-            sizeof(npdu->dest.mac)) != 0) {
-        for (i = 0; i < 6; i++) {
-            mtu[i] = npdu->dest.mac[i];
-        }
-    } else {
-        error_printf("Panic!: No destination MAC address given!\n");
+    if (ETHERNET_HEADER_LEN + NPDU_HEADER_MAX + apdu_len > DEFAULT_MTU) {
+        error_printf
+            ("Attempted (and failed) to send a packet larger than %d bytes.\n",
+            DEFAULT_MTU);
         goto free_packet;
     }
 
-    /* encode source ethernet mac if source mac exists */
-    if (memcmp(npdu->src.mac, Ethernet_Empty_MAC,
-            sizeof(npdu->dest.mac)) != 0) {
-        for (i = 0; i < 6; i++) {
-            mtu[i + 6] = npdu->src.mac[i];
-        }
-    } else {
-        error_printf("Panic!: No source MAC address given!\n");
+    pdu_len = npdu_encode(&mtu[ETHERNET_HEADER_LEN], npdu, apdu, apdu_len);
+    if (!ethernet_header(mtu, npdu->dest.mac, npdu->src.mac, pdu_len))
         goto free_packet;
-    }
-
-    mtu[14] = 0x82;             /* DSAP for BACnet */
-    mtu[15] = 0x82;             /* SSAP for BACnet */
-    mtu[16] = 0x03;             /* Control byte in header */
-    mtu[17] = 0x01;             /* BACnet protocol version 1 */
-
-    mtu[18] = npdu->control_byte;
-    mtu_len = 19;               /* update buffer position */
-
-    if (npdu->dest_present) {
-        mtu[mtu_len] = (int) (npdu->dest.net / 256);    /* upper 8 bits */
-        mtu[mtu_len + 1] = npdu->dest.net - mtu[mtu_len] * 256; /* lower 8 bits */
-        mtu[mtu_len + 2] = npdu->dest.len;
-        mtu_len += 3;
-        if (npdu->dest.len == 6) {      /* dest.adr is present for ethernet */
-            for (i = 0; i < 6; i++) {   /* 6 chunks of mac */
-                mtu[mtu_len] = npdu->dest.adr[i];
-                mtu_len++;
-            }
-        } else if (npdu->dest.len == 1) {       /* dest.adr is present for arcnet, ms/tp */
-            mtu[mtu_len] = npdu->dest.adr[0];
-            mtu_len++;
-        }
-    }
-    if (npdu->src_present) {
-        mtu[mtu_len] = (int) (npdu->src.net / 256);     /* upper 8 bits */
-        mtu[mtu_len + 1] = npdu->src.net - mtu[mtu_len] * 256;  /* lower 8 bits */
-        mtu[mtu_len + 2] = npdu->src.len;
-        mtu_len += 3;
-        if (npdu->src.len == 6) {       /* dest.adr is present for ethernet */
-            for (i = 0; i < 6; i++) {   /* 6 chunks of mac */
-                mtu[mtu_len + i] = npdu->src.adr[i];
-                mtu_len++;
-            }
-        }
-    }
-
-    if (npdu->dest_present) {
-        mtu[mtu_len] = 0xFF;    /* hop count */
-        mtu_len++;
-    }
-
-    if (npdu->network_message) {        /* there is a network message, not an APDU */
-        mtu[mtu_len] = npdu->message_type;
-        mtu_len++;
-    }
-
-    /* at this point only the APDU is remaining */
-    memcpy(&mtu[mtu_len], apdu, apdu_len);
-    mtu_len += apdu_len;
-
-    packet_len = mtu_len - 14;  /* packet length excluding the header */
-    mtu[12] = (int) (packet_len / 256); /* upper 8 bits */
-    mtu[13] = packet_len - mtu[12] * 256;       /* lower 8 bits */
 
     /* packet is now ready to go */
 
@@ -249,33 +262,7 @@ int ethernet_send(struct BACnet_NPDU *npdu, uint8_t * apdu, int apdu_len)
     //display_packet(npdu);
 //#endif
 
-    /* quick sanity check */
-    if (mtu_len > DEFAULT_MTU) {        /* the maximum number of bytes in one shot */
-        error_printf
-            ("Attempted (and failed) to send a packet larger than %d bytes.\n",
-            DEFAULT_MTU);
-        goto free_packet;
-    }
-    if (mtu_len < 17) {         /* the minimum number of bytes in one shot */
-        error_printf
-            ("Attempted (and failed) to send a packet smaller than 17 bytes.\n");
-        goto free_packet;
-    }
-
-    debug_printf(4, "send_packet: sending to %s\n", hwaddrtoa(&mtu[0]));
-    debug_dump_data(4, mtu, mtu_len);
-    /* Send the packet */
-    bytes =
-        sendto(eth802_sockfd, &mtu, mtu_len, 0,
-        (struct sockaddr *) &eth_addr, sizeof(struct sockaddr));
-
-    /* Now, make sure we sent correctly */
-    if (bytes < 0) {            /* Error has occurred */
-        error_printf("Error sending packet: %s\n", strerror(errno));
-        goto free_packet;
-    }
-    // got this far - must be good!
-    status = 1;
+    status = ethernet_send_mtu(mtu, &mtu[ETHERNET_HEADER_LEN], pdu_len);
 
   free_packet:
 #ifdef SEND_PACKET_DYN_MEM
@@ -285,6 +272,24 @@ int ethernet_send(struct BACnet_NPDU *npdu, uint8_t * apdu, int apdu_len)
     return status;
 }
 
+/* sends a frame that npdu_encode() made earlier - a retry of a */
+/* request - straight from where it is kept, without encoding it again */
+/* returns 1 on success, 0 on failure */
+int ethernet_send_frame(const uint8_t * dest, uint8_t * pdu, int pdu_len)
+{
+    uint8_t header[ETHERNET_HEADER_LEN];
+
+    // don't waste time if the socket is not valid
+    if (eth802_sockfd < 0) {
+        debug_printf(4, "ethernet: 802.2 socket is invalid!\n");
+        return 0;
+    }
+    if (!ethernet_header(header, dest, Ethernet_MAC_Address, pdu_len))
+        return 0;
+
+    return ethernet_send_mtu(header, pdu, pdu_len);
+}
+
 /* receives an 802.2 framed packet */
 int ethernet_receive(int eth802_sockfd)
 {
@@ -0,0 +1,491 @@
+/*
+ * GPIO SPI ADC for BACnet4Linux
+ * Reads the analog inputs from an MCP3008 on the Pi's SPI bus.  Every
+ * channel is converted several times in one burst - a single spidev
+ * message - and the conversions are averaged into a per channel ring,
+ * so the value served is a low noise moving average in engineering
+ * units.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/ioctl.h>
+#include <linux/spi/spidev.h>
+#include "debug.h"
+#include "gpio_adc.h"
+
+// the backend in use - selected once by gpio_adc_init()
+static const struct gpio_adc_ops *Adc_Backend = NULL;
+
+// one handle per channel, so a lookup is just an index
+static struct gpio_adc_channel Channels[GPIO_ADC_CHANNELS];
+
+static struct gpio_adc_stats Adc_Stats;
+
+/* spidev backend */
+
+static int Spi_fd = -1;
+
+static int adc_spidev_open(const char *device)
+{
+    char path[64];
+    uint8_t mode = SPI_MODE_0;
+    uint8_t bits = 8;
+    uint32_t speed = GPIO_ADC_SPEED_HZ;
+
+    if (!device || !device[0])
+        return -1;
+    // accept "spidev0.0" as well as "/dev/spidev0.0"
+    if (device[0] == '/')
+        snprintf(path, sizeof(path), "%s", device);
+    else
+        snprintf(path, sizeof(path), "/dev/%s", device);
+
+    Spi_fd = open(path, O_RDWR | O_CLOEXEC);
+    if (Spi_fd < 0) {
+        debug_printf(1, "ADC: Cannot open %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+    if ((ioctl(Spi_fd, SPI_IOC_WR_MODE, &mode) < 0) ||
+        (ioctl(Spi_fd, SPI_IOC_WR_BITS_PER_WORD, &bits) < 0) ||
+        (ioctl(Spi_fd, SPI_IOC_WR_MAX_SPEED_HZ, &speed) < 0)) {
+        debug_printf(1, "ADC: Cannot configure %s: %s\n", path,
+            strerror(errno));
+        close(Spi_fd);
+        Spi_fd = -1;
+        return -1;
+    }
+    debug_printf(1, "ADC: Opened %s (%u Hz)\n", path, speed);
+
+    return 0;
+}
+
+static void adc_spidev_close(void)
+{
+    if (Spi_fd >= 0) {
+        close(Spi_fd);
+        Spi_fd = -1;
+    }
+}
+
+// one transfer per frame, all sent with a single ioctl
+static int adc_spidev_transfer(const uint8_t * tx, uint8_t * rx, int frames)
+{
+    struct spi_ioc_transfer xfer[GPIO_ADC_MAX_FRAMES];
+    int i;
+
+    if ((Spi_fd < 0) || (frames > GPIO_ADC_MAX_FRAMES))
+        return -1;
+    memset(xfer, 0, sizeof(xfer[0]) * frames);
+    for (i = 0; i < frames; i++) {
+        xfer[i].tx_buf = (uintptr_t) & tx[i * GPIO_ADC_FRAME_SIZE];
+        xfer[i].rx_buf = (uintptr_t) & rx[i * GPIO_ADC_FRAME_SIZE];
+        xfer[i].len = GPIO_ADC_FRAME_SIZE;
+        xfer[i].speed_hz = GPIO_ADC_SPEED_HZ;
+        xfer[i].bits_per_word = 8;
+        // the converter starts a conversion on each falling chip select
+        xfer[i].cs_change = (i < frames - 1);
+    }
+    if (ioctl(Spi_fd, SPI_IOC_MESSAGE(frames), xfer) < 0) {
+        debug_printf(1, "ADC: Transfer failed: %s\n", strerror(errno));
+        return -1;
+    }
+
+    return 0;
+}
+
+const struct gpio_adc_ops gpio_adc_spidev_ops = {
+    "spidev",
+    adc_spidev_open,
+    adc_spidev_close,
+    adc_spidev_transfer
+};
+
+/* simulated MCP3008 */
+
+static int Sim_Count[GPIO_ADC_CHANNELS];
+static int Sim_Noise[GPIO_ADC_CHANNELS];
+static uint32_t Sim_Random = 1;
+static unsigned long Sim_Transfers;
+
+static int adc_sim_open(const char *device)
+{
+    debug_printf(2, "ADC: Simulated converter ready (%d channels)\n",
+        GPIO_ADC_CHANNELS);
+
+    return 0;
+}
+
+static void adc_sim_close(void)
+{
+}
+
+// answers each frame the way the converter does - start bit, then
+// single ended and channel bits, then 10 bits of result
+static int adc_sim_transfer(const uint8_t * tx, uint8_t * rx, int frames)
+{
+    const uint8_t *command;
+    uint8_t *reply;
+    int channel;
+    int count;
+    int i;
+
+    Sim_Transfers++;
+    for (i = 0; i < frames; i++) {
+        command = &tx[i * GPIO_ADC_FRAME_SIZE];
+        reply = &rx[i * GPIO_ADC_FRAME_SIZE];
+        memset(reply, 0, GPIO_ADC_FRAME_SIZE);
+        if (!(command[0] & 0x01) || !(command[1] & 0x80))
+            continue;
+        channel = (command[1] >> 4) & 0x07;
+        count = Sim_Count[channel];
+        if (Sim_Noise[channel]) {
+            Sim_Random = Sim_Random * 1103515245 + 12345;
+            count += (int) ((Sim_Random >> 16) %
+                (2 * Sim_Noise[channel] + 1)) - Sim_Noise[channel];
+        }
+        if (count < 0)
+            count = 0;
+        if (count > GPIO_ADC_FULL_SCALE)
+            count = GPIO_ADC_FULL_SCALE;
+        reply[1] = (count >> 8) & 0x03;
+        reply[2] = count & 0xFF;
+    }
+
+    return 0;
+}
+
+const struct gpio_adc_ops gpio_adc_sim_ops = {
+    "sim",
+    adc_sim_open,
+    adc_sim_close,
+    adc_sim_transfer
+};
+
+static bool adc_sim_valid(int channel)
+{
+    return (channel >= 0) && (channel < GPIO_ADC_CHANNELS);
+}
+
+// sets the count a simulated channel converts to, give or take noise
+void gpio_adc_sim_set(int channel, int count, int noise)
+{
+    if (!adc_sim_valid(channel))
+        return;
+    Sim_Count[channel] = count;
+    Sim_Noise[channel] = (noise > 0) ? noise : 0;
+}
+
+// number of messages that reached the simulated converter
+unsigned long gpio_adc_sim_transfer_count(void)
+{
+    return Sim_Transfers;
+}
+
+void gpio_adc_sim_reset(void)
+{
+    memset(Sim_Count, 0, sizeof(Sim_Count));
+    memset(Sim_Noise, 0, sizeof(Sim_Noise));
+    Sim_Random = 1;
+    Sim_Transfers = 0;
+}
+
+/* front end */
+
+static uint64_t gpio_adc_now(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (uint64_t) now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+// selects and opens the ADC backend
+// the simulated converter is only used when asked for by name - without
+// the SPI device no channel can be requested
+int gpio_adc_init(const char *device)
+{
+    if (Adc_Backend)
+        gpio_adc_cleanup();
+    memset(Channels, 0, sizeof(Channels));
+    memset(&Adc_Stats, 0, sizeof(Adc_Stats));
+
+    if (device && (strcmp(device, "sim") == 0))
+        Adc_Backend = &gpio_adc_sim_ops;
+    else
+        Adc_Backend = &gpio_adc_spidev_ops;
+
+    if (Adc_Backend->open(device) < 0) {
+        error_printf("ADC: Unable to open %s backend on %s\n",
+            Adc_Backend->name, device ? device : "(null)");
+        Adc_Backend = NULL;
+        return -1;
+    }
+    debug_printf(1, "ADC: Using %s backend\n", Adc_Backend->name);
+
+    return 0;
+}
+
+const char *gpio_adc_name(void)
+{
+    return Adc_Backend ? Adc_Backend->name : "none";
+}
+
+// returns the handle for the channel.  Readings are scaled linearly from
+// scale_low at a count of 0 to scale_high at full scale.  oversample is
+// clamped to 1..GPIO_ADC_MAX_OVERSAMPLE, 0 picks the default.
+struct gpio_adc_channel *gpio_adc_request(int channel, int oversample,
+    float scale_low, float scale_high)
+{
+    struct gpio_adc_channel *adc;
+
+    if (!Adc_Backend || (channel < 0) || (channel >= GPIO_ADC_CHANNELS))
+        return NULL;
+
+    if (oversample <= 0)
+        oversample = GPIO_ADC_DEFAULT_OVERSAMPLE;
+    if (oversample > GPIO_ADC_MAX_OVERSAMPLE)
+        oversample = GPIO_ADC_MAX_OVERSAMPLE;
+
+    adc = &Channels[channel];
+    // the ring holds sums of oversample conversions, so sums taken at
+    // another oversample can't be averaged with the new divisor
+    if (!adc->requested || (adc->oversample != oversample)) {
+        adc->ring_head = 0;
+        adc->ring_count = 0;
+        adc->ring_sum = 0;
+    }
+    if (!adc->requested) {
+        adc->requested = true;
+        debug_printf(2, "ADC: Holding channel %d, %d conversions per reading\n",
+            channel, oversample);
+    }
+    adc->channel = channel;
+    adc->oversample = oversample;
+    adc->scale_low = scale_low;
+    adc->scale_high = scale_high;
+
+    return adc;
+}
+
+// adds a reading to the ring, dropping the oldest once it is full
+static void gpio_adc_push(struct gpio_adc_channel *adc, uint16_t reading)
+{
+    if (adc->ring_count == GPIO_ADC_RING_SIZE)
+        adc->ring_sum -= adc->ring[adc->ring_head];
+    else
+        adc->ring_count++;
+    adc->ring[adc->ring_head] = reading;
+    adc->ring_sum += reading;
+    adc->ring_head = (adc->ring_head + 1) & (GPIO_ADC_RING_SIZE - 1);
+}
+
+// converts every held channel oversample times in one burst and adds a
+// reading to each channel's ring.  The conversions of each channel are
+// spread through the burst rather than taken back to back.
+// returns 0 on success, -1 on failure
+int gpio_adc_sample(void)
+{
+    uint8_t tx[GPIO_ADC_MAX_FRAMES * GPIO_ADC_FRAME_SIZE];
+    uint8_t rx[GPIO_ADC_MAX_FRAMES * GPIO_ADC_FRAME_SIZE];
+    uint8_t frame_channel[GPIO_ADC_MAX_FRAMES];
+    uint32_t sums[GPIO_ADC_CHANNELS];
+    uint8_t *frame;
+    uint64_t start_ns;
+    int frames = 0;
+    int round;
+    int i;
+
+    if (!Adc_Backend)
+        return -1;
+
+    for (round = 0; round < GPIO_ADC_MAX_OVERSAMPLE; round++) {
+        for (i = 0; i < GPIO_ADC_CHANNELS; i++) {
+            if (!Channels[i].requested || (Channels[i].oversample <= round))
+                continue;
+            frame = &tx[frames * GPIO_ADC_FRAME_SIZE];
+            frame[0] = 0x01;    /* start bit */
+            frame[1] = 0x80 | (i << 4);         /* single ended, channel */
+            frame[2] = 0x00;
+            frame_channel[frames++] = i;
+        }
+    }
+    if (frames == 0)
+        return 0;
+
+    start_ns = gpio_adc_now();
+    if (Adc_Backend->transfer(tx, rx, frames) < 0) {
+        Adc_Stats.errors++;
+        return -1;
+    }
+    Adc_Stats.burst_duration_ns = gpio_adc_now() - start_ns;
+    Adc_Stats.bursts++;
+    Adc_Stats.conversions += frames;
+
+    memset(sums, 0, sizeof(sums));
+    for (i = 0; i < frames; i++) {
+        frame = &rx[i * GPIO_ADC_FRAME_SIZE];
+        sums[frame_channel[i]] += ((frame[1] & 0x03) << 8) | frame[2];
+    }
+    for (i = 0; i < GPIO_ADC_CHANNELS; i++) {
+        if (!Channels[i].requested)
+            continue;
+        gpio_adc_push(&Channels[i], sums[i]);
+        Channels[i].conversions += Channels[i].oversample;
+    }
+
+    return 0;
+}
+
+// the moving average in counts (0 to GPIO_ADC_FULL_SCALE), with the
+// extra resolution the averaging gives
+float gpio_adc_raw(struct gpio_adc_channel *adc)
+{
+    if (!adc || !adc->requested || !adc->ring_count)
+        return 0.0;
+
+    return (float) adc->ring_sum / (adc->ring_count * adc->oversample);
+}
+
+// the moving average in engineering units
+float gpio_adc_value(struct gpio_adc_channel *adc)
+{
+    if (!adc)
+        return 0.0;
+
+    return adc->scale_low + (adc->scale_high - adc->scale_low) *
+        gpio_adc_raw(adc) / GPIO_ADC_FULL_SCALE;
+}
+
+const struct gpio_adc_stats *gpio_adc_stats(void)
+{
+    return &Adc_Stats;
+}
+
+// releases every channel and closes the converter
+void gpio_adc_cleanup(void)
+{
+    int i;
+
+    if (!Adc_Backend)
+        return;
+    for (i = 0; i < GPIO_ADC_CHANNELS; i++)
+        Channels[i].requested = false;
+    Adc_Backend->close();
+    debug_printf(2, "ADC: Released all channels (%s backend)\n",
+        Adc_Backend->name);
+    Adc_Backend = NULL;
+}
+
+#ifdef TEST
+#include <assert.h>
+#include <math.h>
+
+#include "ctest.h"
+
+void testGpioAdcSim(Test * pTest)
+{
+    struct gpio_adc_channel *adc;
+    struct gpio_adc_channel *adc2;
+    int i;
+
+    // a missing SPI device is a failure, not a converter reading zero
+    ct_test(pTest, gpio_adc_init("/dev/spidev-none") == -1);
+    ct_test(pTest, strcmp(gpio_adc_name(), "none") == 0);
+    ct_test(pTest, gpio_adc_request(0, 4, 0.0, 3.3) == NULL);
+
+    ct_test(pTest, gpio_adc_init("sim") == 0);
+    ct_test(pTest, strcmp(gpio_adc_name(), "sim") == 0);
+    gpio_adc_sim_reset();
+
+    // nothing held - nothing converted
+    ct_test(pTest, gpio_adc_sample() == 0);
+    ct_test(pTest, gpio_adc_sim_transfer_count() == 0);
+
+    gpio_adc_sim_set(0, 512, 0);
+    adc = gpio_adc_request(0, 4, 0.0, 3.3);
+    ct_test(pTest, adc != NULL);
+    ct_test(pTest, adc->oversample == 4);
+    ct_test(pTest, gpio_adc_request(0, 4, 0.0, 3.3) == adc);
+    ct_test(pTest, gpio_adc_raw(adc) == 0.0);
+    ct_test(pTest, gpio_adc_sample() == 0);
+    ct_test(pTest, gpio_adc_raw(adc) == 512.0);
+    ct_test(pTest, fabs(gpio_adc_value(adc) - 3.3 * 512 / 1023) < 0.0001);
+
+    // every held channel is converted in the one burst
+    adc2 = gpio_adc_request(7, 0, -50.0, 280.0);
+    ct_test(pTest, adc2 != NULL);
+    ct_test(pTest, adc2->oversample == GPIO_ADC_DEFAULT_OVERSAMPLE);
+    gpio_adc_sim_set(7, 1023, 0);
+    ct_test(pTest, gpio_adc_sample() == 0);
+    ct_test(pTest, gpio_adc_sim_transfer_count() == 2);
+    ct_test(pTest, gpio_adc_stats()->bursts == 2);
+    ct_test(pTest, gpio_adc_stats()->conversions ==
+        4 + 4 + GPIO_ADC_DEFAULT_OVERSAMPLE);
+    ct_test(pTest, gpio_adc_value(adc2) == 280.0);
+
+    // the ring is a moving average of the last GPIO_ADC_RING_SIZE readings
+    gpio_adc_sim_set(0, 0, 0);
+    for (i = 0; i < GPIO_ADC_RING_SIZE - 2; i++)
+        gpio_adc_sample();
+    ct_test(pTest, gpio_adc_raw(adc) == 512.0 * 2 / GPIO_ADC_RING_SIZE);
+    gpio_adc_sample();
+    gpio_adc_sample();
+    ct_test(pTest, gpio_adc_raw(adc) == 0.0);
+
+    // asking again keeps the ring, unless the oversample changes
+    gpio_adc_sim_set(0, 512, 0);
+    gpio_adc_sample();
+    ct_test(pTest, gpio_adc_request(0, 4, 0.0, 3.3) == adc);
+    ct_test(pTest, gpio_adc_raw(adc) == 512.0 / GPIO_ADC_RING_SIZE);
+    ct_test(pTest, gpio_adc_request(0, 8, 0.0, 3.3) == adc);
+    ct_test(pTest, gpio_adc_raw(adc) == 0.0);
+    gpio_adc_sample();
+    ct_test(pTest, gpio_adc_raw(adc) == 512.0);
+
+    // oversampling and the ring average out the noise
+    adc = gpio_adc_request(3, GPIO_ADC_MAX_OVERSAMPLE, 0.0, 100.0);
+    gpio_adc_sim_set(3, 300, 40);
+    for (i = 0; i < GPIO_ADC_RING_SIZE; i++)
+        gpio_adc_sample();
+    ct_test(pTest, fabs(gpio_adc_raw(adc) - 300.0) < 4.0);
+
+    ct_test(pTest, gpio_adc_request(GPIO_ADC_CHANNELS, 1, 0.0, 1.0) == NULL);
+    ct_test(pTest, gpio_adc_request(1, 99, 0.0, 1.0)->oversample ==
+        GPIO_ADC_MAX_OVERSAMPLE);
+
+    gpio_adc_cleanup();
+    ct_test(pTest, gpio_adc_sample() == -1);
+    ct_test(pTest, gpio_adc_raw(adc) == 0.0);
+
+    return;
+}
+
+#ifdef TEST_GPIO_ADC
+int main(void)
+{
+    Test *pTest;
+    bool rc;
+
+    pTest = ct_create("gpio adc", NULL);
+
+    /* individual tests */
+    rc = ct_addTestFunction(pTest, testGpioAdcSim);
+    assert(rc);
+
+    ct_setStream(pTest, stdout);
+    ct_run(pTest);
+    (void) ct_report(pTest);
+
+    ct_destroy(pTest);
+
+    return 0;
+}
+#endif                          /* TEST_GPIO_ADC */
+#endif                          /* TEST */
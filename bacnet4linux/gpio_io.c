@@ -0,0 +1,386 @@
+/*
+ * GPIO I/O for BACnet4Linux
+ * The pieces the GPIO I/O thread and the protocol loop use to talk to
+ * each other without locks: a single producer, single consumer queue
+ * for output writes, sequence locks for the values and counters the
+ * I/O thread publishes, and wake pipes for select() and poll().
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sched.h>
+#include "gpio_io.h"
+
+void gpio_io_queue_init(struct gpio_io_queue *queue)
+{
+    atomic_init(&queue->head, 0);
+    atomic_init(&queue->tail, 0);
+}
+
+// producer side - returns false if the queue is full
+bool gpio_io_queue_push(struct gpio_io_queue *queue,
+    const struct gpio_io_command *command)
+{
+    unsigned head = atomic_load_explicit(&queue->head, memory_order_relaxed);
+    unsigned tail = atomic_load_explicit(&queue->tail, memory_order_acquire);
+
+    if (head - tail >= GPIO_IO_QUEUE_SIZE)
+        return false;
+    queue->commands[head & (GPIO_IO_QUEUE_SIZE - 1)] = *command;
+    // the command is written before the consumer can see the new head
+    atomic_store_explicit(&queue->head, head + 1, memory_order_release);
+
+    return true;
+}
+
+// consumer side - returns false if the queue is empty
+bool gpio_io_queue_pop(struct gpio_io_queue *queue,
+    struct gpio_io_command *command)
+{
+    unsigned tail = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+    unsigned head = atomic_load_explicit(&queue->head, memory_order_acquire);
+
+    if (head == tail)
+        return false;
+    *command = queue->commands[tail & (GPIO_IO_QUEUE_SIZE - 1)];
+    // the slot is read before the producer can reuse it
+    atomic_store_explicit(&queue->tail, tail + 1, memory_order_release);
+
+    return true;
+}
+
+void gpio_seqlock_init(struct gpio_seqlock *lock)
+{
+    atomic_init(&lock->sequence, 0);
+}
+
+void gpio_seqlock_write_begin(struct gpio_seqlock *lock)
+{
+    unsigned sequence =
+        atomic_load_explicit(&lock->sequence, memory_order_relaxed);
+
+    atomic_store_explicit(&lock->sequence, sequence + 1,
+        memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+}
+
+void gpio_seqlock_write_end(struct gpio_seqlock *lock)
+{
+    unsigned sequence =
+        atomic_load_explicit(&lock->sequence, memory_order_relaxed);
+
+    atomic_store_explicit(&lock->sequence, sequence + 1,
+        memory_order_release);
+}
+
+// waits out a write in progress and returns the sequence to check.
+// Yields rather than spins so a writer preempted mid-write on a single
+// core can finish.
+unsigned gpio_seqlock_read_begin(struct gpio_seqlock *lock)
+{
+    unsigned sequence;
+
+    while ((sequence = atomic_load_explicit(&lock->sequence,
+                memory_order_acquire)) & 1)
+        sched_yield();
+
+    return sequence;
+}
+
+// true if a write happened while the reader was copying
+bool gpio_seqlock_read_retry(struct gpio_seqlock *lock, unsigned start)
+{
+    atomic_thread_fence(memory_order_acquire);
+
+    return atomic_load_explicit(&lock->sequence,
+        memory_order_relaxed) != start;
+}
+
+void gpio_io_input_publish(struct gpio_io_input *input, int level,
+    uint64_t timestamp_ns)
+{
+    gpio_seqlock_write_begin(&input->lock);
+    input->level = level;
+    input->timestamp_ns = timestamp_ns;
+    gpio_seqlock_write_end(&input->lock);
+}
+
+// returns the level, and when it was published if timestamp_ns is given
+int gpio_io_input_read(struct gpio_io_input *input, uint64_t *timestamp_ns)
+{
+    unsigned start;
+    int level;
+    uint64_t when;
+
+    do {
+        start = gpio_seqlock_read_begin(&input->lock);
+        level = input->level;
+        when = input->timestamp_ns;
+    } while (gpio_seqlock_read_retry(&input->lock, start));
+    if (timestamp_ns)
+        *timestamp_ns = when;
+
+    return level;
+}
+
+void gpio_io_analog_publish(struct gpio_io_analog *analog, float value,
+    uint64_t timestamp_ns)
+{
+    gpio_seqlock_write_begin(&analog->lock);
+    analog->value = value;
+    analog->timestamp_ns = timestamp_ns;
+    gpio_seqlock_write_end(&analog->lock);
+}
+
+// returns the value, and when it was published if timestamp_ns is given
+float gpio_io_analog_read(struct gpio_io_analog *analog,
+    uint64_t *timestamp_ns)
+{
+    unsigned start;
+    float value;
+    uint64_t when;
+
+    do {
+        start = gpio_seqlock_read_begin(&analog->lock);
+        value = analog->value;
+        when = analog->timestamp_ns;
+    } while (gpio_seqlock_read_retry(&analog->lock, start));
+    if (timestamp_ns)
+        *timestamp_ns = when;
+
+    return value;
+}
+
+void gpio_io_stats_publish(struct gpio_seqlock *lock,
+    struct gpio_io_stats *published, const struct gpio_io_stats *stats)
+{
+    gpio_seqlock_write_begin(lock);
+    memcpy(published, stats, sizeof(*published));
+    gpio_seqlock_write_end(lock);
+}
+
+void gpio_io_stats_read(struct gpio_seqlock *lock,
+    const struct gpio_io_stats *published, struct gpio_io_stats *stats)
+{
+    unsigned start;
+
+    do {
+        start = gpio_seqlock_read_begin(lock);
+        memcpy(stats, published, sizeof(*stats));
+    } while (gpio_seqlock_read_retry(lock, start));
+}
+
+// both ends are non-blocking - a full pipe already means "wake up"
+int gpio_io_wake_open(int fds[2])
+{
+    if (pipe(fds) < 0) {
+        fds[0] = fds[1] = -1;
+        return -1;
+    }
+    fcntl(fds[0], F_SETFL, fcntl(fds[0], F_GETFL) | O_NONBLOCK);
+    fcntl(fds[1], F_SETFL, fcntl(fds[1], F_GETFL) | O_NONBLOCK);
+
+    return 0;
+}
+
+void gpio_io_wake(int fds[2])
+{
+    char wake = 1;
+
+    if (fds[1] >= 0)
+        (void) write(fds[1], &wake, 1);
+}
+
+void gpio_io_wake_drain(int fds[2])
+{
+    char buffer[64];
+
+    if (fds[0] < 0)
+        return;
+    while (read(fds[0], buffer, sizeof(buffer)) > 0);
+}
+
+void gpio_io_wake_close(int fds[2])
+{
+    if (fds[0] >= 0)
+        close(fds[0]);
+    if (fds[1] >= 0)
+        close(fds[1]);
+    fds[0] = fds[1] = -1;
+}
+
+#ifdef TEST
+#include <assert.h>
+#include <pthread.h>
+#include <poll.h>
+
+#include "ctest.h"
+
+#define TEST_COMMANDS 1000000
+
+static struct gpio_io_queue Test_Queue;
+static struct gpio_io_input Test_Input;
+static atomic_bool Test_Done;
+
+// pushes 0..TEST_COMMANDS-1 in order, spinning while the queue is full
+static void *testQueueProducer(void *arg)
+{
+    struct gpio_io_command command = { NULL, 0.0 };
+    int i;
+
+    for (i = 0; i < TEST_COMMANDS; i++) {
+        command.value = i;
+        while (!gpio_io_queue_push(&Test_Queue, &command))
+            sched_yield();
+    }
+
+    return NULL;
+}
+
+// publishes a level with a timestamp that always matches it
+static void *testSeqlockWriter(void *arg)
+{
+    uint64_t i;
+
+    for (i = 1; !atomic_load(&Test_Done); i++)
+        gpio_io_input_publish(&Test_Input, (int) (i & 0xFFFF), i);
+
+    return NULL;
+}
+
+void testGpioIoQueue(Test * pTest)
+{
+    struct gpio_io_queue queue;
+    struct gpio_io_command command = { NULL, 0.0 };
+    pthread_t producer;
+    bool in_order = true;
+    int i;
+
+    gpio_io_queue_init(&queue);
+    ct_test(pTest, gpio_io_queue_pop(&queue, &command) == false);
+    for (i = 0; i < GPIO_IO_QUEUE_SIZE; i++) {
+        command.value = i;
+        ct_test(pTest, gpio_io_queue_push(&queue, &command));
+    }
+    // full - the oldest command is never overwritten
+    ct_test(pTest, gpio_io_queue_push(&queue, &command) == false);
+    ct_test(pTest, gpio_io_queue_pop(&queue, &command));
+    ct_test(pTest, command.value == 0.0);
+    ct_test(pTest, gpio_io_queue_push(&queue, &command));
+    for (i = 1; i < GPIO_IO_QUEUE_SIZE; i++) {
+        ct_test(pTest, gpio_io_queue_pop(&queue, &command));
+        ct_test(pTest, command.value == i);
+    }
+    ct_test(pTest, gpio_io_queue_pop(&queue, &command));
+    ct_test(pTest, gpio_io_queue_pop(&queue, &command) == false);
+
+    // one thread each side - every command arrives once, in order
+    gpio_io_queue_init(&Test_Queue);
+    pthread_create(&producer, NULL, testQueueProducer, NULL);
+    for (i = 0; i < TEST_COMMANDS; i++) {
+        while (!gpio_io_queue_pop(&Test_Queue, &command))
+            sched_yield();
+        if (command.value != i)
+            in_order = false;
+    }
+    pthread_join(producer, NULL);
+    ct_test(pTest, in_order);
+    ct_test(pTest, gpio_io_queue_pop(&Test_Queue, &command) == false);
+
+    return;
+}
+
+void testGpioIoSeqlock(Test * pTest)
+{
+    struct gpio_seqlock lock;
+    struct gpio_io_stats published, stats;
+    struct gpio_io_analog analog;
+    pthread_t writer;
+    uint64_t timestamp_ns;
+    bool torn = false;
+    int level;
+    int i;
+
+    gpio_seqlock_init(&lock);
+    memset(&published, 0, sizeof(published));
+    stats = published;
+    stats.writes = 5;
+    stats.max_busy_ns = 7;
+    gpio_io_stats_publish(&lock, &published, &stats);
+    memset(&stats, 0, sizeof(stats));
+    gpio_io_stats_read(&lock, &published, &stats);
+    ct_test(pTest, stats.writes == 5);
+    ct_test(pTest, stats.max_busy_ns == 7);
+    ct_test(pTest, (atomic_load(&lock.sequence) & 1) == 0);
+    gpio_seqlock_init(&analog.lock);
+    gpio_io_analog_publish(&analog, 21.5, 42);
+    ct_test(pTest, gpio_io_analog_read(&analog, &timestamp_ns) == 21.5);
+    ct_test(pTest, timestamp_ns == 42);
+
+    // a reader never sees a level from one write and a time from another
+    gpio_seqlock_init(&Test_Input.lock);
+    gpio_io_input_publish(&Test_Input, 0, 0);
+    atomic_store(&Test_Done, false);
+    pthread_create(&writer, NULL, testSeqlockWriter, NULL);
+    for (i = 0; i < TEST_COMMANDS; i++) {
+        level = gpio_io_input_read(&Test_Input, &timestamp_ns);
+        if (level != (int) (timestamp_ns & 0xFFFF))
+            torn = true;
+    }
+    atomic_store(&Test_Done, true);
+    pthread_join(writer, NULL);
+    ct_test(pTest, !torn);
+
+    return;
+}
+
+void testGpioIoWake(Test * pTest)
+{
+    struct pollfd fds;
+    int wake_fds[2];
+    int i;
+
+    ct_test(pTest, gpio_io_wake_open(wake_fds) == 0);
+    fds.fd = wake_fds[0];
+    fds.events = POLLIN;
+    ct_test(pTest, poll(&fds, 1, 0) == 0);
+    // more wakes than the pipe holds must not block
+    for (i = 0; i < 100000; i++)
+        gpio_io_wake(wake_fds);
+    ct_test(pTest, poll(&fds, 1, 0) == 1);
+    gpio_io_wake_drain(wake_fds);
+    ct_test(pTest, poll(&fds, 1, 0) == 0);
+    gpio_io_wake_close(wake_fds);
+    ct_test(pTest, wake_fds[0] == -1);
+
+    return;
+}
+
+#ifdef TEST_GPIO_IO
+int main(void)
+{
+    Test *pTest;
+    bool rc;
+
+    pTest = ct_create("gpio io", NULL);
+
+    /* individual tests */
+    rc = ct_addTestFunction(pTest, testGpioIoQueue);
+    assert(rc);
+    rc = ct_addTestFunction(pTest, testGpioIoSeqlock);
+    assert(rc);
+    rc = ct_addTestFunction(pTest, testGpioIoWake);
+    assert(rc);
+
+    ct_setStream(pTest, stdout);
+    ct_run(pTest);
+    (void) ct_report(pTest);
+
+    ct_destroy(pTest);
+
+    return 0;
+}
+#endif                          /* TEST_GPIO_IO */
+#endif                          /* TEST */
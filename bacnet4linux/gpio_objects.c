@@ -9,6 +9,10 @@
 #include <time.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
 #include "bacnet_api.h"
 #include "bacnet_struct.h"
 #include "bacnet_enum.h"
@@ -20,6 +24,13 @@
 #include "options.h"
 #include "bacnet_text.h"
 #include "debug.h"
+#include "main.h"
+#include "gpio_backend.h"
+#include "gpio_pwm.h"
+#include "gpio_adc.h"
+#include "gpio_debounce.h"
+#include "gpio_pins.h"
+#include "gpio_io.h"
 #include "gpio_objects.h"
 
 // Status flag definitions
@@ -28,38 +39,103 @@
 #define STATUS_FLAG_OVERRIDDEN 2
 #define STATUS_FLAG_OUT_OF_SERVICE 3
 
+// PWM channel for a "pwm" pin that doesn't name one.  Pins without a
+// hardware PWM function (such as GPIO 21 for the fan) are driven through
+// the pwm-gpio overlay, which gives the pin its own pwmchip with a
+// single channel.  Only one "pwm" pin can go without naming its channel -
+// the pin table refuses a second pin on a channel already in use.
+#define DEFAULT_PWM_CHANNEL 0
+
+// Analog input scaling when the configuration doesn't give one - the
+// converter's 0 to 3.3 V range
+#define DEFAULT_ADC_SCALE_LOW 0.0
+#define DEFAULT_ADC_SCALE_HIGH 3.3
+
 // Polarity definitions
 #define POLARITY_NORMAL 0
 #define POLARITY_REVERSE 1
 
-// Priority array support (16 priority levels as per BACnet standard)
-#define BACNET_MAX_PRIORITY 16
-#define BACNET_NO_PRIORITY 0
-
-// Priority array structure for each GPIO object
-struct gpio_priority_array {
-    union ObjectValue values[BACNET_MAX_PRIORITY];
-    uint8_t priorities_set;  // Bitmask of which priorities are set
-    union ObjectValue relinquish_default;
-    uint8_t out_of_service;
+// Objects created when there is no gpio_pin_config.json
+static const struct gpio_default_object {
+    BACNET_OBJECT_TYPE object_type;
+    uint32_t instance;
+    int gpio_pin;
+    const char *name;
+    const char *active_text;
+    const char *inactive_text;
+} gpio_default_objects[] = {
+    { OBJECT_BINARY_OUTPUT, 4018, 18, "Test LED", "ON", "OFF" },
+    { OBJECT_BINARY_INPUT, 3019, 19, "Motion Sensor", "Motion", "No Motion" },
 };
 
-// Global priority arrays for each GPIO object
-static struct gpio_priority_array gpio_priorities[5]; // 5 GPIO objects
+// Binary inputs read by the bulk scan, in scan order
+static struct gpio_pin *scan_pins[GPIO_MAX_LINES];
+static int scan_pin_count = 0;
+static struct gpio_scan *input_scan = NULL;
+
+// Analog inputs read by the ADC bursts, and when the next burst is due
+static struct gpio_pin *adc_pins[GPIO_ADC_CHANNELS];
+static int adc_pin_count = 0;
+static uint64_t next_adc_ns = 0;
+
+// Output commit stage - writes are staged on the pin and driven to the
+// hardware once per main loop pass, and only if the value changed
+static struct gpio_pin *dirty_pins[GPIO_MAX_PINS];
+static int dirty_count = 0;
+static struct gpio_commit_stats commit_stats;
+
+// GPIO I/O thread - once started it owns the line and PWM handles.
+// Output writes reach it through an SPSC queue and the input levels and
+// counters come back as seqlock snapshots, so the protocol loop never
+// waits on the hardware.
+static pthread_t io_thread;
+static bool io_running = false;
+static atomic_bool io_stop;
+static struct gpio_io_queue output_queue;
+static int io_wake_fds[2] = { -1, -1 };        // protocol loop -> I/O thread
+static int protocol_wake_fds[2] = { -1, -1 };  // I/O thread -> protocol loop
+static atomic_bool inputs_changed;
+// counters kept by whoever drives the hardware, and the copy published
+static struct gpio_io_stats io_stats;
+static struct gpio_seqlock io_stats_lock;
+static struct gpio_io_stats io_stats_published;
 
 // Forward declaration for helper function
-static void gpio_write_pin(uint32_t instance, float value);
-static union ObjectValue gpio_get_effective_value(uint32_t instance);
-static int gpio_get_object_index(uint32_t instance);
-static int gpio_read_pin(uint32_t instance);
+static struct gpio_pin *gpio_add_object(int device_id,
+    BACNET_OBJECT_TYPE object_type, uint32_t instance, int gpio_pin,
+    int pwm_channel, const char *name, const char *active_text,
+    const char *inactive_text);
+static void gpio_write_pin(struct gpio_pin *pin, float value);
+static void gpio_stage_output(struct gpio_pin *pin, float value);
+static void gpio_reclaim_lines(void);
+static void gpio_request_outputs(void);
+static void gpio_scan_inputs_init(void);
+static void gpio_scan_inputs(void);
+static void gpio_adc_inputs_init(void);
+static void gpio_sample_analog(void);
+static void gpio_create_adc_objects_from_config(int device_id,
+    const char *json_config);
+static void gpio_objects_start(void);
 
-void gpio_objects_init(int device_id)
+int gpio_objects_init(int device_id)
 {
-    struct ObjectRef_Struct *obj_ptr;
+    bool pwm_ready;
+    int i;
     
     debug_printf(1, "GPIO: Initializing GPIO objects for device %d\n", device_id);
     debug_printf(1, "GPIO: Objects before creation: %d\n", object_count(device_id));
     
+    // Open the GPIO chip once - line handles are held from here on
+    if (gpio_backend_init(GPIO_Chip) < 0) {
+        error_printf("GPIO: No GPIO chip - use -gsim to run on the "
+            "simulated chip\n");
+        return -1;
+    }
+    pwm_ready = (gpio_pwm_init(PWM_Chip) == 0);
+    gpio_adc_init(ADC_Device);
+    // The pin table is rebuilt from the configuration on every start
+    gpio_pins_init();
+    
     // Load configuration from JSON file and create objects dynamically
     FILE *config_file = fopen("gpio_pin_config.json", "r");
     if (config_file != NULL) {
@@ -88,492 +164,76 @@ void gpio_objects_init(int device_id)
     
     debug_printf(1, "GPIO: Objects after creation: %d\n", object_count(device_id));
     
-    // Initialize priority arrays with default values
-    memset(gpio_priorities, 0, sizeof(gpio_priorities));
-    
-    // Set relinquish defaults
-    gpio_priorities[0].relinquish_default.enumerated = 0; // BO 4018 - OFF
-    gpio_priorities[1].relinquish_default.enumerated = 0; // BI 3019 - No motion  
-    gpio_priorities[2].relinquish_default.real = 20.0;    // AI 1020 - 20°C
-    gpio_priorities[3].relinquish_default.real = 0.0;     // AO 2021 - 0%
-    gpio_priorities[4].relinquish_default.enumerated = 0; // BO 4026 - OFF
-    
-    debug_printf(1, "GPIO: Initialization complete for device %d\n", device_id);
-    
-    // Test object lookup immediately after creation
-    obj_ptr = object_find(device_id, OBJECT_BINARY_OUTPUT, 4018);
-    debug_printf(1, "GPIO: Test lookup BO 4018: %s\n", obj_ptr ? "Found" : "NOT FOUND");
-    obj_ptr = object_find(device_id, OBJECT_BINARY_INPUT, 3019);
-    debug_printf(1, "GPIO: Test lookup BI 3019: %s\n", obj_ptr ? "Found" : "NOT FOUND");
-}
-
-void gpio_objects_update_values(int device_id)
-{
-    struct ObjectRef_Struct *obj_ptr;
-    
-    // Update GPIO 20 - Temperature Sensor (simulate reading)
-    if ((obj_ptr = object_find(device_id, OBJECT_ANALOG_INPUT, 1020)) != NULL) {
-        // Simulate temperature reading between 18-25°C
-        float temp = 20.0 + (rand() % 50) / 10.0;
-        obj_ptr->value.real = temp;
-        debug_printf(4, "GPIO: Updated temperature to %.1f°C\n", temp);
-    }
-    
-    // Update GPIO 19 - Motion Sensor (simulate motion detection)
-    if ((obj_ptr = object_find(device_id, OBJECT_BINARY_INPUT, 3019)) != NULL) {
-        // Random motion detection for demo
-        if (rand() % 10 == 0) { // 10% chance of motion
-            obj_ptr->value.enumerated = 1;
-            debug_printf(3, "GPIO: Motion detected\n");
-        } else {
-            obj_ptr->value.enumerated = 0;
+    // Analog outputs are driven by PWM, so they need the pwmchip
+    for (i = 0; !pwm_ready && (i < gpio_pin_count()); i++) {
+        if (gpio_pin_at(i)->object_type == OBJECT_ANALOG_OUTPUT) {
+            error_printf("GPIO: Analog Output %u needs a PWM chip - "
+                "use -Psim to run on simulated PWM\n",
+                gpio_pin_at(i)->instance);
+            gpio_backend_cleanup();
+            return -1;
         }
     }
-}
-
-// GPIO ReadProperty handler - provides essential BACnet properties
-int gpio_handle_read_property(struct BACnet_Device_Address *src, uint8_t invoke_id, 
-                             BACNET_OBJECT_TYPE object_type, uint32_t instance,
-                             BACNET_PROPERTY_ID property, 
-                             uint32_t array_index, uint16_t src_max_apdu) {
     
-    struct ObjectRef_Struct *obj_ptr;
-    uint8_t *apdu;
-    uint16_t apdu_len = 0;
+    // Free any of our lines a previous run or another tool left claimed
+    gpio_reclaim_lines();
     
-    debug_printf(1, "GPIO: ReadProperty request for object type %d instance %u property %d\n",
-        object_type, instance, property);
+    // Request the outputs up front so the first write doesn't pay for it
+    memset(&commit_stats, 0, sizeof(commit_stats));
+    dirty_count = 0;
+    gpio_request_outputs();
     
-    // Find the GPIO object using the existing object system
-    debug_printf(3, "GPIO: Searching for object - device %d, type %d, instance %u\n", 
-        BACnet_Device_Instance, object_type, instance);
-    obj_ptr = object_find(BACnet_Device_Instance, object_type, instance);
-    if (!obj_ptr) {
-        debug_printf(2, "GPIO: Object not found - device %d, type %d instance %u\n", 
-            BACnet_Device_Instance, object_type, instance);
-        debug_printf(2, "GPIO: Total objects in system: %d\n", object_count(BACnet_Device_Instance));
-        return -1; // Object not found
-    }
+    // Hold all the binary inputs in one request for the bulk scan
+    memset(&io_stats, 0, sizeof(io_stats));
+    gpio_seqlock_init(&io_stats_lock);
+    gpio_scan_inputs_init();
+    gpio_adc_inputs_init();
     
-    debug_printf(2, "GPIO: Found object %s, handling property %d\n", 
-        obj_ptr->name ? obj_ptr->name : "unnamed", property);
-    
-    // Handle all standard BACnet properties for GPIO objects
-    switch (property) {
-        case PROP_OBJECT_IDENTIFIER:
-            apdu = pdu_alloc();
-            if (apdu) {
-                apdu[0] = PDU_TYPE_COMPLEX_ACK;
-                apdu[1] = invoke_id;
-                apdu[2] = SERVICE_CONFIRMED_READ_PROPERTY;
-                apdu_len = 3;
-                
-                apdu_len += encode_context_object_id(&apdu[apdu_len], 0, object_type, instance);
-                apdu_len += encode_context_enumerated(&apdu[apdu_len], 1, property);
-                apdu_len += encode_opening_tag(&apdu[apdu_len], 3);
-                apdu_len += encode_tagged_object_id(&apdu[apdu_len], object_type, instance);
-                apdu_len += encode_closing_tag(&apdu[apdu_len], 3);
-                
-                if (apdu_len <= src_max_apdu) {
-                    send_npdu_address(src, &apdu[0], apdu_len);
-                    pdu_free(apdu);
-                    return 0;
-                }
-                pdu_free(apdu);
-            }
-            break;
-            
-        case PROP_OBJECT_NAME:
-            apdu = pdu_alloc();
-            if (apdu) {
-                apdu[0] = PDU_TYPE_COMPLEX_ACK;
-                apdu[1] = invoke_id;
-                apdu[2] = SERVICE_CONFIRMED_READ_PROPERTY;
-                apdu_len = 3;
-                
-                apdu_len += encode_context_object_id(&apdu[apdu_len], 0, object_type, instance);
-                apdu_len += encode_context_enumerated(&apdu[apdu_len], 1, property);
-                apdu_len += encode_opening_tag(&apdu[apdu_len], 3);
-                apdu_len += encode_tagged_character_string(&apdu[apdu_len], 
-                    obj_ptr->name ? obj_ptr->name : "GPIO Object");
-                apdu_len += encode_closing_tag(&apdu[apdu_len], 3);
-                
-                if (apdu_len <= src_max_apdu) {
-                    send_npdu_address(src, &apdu[0], apdu_len);
-                    pdu_free(apdu);
-                    return 0;
-                }
-                pdu_free(apdu);
-            }
-            break;
-            
-        case PROP_OBJECT_TYPE:
-            apdu = pdu_alloc();
-            if (apdu) {
-                apdu[0] = PDU_TYPE_COMPLEX_ACK;
-                apdu[1] = invoke_id;
-                apdu[2] = SERVICE_CONFIRMED_READ_PROPERTY;
-                apdu_len = 3;
-                
-                apdu_len += encode_context_object_id(&apdu[apdu_len], 0, object_type, instance);
-                apdu_len += encode_context_enumerated(&apdu[apdu_len], 1, property);
-                apdu_len += encode_opening_tag(&apdu[apdu_len], 3);
-                apdu_len += encode_tagged_enumerated(&apdu[apdu_len], object_type);
-                apdu_len += encode_closing_tag(&apdu[apdu_len], 3);
-                
-                if (apdu_len <= src_max_apdu) {
-                    send_npdu_address(src, &apdu[0], apdu_len);
-                    pdu_free(apdu);
-                    return 0;
-                }
-                pdu_free(apdu);
-            }
-            break;
-            
-        case PROP_PRESENT_VALUE:
-            apdu = pdu_alloc();
-            if (apdu) {
-                apdu[0] = PDU_TYPE_COMPLEX_ACK;
-                apdu[1] = invoke_id;
-                apdu[2] = SERVICE_CONFIRMED_READ_PROPERTY;
-                apdu_len = 3;
-                
-                apdu_len += encode_context_object_id(&apdu[apdu_len], 0, object_type, instance);
-                apdu_len += encode_context_enumerated(&apdu[apdu_len], 1, property);
-                apdu_len += encode_opening_tag(&apdu[apdu_len], 3);
-                
-                if (object_type == OBJECT_BINARY_INPUT || object_type == OBJECT_BINARY_OUTPUT) {
-                    apdu_len += encode_tagged_enumerated(&apdu[apdu_len], obj_ptr->value.enumerated);
-                } else {
-                    apdu_len += encode_tagged_real(&apdu[apdu_len], obj_ptr->value.real);
-                }
-                
-                apdu_len += encode_closing_tag(&apdu[apdu_len], 3);
-                
-                if (apdu_len <= src_max_apdu) {
-                    send_npdu_address(src, &apdu[0], apdu_len);
-                    pdu_free(apdu);
-                    return 0;
-                }
-                pdu_free(apdu);
-            }
-            break;
-            
-        case PROP_STATUS_FLAGS:
-            apdu = pdu_alloc();
-            if (apdu) {
-                apdu[0] = PDU_TYPE_COMPLEX_ACK;
-                apdu[1] = invoke_id;
-                apdu[2] = SERVICE_CONFIRMED_READ_PROPERTY;
-                apdu_len = 3;
-                
-                apdu_len += encode_context_object_id(&apdu[apdu_len], 0, object_type, instance);
-                apdu_len += encode_context_enumerated(&apdu[apdu_len], 1, property);
-                apdu_len += encode_opening_tag(&apdu[apdu_len], 3);
-                
-                // Status flags bitstring: [in-alarm, fault, overridden, out-of-service]
-                BACNET_BIT_STRING bit_string;
-                bitstring_init(&bit_string);
-                bitstring_set_bit(&bit_string, 0, false); // in-alarm
-                bitstring_set_bit(&bit_string, 1, false); // fault
-                bitstring_set_bit(&bit_string, 2, false); // overridden
-                bitstring_set_bit(&bit_string, 3, false); // out-of-service
-                apdu_len += encode_tagged_bitstring(&apdu[apdu_len], &bit_string);
-                
-                apdu_len += encode_closing_tag(&apdu[apdu_len], 3);
-                
-                if (apdu_len <= src_max_apdu) {
-                    send_npdu_address(src, &apdu[0], apdu_len);
-                    pdu_free(apdu);
-                    return 0;
-                }
-                pdu_free(apdu);
-            }
-            break;
-            
-        case PROP_OUT_OF_SERVICE:
-            apdu = pdu_alloc();
-            if (apdu) {
-                apdu[0] = PDU_TYPE_COMPLEX_ACK;
-                apdu[1] = invoke_id;
-                apdu[2] = SERVICE_CONFIRMED_READ_PROPERTY;
-                apdu_len = 3;
-                
-                apdu_len += encode_context_object_id(&apdu[apdu_len], 0, object_type, instance);
-                apdu_len += encode_context_enumerated(&apdu[apdu_len], 1, property);
-                apdu_len += encode_opening_tag(&apdu[apdu_len], 3);
-                apdu_len += encode_tagged_enumerated(&apdu[apdu_len], 0); // Not out of service
-                apdu_len += encode_closing_tag(&apdu[apdu_len], 3);
-                
-                if (apdu_len <= src_max_apdu) {
-                    send_npdu_address(src, &apdu[0], apdu_len);
-                    pdu_free(apdu);
-                    return 0;
-                }
-                pdu_free(apdu);
-            }
-            break;
-            
-        case PROP_UNITS:
-            apdu = pdu_alloc();
-            if (apdu) {
-                apdu[0] = PDU_TYPE_COMPLEX_ACK;
-                apdu[1] = invoke_id;
-                apdu[2] = SERVICE_CONFIRMED_READ_PROPERTY;
-                apdu_len = 3;
-                
-                apdu_len += encode_context_object_id(&apdu[apdu_len], 0, object_type, instance);
-                apdu_len += encode_context_enumerated(&apdu[apdu_len], 1, property);
-                apdu_len += encode_opening_tag(&apdu[apdu_len], 3);
-                
-                if (object_type == OBJECT_BINARY_INPUT || object_type == OBJECT_BINARY_OUTPUT) {
-                    apdu_len += encode_tagged_enumerated(&apdu[apdu_len], 95); // No units
-                } else {
-                    apdu_len += encode_tagged_enumerated(&apdu[apdu_len], 62); // Degrees Celsius
-                }
-                
-                apdu_len += encode_closing_tag(&apdu[apdu_len], 3);
-                
-                if (apdu_len <= src_max_apdu) {
-                    send_npdu_address(src, &apdu[0], apdu_len);
-                    pdu_free(apdu);
-                    return 0;
-                }
-                pdu_free(apdu);
-            }
-            break;
-            
-        case PROP_ACTIVE_TEXT:
-            if (object_type == OBJECT_BINARY_INPUT || object_type == OBJECT_BINARY_OUTPUT) {
-                apdu = pdu_alloc();
-                if (apdu) {
-                    apdu[0] = PDU_TYPE_COMPLEX_ACK;
-                    apdu[1] = invoke_id;
-                    apdu[2] = SERVICE_CONFIRMED_READ_PROPERTY;
-                    apdu_len = 3;
-                    
-                    apdu_len += encode_context_object_id(&apdu[apdu_len], 0, object_type, instance);
-                    apdu_len += encode_context_enumerated(&apdu[apdu_len], 1, property);
-                    apdu_len += encode_opening_tag(&apdu[apdu_len], 3);
-                    apdu_len += encode_tagged_character_string(&apdu[apdu_len], 
-                        obj_ptr->units.states.active ? obj_ptr->units.states.active : "Active");
-                    apdu_len += encode_closing_tag(&apdu[apdu_len], 3);
-                    
-                    if (apdu_len <= src_max_apdu) {
-                        send_npdu_address(src, &apdu[0], apdu_len);
-                        pdu_free(apdu);
-                        return 0;
-                    }
-                    pdu_free(apdu);
-                }
-            }
-            break;
-            
-        case PROP_INACTIVE_TEXT:
-            if (object_type == OBJECT_BINARY_INPUT || object_type == OBJECT_BINARY_OUTPUT) {
-                apdu = pdu_alloc();
-                if (apdu) {
-                    apdu[0] = PDU_TYPE_COMPLEX_ACK;
-                    apdu[1] = invoke_id;
-                    apdu[2] = SERVICE_CONFIRMED_READ_PROPERTY;
-                    apdu_len = 3;
-                    
-                    apdu_len += encode_context_object_id(&apdu[apdu_len], 0, object_type, instance);
-                    apdu_len += encode_context_enumerated(&apdu[apdu_len], 1, property);
-                    apdu_len += encode_opening_tag(&apdu[apdu_len], 3);
-                    apdu_len += encode_tagged_character_string(&apdu[apdu_len], 
-                        obj_ptr->units.states.inactive ? obj_ptr->units.states.inactive : "Inactive");
-                    apdu_len += encode_closing_tag(&apdu[apdu_len], 3);
-                    
-                    if (apdu_len <= src_max_apdu) {
-                        send_npdu_address(src, &apdu[0], apdu_len);
-                        pdu_free(apdu);
-                        return 0;
-                    }
-                    pdu_free(apdu);
-                }
-            }
-            break;
-        case PROP_PRIORITY_ARRAY:
-            // Handle priority array ONLY for output objects
-            debug_printf(1, "GPIO: Priority array request for object type %d instance %u\n", object_type, instance);
-            if (object_type == OBJECT_BINARY_OUTPUT || object_type == OBJECT_ANALOG_OUTPUT) {
-                apdu = pdu_alloc();
-                if (apdu) {
-                    apdu[0] = PDU_TYPE_COMPLEX_ACK;
-                    apdu[1] = invoke_id;
-                    apdu[2] = SERVICE_CONFIRMED_READ_PROPERTY;
-                    apdu_len = 3;
-                    
-                    apdu_len += encode_context_object_id(&apdu[apdu_len], 0, object_type, instance);
-                    apdu_len += encode_context_enumerated(&apdu[apdu_len], 1, property);
-                    apdu_len += encode_opening_tag(&apdu[apdu_len], 3);
-                    
-                    int obj_index = gpio_get_object_index(instance);
-                    if (obj_index >= 0) {
-                        struct gpio_priority_array *prio = &gpio_priorities[obj_index];
-                        
-                        if (array_index == 0) {
-                            // Return array length (16)
-                            apdu_len += encode_tagged_unsigned(&apdu[apdu_len], BACNET_MAX_PRIORITY);
-                        } else if (array_index >= 1 && array_index <= BACNET_MAX_PRIORITY) {
-                            // Return specific priority value or NULL
-                            int prio_index = array_index - 1;
-                            if (prio->priorities_set & (1 << prio_index)) {
-                                if (object_type == OBJECT_BINARY_OUTPUT) {
-                                    apdu_len += encode_tagged_enumerated(&apdu[apdu_len], 
-                                        prio->values[prio_index].enumerated);
-                                } else {
-                                    apdu_len += encode_tagged_real(&apdu[apdu_len], 
-                                        prio->values[prio_index].real);
-                                }
-                            } else {
-                                // Priority not set - return NULL
-                                apdu[apdu_len++] = 0x00; // BACnet NULL tag
-                            }
-                        } else {
-                            // Invalid array index - return error
-                            pdu_free(apdu);
-                            send_error_address(src, invoke_id, SERVICE_CONFIRMED_READ_PROPERTY,
-                                ERROR_CLASS_PROPERTY, ERROR_CODE_INVALID_ARRAY_INDEX);
-                            return 0;
-                        }
-                    } else {
-                        apdu[apdu_len++] = 0x00; // BACnet NULL tag
-                    }
-                    
-                    apdu_len += encode_closing_tag(&apdu[apdu_len], 3);
-                    
-                    if (apdu_len <= src_max_apdu) {
-                        send_npdu_address(src, &apdu[0], apdu_len);
-                        pdu_free(apdu);
-                        return 0; // Success
-                    }
-                }
-                pdu_free(apdu);
-            }
-            return -1; // Not an output object or failed
-            
-        case PROP_RELINQUISH_DEFAULT:
-            // Handle relinquish-default ONLY for output objects
-            debug_printf(1, "GPIO: Relinquish-default request for object type %d instance %u\n", object_type, instance);
-            if (object_type == OBJECT_BINARY_OUTPUT || object_type == OBJECT_ANALOG_OUTPUT) {
-                apdu = pdu_alloc();
-                if (apdu) {
-                    apdu[0] = PDU_TYPE_COMPLEX_ACK;
-                    apdu[1] = invoke_id;
-                    apdu[2] = SERVICE_CONFIRMED_READ_PROPERTY;
-                    apdu_len = 3;
-                    
-                    apdu_len += encode_context_object_id(&apdu[apdu_len], 0, object_type, instance);
-                    apdu_len += encode_context_enumerated(&apdu[apdu_len], 1, property);
-                    apdu_len += encode_opening_tag(&apdu[apdu_len], 3);
-                    
-                    debug_printf(1, "GPIO: *** RELINQUISH-DEFAULT READ REQUEST ***\n");
-                    debug_printf(1, "GPIO: Reading relinquish-default for %s %u\n", 
-                        object_type == OBJECT_BINARY_OUTPUT ? "Binary Output" : "Analog Output", instance);
-                    
-                    int obj_index = gpio_get_object_index(instance);
-                    debug_printf(1, "GPIO: Object index lookup for instance %u: %d\n", instance, obj_index);
-                    
-                    // Use relinquish_defaults array directly
-                    extern union ObjectValue relinquish_defaults[5];
-                    
-                    if (object_type == OBJECT_BINARY_OUTPUT) {
-                        uint32_t stored_value = 0;
-                        if (instance == 4018) {
-                            stored_value = relinquish_defaults[0].enumerated;
-                        } else if (instance == 4026) {
-                            stored_value = relinquish_defaults[1].enumerated;
-                        }
-                        debug_printf(1, "GPIO: *** FOUND STORED VALUE - Binary Output %u relinquish-default: %u ***\n", 
-                            instance, stored_value);
-                        apdu_len += encode_tagged_enumerated(&apdu[apdu_len], stored_value);
-                    } else if (object_type == OBJECT_ANALOG_OUTPUT) {
-                        float stored_value = relinquish_defaults[2].real;
-                        debug_printf(1, "GPIO: *** FOUND STORED VALUE - Analog Output %u relinquish-default: %.2f ***\n", 
-                            instance, stored_value);
-                        apdu_len += encode_tagged_real(&apdu[apdu_len], stored_value);
-                    } else {
-                        // Use default values for unknown objects (obj_index == -1)
-                        debug_printf(1, "GPIO: *** OBJECT NOT FOUND - Using default for instance %u ***\n", instance);
-                        if (object_type == OBJECT_BINARY_OUTPUT) {
-                            debug_printf(1, "GPIO: *** RETURNING DEFAULT INACTIVE (0) for Binary Output %u ***\n", instance);
-                            apdu_len += encode_tagged_enumerated(&apdu[apdu_len], 0); // INACTIVE
-                        } else {
-                            debug_printf(1, "GPIO: *** RETURNING DEFAULT 0.0 for Analog Output %u ***\n", instance);
-                            apdu_len += encode_tagged_real(&apdu[apdu_len], 0.0); // 0%
-                        }
-                    }
-                    
-                    apdu_len += encode_closing_tag(&apdu[apdu_len], 3);
-                    
-                    if (apdu_len <= src_max_apdu) {
-                        send_npdu_address(src, &apdu[0], apdu_len);
-                        pdu_free(apdu);
-                        return 0;
-                    }
-                    pdu_free(apdu);
-                }
-            }
-            return -1; // Not an output object
-            break;
-        
+    // From here on only the I/O thread touches the hardware
+    gpio_objects_start();
+    
+    debug_printf(1, "GPIO: Initialization complete for device %d - %d pins\n",
+        device_id, gpio_pin_count());
 
-            
-        default:
-            // Send proper BACnet error for unsupported properties
-            debug_printf(1, "GPIO: Unsupported property %d for GPIO object type %d instance %u\n", 
-                property, object_type, instance);
-            send_error_address(src, invoke_id, SERVICE_CONFIRMED_READ_PROPERTY, 
-                ERROR_CLASS_PROPERTY, ERROR_CODE_UNKNOWN_PROPERTY);
-            return 0;
-    }
+    return 0;
+}
+
+// An analog input whose converter channel could not be held has no
+// sensor behind it - its present value is not a reading
+BACNET_RELIABILITY gpio_object_reliability(BACNET_OBJECT_TYPE object_type,
+    uint32_t instance)
+{
+    struct gpio_pin *pin = gpio_pin_find(object_type, instance);
     
-    // If we get here, send a general error
-    send_error_address(src, invoke_id, SERVICE_CONFIRMED_READ_PROPERTY, 
-                      ERROR_CLASS_OBJECT, ERROR_CODE_UNKNOWN_OBJECT);
+    if (pin && (pin->object_type == OBJECT_ANALOG_INPUT) &&
+        (pin->adc_channel >= 0) && (pin->adc == NULL))
+        return RELIABILITY_NO_SENSOR;
     
-    return 0;
+    return RELIABILITY_NO_FAULT_DETECTED;
 }
 
 // Function to encode relinquish-default for read property requests
 int gpio_encode_relinquish_default(uint8_t *apdu, BACNET_OBJECT_TYPE object_type, uint32_t instance)
 {
-    debug_printf(1, "GPIO: *** RELINQUISH-DEFAULT READ REQUEST ***\n");
-    debug_printf(1, "GPIO: Reading relinquish-default for %s %u\n", 
-        (object_type == OBJECT_BINARY_OUTPUT) ? "Binary Output" : "Analog Output", instance);
+    struct gpio_pin *pin = gpio_pin_find(object_type, instance);
+    union ObjectValue stored_value;
     
-    int obj_index = gpio_get_object_index(instance);
-    debug_printf(1, "GPIO: Object index lookup for instance %u: %d\n", instance, obj_index);
+    debug_printf(2, "GPIO: Reading relinquish-default for %s %u\n", 
+        (object_type == OBJECT_BINARY_OUTPUT) ? "Binary Output" : "Analog Output", instance);
     
-    // Use relinquish_defaults array directly instead of gpio_priorities
-    extern union ObjectValue relinquish_defaults[5];
+    if (pin) {
+        stored_value = pin->priority.relinquish_default;
+    } else {
+        // Not one of our outputs - INACTIVE or 0%
+        debug_printf(1, "GPIO: No pin for %s %u, using default relinquish-default\n",
+            (object_type == OBJECT_BINARY_OUTPUT) ? "Binary Output" : "Analog Output", instance);
+        memset(&stored_value, 0, sizeof(stored_value));
+    }
     
     if (object_type == OBJECT_BINARY_OUTPUT) {
-        uint32_t stored_value = 0;
-        if (instance == 4018) {
-            stored_value = relinquish_defaults[0].enumerated;
-        } else if (instance == 4026) {
-            stored_value = relinquish_defaults[1].enumerated;
-        }
-        debug_printf(1, "GPIO: *** FOUND STORED VALUE - Binary Output %u relinquish-default: %u ***\n", 
-            instance, stored_value);
-        return encode_tagged_enumerated(&apdu[0], stored_value);
-    } else if (object_type == OBJECT_ANALOG_OUTPUT) {
-        float stored_value = relinquish_defaults[2].real;
-        debug_printf(1, "GPIO: *** FOUND STORED VALUE - Analog Output %u relinquish-default: %.2f ***\n", 
-            instance, stored_value);
-        return encode_tagged_real(&apdu[0], stored_value);
+        return encode_tagged_enumerated(&apdu[0], stored_value.enumerated);
     } else {
-        debug_printf(1, "GPIO: *** OBJECT NOT FOUND - Using default for instance %u ***\n", instance);
-        if (object_type == OBJECT_BINARY_OUTPUT) {
-            debug_printf(1, "GPIO: *** RETURNING DEFAULT INACTIVE (0) for Binary Output %u ***\n", instance);
-            return encode_tagged_enumerated(&apdu[0], 0); // INACTIVE
-        } else {
-            debug_printf(1, "GPIO: *** RETURNING DEFAULT 0.0 for Analog Output %u ***\n", instance);
-            return encode_tagged_real(&apdu[0], 0.0); // 0%
-        }
+        return encode_tagged_real(&apdu[0], stored_value.real);
     }
 }
 
@@ -582,6 +242,7 @@ int gpio_objects_write_property(int object_type,
     uint8_t tag, void *value, uint8_t priority)
 {
     struct ObjectRef_Struct *obj_ptr;
+    struct gpio_pin *pin;
     
     debug_printf(2, "GPIO: WriteProperty request for object type %d instance %u property %d priority %u\n",
         object_type, instance, property, priority);
@@ -595,9 +256,11 @@ int gpio_objects_write_property(int object_type,
             BACnet_Device_Instance, object_type, instance);
         return -2; // Object not found
     }
+    // The pin behind the object, NULL if it isn't one of ours
+    pin = gpio_pin_find(object_type, instance);
     
     debug_printf(2, "GPIO: Found object %s, writing property %d\n", 
-        obj_ptr->name ? obj_ptr->name : "unnamed", property);
+        object_name(obj_ptr) ? object_name(obj_ptr) : "unnamed", property);
     
     // Handle present-value property (the main writable property)
     if (property == PROP_PRESENT_VALUE) {
@@ -610,7 +273,7 @@ int gpio_objects_write_property(int object_type,
                 obj_ptr->value.enumerated = (enum_value != 0) ? 1 : 0;
                 
                 // Update the actual GPIO pin
-                gpio_write_pin(instance, obj_ptr->value.enumerated);
+                gpio_stage_output(pin, obj_ptr->value.enumerated);
                 
                 debug_printf(2, "GPIO: Set Binary Output %u to %s\n", 
                     instance, obj_ptr->value.enumerated ? "ACTIVE" : "INACTIVE");
@@ -629,7 +292,7 @@ int gpio_objects_write_property(int object_type,
                 obj_ptr->value.real = real_value;
                 
                 // Update the actual GPIO pin (PWM or DAC)
-                gpio_write_pin(instance, real_value);
+                gpio_stage_output(pin, real_value);
                 
                 debug_printf(2, "GPIO: Set Analog Output %u to %.2f\n", 
                     instance, real_value);
@@ -647,9 +310,8 @@ int gpio_objects_write_property(int object_type,
     } else if (property == PROP_RELINQUISH_DEFAULT) {
         // Handle relinquish-default property writes for output objects
         if (object_type == OBJECT_BINARY_OUTPUT || object_type == OBJECT_ANALOG_OUTPUT) {
-            int obj_index = gpio_get_object_index(instance);
-            if (obj_index >= 0) {
-                struct gpio_priority_array *prio = &gpio_priorities[obj_index];
+            if (pin) {
+                struct gpio_priority_array *prio = &pin->priority;
                 
                 if (object_type == OBJECT_BINARY_OUTPUT) {
                     if (tag == BACNET_APPLICATION_TAG_ENUMERATED) {
@@ -660,9 +322,9 @@ int gpio_objects_write_property(int object_type,
                             instance, prio->relinquish_default.enumerated ? "ACTIVE" : "INACTIVE");
                         
                         // Recalculate effective value and update GPIO
-                        union ObjectValue effective = gpio_get_effective_value(instance);
+                        union ObjectValue effective = gpio_pin_effective_value(pin);
                         obj_ptr->value = effective;
-                        gpio_write_pin(instance, effective.enumerated);
+                        gpio_stage_output(pin, effective.enumerated);
                         
                         return 0;
                     } else {
@@ -678,9 +340,9 @@ int gpio_objects_write_property(int object_type,
                             instance, real_value);
                         
                         // Recalculate effective value and update GPIO
-                        union ObjectValue effective = gpio_get_effective_value(instance);
+                        union ObjectValue effective = gpio_pin_effective_value(pin);
                         obj_ptr->value = effective;
-                        gpio_write_pin(instance, effective.real);
+                        gpio_stage_output(pin, effective.real);
                         
                         return 0;
                     } else {
@@ -706,290 +368,740 @@ int gpio_objects_write_property(int object_type,
     return 0; // Default success return
 }
 
-// Helper function to write to actual GPIO pin
-static void gpio_write_pin(uint32_t instance, float value)
+// Stage a new effective value for an output.  Several writes to the
+// same output before the next commit collapse into the last one.
+static void gpio_stage_output(struct gpio_pin *pin, float value)
 {
-    // Map BACnet instance to GPIO pin number
-    int gpio_pin = -1;
-    
-    switch (instance) {
-        case 4018: gpio_pin = 18; break;  // Test LED
-        case 4026: gpio_pin = 26; break;  // Main Relay
-        case 2021: gpio_pin = 21; break;  // Fan Control (PWM)
-        default:
-            debug_printf(1, "GPIO: Unknown instance %u for write\n", instance);
-            return;
+    if (!gpio_pin_is_output(pin)) {
+        debug_printf(1, "GPIO: No output pin for write\n");
+        return;
     }
     
-    debug_printf(1, "GPIO: Writing value %.2f to pin %d (Raspberry Pi 5 compatible)\n", value, gpio_pin);
+    commit_stats.staged++;
+    if (pin->dirty) {
+        commit_stats.coalesced++;
+        debug_printf(3, "GPIO: Output %u write %.2f replaces staged %.2f\n",
+            pin->instance, value, pin->pending);
+    } else {
+        dirty_pins[dirty_count++] = pin;
+    }
+    pin->pending = value;
+    pin->dirty = true;
+}
+
+// Pass the staged outputs on to the hardware - called once per pass of
+// the main loop.  Outputs already at the staged value are not touched.
+// With the I/O thread running this only queues the writes, so it never
+// waits on the hardware.
+void gpio_commit_outputs(void)
+{
+    struct gpio_io_command command;
+    struct gpio_pin *pin;
+    bool queued = false;
+    int deferred = 0;
+    int i;
     
-    // For binary outputs, write digital value
-    if (instance == 4018 || instance == 4026) {
-        int digital_value = (value != 0.0) ? 1 : 0;
-        
-        debug_printf(1, "GPIO: Setting pin %d to %s for Raspberry Pi 5\n", 
-            gpio_pin, digital_value ? "HIGH" : "LOW");
-        
-        // Method 1: Try libgpiod (preferred for Pi 5)
-        char cmd[512];
-        snprintf(cmd, sizeof(cmd), "gpioset gpiochip4 %d=%d 2>&1", gpio_pin, digital_value);
-        debug_printf(1, "GPIO: Trying libgpiod command: %s\n", cmd);
-        int result = system(cmd);
-        
-        if (result == 0) {
-            debug_printf(1, "GPIO: *** SUCCESS (libgpiod) *** Pin %d set to %s (%.1fV)\n", 
-                gpio_pin, digital_value ? "HIGH" : "LOW", digital_value ? 3.3 : 0.0);
-            return;
+    // only the pins written since the last pass are visited
+    for (i = 0; i < dirty_count; i++) {
+        pin = dirty_pins[i];
+        if (pin->committed_valid && (pin->pending == pin->committed)) {
+            pin->dirty = false;
+            commit_stats.unchanged++;
+            debug_printf(3, "GPIO: Output %u already at %.2f, not written\n",
+                pin->instance, pin->pending);
+            continue;
         }
-        
-        debug_printf(1, "GPIO: libgpiod failed with exit code %d, trying gpiozero\n", result);
-        
-        // Method 2: Python gpiozero fallback with detailed error logging
-        snprintf(cmd, sizeof(cmd), 
-            "timeout 3 python3 -c \"try:\n  from gpiozero import LED\n  import time\n  led=LED(%d)\n  led.%s()\n  time.sleep(0.1)\n  print('GPIO_%d_SUCCESS')\nexcept Exception as e:\n  print(f'GPIO_%d_ERROR: {e}')\n\" 2>&1", 
-            gpio_pin, digital_value ? "on" : "off", gpio_pin, gpio_pin);
-        debug_printf(1, "GPIO: Trying gpiozero command for pin %d\n", gpio_pin);
-        
-        FILE *fp = popen(cmd, "r");
-        if (fp != NULL) {
-            char output[256];
-            if (fgets(output, sizeof(output), fp) != NULL) {
-                // Remove newline
-                output[strcspn(output, "\n")] = 0;
-                debug_printf(1, "GPIO: Python output: %s\n", output);
-                
-                if (strstr(output, "GPIO_SUCCESS") != NULL) {
-                    debug_printf(1, "GPIO: *** SUCCESS (gpiozero) *** Pin %d set to %s\n", 
-                        gpio_pin, digital_value ? "HIGH" : "LOW");
-                    pclose(fp);
-                    return;
-                }
+        if (io_running) {
+            command.pin = pin;
+            command.value = pin->pending;
+            if (!gpio_io_queue_push(&output_queue, &command)) {
+                // the I/O thread is behind - try again next pass
+                commit_stats.deferred++;
+                dirty_pins[deferred++] = pin;
+                continue;
             }
-            pclose(fp);
+            queued = true;
+        } else {
+            gpio_write_pin(pin, pin->pending);
         }
+        pin->dirty = false;
+        pin->committed = pin->pending;
+        pin->committed_valid = true;
+        commit_stats.committed++;
+    }
+    dirty_count = deferred;
+    
+    if (queued)
+        gpio_io_wake(io_wake_fds);
+    else if (!io_running)
+        gpio_io_stats_publish(&io_stats_lock, &io_stats_published, &io_stats);
+}
+
+const struct gpio_commit_stats *gpio_objects_commit_stats(void)
+{
+    return &commit_stats;
+}
+
+// A copy of the hardware counters, safe to take while the I/O thread runs
+void gpio_objects_io_stats(struct gpio_io_stats *stats)
+{
+    gpio_io_stats_read(&io_stats_lock, &io_stats_published, stats);
+}
+
+// true if the hardware is driven from the I/O thread
+bool gpio_objects_io_thread(void)
+{
+    return io_running;
+}
+
+// Helper function to write to actual GPIO pin
+static void gpio_write_pin(struct gpio_pin *pin, float value)
+{
+    debug_printf(2, "GPIO: Writing value %.2f to pin %d\n", value, pin->gpio_pin);
+    
+    // For binary outputs, write digital value
+    if (pin->object_type == OBJECT_BINARY_OUTPUT) {
+        int digital_value = (value != 0.0) ? 1 : 0;
         
-        debug_printf(1, "GPIO: gpiozero failed, trying sysfs\n");
-        
-        // Method 3: Traditional sysfs (may not work on Pi 5)
-        
-        // Write to actual GPIO pin
-        char gpio_path[64];
-        char value_str[8];
-        int fd;
-        
-        // Export GPIO pin if not already exported
-        snprintf(gpio_path, sizeof(gpio_path), "/sys/class/gpio/gpio%d", gpio_pin);
-        if (access(gpio_path, F_OK) != 0) {
-            fd = open("/sys/class/gpio/export", O_WRONLY);
-            if (fd >= 0) {
-                snprintf(value_str, sizeof(value_str), "%d", gpio_pin);
-                write(fd, value_str, strlen(value_str));
-                close(fd);
-                usleep(100000); // Wait 100ms for export
-            }
+        // The line is requested once and the handle is held, so this is
+        // a single ioctl rather than a process per write
+        if (pin->line && (gpio_backend_set(pin->line, digital_value) == 0)) {
+            io_stats.writes++;
+            debug_printf(2, "GPIO: Pin %d set to %s (%.1fV)\n", 
+                pin->gpio_pin, digital_value ? "HIGH" : "LOW", digital_value ? 3.3 : 0.0);
+        } else {
+            io_stats.write_errors++;
+            debug_printf(1, "GPIO: ERROR: Write failed for pin %d\n", pin->gpio_pin);
         }
         
-        // Set pin direction to output
-        snprintf(gpio_path, sizeof(gpio_path), "/sys/class/gpio/gpio%d/direction", gpio_pin);
-        fd = open(gpio_path, O_WRONLY);
-        if (fd >= 0) {
-            write(fd, "out", 3);
-            close(fd);
+    } else if (pin->object_type == OBJECT_ANALOG_OUTPUT) {
+        // For analog outputs, write PWM duty (0-100%).  The channel fd
+        // is held open and the duty is only written when it changes.
+        if (pin->pwm && (gpio_pwm_set_percent(pin->pwm, value) == 0)) {
+            io_stats.writes++;
+            debug_printf(2, "GPIO: PWM pin %d duty %lu of %lu ns (%.1f%%)\n", 
+                pin->gpio_pin, pin->pwm->duty_ns, pin->pwm->period_ns, value);
+        } else {
+            io_stats.write_errors++;
+            debug_printf(1, "GPIO: ERROR: PWM write failed for pin %d\n", pin->gpio_pin);
         }
-        
-        // Write the value
-        snprintf(gpio_path, sizeof(gpio_path), "/sys/class/gpio/gpio%d/value", gpio_pin);
-        fd = open(gpio_path, O_WRONLY);
-        if (fd >= 0) {
-            snprintf(value_str, sizeof(value_str), "%d", digital_value);
-            ssize_t bytes_written = write(fd, value_str, strlen(value_str));
-            close(fd);
-            
-            if (bytes_written > 0) {
-                debug_printf(1, "GPIO: *** SUCCESS *** Pin %d set to %s (%.1fV)\n", 
-                    gpio_pin, digital_value ? "HIGH" : "LOW", digital_value ? 3.3 : 0.0);
-            } else {
-                debug_printf(1, "GPIO: ERROR: Write failed for pin %d\n", gpio_pin);
-            }
+    }
+}
+
+// Release the configured lines from whoever still has them exported,
+// in place of running the RPi.GPIO and gpiozero cleanups
+static void gpio_reclaim_lines(void)
+{
+    int offsets[GPIO_MAX_PINS];
+    int num_lines = 0;
+    int reclaimed;
+    int i;
+    
+    for (i = 0; i < gpio_pin_count(); i++) {
+        if (gpio_pin_at(i)->gpio_pin >= 0)
+            offsets[num_lines++] = gpio_pin_at(i)->gpio_pin;
+    }
+    reclaimed = gpio_backend_reclaim(offsets, num_lines);
+    if (reclaimed > 0)
+        debug_printf(1, "GPIO: Reclaimed %d stale lines\n", reclaimed);
+}
+
+// Request every output line and PWM channel in the pin table.  They are
+// requested at 0, so that is what is committed.
+static void gpio_request_outputs(void)
+{
+    struct gpio_pin *pin;
+    int i;
+    
+    for (i = 0; i < gpio_pin_count(); i++) {
+        pin = gpio_pin_at(i);
+        if (pin->object_type == OBJECT_BINARY_OUTPUT) {
+            pin->line = gpio_backend_request(pin->gpio_pin,
+                GPIO_DIRECTION_OUTPUT, 0);
+            pin->committed_valid = (pin->line != NULL);
+        } else if (pin->object_type == OBJECT_ANALOG_OUTPUT) {
+            pin->pwm = gpio_pwm_request(pin->pwm_channel, GPIO_PWM_PERIOD_NS);
+            pin->committed_valid = (pin->pwm != NULL);
         } else {
-            debug_printf(1, "GPIO: ERROR: Cannot open %s for writing\n", gpio_path);
-            
-            // Try alternative method using system commands
-            char cmd[128];
-            snprintf(cmd, sizeof(cmd), "echo %d > /sys/class/gpio/gpio%d/value 2>/dev/null", 
-                digital_value, gpio_pin);
-            int result = system(cmd);
-            if (result == 0) {
-                debug_printf(1, "GPIO: *** SUCCESS (fallback) *** Pin %d set to %s\n", 
-                    gpio_pin, digital_value ? "HIGH" : "LOW");
-            } else {
-                debug_printf(1, "GPIO: ERROR: All methods failed for pin %d\n", gpio_pin);
-            }
+            continue;
         }
-        
-    } else if (instance == 2021) {
-        // For analog outputs, write PWM value (0-100%)
-        int pwm_value = (int)(value * 255.0 / 100.0); // Convert percentage to 0-255
-        if (pwm_value > 255) pwm_value = 255;
-        if (pwm_value < 0) pwm_value = 0;
-        
-        debug_printf(2, "GPIO: Would set PWM pin %d to %d (%.1f%%)\n", 
-            gpio_pin, pwm_value, value);
-            
-        // TODO: Add actual PWM write
-        // Setup PWM and set duty cycle
+        pin->committed = 0.0;
+        if (!pin->committed_valid) {
+            debug_printf(1, "GPIO: Output %u could not be requested\n",
+                pin->instance);
+        }
+    }
+}
+
+// Copy the level of an input to its object - protocol loop side
+static void gpio_apply_input(struct gpio_pin *pin, int new_value)
+{
+    if (pin->obj_ptr == NULL)
+        return;
+    
+    // Convert 0/1 to BACnet enumerated values (0=INACTIVE, 1=ACTIVE)
+    if (pin->obj_ptr->value.enumerated != new_value) {
+        debug_printf(1, "GPIO: Binary Input %u changed: %s -> %s (GPIO pin %d = %s)\n",
+            pin->instance,
+            pin->obj_ptr->value.enumerated ? "ACTIVE" : "INACTIVE",
+            new_value ? "ACTIVE" : "INACTIVE",
+            pin->gpio_pin, new_value ? "HIGH" : "LOW");
+        pin->obj_ptr->value.enumerated = new_value;
+    }
+}
+
+// Copy the averaged value of an analog input to its object
+static void gpio_apply_analog(struct gpio_pin *pin, float value)
+{
+    if (pin->obj_ptr == NULL)
+        return;
+    
+    if (pin->obj_ptr->value.real != value) {
+        debug_printf(4, "GPIO: Analog Input %u = %.3f (ADC channel %d)\n",
+            pin->instance, value, pin->adc_channel);
+        pin->obj_ptr->value.real = value;
+    }
+}
+
+// Copy the levels and values the I/O thread published to the objects
+static void gpio_apply_inputs(void)
+{
+    int i;
+    
+    if (!atomic_exchange(&inputs_changed, false))
+        return;
+    
+    for (i = 0; i < scan_pin_count; i++)
+        gpio_apply_input(scan_pins[i], gpio_io_input_read(&scan_pins[i]->input, NULL));
+    for (i = 0; i < adc_pin_count; i++)
+        gpio_apply_analog(adc_pins[i], gpio_io_analog_read(&adc_pins[i]->analog, NULL));
+}
+
+// Publish the filtered level of an input - hardware side.  With the I/O
+// thread running the level goes out as a snapshot and the protocol loop
+// is woken to pick it up.
+static void gpio_publish_input(struct gpio_pin *pin)
+{
+    if (!io_running) {
+        gpio_apply_input(pin, pin->filter.published);
+        return;
     }
+    
+    gpio_io_input_publish(&pin->input, pin->filter.published,
+        gpio_debounce_now());
+    atomic_store(&inputs_changed, true);
+    gpio_io_wake(protocol_wake_fds);
 }
 
-// Helper function to read GPIO pin value
-static int gpio_read_pin(uint32_t instance)
+// Publish the inputs that have now been stable for their debounce time
+static void gpio_expire_inputs(uint64_t now_ns)
 {
-    // Map BACnet instance to GPIO pin number
-    int gpio_pin = -1;
-    
-    switch (instance) {
-        case 3019: gpio_pin = 19; break;  // Motion Sensor
-        case 1020: gpio_pin = 20; break;  // Temperature Sensor (if real GPIO)
-        default:
-            debug_printf(1, "GPIO: Unknown input instance %u for read\n", instance);
-            return 0;
+    int i;
+    
+    for (i = 0; i < scan_pin_count; i++) {
+        if (gpio_debounce_expire(&scan_pins[i]->filter, now_ns))
+            gpio_publish_input(scan_pins[i]);
     }
+}
+
+// When the next debounced input is due, 0 if none is pending
+static uint64_t gpio_inputs_deadline(void)
+{
+    uint64_t deadline = 0;
+    uint64_t input_deadline;
+    int i;
     
-    debug_printf(2, "GPIO: Reading GPIO pin %d for instance %u\n", gpio_pin, instance);
-    
-    // Method 1: Try libgpiod (preferred for Pi 5)
-    char cmd[256];
-    snprintf(cmd, sizeof(cmd), "gpioget gpiochip4 %d 2>/dev/null", gpio_pin);
-    
-    FILE *fp = popen(cmd, "r");
-    if (fp != NULL) {
-        char output[16];
-        if (fgets(output, sizeof(output), fp) != NULL) {
-            int value = atoi(output);
-            pclose(fp);
-            debug_printf(2, "GPIO: libgpiod read pin %d as %s\n", 
-                gpio_pin, value ? "HIGH" : "LOW");
-            return value;
+    for (i = 0; i < scan_pin_count; i++) {
+        input_deadline = gpio_debounce_deadline(&scan_pins[i]->filter);
+        if (input_deadline && (!deadline || (input_deadline < deadline)))
+            deadline = input_deadline;
+    }
+    
+    return deadline;
+}
+
+// Sum of the changes the debounce filters dropped as glitches
+static unsigned long gpio_inputs_glitches(void)
+{
+    unsigned long glitches = 0;
+    int i;
+    
+    for (i = 0; i < scan_pin_count; i++)
+        glitches += scan_pins[i]->filter.glitches;
+    
+    return glitches;
+}
+
+// Request every binary input line in one go and take the first reading
+static void gpio_scan_inputs_init(void)
+{
+    struct gpio_pin *pin;
+    int offsets[GPIO_MAX_LINES];
+    int i;
+    
+    input_scan = NULL;
+    scan_pin_count = 0;
+    for (i = 0; i < gpio_pin_count(); i++) {
+        pin = gpio_pin_at(i);
+        if ((pin->object_type != OBJECT_BINARY_INPUT) || (pin->gpio_pin < 0) ||
+            (scan_pin_count >= GPIO_MAX_LINES))
+            continue;
+        pin->scan_index = scan_pin_count;
+        offsets[scan_pin_count] = pin->gpio_pin;
+        scan_pins[scan_pin_count++] = pin;
+    }
+    if (scan_pin_count == 0)
+        return;
+    
+    input_scan = gpio_backend_scan_request(offsets, scan_pin_count);
+    if (input_scan == NULL) {
+        debug_printf(1, "GPIO: Bulk scan unavailable, reading %d inputs one at a time\n",
+            scan_pin_count);
+    }
+    
+    gpio_scan_inputs();
+    // the level at startup is taken as settled
+    for (i = 0; i < scan_pin_count; i++) {
+        scan_pins[i]->filter.published = scan_pins[i]->filter.candidate;
+        scan_pins[i]->filter.pending = false;
+        gpio_io_input_publish(&scan_pins[i]->input,
+            scan_pins[i]->filter.published, gpio_debounce_now());
+        gpio_apply_input(scan_pins[i], scan_pins[i]->filter.published);
+    }
+}
+
+// Read all the binary inputs with one bulk request and feed the levels
+// through the debounce filters in a single pass over the results
+static void gpio_scan_inputs(void)
+{
+    struct gpio_pin *pin;
+    uint64_t now_ns;
+    int new_value;
+    int i;
+    
+    if (input_scan) {
+        if (gpio_backend_scan(input_scan) < 0) {
+            debug_printf(1, "GPIO: Input scan failed\n");
+            return;
         }
-        pclose(fp);
+        io_stats.scans = input_scan->count;
+        io_stats.scan_duration_ns = input_scan->duration_ns;
+        debug_printf(4, "GPIO: Scanned %d inputs in %lu ns\n",
+            input_scan->num_lines, (unsigned long) input_scan->duration_ns);
     }
     
-    debug_printf(2, "GPIO: libgpiod failed, trying Python\n");
-    
-    // Method 2: Try Python GPIO reading
-    snprintf(cmd, sizeof(cmd), 
-        "python3 -c \"try:\n  import RPi.GPIO as GPIO\n  GPIO.setmode(GPIO.BCM)\n  GPIO.setup(%d, GPIO.IN)\n  val=GPIO.input(%d)\n  GPIO.cleanup(%d)\n  print(val)\nexcept Exception as e:\n  print('0')\" 2>/dev/null", 
-        gpio_pin, gpio_pin, gpio_pin);
-    
-    fp = popen(cmd, "r");
-    if (fp != NULL) {
-        char output[16];
-        if (fgets(output, sizeof(output), fp) != NULL) {
-            int value = atoi(output);
-            pclose(fp);
-            debug_printf(2, "GPIO: Python read pin %d as %s\n", 
-                gpio_pin, value ? "HIGH" : "LOW");
-            return value;
+    now_ns = gpio_debounce_now();
+    for (i = 0; i < scan_pin_count; i++) {
+        pin = scan_pins[i];
+        if (input_scan) {
+            new_value = input_scan->lines[i]->value;
+        } else {
+            // no bulk request - fall back to one read per pin
+            if (pin->line == NULL)
+                pin->line = gpio_backend_request(pin->gpio_pin, GPIO_DIRECTION_INPUT, 0);
+            new_value = gpio_backend_get(pin->line);
+            if (new_value < 0)
+                new_value = 0; // Default to LOW if the read fails
         }
-        pclose(fp);
+        // a level that differs from the last edge is treated as an edge
+        // seen now, so polled inputs are debounced the same way
+        if (gpio_debounce_sample(&pin->filter, new_value, now_ns))
+            gpio_publish_input(pin);
     }
+}
+
+// Collect the analog inputs that hold an ADC channel and take the first
+// burst, so they have a value before the first I-Am goes out.  The ring
+// averages in later bursts as they come.
+static void gpio_adc_inputs_init(void)
+{
+    struct gpio_pin *pin;
+    int i;
     
-    debug_printf(2, "GPIO: Python failed, trying sysfs\n");
-    
-    // Method 3: Try sysfs (fallback)
-    char gpio_path[64];
-    snprintf(gpio_path, sizeof(gpio_path), "/sys/class/gpio/gpio%d/value", gpio_pin);
-    
-    FILE *value_file = fopen(gpio_path, "r");
-    if (value_file != NULL) {
-        char value_str[8];
-        if (fgets(value_str, sizeof(value_str), value_file) != NULL) {
-            int value = atoi(value_str);
-            fclose(value_file);
-            debug_printf(2, "GPIO: sysfs read pin %d as %s\n", 
-                gpio_pin, value ? "HIGH" : "LOW");
-            return value;
+    adc_pin_count = 0;
+    for (i = 0; i < gpio_pin_count(); i++) {
+        pin = gpio_pin_at(i);
+        if ((pin->object_type == OBJECT_ANALOG_INPUT) && pin->adc &&
+            (adc_pin_count < GPIO_ADC_CHANNELS))
+            adc_pins[adc_pin_count++] = pin;
+    }
+    
+    gpio_sample_analog();
+    for (i = 0; i < adc_pin_count; i++) {
+        gpio_seqlock_init(&adc_pins[i]->analog.lock);
+        gpio_io_analog_publish(&adc_pins[i]->analog,
+            gpio_adc_value(adc_pins[i]->adc), gpio_debounce_now());
+    }
+    if (adc_pin_count) {
+        debug_printf(1, "GPIO: %d analog inputs on the %s ADC, %lu ns per burst\n",
+            adc_pin_count, gpio_adc_name(),
+            (unsigned long) gpio_adc_stats()->burst_duration_ns);
+    }
+}
+
+// Run one ADC burst and publish the averaged value of each analog input.
+// With the I/O thread running the protocol loop is only woken if a value
+// moved.
+static void gpio_sample_analog(void)
+{
+    const struct gpio_adc_stats *stats;
+    struct gpio_pin *pin;
+    bool changed = false;
+    float value;
+    int i;
+    
+    next_adc_ns = gpio_debounce_now() + GPIO_ADC_PERIOD_MS * 1000000ULL;
+    if (adc_pin_count == 0)
+        return;
+    
+    if (gpio_adc_sample() < 0)
+        debug_printf(1, "GPIO: ADC burst failed\n");
+    stats = gpio_adc_stats();
+    io_stats.adc_bursts = stats->bursts;
+    io_stats.adc_conversions = stats->conversions;
+    io_stats.adc_errors = stats->errors;
+    io_stats.adc_burst_ns = stats->burst_duration_ns;
+    
+    for (i = 0; i < adc_pin_count; i++) {
+        pin = adc_pins[i];
+        value = gpio_adc_value(pin->adc);
+        if (!io_running) {
+            gpio_apply_analog(pin, value);
+            continue;
         }
-        fclose(value_file);
+        // only this thread writes the snapshot, so it can read it freely
+        if (pin->analog.value == value)
+            continue;
+        gpio_io_analog_publish(&pin->analog, value, gpio_debounce_now());
+        changed = true;
     }
+    if (changed) {
+        atomic_store(&inputs_changed, true);
+        gpio_io_wake(protocol_wake_fds);
+    }
+}
+
+// Drain the edges waiting on the input lines and feed them through the
+// debounce filters, rather than waiting for the next one second scan
+static void gpio_read_edges(void)
+{
+    struct gpio_pin *pin;
+    struct gpio_edge_event event;
     
-    debug_printf(1, "GPIO: All read methods failed for pin %d\n", gpio_pin);
-    return 0; // Default to LOW if all methods fail
+    // all the scanned inputs share one event handle
+    while (gpio_backend_read_event(input_scan->lines[0], &event) == 1) {
+        io_stats.edges++;
+        debug_printf(3, "GPIO: Edge on pin %d: %s at %llu.%06llu ms (seq %u)\n",
+            event.offset, event.value ? "RISING" : "FALLING",
+            (unsigned long long)(event.timestamp_ns / 1000000),
+            (unsigned long long)(event.timestamp_ns % 1000000),
+            event.seqno);
+        pin = gpio_pin_from_line(event.offset);
+        if (!pin || (pin->scan_index < 0))
+            continue;
+        if (gpio_debounce_sample(&pin->filter, event.value, event.timestamp_ns))
+            gpio_publish_input(pin);
+    }
+}
+
+// The I/O thread - sleeps in poll() until an output is queued, an edge
+// arrives, a debounce window closes, an ADC burst or the once a second
+// resync is due
+static void *gpio_io_main(void *arg)
+{
+    struct gpio_io_command command;
+    struct pollfd fds[2];
+    uint64_t now_ns, deadline, next_scan_ns, busy_ns;
+    int timeout_ms;
+    int nfds;
+    
+    next_scan_ns = gpio_debounce_now() + 1000000000ULL;
+    while (!atomic_load(&io_stop)) {
+        deadline = gpio_inputs_deadline();
+        if (!deadline || (deadline > next_scan_ns))
+            deadline = next_scan_ns;
+        if (adc_pin_count && (deadline > next_adc_ns))
+            deadline = next_adc_ns;
+        now_ns = gpio_debounce_now();
+        timeout_ms = (deadline > now_ns) ? (deadline - now_ns + 999999) / 1000000 : 0;
+        
+        fds[0].fd = io_wake_fds[0];
+        fds[0].events = POLLIN;
+        fds[0].revents = 0;
+        nfds = 1;
+        if (input_scan && input_scan->edges && (input_scan->fd >= 0)) {
+            fds[1].fd = input_scan->fd;
+            fds[1].events = POLLIN;
+            fds[1].revents = 0;
+            nfds = 2;
+        }
+        if ((poll(fds, nfds, timeout_ms) < 0) && (errno != EINTR)) {
+            error_printf("GPIO: I/O thread poll failed: %s\n", strerror(errno));
+            break;
+        }
+        
+        now_ns = gpio_debounce_now();
+        io_stats.passes++;
+        if (fds[0].revents & POLLIN)
+            gpio_io_wake_drain(io_wake_fds);
+        while (gpio_io_queue_pop(&output_queue, &command))
+            gpio_write_pin(command.pin, command.value);
+        if ((nfds > 1) && (fds[1].revents & POLLIN))
+            gpio_read_edges();
+        gpio_expire_inputs(gpio_debounce_now());
+        if (gpio_debounce_now() >= next_scan_ns) {
+            gpio_scan_inputs();
+            next_scan_ns = gpio_debounce_now() + 1000000000ULL;
+        }
+        if (adc_pin_count && (gpio_debounce_now() >= next_adc_ns))
+            gpio_sample_analog();
+        
+        busy_ns = gpio_debounce_now() - now_ns;
+        if (busy_ns > io_stats.max_busy_ns)
+            io_stats.max_busy_ns = busy_ns;
+        io_stats.glitches = gpio_inputs_glitches();
+        gpio_io_stats_publish(&io_stats_lock, &io_stats_published, &io_stats);
+    }
+    
+    return NULL;
+}
+
+// Hand the hardware over to the I/O thread.  If the thread can't be
+// started the protocol loop keeps driving the hardware itself.
+static void gpio_objects_start(void)
+{
+    sigset_t all_signals, old_signals;
+    int rc;
+    
+    io_stats.glitches = gpio_inputs_glitches();
+    gpio_io_stats_publish(&io_stats_lock, &io_stats_published, &io_stats);
+    
+    gpio_io_queue_init(&output_queue);
+    atomic_store(&io_stop, false);
+    atomic_store(&inputs_changed, false);
+    if ((gpio_io_wake_open(io_wake_fds) < 0) ||
+        (gpio_io_wake_open(protocol_wake_fds) < 0)) {
+        error_printf("GPIO: No wake pipes, driving GPIO from the main loop\n");
+        gpio_io_wake_close(io_wake_fds);
+        return;
+    }
+    
+    // signals are left to the main thread and its handlers
+    io_running = true;
+    sigfillset(&all_signals);
+    pthread_sigmask(SIG_BLOCK, &all_signals, &old_signals);
+    rc = pthread_create(&io_thread, NULL, gpio_io_main, NULL);
+    pthread_sigmask(SIG_SETMASK, &old_signals, NULL);
+    if (rc != 0) {
+        io_running = false;
+        error_printf("GPIO: No I/O thread (%s), driving GPIO from the main loop\n",
+            strerror(rc));
+        gpio_io_wake_close(io_wake_fds);
+        gpio_io_wake_close(protocol_wake_fds);
+        return;
+    }
+    debug_printf(1, "GPIO: I/O thread started\n");
+}
+
+// Stop the I/O thread so the hardware can be released
+void gpio_objects_stop(void)
+{
+    if (!io_running)
+        return;
+    
+    atomic_store(&io_stop, true);
+    gpio_io_wake(io_wake_fds);
+    pthread_join(io_thread, NULL);
+    io_running = false;
+    gpio_io_wake_close(io_wake_fds);
+    gpio_io_wake_close(protocol_wake_fds);
+    debug_printf(1, "GPIO: I/O thread stopped\n");
 }
 
 // Function to update input values from GPIO pins
 void gpio_update_inputs(int device_id)
 {
-    struct ObjectRef_Struct *obj_ptr;
     static time_t last_update = 0;
-    time_t current_time = time(NULL);
+    time_t current_time;
+    
+    if (io_running) {
+        gpio_apply_inputs();
+        return;
+    }
+    
+    gpio_expire_inputs(gpio_debounce_now());
+    if (adc_pin_count && (gpio_debounce_now() >= next_adc_ns)) {
+        gpio_sample_analog();
+        gpio_io_stats_publish(&io_stats_lock, &io_stats_published, &io_stats);
+    }
     
-    // Only update every 1 second to avoid excessive polling
+    // Edges update the inputs as they happen, so this is a once a second
+    // resync (and the only update on chips without edge events)
+    current_time = time(NULL);
     if (current_time - last_update < 1) {
         return;
     }
     last_update = current_time;
     
-    // Update Binary Input 3019 (GPIO 19 - Motion Sensor)
-    obj_ptr = object_find(device_id, OBJECT_BINARY_INPUT, 3019);
-    if (obj_ptr != NULL) {
-        int gpio_value = gpio_read_pin(3019);
-        // Convert 0/1 to BACnet enumerated values (0=INACTIVE, 1=ACTIVE)
-        int new_value = gpio_value ? 1 : 0;
-        
-        if (obj_ptr->value.enumerated != new_value) {
-            debug_printf(1, "GPIO: Binary Input 3019 changed: %s -> %s (GPIO pin 19 = %s)\n",
-                obj_ptr->value.enumerated ? "ACTIVE" : "INACTIVE",
-                new_value ? "ACTIVE" : "INACTIVE",
-                gpio_value ? "HIGH" : "LOW");
-            obj_ptr->value.enumerated = new_value;
-        }
+    gpio_scan_inputs();
+    io_stats.glitches = gpio_inputs_glitches();
+    gpio_io_stats_publish(&io_stats_lock, &io_stats_published, &io_stats);
+}
+
+// Shorten the select timeout so a debounced input is published and the
+// ADC is sampled on time.  The I/O thread keeps its own deadlines.
+void gpio_objects_timeout(struct timeval *timeout)
+{
+    uint64_t deadline;
+    uint64_t now_ns;
+    uint64_t wait_us;
+    
+    if (io_running)
+        return;
+    deadline = gpio_inputs_deadline();
+    if (adc_pin_count && (!deadline || (deadline > next_adc_ns)))
+        deadline = next_adc_ns;
+    if (!deadline)
+        return;
+    
+    now_ns = gpio_debounce_now();
+    wait_us = (deadline > now_ns) ? (deadline - now_ns + 999) / 1000 : 0;
+    if (wait_us < (uint64_t) timeout->tv_sec * 1000000 + timeout->tv_usec) {
+        timeout->tv_sec = wait_us / 1000000;
+        timeout->tv_usec = wait_us % 1000000;
     }
 }
 
-// Create default GPIO objects (fallback)
-void gpio_create_default_objects(int device_id)
+// The bulk scan request, or NULL if the inputs are read one at a time
+struct gpio_scan *gpio_objects_input_scan(void)
+{
+    return input_scan;
+}
+
+// Changes the debounce filters dropped as glitches
+unsigned long gpio_objects_glitch_count(void)
+{
+    struct gpio_io_stats stats;
+    
+    gpio_objects_io_stats(&stats);
+    
+    return stats.glitches;
+}
+
+// Add the handle that signals new input levels to the main select set -
+// the I/O thread's wake pipe, or the edge events when there is no thread
+int gpio_objects_fd_set(fd_set *read_fds, int max)
+{
+    int fd = -1;
+    
+    if (io_running)
+        fd = protocol_wake_fds[0];
+    else if (input_scan && input_scan->edges)
+        fd = input_scan->fd;
+    if (fd >= 0) {
+        FD_SET(fd, read_fds);
+        if (max < fd)
+            max = fd;
+    }
+    
+    return max;
+}
+
+// Pick up the input levels that changed since the last pass
+void gpio_receive_events(int device_id, fd_set *read_fds)
+{
+    if (io_running) {
+        if (FD_ISSET(protocol_wake_fds[0], read_fds))
+            gpio_io_wake_drain(protocol_wake_fds);
+        gpio_apply_inputs();
+        return;
+    }
+    
+    if (!input_scan || !input_scan->edges || (input_scan->fd < 0) ||
+        !FD_ISSET(input_scan->fd, read_fds))
+        return;
+    
+    gpio_read_edges();
+    gpio_expire_inputs(gpio_debounce_now());
+    io_stats.glitches = gpio_inputs_glitches();
+    gpio_io_stats_publish(&io_stats_lock, &io_stats_published, &io_stats);
+}
+
+// Create the BACnet object for a pin and add the pin to the pin table
+static struct gpio_pin *gpio_add_object(int device_id,
+    BACNET_OBJECT_TYPE object_type, uint32_t instance, int gpio_pin,
+    int pwm_channel, const char *name, const char *active_text,
+    const char *inactive_text)
 {
     struct ObjectRef_Struct *obj_ptr;
+    struct gpio_pin *pin;
+    
+    pin = gpio_pin_add(object_type, instance, gpio_pin, pwm_channel);
+    if (pin == NULL)
+        return NULL;
     
-    // GPIO 18 - Binary Output (Test LED)
-    if ((obj_ptr = object_new(device_id, OBJECT_BINARY_OUTPUT, 4018)) != NULL) {
-        obj_ptr->name = strdup("Test LED");
-        obj_ptr->value.enumerated = 0;
-        obj_ptr->units.states.active = strdup("ON");
-        obj_ptr->units.states.inactive = strdup("OFF");
-        debug_printf(2, "GPIO: Created default Binary Output 4018 - Test LED\n");
+    if ((obj_ptr = object_new(device_id, object_type, instance)) != NULL) {
+        object_set_name(obj_ptr, name);
+        if (object_type == OBJECT_ANALOG_OUTPUT) {
+            obj_ptr->value.real = 0.0;
+            object_set_units(obj_ptr, UNITS_PERCENT);
+        } else if (object_type == OBJECT_ANALOG_INPUT) {
+            obj_ptr->value.real = 0.0;
+            object_set_units(obj_ptr, UNITS_VOLTS);
+        } else {
+            obj_ptr->value.enumerated = 0;
+            object_set_state_texts(obj_ptr, active_text, inactive_text);
+        }
+        debug_printf(1, "GPIO: Created %s %u (GPIO %d) - %s\n",
+            enum_to_text_object(object_type), instance, gpio_pin, name);
     }
+    pin->obj_ptr = obj_ptr;
     
-    // GPIO 19 - Binary Input (Motion Sensor)
-    if ((obj_ptr = object_new(device_id, OBJECT_BINARY_INPUT, 3019)) != NULL) {
-        obj_ptr->name = strdup("Motion Sensor");
-        obj_ptr->value.enumerated = 0;
-        obj_ptr->units.states.active = strdup("Motion");
-        obj_ptr->units.states.inactive = strdup("No Motion");
-        debug_printf(2, "GPIO: Created default Binary Input 3019 - Motion Sensor\n");
+    return pin;
+}
+
+// Create default GPIO objects (fallback)
+void gpio_create_default_objects(int device_id)
+{
+    const struct gpio_default_object *def;
+    unsigned i;
+    
+    for (i = 0; i < sizeof(gpio_default_objects) / sizeof(gpio_default_objects[0]); i++) {
+        def = &gpio_default_objects[i];
+        gpio_add_object(device_id, def->object_type, def->instance,
+            def->gpio_pin, -1, def->name, def->active_text, def->inactive_text);
     }
 }
 
 // Parse JSON configuration and create GPIO objects
 void gpio_create_objects_from_config(int device_id, const char *json_config)
 {
-    struct ObjectRef_Struct *obj_ptr;
+    struct gpio_pin *pin;
     
     // Simple JSON parsing for GPIO configuration
     // Look for enabled pins and create corresponding BACnet objects
     
     const char *ptr = json_config;
     char pin_str[8], name[64], direction[16], high_unit[32], low_unit[32];
-    int instance, enabled;
+    int instance, enabled, pwm_channel;
+    unsigned debounce_ms;
+    
+    // Pins are looked up in the "gpio_pins" section, and never in the
+    // "adc_channels" section, whose keys are numbered the same way
+    const char *adc_section = strstr(json_config, "\"adc_channels\"");
+    if (strstr(json_config, "\"gpio_pins\"") != NULL)
+        ptr = strstr(json_config, "\"gpio_pins\"");
+    if (adc_section != NULL && adc_section < ptr)
+        adc_section = NULL;
     
-    // Parse each GPIO pin configuration
-    for (int gpio_pin = 0; gpio_pin <= 23; gpio_pin++) {
+    // Parse each GPIO pin configuration - every BCM line on the header
+    for (int gpio_pin = 0; gpio_pin <= 27; gpio_pin++) {
         snprintf(pin_str, sizeof(pin_str), "\"%d\"", gpio_pin);
         
         // Find this pin's configuration in JSON
         const char *pin_config = strstr(ptr, pin_str);
         if (pin_config == NULL) continue;
+        if (adc_section != NULL && pin_config > adc_section) continue;
         
         // Extract enabled status
         const char *enabled_ptr = strstr(pin_config, "\"enabled\":");
@@ -1117,79 +1229,134 @@ void gpio_create_objects_from_config(int device_id, const char *json_config)
             instance = (gpio_pin == 0) ? 24 : gpio_pin;
         }
         
+        // Extract debounce time (optional, inputs only) - only look
+        // inside this pin's block so the next pin's setting isn't used
+        debounce_ms = 0;
+        const char *pin_end = strchr(pin_config, '}');
+        const char *debounce_ptr = strstr(pin_config, "\"debounce_ms\":");
+        if ((debounce_ptr != NULL) && (pin_end == NULL || debounce_ptr < pin_end)) {
+            debounce_ptr = strchr(debounce_ptr, ':');
+            if (debounce_ptr != NULL) {
+                debounce_ptr++;
+                while (*debounce_ptr == ' ' || *debounce_ptr == '\t') debounce_ptr++;
+                if (atoi(debounce_ptr) > 0)
+                    debounce_ms = atoi(debounce_ptr);
+            }
+        }
+        
+        // Extract PWM channel (optional, "pwm" pins only)
+        pwm_channel = DEFAULT_PWM_CHANNEL;
+        const char *channel_ptr = strstr(pin_config, "\"pwm_channel\":");
+        if ((channel_ptr != NULL) && (pin_end == NULL || channel_ptr < pin_end)) {
+            channel_ptr = strchr(channel_ptr, ':');
+            if (channel_ptr != NULL) {
+                channel_ptr++;
+                while (*channel_ptr == ' ' || *channel_ptr == '\t') channel_ptr++;
+                pwm_channel = atoi(channel_ptr);
+            }
+        }
+        
         // Create BACnet object based on direction
         if (strcmp(direction, "output") == 0) {
             // Create Binary Output
-            int bacnet_instance = 4000 + instance;
-            if ((obj_ptr = object_new(device_id, OBJECT_BINARY_OUTPUT, bacnet_instance)) != NULL) {
-                obj_ptr->name = strdup(name);
-                obj_ptr->value.enumerated = 0;
-                obj_ptr->units.states.active = strdup(high_unit);
-                obj_ptr->units.states.inactive = strdup(low_unit);
-                debug_printf(1, "GPIO: Created Binary Output %d (GPIO %d) - %s\n", 
-                    bacnet_instance, gpio_pin, name);
-            }
+            gpio_add_object(device_id, OBJECT_BINARY_OUTPUT, 4000 + instance,
+                gpio_pin, -1, name, high_unit, low_unit);
+        } else if (strcmp(direction, "pwm") == 0) {
+            // Create Analog Output driven by PWM duty (0-100%)
+            gpio_add_object(device_id, OBJECT_ANALOG_OUTPUT, 2000 + instance,
+                gpio_pin, pwm_channel, name, high_unit, low_unit);
         } else {
             // Create Binary Input
-            int bacnet_instance = 3000 + instance;
-            if ((obj_ptr = object_new(device_id, OBJECT_BINARY_INPUT, bacnet_instance)) != NULL) {
-                obj_ptr->name = strdup(name);
-                obj_ptr->value.enumerated = 0;
-                obj_ptr->units.states.active = strdup(high_unit);
-                obj_ptr->units.states.inactive = strdup(low_unit);
-                debug_printf(1, "GPIO: Created Binary Input %d (GPIO %d) - %s\n", 
-                    bacnet_instance, gpio_pin, name);
+            pin = gpio_add_object(device_id, OBJECT_BINARY_INPUT, 3000 + instance,
+                gpio_pin, -1, name, high_unit, low_unit);
+            if (pin && debounce_ms) {
+                gpio_debounce_init(&pin->filter, debounce_ms, 0);
+                debug_printf(2, "GPIO: Pin %d debounce %u ms\n", gpio_pin, debounce_ms);
             }
         }
-    }
+    }    
+    gpio_create_adc_objects_from_config(device_id, json_config);
 }
 
-// Helper function to get object index from instance
-static int gpio_get_object_index(uint32_t instance)
+// The text after "key": inside one object of the configuration, or NULL
+// if the object doesn't set it
+static const char *gpio_config_value(const char *block, const char *block_end,
+    const char *key)
 {
-    switch(instance) {
-        case 4018: return 0; // BO Test LED
-        case 3019: return 1; // BI Motion Sensor
-        case 1020: return 2; // AI Temperature
-        case 2021: return 3; // AO Fan Control
-        case 4026: return 4; // BO Main Relay
-        default: return -1;
-    }
+    char pattern[32];
+    const char *value;
+    
+    snprintf(pattern, sizeof(pattern), "\"%s\":", key);
+    value = strstr(block, pattern);
+    if ((value == NULL) || (block_end && (value >= block_end)))
+        return NULL;
+    value += strlen(pattern);
+    while (*value == ' ' || *value == '\t') value++;
+    
+    return value;
 }
 
-// Helper function to get effective value from priority array
-static union ObjectValue gpio_get_effective_value(uint32_t instance)
+// Create an Analog Input for each enabled MCP3008 channel in the
+// "adc_channels" section:
+//   "0": { "name": "Temperature Sensor", "enabled": true, "instance": 20,
+//          "units": 62, "scale_low": -50.0, "scale_high": 280.0,
+//          "oversample": 8 }
+// Counts are scaled linearly from scale_low at 0 to scale_high at full
+// scale, and units is a BACnet engineering units number.
+static void gpio_create_adc_objects_from_config(int device_id,
+    const char *json_config)
 {
-    int index = gpio_get_object_index(instance);
-    union ObjectValue result;
+    const char *section, *block, *block_end, *value, *value_end;
+    char key[8], name[64];
+    struct gpio_pin *pin;
+    int channel, instance, oversample, units;
+    float scale_low, scale_high;
     
-    if (index < 0) {
-        // Invalid instance, return zero
-        result.real = 0.0;
-        return result;
-    }
-    
-    struct gpio_priority_array *prio = &gpio_priorities[index];
-    
-    // If out of service, return present value (not priority array)
-    if (prio->out_of_service) {
-        struct ObjectRef_Struct *obj_ptr = object_find(BACnet_Device_Instance, 
-            (instance >= 4000) ? OBJECT_BINARY_OUTPUT : 
-            (instance >= 3000) ? OBJECT_BINARY_INPUT :
-            (instance >= 2000) ? OBJECT_ANALOG_OUTPUT : OBJECT_ANALOG_INPUT, 
-            instance);
-        if (obj_ptr) {
-            return obj_ptr->value;
-        }
-    }
+    section = strstr(json_config, "\"adc_channels\"");
+    if (section == NULL)
+        return;
     
-    // Check priority array from highest to lowest priority (1-16)
-    for (int i = 0; i < BACNET_MAX_PRIORITY; i++) {
-        if (prio->priorities_set & (1 << i)) {
-            return prio->values[i];
+    for (channel = 0; channel < GPIO_ADC_CHANNELS; channel++) {
+        snprintf(key, sizeof(key), "\"%d\"", channel);
+        block = strstr(section, key);
+        if (block == NULL) continue;
+        block_end = strchr(block, '}');
+        
+        value = gpio_config_value(block, block_end, "enabled");
+        if ((value == NULL) || (strncmp(value, "true", 4) != 0)) continue;
+        
+        snprintf(name, sizeof(name), "ADC %d", channel);
+        value = gpio_config_value(block, block_end, "name");
+        if (value && (*value == '"')) {
+            value++;
+            value_end = strchr(value, '"');
+            if (value_end && (value_end - value < sizeof(name))) {
+                memcpy(name, value, value_end - value);
+                name[value_end - value] = '\0';
+            }
         }
+        value = gpio_config_value(block, block_end, "instance");
+        instance = value ? atoi(value) : channel;
+        value = gpio_config_value(block, block_end, "units");
+        units = value ? atoi(value) : UNITS_VOLTS;
+        value = gpio_config_value(block, block_end, "scale_low");
+        scale_low = value ? atof(value) : DEFAULT_ADC_SCALE_LOW;
+        value = gpio_config_value(block, block_end, "scale_high");
+        scale_high = value ? atof(value) : DEFAULT_ADC_SCALE_HIGH;
+        value = gpio_config_value(block, block_end, "oversample");
+        oversample = value ? atoi(value) : GPIO_ADC_DEFAULT_OVERSAMPLE;
+        
+        pin = gpio_add_object(device_id, OBJECT_ANALOG_INPUT, 1000 + instance,
+            -1, -1, name, "", "");
+        if (pin == NULL) continue;
+        pin->adc_channel = channel;
+        pin->adc = gpio_adc_request(channel, oversample, scale_low, scale_high);
+        if (pin->adc == NULL)
+            error_printf("GPIO: Analog Input %u has no ADC channel %d - "
+                "reported as unreliable (no sensor)\n", pin->instance, channel);
+        if (pin->obj_ptr)
+            object_set_units(pin->obj_ptr, units);
+        debug_printf(2, "GPIO: ADC channel %d scaled %.3f to %.3f, %d conversions per reading\n",
+            channel, scale_low, scale_high, pin->adc ? pin->adc->oversample : 0);
     }
-    
-    // No priority set, return relinquish default
-    return prio->relinquish_default;
-}
\ No newline at end of file
+}
@@ -0,0 +1,431 @@
+/*
+ * GPIO PWM for BACnet4Linux
+ * Drives analog outputs through the kernel pwmchip interface.  Each
+ * channel is exported and enabled once and its duty_cycle attribute
+ * is kept open, so a change in value is a single write.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <math.h>
+#include "debug.h"
+#include "gpio_pwm.h"
+
+// the backend in use - selected once by gpio_pwm_init()
+static const struct gpio_pwm_ops *Pwm_Backend = NULL;
+
+// one handle per channel, so a lookup is just an index
+static struct gpio_pwm_channel Channels[GPIO_PWM_MAX_CHANNELS];
+
+/* sysfs pwmchip backend */
+
+static char Pwm_Chip_Path[64];
+
+static int pwm_sysfs_write(const char *path, const char *value)
+{
+    int fd;
+    ssize_t len;
+
+    fd = open(path, O_WRONLY | O_CLOEXEC);
+    if (fd < 0)
+        return -1;
+    len = write(fd, value, strlen(value));
+    close(fd);
+
+    return (len == (ssize_t) strlen(value)) ? 0 : -1;
+}
+
+static int pwm_sysfs_open(const char *chip)
+{
+    if (!chip || !chip[0])
+        return -1;
+    // accept "pwmchip0" as well as "/sys/class/pwm/pwmchip0"
+    if (chip[0] == '/')
+        snprintf(Pwm_Chip_Path, sizeof(Pwm_Chip_Path), "%s", chip);
+    else
+        snprintf(Pwm_Chip_Path, sizeof(Pwm_Chip_Path),
+            "/sys/class/pwm/%s", chip);
+    if (access(Pwm_Chip_Path, W_OK) < 0) {
+        debug_printf(1, "PWM: Cannot use %s: %s\n", Pwm_Chip_Path,
+            strerror(errno));
+        return -1;
+    }
+    debug_printf(1, "PWM: Opened %s\n", Pwm_Chip_Path);
+
+    return 0;
+}
+
+static void pwm_sysfs_close(void)
+{
+    Pwm_Chip_Path[0] = 0;
+}
+
+static int pwm_sysfs_request(struct gpio_pwm_channel *pwm)
+{
+    char path[96];
+    char value[32];
+    int tries;
+
+    snprintf(path, sizeof(path), "%s/pwm%d", Pwm_Chip_Path, pwm->channel);
+    if (access(path, F_OK) < 0) {
+        snprintf(value, sizeof(value), "%d", pwm->channel);
+        snprintf(path, sizeof(path), "%s/export", Pwm_Chip_Path);
+        if (pwm_sysfs_write(path, value) < 0) {
+            debug_printf(1, "PWM: Channel %d export failed: %s\n",
+                pwm->channel, strerror(errno));
+            return -1;
+        }
+    }
+
+    // udev may still be fixing up the new attributes
+    snprintf(path, sizeof(path), "%s/pwm%d/duty_cycle", Pwm_Chip_Path,
+        pwm->channel);
+    for (tries = 0; tries < 10; tries++) {
+        pwm->duty_fd = open(path, O_WRONLY | O_CLOEXEC);
+        if (pwm->duty_fd >= 0)
+            break;
+        usleep(10000);
+    }
+    if (pwm->duty_fd < 0) {
+        debug_printf(1, "PWM: Cannot open %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+    // duty can't exceed the period, so clear it before setting the period
+    if (pwrite(pwm->duty_fd, "0", 1, 0) < 0)
+        debug_printf(2, "PWM: Channel %d duty reset failed\n", pwm->channel);
+    snprintf(path, sizeof(path), "%s/pwm%d/period", Pwm_Chip_Path,
+        pwm->channel);
+    snprintf(value, sizeof(value), "%lu", pwm->period_ns);
+    if (pwm_sysfs_write(path, value) < 0) {
+        debug_printf(1, "PWM: Channel %d period %lu ns failed: %s\n",
+            pwm->channel, pwm->period_ns, strerror(errno));
+        close(pwm->duty_fd);
+        pwm->duty_fd = -1;
+        return -1;
+    }
+    snprintf(path, sizeof(path), "%s/pwm%d/enable", Pwm_Chip_Path,
+        pwm->channel);
+    if (pwm_sysfs_write(path, "1") < 0) {
+        debug_printf(1, "PWM: Channel %d enable failed: %s\n",
+            pwm->channel, strerror(errno));
+        close(pwm->duty_fd);
+        pwm->duty_fd = -1;
+        return -1;
+    }
+
+    return 0;
+}
+
+static void pwm_sysfs_release(struct gpio_pwm_channel *pwm)
+{
+    char path[96];
+    char value[32];
+
+    snprintf(path, sizeof(path), "%s/pwm%d/enable", Pwm_Chip_Path,
+        pwm->channel);
+    (void) pwm_sysfs_write(path, "0");
+    if (pwm->duty_fd >= 0) {
+        close(pwm->duty_fd);
+        pwm->duty_fd = -1;
+    }
+    snprintf(path, sizeof(path), "%s/unexport", Pwm_Chip_Path);
+    snprintf(value, sizeof(value), "%d", pwm->channel);
+    (void) pwm_sysfs_write(path, value);
+}
+
+static int pwm_sysfs_set_duty(struct gpio_pwm_channel *pwm,
+    unsigned long duty_ns)
+{
+    char value[32];
+    int len;
+
+    len = snprintf(value, sizeof(value), "%lu", duty_ns);
+    if (pwrite(pwm->duty_fd, value, len, 0) != len) {
+        debug_printf(1, "PWM: Channel %d duty write failed: %s\n",
+            pwm->channel, strerror(errno));
+        return -1;
+    }
+
+    return 0;
+}
+
+const struct gpio_pwm_ops gpio_pwm_sysfs_ops = {
+    "sysfs",
+    pwm_sysfs_open,
+    pwm_sysfs_close,
+    pwm_sysfs_request,
+    pwm_sysfs_release,
+    pwm_sysfs_set_duty
+};
+
+/* simulated PWM backend */
+
+static unsigned long Sim_Duty[GPIO_PWM_MAX_CHANNELS];
+static unsigned long Sim_Writes[GPIO_PWM_MAX_CHANNELS];
+
+static int pwm_sim_open(const char *chip)
+{
+    debug_printf(2, "PWM: Simulated chip ready (%d channels)\n",
+        GPIO_PWM_MAX_CHANNELS);
+
+    return 0;
+}
+
+static void pwm_sim_close(void)
+{
+}
+
+static int pwm_sim_request(struct gpio_pwm_channel *pwm)
+{
+    Sim_Duty[pwm->channel] = 0;
+
+    return 0;
+}
+
+static void pwm_sim_release(struct gpio_pwm_channel *pwm)
+{
+}
+
+static int pwm_sim_set_duty(struct gpio_pwm_channel *pwm,
+    unsigned long duty_ns)
+{
+    Sim_Duty[pwm->channel] = duty_ns;
+    Sim_Writes[pwm->channel]++;
+
+    return 0;
+}
+
+const struct gpio_pwm_ops gpio_pwm_sim_ops = {
+    "sim",
+    pwm_sim_open,
+    pwm_sim_close,
+    pwm_sim_request,
+    pwm_sim_release,
+    pwm_sim_set_duty
+};
+
+static bool pwm_sim_valid(int channel)
+{
+    return (channel >= 0) && (channel < GPIO_PWM_MAX_CHANNELS);
+}
+
+// duty last written to a simulated channel
+unsigned long gpio_pwm_sim_duty(int channel)
+{
+    return pwm_sim_valid(channel) ? Sim_Duty[channel] : 0;
+}
+
+// number of duty writes that reached a simulated channel
+unsigned long gpio_pwm_sim_write_count(int channel)
+{
+    return pwm_sim_valid(channel) ? Sim_Writes[channel] : 0;
+}
+
+void gpio_pwm_sim_reset(void)
+{
+    memset(Sim_Duty, 0, sizeof(Sim_Duty));
+    memset(Sim_Writes, 0, sizeof(Sim_Writes));
+}
+
+/* front end */
+
+// selects and opens the PWM backend
+// simulated PWM is only used when asked for by name
+int gpio_pwm_init(const char *chip)
+{
+    int i;
+
+    if (Pwm_Backend)
+        gpio_pwm_cleanup();
+    for (i = 0; i < GPIO_PWM_MAX_CHANNELS; i++) {
+        Channels[i].channel = i;
+        Channels[i].requested = false;
+        Channels[i].duty_fd = -1;
+        Channels[i].period_ns = 0;
+        Channels[i].duty_ns = 0;
+        Channels[i].writes = 0;
+    }
+
+    if (chip && (strcmp(chip, "sim") == 0))
+        Pwm_Backend = &gpio_pwm_sim_ops;
+    else
+        Pwm_Backend = &gpio_pwm_sysfs_ops;
+
+    if (Pwm_Backend->open(chip) < 0) {
+        error_printf("PWM: Unable to open %s backend on %s\n",
+            Pwm_Backend->name, chip ? chip : "(null)");
+        Pwm_Backend = NULL;
+        return -1;
+    }
+    debug_printf(1, "PWM: Using %s backend\n", Pwm_Backend->name);
+
+    return 0;
+}
+
+const char *gpio_pwm_name(void)
+{
+    return Pwm_Backend ? Pwm_Backend->name : "none";
+}
+
+// returns the handle for the channel, exporting and enabling it with
+// a zero duty the first time.  Later calls return the held handle.
+struct gpio_pwm_channel *gpio_pwm_request(int channel,
+    unsigned long period_ns)
+{
+    struct gpio_pwm_channel *pwm;
+
+    if (!Pwm_Backend || (channel < 0) || (channel >= GPIO_PWM_MAX_CHANNELS)
+        || (period_ns == 0))
+        return NULL;
+
+    pwm = &Channels[channel];
+    if (pwm->requested)
+        return pwm;
+
+    pwm->period_ns = period_ns;
+    pwm->duty_ns = 0;
+    if (Pwm_Backend->request(pwm) < 0) {
+        error_printf("PWM: Unable to request channel %d\n", channel);
+        return NULL;
+    }
+    pwm->requested = true;
+    debug_printf(2, "PWM: Holding channel %d, period %lu ns\n", channel,
+        period_ns);
+
+    return pwm;
+}
+
+// sets the duty as a percentage of the period (clamped to 0-100).
+// The duty is only written when it differs from what the channel
+// already has.  returns 0 on success, -1 on failure - a NaN or an
+// infinity is a failure, and leaves the duty as it was
+int gpio_pwm_set_percent(struct gpio_pwm_channel *pwm, float percent)
+{
+    unsigned long duty_ns;
+
+    if (!Pwm_Backend || !pwm || !pwm->requested || !isfinite(percent))
+        return -1;
+
+    if (percent < 0.0)
+        percent = 0.0;
+    if (percent > 100.0)
+        percent = 100.0;
+    duty_ns = (unsigned long) ((double) pwm->period_ns * percent / 100.0 + 0.5);
+    if (duty_ns > pwm->period_ns)
+        duty_ns = pwm->period_ns;
+    if (duty_ns == pwm->duty_ns)
+        return 0;
+
+    if (Pwm_Backend->set_duty(pwm, duty_ns) < 0)
+        return -1;
+    pwm->duty_ns = duty_ns;
+    pwm->writes++;
+
+    return 0;
+}
+
+// disables and releases every held channel
+void gpio_pwm_cleanup(void)
+{
+    int i;
+
+    if (!Pwm_Backend)
+        return;
+    for (i = 0; i < GPIO_PWM_MAX_CHANNELS; i++) {
+        if (Channels[i].requested) {
+            Pwm_Backend->release(&Channels[i]);
+            Channels[i].requested = false;
+            Channels[i].duty_fd = -1;
+        }
+    }
+    Pwm_Backend->close();
+    debug_printf(2, "PWM: Released all channels (%s backend)\n",
+        Pwm_Backend->name);
+    Pwm_Backend = NULL;
+}
+
+#ifdef TEST
+#include <assert.h>
+
+#include "ctest.h"
+
+void testGpioPwmSim(Test * pTest)
+{
+    struct gpio_pwm_channel *pwm;
+    struct gpio_pwm_channel *pwm2;
+
+    ct_test(pTest, gpio_pwm_init("sim") == 0);
+    ct_test(pTest, strcmp(gpio_pwm_name(), "sim") == 0);
+    gpio_pwm_sim_reset();
+
+    pwm = gpio_pwm_request(0, 1000000);
+    ct_test(pTest, pwm != NULL);
+    ct_test(pTest, pwm->duty_ns == 0);
+    pwm2 = gpio_pwm_request(0, 1000000);
+    ct_test(pTest, pwm2 == pwm);
+
+    ct_test(pTest, gpio_pwm_set_percent(pwm, 50.0) == 0);
+    ct_test(pTest, gpio_pwm_sim_duty(0) == 500000);
+    ct_test(pTest, gpio_pwm_sim_write_count(0) == 1);
+
+    // the same duty is not written again
+    ct_test(pTest, gpio_pwm_set_percent(pwm, 50.0) == 0);
+    ct_test(pTest, gpio_pwm_sim_write_count(0) == 1);
+    ct_test(pTest, pwm->writes == 1);
+
+    // out of range values are clamped
+    ct_test(pTest, gpio_pwm_set_percent(pwm, 150.0) == 0);
+    ct_test(pTest, gpio_pwm_sim_duty(0) == 1000000);
+    ct_test(pTest, gpio_pwm_set_percent(pwm, -5.0) == 0);
+    ct_test(pTest, gpio_pwm_sim_duty(0) == 0);
+    ct_test(pTest, gpio_pwm_sim_write_count(0) == 3);
+
+    // values that are not numbers are refused
+    ct_test(pTest, gpio_pwm_set_percent(pwm, 25.0) == 0);
+    ct_test(pTest, gpio_pwm_set_percent(pwm, NAN) == -1);
+    ct_test(pTest, gpio_pwm_set_percent(pwm, INFINITY) == -1);
+    ct_test(pTest, gpio_pwm_set_percent(pwm, -INFINITY) == -1);
+    ct_test(pTest, gpio_pwm_sim_duty(0) == 250000);
+    ct_test(pTest, gpio_pwm_sim_write_count(0) == 4);
+
+    ct_test(pTest, gpio_pwm_request(GPIO_PWM_MAX_CHANNELS, 1000000) == NULL);
+    ct_test(pTest, gpio_pwm_request(1, 0) == NULL);
+
+    gpio_pwm_cleanup();
+    ct_test(pTest, gpio_pwm_set_percent(pwm, 10.0) == -1);
+
+    // a pwmchip that isn't there is not replaced by simulated PWM
+    ct_test(pTest, gpio_pwm_init("pwmchip-none") == -1);
+    ct_test(pTest, strcmp(gpio_pwm_name(), "none") == 0);
+    ct_test(pTest, gpio_pwm_request(0, 1000000) == NULL);
+
+    return;
+}
+
+// time the held-handle duty write path against simulated PWM
+#ifdef TEST_GPIO_PWM
+int main(void)
+{
+    Test *pTest;
+    bool rc;
+
+    pTest = ct_create("gpio pwm", NULL);
+
+    /* individual tests */
+    rc = ct_addTestFunction(pTest, testGpioPwmSim);
+    assert(rc);
+
+    ct_setStream(pTest, stdout);
+    ct_run(pTest);
+    (void) ct_report(pTest);
+
+    ct_destroy(pTest);
+
+    return 0;
+}
+#endif                          /* TEST_GPIO_PWM */
+#endif                          /* TEST */
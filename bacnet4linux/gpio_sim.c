@@ -0,0 +1,277 @@
+/*
+ * Simulated GPIO chip for BACnet4Linux
+ * Keeps line values in memory so the GPIO code paths can be
+ * exercised and timed without Raspberry Pi hardware
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <time.h>
+#include "debug.h"
+#include "gpio_backend.h"
+
+static int Sim_Value[GPIO_MAX_LINES];
+static unsigned long Sim_Writes[GPIO_MAX_LINES];
+// edge lines get a pipe - the read end stands in for the line event
+// handle so injected edges wake select() just like the kernel would
+static int Sim_Event_fd[GPIO_MAX_LINES];
+static uint32_t Sim_Seqno[GPIO_MAX_LINES];
+// write end of the scan group's event pipe
+static int Sim_Scan_fd = -1;
+// reads that reached the simulated chip, single line or bulk
+static unsigned long Sim_Reads;
+// lines left claimed by another process until they are reclaimed
+static bool Sim_Claimed[GPIO_MAX_LINES];
+
+static int sim_valid(int offset)
+{
+    return (offset >= 0) && (offset < GPIO_MAX_LINES);
+}
+
+static int sim_open(const char *chip)
+{
+    int i;
+
+    for (i = 0; i < GPIO_MAX_LINES; i++)
+        Sim_Event_fd[i] = -1;
+    Sim_Scan_fd = -1;
+    debug_printf(2, "GPIO: Simulated chip ready (%d lines)\n",
+        GPIO_MAX_LINES);
+
+    return 0;
+}
+
+static void sim_close(void)
+{
+}
+
+static int sim_request(struct gpio_line *line, int initial_value)
+{
+    int fds[2];
+
+    if (!sim_valid(line->offset))
+        return -1;
+    if (Sim_Claimed[line->offset]) {
+        debug_printf(1, "GPIO: Simulated line %d is busy\n", line->offset);
+        return -1;
+    }
+    line->fd = -1;
+    if (line->direction == GPIO_DIRECTION_OUTPUT)
+        Sim_Value[line->offset] = initial_value;
+    if (line->edges) {
+        if (pipe(fds) < 0) {
+            debug_printf(1, "GPIO: Simulated line %d event pipe: %s\n",
+                line->offset, strerror(errno));
+            return -1;
+        }
+        fcntl(fds[0], F_SETFL, O_NONBLOCK);
+        fcntl(fds[1], F_SETFL, O_NONBLOCK);
+        line->fd = fds[0];
+        Sim_Event_fd[line->offset] = fds[1];
+        Sim_Seqno[line->offset] = 0;
+    }
+
+    return 0;
+}
+
+static void sim_release(struct gpio_line *line)
+{
+    if (line->fd >= 0) {
+        close(line->fd);
+        line->fd = -1;
+    }
+    if (Sim_Event_fd[line->offset] >= 0) {
+        close(Sim_Event_fd[line->offset]);
+        Sim_Event_fd[line->offset] = -1;
+    }
+}
+
+static int sim_get(struct gpio_line *line)
+{
+    Sim_Reads++;
+
+    return Sim_Value[line->offset];
+}
+
+static int sim_set(struct gpio_line *line, int value)
+{
+    Sim_Value[line->offset] = value;
+    Sim_Writes[line->offset]++;
+
+    return 0;
+}
+
+static int sim_read_event(struct gpio_line *line,
+    struct gpio_edge_event *event)
+{
+    ssize_t len;
+
+    len = read(line->fd, event, sizeof(*event));
+    if (len == sizeof(*event))
+        return 1;
+    if ((len < 0) && ((errno == EAGAIN) || (errno == EWOULDBLOCK)))
+        return 0;
+
+    return -1;
+}
+
+static int sim_request_scan(struct gpio_scan *scan)
+{
+    int fds[2];
+    int i;
+
+    scan->fd = -1;
+    for (i = 0; i < scan->num_lines; i++) {
+        if (Sim_Claimed[scan->lines[i]->offset])
+            return -1;
+    }
+    if (scan->edges) {
+        if (pipe(fds) < 0) {
+            debug_printf(1, "GPIO: Simulated scan event pipe: %s\n",
+                strerror(errno));
+            return -1;
+        }
+        fcntl(fds[0], F_SETFL, O_NONBLOCK);
+        fcntl(fds[1], F_SETFL, O_NONBLOCK);
+        scan->fd = fds[0];
+        Sim_Scan_fd = fds[1];
+    }
+    for (i = 0; i < scan->num_lines; i++) {
+        Sim_Event_fd[scan->lines[i]->offset] = scan->edges ? Sim_Scan_fd : -1;
+        Sim_Seqno[scan->lines[i]->offset] = 0;
+    }
+
+    return 0;
+}
+
+static void sim_release_scan(struct gpio_scan *scan)
+{
+    int i;
+
+    for (i = 0; i < scan->num_lines; i++)
+        Sim_Event_fd[scan->lines[i]->offset] = -1;
+    if (scan->fd >= 0) {
+        close(scan->fd);
+        scan->fd = -1;
+    }
+    if (Sim_Scan_fd >= 0) {
+        close(Sim_Scan_fd);
+        Sim_Scan_fd = -1;
+    }
+}
+
+static int sim_get_scan(struct gpio_scan *scan, uint64_t * values)
+{
+    uint64_t bits = 0;
+    int i;
+
+    Sim_Reads++;
+    for (i = 0; i < scan->num_lines; i++) {
+        if (Sim_Value[scan->lines[i]->offset])
+            bits |= 1ULL << i;
+    }
+    *values = bits;
+
+    return 0;
+}
+
+static int sim_reclaim(int offset)
+{
+    if (!sim_valid(offset))
+        return -1;
+    if (!Sim_Claimed[offset])
+        return 0;
+    Sim_Claimed[offset] = false;
+
+    return 1;
+}
+
+const struct gpio_backend_ops gpio_sim_ops = {
+    "sim",
+    sim_open,
+    sim_close,
+    sim_request,
+    sim_release,
+    sim_get,
+    sim_set,
+    sim_read_event,
+    sim_request_scan,
+    sim_release_scan,
+    sim_get_scan,
+    sim_reclaim
+};
+
+// queues an edge on a simulated edge line, as if the kernel saw it
+// at timestamp_ns (0 stamps it with the current monotonic time).
+// returns -1 if the line isn't held with edge events.
+int gpio_sim_inject_edge(int offset, int value, uint64_t timestamp_ns)
+{
+    struct gpio_edge_event event;
+    struct timespec now;
+
+    if (!sim_valid(offset) || (Sim_Event_fd[offset] < 0))
+        return -1;
+    if (timestamp_ns == 0) {
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        timestamp_ns = (uint64_t) now.tv_sec * 1000000000ULL + now.tv_nsec;
+    }
+    Sim_Value[offset] = value ? 1 : 0;
+    event.offset = offset;
+    event.value = Sim_Value[offset];
+    event.timestamp_ns = timestamp_ns;
+    event.seqno = ++Sim_Seqno[offset];
+    if (write(Sim_Event_fd[offset], &event, sizeof(event)) != sizeof(event))
+        return -1;
+
+    return 0;
+}
+
+// drives a simulated input pin
+// a level change on an edge line also queues the edge
+void gpio_sim_set_input(int offset, int value)
+{
+    if (!sim_valid(offset))
+        return;
+    value = value ? 1 : 0;
+    if ((Sim_Event_fd[offset] >= 0) && (Sim_Value[offset] != value))
+        (void) gpio_sim_inject_edge(offset, value, 0);
+    else
+        Sim_Value[offset] = value;
+}
+
+// returns the level an output was last driven to
+int gpio_sim_get_output(int offset)
+{
+    return sim_valid(offset) ? Sim_Value[offset] : -1;
+}
+
+// number of writes that reached the simulated pin
+unsigned long gpio_sim_write_count(int offset)
+{
+    return sim_valid(offset) ? Sim_Writes[offset] : 0;
+}
+
+// number of reads that reached the chip - a bulk scan counts once
+unsigned long gpio_sim_read_count(void)
+{
+    return Sim_Reads;
+}
+
+// marks a line as left claimed by another process - requests fail
+// until it is reclaimed
+void gpio_sim_claim(int offset)
+{
+    if (sim_valid(offset))
+        Sim_Claimed[offset] = true;
+}
+
+void gpio_sim_reset(void)
+{
+    memset(Sim_Value, 0, sizeof(Sim_Value));
+    memset(Sim_Claimed, 0, sizeof(Sim_Claimed));
+    memset(Sim_Writes, 0, sizeof(Sim_Writes));
+    Sim_Reads = 0;
+}
@@ -50,12 +50,18 @@
 #include "bacnet_object.h"
 #include "bacnet_text.h"
 #include "invoke_id.h"
+#include "slab.h"
+#include "intern.h"
 #include "main.h"
 #include "options.h"
 #include "dstring.h"
 #include "dbuffer.h"
 #include "version.h"
 #include "debug.h"
+#include "gpio_backend.h"
+#include "gpio_pwm.h"
+#include "gpio_adc.h"
+#include "gpio_objects.h"
 
 /* max number of bytes in one HTTP request/reply */
 #define MAX_TCP_SIZE 30000
@@ -277,11 +283,10 @@ static void construct_object_list(long device_id, OS_DString response_html)
 {
     struct BACnet_Device_Info *dev_ptr = NULL;
     struct ObjectRef_Struct *obj_ptr = NULL;    /* a single object reference */
-    int i;                      // counter
+    struct Keylist_Cursor cursor = { 0 };       // place in the object list
     const char *bgcolor = "#AF206F";
     const char *valuecolor = "#FF0000";
     OS_DString object_value = NULL;     // used to store the object value
-    int num_objects = 0;        // number of objects in the device
     int previous_object_type = -1;
 
     object_value = DString_Create();
@@ -297,24 +302,21 @@ static void construct_object_list(long device_id, OS_DString response_html)
     if (dev_ptr) {
         // since the object list is sorted by key (object+id)
         // we don't have to sort them here
-        num_objects = object_count(device_id);
-        for (i = 0; i < num_objects; i++) {
-            obj_ptr = object_get_by_index(dev_ptr, i);
-            if (!obj_ptr)
-                continue;
+        for (obj_ptr = object_cursor_data(dev_ptr, &cursor); obj_ptr;
+            obj_ptr = object_cursor_next(dev_ptr, &cursor)) {
             // keeps them together...
-            if (previous_object_type != obj_ptr->type) {
-                previous_object_type = obj_ptr->type;
-                bgcolor = get_object_bgcolor(obj_ptr->type);
+            if (previous_object_type != object_type(obj_ptr)) {
+                previous_object_type = object_type(obj_ptr);
+                bgcolor = get_object_bgcolor(object_type(obj_ptr));
                 DString_Append_Printf(response_html,
                     "<tr>"
                     "<th colspan=4 bgcolor=\"%s\">"
                     "<center>%s Objects</center></th>"
                     "</tr>\n",
-                    bgcolor, enum_to_text_object(obj_ptr->type));
+                    bgcolor, enum_to_text_object(object_type(obj_ptr)));
             }
             // create the line with the object info
-            switch (obj_ptr->type) {
+            switch (object_type(obj_ptr)) {
             case OBJECT_ANALOG_INPUT:
             case OBJECT_ANALOG_OUTPUT:
             case OBJECT_ANALOG_VALUE:
@@ -323,22 +325,22 @@ static void construct_object_list(long device_id, OS_DString response_html)
                     DString_Printf(object_value,
                         "%.0f %s",
                         obj_ptr->value.real,
-                        enum_to_text_units(obj_ptr->units.units));
+                        enum_to_text_units(object_units(obj_ptr)));
                 else if (obj_ptr->value.real > 10)
                     DString_Printf(object_value,
                         "%.1f %s",
                         obj_ptr->value.real,
-                        enum_to_text_units(obj_ptr->units.units));
+                        enum_to_text_units(object_units(obj_ptr)));
                 else if (obj_ptr->value.real > 1)
                     DString_Printf(object_value,
                         "%.2f %s",
                         obj_ptr->value.real,
-                        enum_to_text_units(obj_ptr->units.units));
+                        enum_to_text_units(object_units(obj_ptr)));
                 else
                     DString_Printf(object_value,
                         "%.3f %s",
                         obj_ptr->value.real,
-                        enum_to_text_units(obj_ptr->units.units));
+                        enum_to_text_units(object_units(obj_ptr)));
                 valuecolor = "#CCCCCC";
                 break;
             case OBJECT_BINARY_INPUT:
@@ -348,11 +350,11 @@ static void construct_object_list(long device_id, OS_DString response_html)
             case OBJECT_SCHEDULE:
                 if (obj_ptr->value.binary) {    /* Active */
                     DString_Printf(object_value, "%s",
-                        obj_ptr->units.states.active);
+                        object_active_text(obj_ptr));
                     valuecolor = "#00FF00";
                 } else {        /* Inactive */
                     DString_Printf(object_value,
-                        "%s", obj_ptr->units.states.inactive);
+                        "%s", object_inactive_text(obj_ptr));
                     valuecolor = "#FF0000";
                 }
                 break;
@@ -384,12 +386,12 @@ static void construct_object_list(long device_id, OS_DString response_html)
                 "target=\"objectlist\">%s</a></td>"
                 "</tr>\n",
                 bgcolor,
-                enum_to_text_object(obj_ptr->type),
-                obj_ptr->instance,
+                enum_to_text_object(object_type(obj_ptr)),
+                object_instance(obj_ptr),
                 valuecolor,
                 DString_Data(object_value),
                 dev_ptr->device,
-                obj_ptr->type, obj_ptr->instance, obj_ptr->name);
+                object_type(obj_ptr), object_instance(obj_ptr), object_name(obj_ptr));
         }
     }
     DString_Delete(object_value);
@@ -626,6 +628,39 @@ static void construct_device_info_page(char *url, OS_DString response_html)
             // finish the table
             DString_Concat(response_html, "</table>\n");
 
+            /* how the device answers requests */
+            DString_Concat(response_html,
+                "<table border=1>\n"
+                "<tr>" "<th colspan=\"2\">Requests:</th>" "</tr>\n");
+            if (dev_ptr->srtt_us)
+                DString_Printf(device_html,
+                    "<tr>" "<td>Round trip</td>"
+                    "<td>%.1f ms (varies %.1f ms)</td>" "</tr>\n",
+                    dev_ptr->srtt_us / 1000.0, dev_ptr->rttvar_us / 1000.0);
+            else
+                DString_Printf(device_html,
+                    "<tr>" "<td>Round trip</td>"
+                    "<td>not measured</td>" "</tr>\n");
+            DString_Concat(response_html, DString_Data(device_html));
+
+            DString_Printf(device_html,
+                "<tr>" "<td>Timeout</td>"
+                "<td>%d ms, %d retries</td>" "</tr>\n",
+                invoke_id_device_timeout(dev_ptr), BACnet_APDU_Retries);
+            DString_Concat(response_html, DString_Data(device_html));
+
+            DString_Printf(device_html,
+                "<tr>" "<td>Sent</td>" "<td>%lu</td>" "</tr>\n"
+                "<tr>" "<td>Answered</td>" "<td>%lu</td>" "</tr>\n"
+                "<tr>" "<td>Retried</td>" "<td>%lu</td>" "</tr>\n"
+                "<tr>" "<td>Failed</td>" "<td>%lu</td>" "</tr>\n",
+                (unsigned long) dev_ptr->requests,
+                (unsigned long) dev_ptr->replies,
+                (unsigned long) dev_ptr->retries,
+                (unsigned long) dev_ptr->failures);
+            DString_Concat(response_html, DString_Data(device_html));
+            DString_Concat(response_html, "</table>\n");
+
             /* link to load object list */
             DString_Printf(device_html,
                 "<script type=\"text/javascript\">parent.objectlist.location "
@@ -645,7 +680,6 @@ static void construct_device_info_page(char *url, OS_DString response_html)
 // FIXME: perhaps object-device-type-instance.html is easier to parse?
 static void construct_object_page(char *url, OS_DString response_html)
 {
-    int j = 0;                  // loop counter
     long device_id = 0;         // holds the decoded device id
     long objecttype = 0;
     long objectinstance = 0;
@@ -675,30 +709,23 @@ static void construct_object_page(char *url, OS_DString response_html)
             objecttype = strtol(objecttypestr, NULL, 10);
             strncpy(objectinstancestr, &url[18], 7);
             objectinstance = strtol(objectinstancestr, NULL, 10);
-            /* object list */
-            for (j = 0; j < object_count(dev_ptr->device); j++) {
-                obj_ptr = object_get_by_index(dev_ptr, j);
-                if (!obj_ptr)
-                    continue;
-                if ((obj_ptr->type == objecttype) &&
-                    (obj_ptr->instance == objectinstance)) {
-                    /* an object that is known to exist */
-                    debug_printf(3,
-                        "html: Requesting Device %d Properties for %s %d \n",
-                        dev_ptr->device, enum_to_text_object(objecttype),
-                        objectinstance);
-                    /* properties of this type of object */
-                    prop_ptr = getobjectprops(objecttype);
-                    while (*prop_ptr != PROP_NO_PROPERTY) {
-                        /* send read-property to object properties */
-                        read_property(dev_ptr->device, objecttype,
-                            objectinstance, *prop_ptr,
-                            -1 /* array index */ );
-                        prop_ptr++;     /* increment to next property */
-                    }
-                    break;      /* exit for j loop */
+            /* an object that is known to exist */
+            obj_ptr = object_find(dev_ptr->device, objecttype,
+                objectinstance);
+            if (obj_ptr) {
+                debug_printf(3,
+                    "html: Requesting Device %d Properties for %s %d \n",
+                    dev_ptr->device, enum_to_text_object(objecttype),
+                    objectinstance);
+                /* properties of this type of object */
+                prop_ptr = getobjectprops(objecttype);
+                while (*prop_ptr != PROP_NO_PROPERTY) {
+                    /* send read-property to object properties */
+                    read_property(dev_ptr->device, objecttype,
+                        objectinstance, *prop_ptr, -1 /* array index */ );
+                    prop_ptr++; /* increment to next property */
                 }
-            }                   /* all known objects list */
+            }
         }
         DString_Concat(response_html,
             "</table>\n" "</body>\n" "</html>\n");
@@ -712,6 +739,13 @@ static void construct_status_page(OS_DString response_html)
     time_t t = 0;               // used for the current time
     float duration = 0.0;       // used to calculate the server duration uptime
     OS_DString status_html;     // used to form each status
+    struct gpio_scan *scan;     // GPIO input scan statistics
+    const struct gpio_commit_stats *commits;    // GPIO output writes
+    struct gpio_io_stats io_stats;      // GPIO I/O thread counters
+    unsigned long startup_usec; // time from start to the first I-Am
+    const struct slab_stats *pool;      // memory pool counters
+    struct intern_stats strings;        // shared name and state texts
+    int i;                      // counter
 
     status_html = DString_Create();
     if (!status_html)
@@ -778,6 +812,141 @@ static void construct_status_page(OS_DString response_html)
             "<td>%d</td>" "</tr>\n", BACnet_HTTP_Port);
         DString_Concat(response_html, DString_Data(status_html));
 
+        DString_Printf(status_html,
+            "<tr>" "<th colspan=\"2\">GPIO:</th>" "</tr>\n");
+        DString_Concat(response_html, DString_Data(status_html));
+
+        DString_Printf(status_html,
+            "<tr>" "<td>Backend</td>"
+            "<td>%s on %s</td>" "</tr>\n", gpio_backend_name(), GPIO_Chip);
+        DString_Concat(response_html, DString_Data(status_html));
+
+        DString_Printf(status_html,
+            "<tr>" "<td>PWM</td>"
+            "<td>%s on %s</td>" "</tr>\n", gpio_pwm_name(), PWM_Chip);
+        DString_Concat(response_html, DString_Data(status_html));
+
+        DString_Printf(status_html,
+            "<tr>" "<td>ADC</td>"
+            "<td>%s on %s</td>" "</tr>\n", gpio_adc_name(), ADC_Device);
+        DString_Concat(response_html, DString_Data(status_html));
+
+        gpio_objects_io_stats(&io_stats);
+        if (gpio_objects_io_thread()) {
+            DString_Printf(status_html,
+                "<tr>" "<td>I/O thread</td>"
+                "<td>%lu passes, longest %lu us on hardware</td>" "</tr>\n",
+                io_stats.passes, (unsigned long) (io_stats.max_busy_ns / 1000));
+        } else {
+            DString_Printf(status_html,
+                "<tr>" "<td>I/O thread</td>"
+                "<td>not running - driven from the main loop</td>" "</tr>\n");
+        }
+        DString_Concat(response_html, DString_Data(status_html));
+
+        commits = gpio_objects_commit_stats();
+        DString_Printf(status_html,
+            "<tr>" "<td>Output writes</td>"
+            "<td>%lu to hardware (%lu failed), %lu suppressed "
+            "(%lu coalesced, %lu unchanged) of %lu, %lu deferred</td>" "</tr>\n",
+            io_stats.writes, io_stats.write_errors,
+            commits->coalesced + commits->unchanged,
+            commits->coalesced, commits->unchanged, commits->staged,
+            commits->deferred);
+        DString_Concat(response_html, DString_Data(status_html));
+
+        scan = gpio_objects_input_scan();
+        if (scan) {
+            DString_Printf(status_html,
+                "<tr>" "<td>Input scan</td>"
+                "<td>%d inputs in %lu us (%lu scans, %s, %lu edges)</td>" "</tr>\n",
+                scan->num_lines, (unsigned long) (io_stats.scan_duration_ns / 1000),
+                io_stats.scans, scan->edges ? "edge events" : "polled",
+                io_stats.edges);
+            DString_Concat(response_html, DString_Data(status_html));
+        }
+
+        if (io_stats.adc_bursts) {
+            DString_Printf(status_html,
+                "<tr>" "<td>Analog inputs</td>"
+                "<td>%lu conversions in %lu bursts, last %lu us "
+                "(%lu failed)</td>" "</tr>\n",
+                io_stats.adc_conversions, io_stats.adc_bursts,
+                (unsigned long) (io_stats.adc_burst_ns / 1000),
+                io_stats.adc_errors);
+            DString_Concat(response_html, DString_Data(status_html));
+        }
+
+        DString_Printf(status_html,
+            "<tr>" "<td>Input glitches filtered</td>"
+            "<td>%lu</td>" "</tr>\n", io_stats.glitches);
+        DString_Concat(response_html, DString_Data(status_html));
+
+        DString_Printf(status_html,
+            "<tr>" "<th colspan=\"2\">Startup:</th>" "</tr>\n");
+        DString_Concat(response_html, DString_Data(status_html));
+
+        startup_usec = 0;
+        for (i = 0; i < MAX_STARTUP_PHASES; i++) {
+            DString_Printf(status_html,
+                "<tr>" "<td>%s</td>"
+                "<td>%lu us</td>" "</tr>\n",
+                Startup_Phase_Name[i], Startup_Phase_Usec[i]);
+            DString_Concat(response_html, DString_Data(status_html));
+            startup_usec += Startup_Phase_Usec[i];
+        }
+
+        DString_Printf(status_html,
+            "<tr>" "<td>Time to first I-Am</td>"
+            "<td>%lu us</td>" "</tr>\n", startup_usec);
+        DString_Concat(response_html, DString_Data(status_html));
+
+        DString_Printf(status_html,
+            "<tr>" "<th colspan=\"2\">Invoke IDs:</th>" "</tr>\n");
+        DString_Concat(response_html, DString_Data(status_html));
+
+        DString_Printf(status_html,
+            "<tr>" "<td>In use</td>"
+            "<td>%d of %d allowed</td>" "</tr>\n",
+            invoke_id_in_use(), BACnet_Invoke_Ids);
+        DString_Concat(response_html, DString_Data(status_html));
+
+        DString_Printf(status_html,
+            "<tr>" "<td>High water</td>"
+            "<td>%d of %d</td>" "</tr>\n",
+            invoke_id_high_water(), MAXTRANSACTIONS);
+        DString_Concat(response_html, DString_Data(status_html));
+
+        DString_Printf(status_html,
+            "<tr>" "<th colspan=\"2\">Memory Pools:</th>" "</tr>\n");
+        DString_Concat(response_html, DString_Data(status_html));
+
+        for (i = 0; i < slab_stats_count(); i++) {
+            pool = slab_stats_at(i);
+            DString_Printf(status_html,
+                "<tr>" "<td>%s</td>"
+                "<td>%lu in use of %lu (peak %lu), %lu slabs of "
+                "%u byte records, %lu allocs, %lu frees</td>" "</tr>\n",
+                pool->name, pool->in_use, pool->capacity, pool->high_water,
+                pool->slabs, (unsigned) pool->object_size, pool->allocs,
+                pool->frees);
+            DString_Concat(response_html, DString_Data(status_html));
+        }
+
+        intern_get_stats(&strings);
+        DString_Printf(status_html,
+            "<tr>" "<td>Names and state texts</td>"
+            "<td>%lu distinct, %lu references</td>" "</tr>\n",
+            strings.strings, strings.references);
+        DString_Concat(response_html, DString_Data(status_html));
+
+        DString_Printf(status_html,
+            "<tr>" "<td>String memory</td>"
+            "<td>%lu bytes shared, %lu bytes as separate copies</td>"
+            "</tr>\n", (unsigned long) strings.interned_bytes,
+            (unsigned long) strings.copy_bytes);
+        DString_Concat(response_html, DString_Data(status_html));
+
         DString_Printf(status_html,
             "<tr>" "<th colspan=\"2\">Structure Sizeofs:</th>" "</tr>\n");
         DString_Concat(response_html, DString_Data(status_html));
@@ -0,0 +1,369 @@
+/*
+ * Interned String Table for BACnet4Linux
+ * Each distinct text is kept once, in an entry that carries its
+ * reference count and hash, in an open addressing table of entries.
+ * A release goes straight from the text to its entry, so only the
+ * last release of a text has to touch the table.  Entries are also
+ * numbered, the most recently freed id first, so a text can be kept as
+ * a 20 bit id.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "debug.h"
+#include "intern.h"
+
+struct intern_entry {
+    uint32_t references;
+    uint32_t hash;
+    uint32_t length;
+    uint32_t id;
+    char text[];
+};
+
+static struct intern_entry **Slots = NULL;
+static unsigned Slot_Mask = 0;  /* slots - 1 */
+static struct intern_stats Stats;
+// entries by id, and the ids given back, most recent last
+static struct intern_entry **Entries = NULL;
+static uint32_t *Free_Ids = NULL;
+static uint32_t Entry_Size = 0; /* ids 0 .. Entry_Size - 1 */
+static uint32_t Next_Id = 1;    /* lowest id never handed out */
+static uint32_t Free_Count = 0;
+
+static struct intern_entry *intern_entry_of(char *text)
+{
+    return (struct intern_entry *) (text -
+        offsetof(struct intern_entry, text));
+}
+
+/* FNV-1a */
+static uint32_t intern_hash(const char *text, size_t length)
+{
+    uint32_t hash = 2166136261u;
+    size_t i;
+
+    for (i = 0; i < length; i++) {
+        hash ^= (uint8_t) text[i];
+        hash *= 16777619u;
+    }
+
+    return hash;
+}
+
+static bool intern_resize(unsigned slot_count)
+{
+    struct intern_entry **old_slots = Slots;
+    unsigned old_slot_count = Slots ? Slot_Mask + 1 : 0;
+    struct intern_entry **slots;
+    unsigned i, slot;
+
+    slots = calloc(slot_count, sizeof(*slots));
+    if (!slots) {
+        error_printf("Intern: Unable to allocate %u slots\n", slot_count);
+        return false;
+    }
+    Slots = slots;
+    Slot_Mask = slot_count - 1;
+    for (i = 0; i < old_slot_count; i++) {
+        if (!old_slots[i])
+            continue;
+        slot = old_slots[i]->hash & Slot_Mask;
+        while (Slots[slot])
+            slot = (slot + 1) & Slot_Mask;
+        Slots[slot] = old_slots[i];
+    }
+    free(old_slots);
+
+    return true;
+}
+
+static uint32_t intern_new_id(void)
+{
+    struct intern_entry **entries;
+    uint32_t *free_ids;
+    uint32_t size;
+
+    if (Free_Count)
+        return Free_Ids[--Free_Count];
+    if (Next_Id >= INTERN_MAX_IDS) {
+        error_printf("Intern: Out of ids\n");
+        return 0;
+    }
+    if (Next_Id >= Entry_Size) {
+        size = Entry_Size ? Entry_Size * 2 : INTERN_MIN_SLOTS;
+        entries = realloc(Entries, size * sizeof(*entries));
+        if (!entries) {
+            error_printf("Intern: Unable to allocate %u ids\n", size);
+            return 0;
+        }
+        Entries = entries;
+        free_ids = realloc(Free_Ids, size * sizeof(*free_ids));
+        if (!free_ids) {
+            error_printf("Intern: Unable to allocate %u ids\n", size);
+            return 0;
+        }
+        Free_Ids = free_ids;
+        Entry_Size = size;
+    }
+
+    return Next_Id++;
+}
+
+char *intern_string(const char *text)
+{
+    struct intern_entry *entry;
+    size_t length;
+    uint32_t hash;
+    unsigned slot;
+
+    if (!text)
+        return NULL;
+    length = strlen(text);
+    hash = intern_hash(text, length);
+    if (Slots) {
+        for (slot = hash & Slot_Mask; (entry = Slots[slot]);
+            slot = (slot + 1) & Slot_Mask) {
+            if ((entry->hash == hash) && (entry->length == length) &&
+                (memcmp(entry->text, text, length) == 0)) {
+                entry->references++;
+                Stats.references++;
+                Stats.copy_bytes += length + 1;
+                return entry->text;
+            }
+        }
+    }
+    // no more than half full
+    if (!Slots || ((Stats.strings + 1) * 2 > Slot_Mask + 1)) {
+        if (!intern_resize(Slots ? (Slot_Mask + 1) * 2 : INTERN_MIN_SLOTS))
+            return NULL;
+    }
+    entry = malloc(sizeof(*entry) + length + 1);
+    if (!entry) {
+        error_printf("Intern: Unable to allocate %lu byte string\n",
+            (unsigned long) length);
+        return NULL;
+    }
+    entry->id = intern_new_id();
+    if (!entry->id) {
+        free(entry);
+        return NULL;
+    }
+    Entries[entry->id] = entry;
+    entry->references = 1;
+    entry->hash = hash;
+    entry->length = (uint32_t) length;
+    memcpy(entry->text, text, length + 1);
+    for (slot = hash & Slot_Mask; Slots[slot]; slot = (slot + 1) & Slot_Mask);
+    Slots[slot] = entry;
+    Stats.strings++;
+    Stats.references++;
+    Stats.copy_bytes += length + 1;
+    Stats.interned_bytes += sizeof(*entry) + length + 1;
+
+    return entry->text;
+}
+
+void intern_release(char *text)
+{
+    struct intern_entry *entry;
+    unsigned hole, slot, home;
+
+    if (!text)
+        return;
+    entry = intern_entry_of(text);
+    Stats.references--;
+    Stats.copy_bytes -= entry->length + 1;
+    if (--entry->references)
+        return;
+
+    for (hole = entry->hash & Slot_Mask; Slots[hole] != entry;
+        hole = (hole + 1) & Slot_Mask);
+    Slots[hole] = NULL;
+    // pull back any later entry of the run that the hole now cuts off
+    // from its home slot
+    for (slot = (hole + 1) & Slot_Mask; Slots[slot];
+        slot = (slot + 1) & Slot_Mask) {
+        home = Slots[slot]->hash & Slot_Mask;
+        if (((slot - home) & Slot_Mask) >= ((slot - hole) & Slot_Mask)) {
+            Slots[hole] = Slots[slot];
+            Slots[slot] = NULL;
+            hole = slot;
+        }
+    }
+    Entries[entry->id] = NULL;
+    Free_Ids[Free_Count++] = entry->id;
+    Stats.strings--;
+    Stats.interned_bytes -= sizeof(*entry) + entry->length + 1;
+    free(entry);
+}
+
+void intern_assign(char **field, const char *text)
+{
+    char *old = *field;
+
+    // take the new reference first, in case text is the old string
+    *field = intern_string(text);
+    intern_release(old);
+}
+
+uint32_t intern_id(const char *text)
+{
+    char *interned = intern_string(text);
+
+    return interned ? intern_entry_of(interned)->id : 0;
+}
+
+const char *intern_text(uint32_t id)
+{
+    if (!id || (id >= Next_Id) || !Entries[id])
+        return NULL;
+
+    return Entries[id]->text;
+}
+
+void intern_release_id(uint32_t id)
+{
+    intern_release((char *) intern_text(id));
+}
+
+void intern_get_stats(struct intern_stats *stats)
+{
+    *stats = Stats;
+}
+
+#ifdef TEST
+#include <assert.h>
+#include <stdio.h>
+
+#include "ctest.h"
+
+void testIntern(Test * pTest)
+{
+    char *texts[2000];
+    char buffer[32];
+    char *active, *active2, *inactive, *field = NULL;
+    struct intern_stats stats;
+    uint32_t id;
+    unsigned errors = 0;
+    int i;
+
+    ct_test(pTest, intern_string(NULL) == NULL);
+    active = intern_string("Active");
+    active2 = intern_string("Active");
+    ct_test(pTest, active != NULL);
+    ct_test(pTest, active == active2);
+    ct_test(pTest, strcmp(active, "Active") == 0);
+    inactive = intern_string("Inactive");
+    ct_test(pTest, inactive != active);
+    intern_get_stats(&stats);
+    ct_test(pTest, stats.strings == 2);
+    ct_test(pTest, stats.references == 3);
+    ct_test(pTest, stats.copy_bytes == 7 + 7 + 9);
+
+    // a release keeps the text while others hold it
+    intern_release(active2);
+    ct_test(pTest, strcmp(active, "Active") == 0);
+    ct_test(pTest, intern_string("Active") == active);
+    intern_release(active);
+    intern_release(active);
+    intern_release(intern_string("Inactive"));
+    intern_release(inactive);
+    intern_get_stats(&stats);
+    ct_test(pTest, stats.strings == 0);
+    ct_test(pTest, stats.references == 0);
+    ct_test(pTest, stats.copy_bytes == 0);
+    ct_test(pTest, stats.interned_bytes == 0);
+
+    // many texts, each held twice, through growth and deletes
+    for (i = 0; i < 2000; i++) {
+        snprintf(buffer, sizeof(buffer), "AHU-%d Supply Temp", i % 1000);
+        texts[i] = intern_string(buffer);
+        if (!texts[i] || strcmp(texts[i], buffer))
+            errors++;
+    }
+    ct_test(pTest, errors == 0);
+    intern_get_stats(&stats);
+    ct_test(pTest, stats.strings == 1000);
+    ct_test(pTest, stats.references == 2000);
+    ct_test(pTest, stats.interned_bytes < stats.copy_bytes);
+    for (i = 0; i < 1000; i++) {
+        if (texts[i] != texts[i + 1000])
+            errors++;
+    }
+    ct_test(pTest, errors == 0);
+    for (i = 0; i < 1000; i += 2) {
+        intern_release(texts[i]);
+        intern_release(texts[i + 1000]);
+    }
+    intern_get_stats(&stats);
+    ct_test(pTest, stats.strings == 500);
+    for (i = 1; i < 1000; i += 2) {
+        snprintf(buffer, sizeof(buffer), "AHU-%d Supply Temp", i);
+        if (intern_string(buffer) != texts[i])
+            errors++;
+        intern_release(texts[i]);
+    }
+    ct_test(pTest, errors == 0);
+
+    // assigning replaces and releases
+    intern_assign(&field, "On");
+    ct_test(pTest, strcmp(field, "On") == 0);
+    intern_assign(&field, field);
+    ct_test(pTest, strcmp(field, "On") == 0);
+    intern_assign(&field, "Off");
+    ct_test(pTest, strcmp(field, "Off") == 0);
+    intern_assign(&field, NULL);
+    ct_test(pTest, field == NULL);
+
+    // ids reach the same shared texts
+    ct_test(pTest, intern_id(NULL) == 0);
+    ct_test(pTest, intern_text(0) == NULL);
+    id = intern_id("Supply Fan");
+    ct_test(pTest, id != 0);
+    ct_test(pTest, id < INTERN_MAX_IDS);
+    ct_test(pTest, intern_id("Supply Fan") == id);
+    ct_test(pTest, strcmp(intern_text(id), "Supply Fan") == 0);
+    active = intern_string("Supply Fan");
+    ct_test(pTest, active == intern_text(id));
+    intern_release(active);
+    intern_release_id(id);
+    ct_test(pTest, intern_text(id) != NULL);
+    intern_release_id(id);
+    ct_test(pTest, intern_text(id) == NULL);
+    // a freed id is handed out again
+    ct_test(pTest, intern_id("Return Fan") == id);
+    intern_release_id(id);
+    for (i = 1; i < 2000; i += 2)
+        intern_release(texts[i]);
+    intern_get_stats(&stats);
+    ct_test(pTest, stats.strings == 0);
+    ct_test(pTest, stats.references == 0);
+
+    return;
+}
+
+#ifdef TEST_INTERN
+int main(void)
+{
+    Test *pTest;
+    bool rc;
+
+    pTest = ct_create("intern", NULL);
+
+    /* individual tests */
+    rc = ct_addTestFunction(pTest, testIntern);
+    assert(rc);
+
+    ct_setStream(pTest, stdout);
+    ct_run(pTest);
+    (void) ct_report(pTest);
+
+    ct_destroy(pTest);
+
+    return 0;
+}
+#endif                          /* TEST_INTERN */
+#endif                          /* TEST */
@@ -0,0 +1,245 @@
+/*
+ * Object Index for BACnet4Linux
+ * An open addressing hash table over every object of every device,
+ * keyed on (device, type, instance).  Linear probing keeps a lookup to
+ * a cache line or two, and deletes shift the entries after them back
+ * rather than leaving tombstones, so the table never needs a cleanup
+ * pass.  It stays at most half full and doubles when it gets there.
+ */
+
+#include <stdlib.h>
+#include "key.h"
+#include "debug.h"
+#include "object_index.h"
+
+struct object_index_slot {
+    uint64_t key;               /* device in the top half, KEY below */
+    struct ObjectRef_Struct *obj_ptr;   /* NULL if the slot is empty */
+};
+
+static struct object_index_slot *Slots = NULL;
+static unsigned Slot_Mask = 0;  /* slots - 1 */
+static int Slot_Bits = 0;       /* log2 of slots */
+static int Count = 0;           /* slots in use */
+
+static uint64_t object_index_key(int device_id, enum BACnetObjectType type,
+    int instance)
+{
+    return ((uint64_t) (uint32_t) device_id << 32) |
+        KEY_ENCODE(type, instance);
+}
+
+// Fibonacci hashing - the multiply mixes every key bit into the top
+// bits, which become the home slot
+static unsigned object_index_home(uint64_t key)
+{
+    return (unsigned) ((key * 0x9E3779B97F4A7C15ULL) >> (64 - Slot_Bits));
+}
+
+// move every entry into a table of the given size
+static bool object_index_resize(int bits)
+{
+    struct object_index_slot *old_slots = Slots;
+    unsigned old_slot_count = Slots ? Slot_Mask + 1 : 0;
+    struct object_index_slot *slots;
+    unsigned i, slot;
+
+    slots = calloc((size_t) 1 << bits, sizeof(*slots));
+    if (!slots) {
+        error_printf("Object Index: Unable to allocate %u slots\n",
+            1u << bits);
+        return false;
+    }
+    Slots = slots;
+    Slot_Bits = bits;
+    Slot_Mask = (1u << bits) - 1;
+    for (i = 0; i < old_slot_count; i++) {
+        if (!old_slots[i].obj_ptr)
+            continue;
+        slot = object_index_home(old_slots[i].key);
+        while (Slots[slot].obj_ptr)
+            slot = (slot + 1) & Slot_Mask;
+        Slots[slot] = old_slots[i];
+    }
+    free(old_slots);
+
+    return true;
+}
+
+// finds the slot holding key, or the empty slot that ends its run
+static unsigned object_index_probe(uint64_t key)
+{
+    unsigned slot = object_index_home(key);
+
+    while (Slots[slot].obj_ptr && (Slots[slot].key != key))
+        slot = (slot + 1) & Slot_Mask;
+
+    return slot;
+}
+
+// adds an object, or points an existing entry at it
+bool object_index_add(int device_id, struct ObjectRef_Struct *obj_ptr)
+{
+    uint64_t key;
+    unsigned slot;
+    int bits;
+
+    if (!obj_ptr)
+        return false;
+    // no more than half full
+    if (!Slots || ((unsigned) (Count + 1) * 2 > Slot_Mask + 1)) {
+        bits = Slots ? Slot_Bits + 1 : 0;
+        while ((1 << bits) < OBJECT_INDEX_MIN_SLOTS)
+            bits++;
+        if (!object_index_resize(bits))
+            return false;
+    }
+    key = ((uint64_t) (uint32_t) device_id << 32) | obj_ptr->key;
+    slot = object_index_probe(key);
+    if (!Slots[slot].obj_ptr)
+        Count++;
+    Slots[slot].key = key;
+    Slots[slot].obj_ptr = obj_ptr;
+
+    return true;
+}
+
+struct ObjectRef_Struct *object_index_find(int device_id,
+    enum BACnetObjectType type, int instance)
+{
+    if (!Slots)
+        return NULL;
+
+    return Slots[object_index_probe(object_index_key(device_id, type,
+                instance))].obj_ptr;
+}
+
+bool object_index_remove(int device_id, enum BACnetObjectType type,
+    int instance)
+{
+    unsigned hole, slot, home;
+
+    if (!Slots)
+        return false;
+    hole = object_index_probe(object_index_key(device_id, type, instance));
+    if (!Slots[hole].obj_ptr)
+        return false;
+    Slots[hole].obj_ptr = NULL;
+    Count--;
+    // pull back any later entry of the run that the hole now cuts off
+    // from its home slot
+    for (slot = (hole + 1) & Slot_Mask; Slots[slot].obj_ptr;
+        slot = (slot + 1) & Slot_Mask) {
+        home = object_index_home(Slots[slot].key);
+        if (((slot - home) & Slot_Mask) >= ((slot - hole) & Slot_Mask)) {
+            Slots[hole] = Slots[slot];
+            Slots[slot].obj_ptr = NULL;
+            hole = slot;
+        }
+    }
+
+    return true;
+}
+
+int object_index_count(void)
+{
+    return Count;
+}
+
+void object_index_cleanup(void)
+{
+    free(Slots);
+    Slots = NULL;
+    Slot_Mask = 0;
+    Slot_Bits = 0;
+    Count = 0;
+}
+
+#ifdef TEST
+#include <assert.h>
+#include <stdio.h>
+
+#include "bacnet_object.h"
+#include "ctest.h"
+
+void testObjectIndex(Test * pTest)
+{
+    static struct ObjectRef_Struct objects[3000];
+    struct ObjectRef_Struct other;
+    unsigned errors = 0;
+    int device_id, i;
+
+    // three devices with overlapping object ids
+    for (i = 0; i < 3000; i++) {
+        objects[i].key = KEY_ENCODE((i & 1) ? OBJECT_BINARY_INPUT :
+            OBJECT_ANALOG_INPUT, (i % 1000) / 2);
+        if (!object_index_add(i / 1000, &objects[i]))
+            errors++;
+    }
+    ct_test(pTest, errors == 0);
+    ct_test(pTest, object_index_count() == 3000);
+    for (i = 0; i < 3000; i++) {
+        if (object_index_find(i / 1000, object_type(&objects[i]),
+                object_instance(&objects[i])) != &objects[i])
+            errors++;
+    }
+    ct_test(pTest, errors == 0);
+    ct_test(pTest, object_index_find(3, OBJECT_ANALOG_INPUT, 0) == NULL);
+    ct_test(pTest, object_index_find(0, OBJECT_ANALOG_OUTPUT, 0) == NULL);
+
+    // adding again replaces the entry
+    other = objects[0];
+    ct_test(pTest, object_index_add(0, &other));
+    ct_test(pTest, object_index_count() == 3000);
+    ct_test(pTest, object_index_find(0, object_type(&other),
+            object_instance(&other)) == &other);
+
+    // deleting every other entry leaves the rest findable
+    for (i = 0; i < 3000; i += 2) {
+        if (!object_index_remove(i / 1000, object_type(&objects[i]),
+                object_instance(&objects[i])))
+            errors++;
+    }
+    ct_test(pTest, errors == 0);
+    ct_test(pTest, object_index_count() == 1500);
+    ct_test(pTest, !object_index_remove(0, object_type(&objects[0]),
+            object_instance(&objects[0])));
+    for (i = 0; i < 3000; i++) {
+        device_id = i / 1000;
+        if (object_index_find(device_id, object_type(&objects[i]),
+                object_instance(&objects[i])) !=
+            ((i & 1) ? &objects[i] : NULL))
+            errors++;
+    }
+    ct_test(pTest, errors == 0);
+
+    object_index_cleanup();
+    ct_test(pTest, object_index_count() == 0);
+    ct_test(pTest, object_index_find(1, object_type(&objects[1]),
+            object_instance(&objects[1])) == NULL);
+
+    return;
+}
+
+#ifdef TEST_OBJECT_INDEX
+int main(void)
+{
+    Test *pTest;
+    bool rc;
+
+    pTest = ct_create("object index", NULL);
+
+    /* individual tests */
+    rc = ct_addTestFunction(pTest, testObjectIndex);
+    assert(rc);
+
+    ct_setStream(pTest, stdout);
+    ct_run(pTest);
+    (void) ct_report(pTest);
+
+    ct_destroy(pTest);
+
+    return 0;
+}
+#endif                          /* TEST_OBJECT_INDEX */
+#endif                          /* TEST */
@@ -37,8 +37,10 @@
 // common global configuration options
 // the device instance that this will be (0-4194303)
 int BACnet_Device_Instance = 2;
-// APDU timeout (for retries) in seconds 
-int BACnet_APDU_Timeout = 10;
+// APDU timeout (for retries) in milliseconds
+int BACnet_APDU_Timeout = 10000;
+// times a request is sent again before it fails
+int BACnet_APDU_Retries = 3;
 // the BACnet Vendor ID that will be used (0 == ASHRAE)
 // Note: ASHRAE maintains the list of Vendor Ids - see them for one.
 int BACnet_Vendor_Identifier = 6;
@@ -62,21 +64,24 @@ void options_usage(void)
         " -iname BACnet Ethernet interface name (eth0, eth1, etc.)\n"
         " -m###  BACnet MS/TP port number (0-65534)\n"
         " -p###  BACnet/IP UDP port number (0=disabled,1-65534,0xBAC0)\n"
-        " -t###  BACnet APDU timeout (seconds)\n"
+        " -n###  BACnet APDU retries (0-%d)\n"
+        " -t###  BACnet APDU timeout until a device's own is learned\n"
+        "        (seconds, 0.25 for 250 ms)\n"
         " -v###  BACnet Vendor Identifier (0-65534)\n"
-        " -V     Returns the version information\n");
+        " -V     Returns the version information\n", APDU_RETRIES_MAX);
 
     return;
 }
 
 void options_default(void)
 {
-    printf("-d%d -e%d -i%s -m%d -p%d -t%d -v%d\n",
+    printf("-d%d -e%d -i%s -m%d -n%d -p%d -t%g -v%d\n",
         BACnet_Device_Instance,
         BACnet_Ethernet_Enable,
         BACnet_Device_Interface,
-        BACnet_MSTP_Port,
-        BACnet_UDP_Port, BACnet_APDU_Timeout, BACnet_Vendor_Identifier);
+        BACnet_MSTP_Port, BACnet_APDU_Retries,
+        BACnet_UDP_Port, BACnet_APDU_Timeout / 1000.0,
+        BACnet_Vendor_Identifier);
 
     return;
 }
@@ -88,6 +93,7 @@ void options_interpret_arguments(int argc, char *argv[])
     int i = 0;                  /* used to index through arguments */
     char *p_arg = NULL;         /* points to current argument */
     long number = 0;            /* used for strtol */
+    double seconds = 0.0;       /* used for strtod */
     char *p_data = NULL;        /* points to data portion of argument */
 
     if (!argv)
@@ -122,6 +128,14 @@ void options_interpret_arguments(int argc, char *argv[])
                     printf("Invalid BACnet Ethernet interface. "
                         "Using default.\n");
                 break;
+            case 'n':
+                number = strtol(p_data, NULL, 0);
+                if ((number >= 0L) && (number <= APDU_RETRIES_MAX))
+                    BACnet_APDU_Retries = number;
+                else
+                    printf("Invalid BACnet APDU retries. "
+                        "Using default.\n");
+                break;
             case 'p':
                 number = strtol(p_data, NULL, 0);
                 if ((number >= 0L) && (number <= 0xFFFFL))
@@ -131,8 +145,12 @@ void options_interpret_arguments(int argc, char *argv[])
                         "Using default.\n");
                 break;
             case 't':
-                number = strtol(p_data, NULL, 0);
-                BACnet_APDU_Timeout = number;
+                seconds = strtod(p_data, NULL);
+                if ((seconds >= 0.001) && (seconds <= 3600.0))
+                    BACnet_APDU_Timeout = (int) (seconds * 1000.0 + 0.5);
+                else
+                    printf("Invalid BACnet APDU timeout. "
+                        "Using default.\n");
                 break;
             case 'v':
                 number = strtol(p_data, NULL, 0);
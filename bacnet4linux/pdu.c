@@ -77,6 +77,47 @@ void npdu_free(struct BACnet_NPDU *npdu)
         free(npdu);
 }
 
+/* encodes the network layer of a packet - the NPCI and the APDU -
+   into pdu, which must hold NPDU_HEADER_MAX + apdu_len bytes.  This
+   is the part of a frame that is the same on every data link.
+   Returns the number of bytes encoded. */
+int npdu_encode(uint8_t * pdu, struct BACnet_NPDU *npdu, uint8_t * apdu,
+    int apdu_len)
+{
+    int pdu_len = 0;
+
+    pdu[pdu_len++] = npdu->version;     /* NPDU... Version */
+    pdu[pdu_len++] = npdu->control_byte;        /* Control Byte */
+    if (npdu->dest_present) {
+        pdu[pdu_len++] = (npdu->dest.net >> 8) & 0xFF;
+        pdu[pdu_len++] = npdu->dest.net & 0xFF;
+        pdu[pdu_len++] = npdu->dest.len;
+        if (npdu->dest.len == 6) {      /* dest.adr is present for ethernet */
+            memcpy(&pdu[pdu_len], npdu->dest.adr, 6);
+            pdu_len += 6;
+        } else if (npdu->dest.len == 1)       /* dest.adr is present for arcnet, ms/tp */
+            pdu[pdu_len++] = npdu->dest.adr[0];
+    }
+    if (npdu->src_present) {
+        pdu[pdu_len++] = (npdu->src.net >> 8) & 0xFF;
+        pdu[pdu_len++] = npdu->src.net & 0xFF;
+        pdu[pdu_len++] = npdu->src.len;
+        if (npdu->src.len == 6) {       /* src.adr is present for ethernet */
+            memcpy(&pdu[pdu_len], npdu->src.adr, 6);
+            pdu_len += 6;
+        }
+    }
+    if (npdu->dest_present)
+        pdu[pdu_len++] = 0xFF;  /* hop count */
+    /* there is a network message, not an APDU */
+    if (npdu->network_message)
+        pdu[pdu_len++] = npdu->message_type;
+    /* at this point only the APDU is remaining */
+    memcpy(&pdu[pdu_len], apdu, apdu_len);
+    pdu_len += apdu_len;
+
+    return pdu_len;
+}
 
 unsigned char *pdu_alloc(void)
 {
@@ -0,0 +1,255 @@
+/*
+ * Slab Pools for BACnet4Linux
+ * Fixed size records (devices, objects, keylists) are carved out of
+ * slabs rather than malloc'd one at a time.  An alloc or free is a
+ * push or pop on the pool's free list, the records of a pool sit
+ * together in memory, and a whole pool - all the objects of one
+ * device - goes back to the heap in a few frees.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "debug.h"
+#include "slab.h"
+
+struct slab {
+    struct slab *next;
+    // records follow, starting on a SLAB_ALIGN boundary
+};
+
+#define SLAB_HEADER_SIZE \
+    ((sizeof(struct slab) + SLAB_ALIGN - 1) & ~(size_t) (SLAB_ALIGN - 1))
+
+static struct slab_stats *Slab_Stats[SLAB_MAX_STATS];
+static int Slab_Stats_Count = 0;
+
+void slab_pool_init(struct slab_pool *pool, struct slab_stats *stats,
+    size_t object_size, unsigned slab_objects)
+{
+    memset(pool, 0, sizeof(*pool));
+    // room for the free list link, rounded up to the alignment
+    if (object_size < sizeof(void *))
+        object_size = sizeof(void *);
+    pool->object_size = (object_size + SLAB_ALIGN - 1) &
+        ~(size_t) (SLAB_ALIGN - 1);
+    pool->slab_objects = slab_objects ? slab_objects : 1;
+    pool->stats = stats;
+    if (stats) {
+        stats->object_size = pool->object_size;
+        if (!stats->registered && (Slab_Stats_Count < SLAB_MAX_STATS)) {
+            Slab_Stats[Slab_Stats_Count++] = stats;
+            stats->registered = true;
+        }
+    }
+}
+
+// adds a slab and puts its records on the free list
+static bool slab_grow(struct slab_pool *pool)
+{
+    void *memory;
+    struct slab *slab;
+    char *record;
+    unsigned i;
+
+    // malloc only promises 8 bytes on 32-bit ARM, so ask for the
+    // boundary the records are laid out on
+    if (posix_memalign(&memory, SLAB_ALIGN, SLAB_HEADER_SIZE +
+            pool->object_size * pool->slab_objects) != 0)
+        memory = NULL;
+    slab = memory;
+    if (!slab) {
+        error_printf("Slab: Unable to allocate %u %s\n",
+            pool->slab_objects, pool->stats ? pool->stats->name : "records");
+        return false;
+    }
+    slab->next = pool->slabs;
+    pool->slabs = slab;
+    // thread the records so the first one is handed out first
+    record = (char *) slab + SLAB_HEADER_SIZE +
+        pool->object_size * pool->slab_objects;
+    for (i = 0; i < pool->slab_objects; i++) {
+        record -= pool->object_size;
+        *(void **) record = pool->free_list;
+        pool->free_list = record;
+    }
+    pool->capacity += pool->slab_objects;
+    pool->slab_count++;
+    if (pool->stats) {
+        pool->stats->capacity += pool->slab_objects;
+        pool->stats->slabs++;
+    }
+
+    return true;
+}
+
+void *slab_alloc(struct slab_pool *pool)
+{
+    void *record;
+
+    if (!pool->free_list && !slab_grow(pool))
+        return NULL;
+    record = pool->free_list;
+    pool->free_list = *(void **) record;
+    memset(record, 0, pool->object_size);
+    pool->in_use++;
+    if (pool->stats) {
+        pool->stats->allocs++;
+        pool->stats->in_use++;
+        if (pool->stats->in_use > pool->stats->high_water)
+            pool->stats->high_water = pool->stats->in_use;
+    }
+
+    return record;
+}
+
+void slab_free(struct slab_pool *pool, void *record)
+{
+    if (!record)
+        return;
+    *(void **) record = pool->free_list;
+    pool->free_list = record;
+    pool->in_use--;
+    if (pool->stats) {
+        pool->stats->frees++;
+        pool->stats->in_use--;
+    }
+}
+
+void slab_pool_release(struct slab_pool *pool)
+{
+    struct slab *slab;
+
+    while ((slab = pool->slabs)) {
+        pool->slabs = slab->next;
+        free(slab);
+    }
+    if (pool->stats) {
+        pool->stats->frees += pool->in_use;
+        pool->stats->in_use -= pool->in_use;
+        pool->stats->capacity -= pool->capacity;
+        pool->stats->slabs -= pool->slab_count;
+    }
+    pool->free_list = NULL;
+    pool->in_use = 0;
+    pool->capacity = 0;
+    pool->slab_count = 0;
+}
+
+int slab_stats_count(void)
+{
+    return Slab_Stats_Count;
+}
+
+const struct slab_stats *slab_stats_at(int index)
+{
+    if ((index < 0) || (index >= Slab_Stats_Count))
+        return NULL;
+
+    return Slab_Stats[index];
+}
+
+#ifdef TEST
+#include <assert.h>
+#include <stdio.h>
+#include <stdint.h>
+
+#include "ctest.h"
+
+struct test_record {
+    double value;
+    char text[20];
+};
+
+void testSlab(Test * pTest)
+{
+    static struct slab_stats stats = { "Test records" };
+    struct slab_pool pool, other;
+    struct test_record *records[100];
+    struct test_record *record;
+    unsigned errors = 0;
+    int i;
+
+    slab_pool_init(&pool, &stats, sizeof(struct test_record), 16);
+    slab_pool_init(&other, &stats, sizeof(struct test_record), 16);
+    ct_test(pTest, pool.object_size % SLAB_ALIGN == 0);
+    ct_test(pTest, pool.object_size >= sizeof(struct test_record));
+    ct_test(pTest, slab_stats_count() == 1);
+    ct_test(pTest, slab_stats_at(0) == &stats);
+    ct_test(pTest, slab_stats_at(1) == NULL);
+
+    // records are zeroed, aligned and distinct
+    for (i = 0; i < 100; i++) {
+        records[i] = slab_alloc(&pool);
+        if (!records[i] || (records[i]->value != 0.0) ||
+            ((uintptr_t) records[i] % SLAB_ALIGN))
+            errors++;
+        else {
+            records[i]->value = i;
+            memset(records[i]->text, 'x', sizeof(records[i]->text));
+        }
+    }
+    for (i = 0; i < 100; i++) {
+        if (records[i]->value != i)
+            errors++;
+    }
+    ct_test(pTest, errors == 0);
+    ct_test(pTest, pool.in_use == 100);
+    ct_test(pTest, pool.slab_count == 7);
+    ct_test(pTest, stats.capacity == 7 * 16);
+
+    // a freed record is the next one handed out, zeroed again
+    slab_free(&pool, records[42]);
+    ct_test(pTest, stats.in_use == 99);
+    record = slab_alloc(&pool);
+    ct_test(pTest, record == records[42]);
+    ct_test(pTest, record->value == 0.0);
+    ct_test(pTest, record->text[0] == 0);
+
+    // pools of a kind share totals
+    record = slab_alloc(&other);
+    ct_test(pTest, record != NULL);
+    ct_test(pTest, stats.in_use == 101);
+    ct_test(pTest, stats.high_water == 101);
+    ct_test(pTest, stats.slabs == 8);
+
+    // releasing a pool gives back all its records at once
+    slab_pool_release(&pool);
+    ct_test(pTest, stats.in_use == 1);
+    ct_test(pTest, stats.allocs == 102);
+    ct_test(pTest, stats.frees == 101);
+    ct_test(pTest, stats.slabs == 1);
+    ct_test(pTest, stats.capacity == 16);
+    ct_test(pTest, pool.in_use == 0);
+    record = slab_alloc(&pool);
+    ct_test(pTest, record != NULL);
+    slab_pool_release(&pool);
+    slab_pool_release(&other);
+    ct_test(pTest, stats.in_use == 0);
+    ct_test(pTest, stats.slabs == 0);
+    ct_test(pTest, stats.high_water == 101);
+
+    return;
+}
+
+#ifdef TEST_SLAB
+int main(void)
+{
+    Test *pTest;
+    bool rc;
+
+    pTest = ct_create("slab", NULL);
+
+    /* individual tests */
+    rc = ct_addTestFunction(pTest, testSlab);
+    assert(rc);
+
+    ct_setStream(pTest, stdout);
+    ct_run(pTest);
+    (void) ct_report(pTest);
+
+    ct_destroy(pTest);
+
+    return 0;
+}
+#endif                          /* TEST_SLAB */
+#endif                          /* TEST */
@@ -40,6 +40,7 @@
 #include "version.h"
 #include "signal_handler.h"
 #include "gpio_objects.h"
+#include "main.h"
 
 /* globals */
 
@@ -65,24 +66,34 @@ int BACnet_Time_Sync_Seconds = 0;
 // initial polling delay is how long to wait to begin 
 // querying new devices (in seconds, 0=disable query)
 int BACnet_Initial_Query_Delay = 5;
+// GPIO chip that holds the Raspberry Pi header lines
+// ("sim" selects an in-process simulated chip)
+char *GPIO_Chip = "gpiochip4";
+// pwmchip that drives the analog outputs ("sim" for simulated PWM)
+char *PWM_Chip = "pwmchip0";
+// SPI device of the MCP3008 analog inputs ("sim" for a simulated one)
+char *ADC_Device = "spidev0.0";
 // my local device data - MAC address
 struct in_addr BACnet_Device_IP_Address = { 0 };
 
 // stores the local IP broadcast address which varies depending on subnet
 struct in_addr Local_IP_Broadcast_Address = { 0 };
 
+// how long each startup phase took (microseconds)
+unsigned long Startup_Phase_Usec[MAX_STARTUP_PHASES];
+const char *Startup_Phase_Name[MAX_STARTUP_PHASES] = {
+    "config parse",
+    "socket open",
+    "object creation",
+    "first I-Am"
+};
+
 // filename used to read initialization of device database
 char *readFile = NULL;
 // filename used to save device database
 char *writeFile = NULL;
 
 // linked list of devices to accept I-Am's from
-struct deviceRange {
-    int min;
-    int max;
-    struct deviceRange *next;
-};
-
 struct deviceRange *deviceRangeList = NULL;
 static struct deviceRange *deviceRangeTemp;
 
@@ -97,11 +108,14 @@ static void Usage(char *program_name)
         "to redistribute it under certain conditions.\n"
         "\n" "Usage:\n" "%s [options]\n", Program_Version, program_name);
     // main options
-    printf(" -c#    BACnet COV support (0=disable,1=enable)\n"
+    printf(" -Aname SPI ADC for analog inputs (spidev0.0, sim)\n"
+        " -c#    BACnet COV support (0=disable,1=enable)\n"
         " -C###  BACnet COV lifetime (seconds)\n"
         " -D#    debug level, larger is more verbose (0-9)\n"
+        " -gname GPIO chip (gpiochip4, /dev/gpiochip0, sim)\n"
         " -h###  HTTP server port (0-65534)\n"
-        " -I###  Number of concurrent queries (invoke ids)\n"
+        " -I###  Number of concurrent queries, over all devices\n"
+        " -Pname PWM chip for analog outputs (pwmchip0, sim)\n"
         " -q###  Initial query delay (seconds, 0=disable query)\n"
         " -rfilename Initialize device database from XML 'filename'\n"
         " -s###  BACnet Sync Time Periodic (seconds,0=disabled)\n"
@@ -109,12 +123,15 @@ static void Usage(char *program_name)
         " -x###-###  eXclude devices except range ### to ### (multiple -x's OK)\n");
     options_usage();
     printf("default settings:\n"
-        "-c%d -C%d -D%d -h%d -I%d -q%d -s%d\n",
+        "-A%s -c%d -C%d -D%d -g%s -h%d -I%d -P%s -q%d -s%d\n",
+        ADC_Device,
         BACnet_COV_Support,
         BACnet_COV_Lifetime,
         debug_get_level(),
+        GPIO_Chip,
         BACnet_HTTP_Port,
         BACnet_Invoke_Ids,
+        PWM_Chip,
         BACnet_Initial_Query_Delay, BACnet_Time_Sync_Seconds);
     options_default();
 
@@ -140,6 +157,13 @@ static void Interpret_Arguments(int argc, char *argv[])
         if (p_arg[0] == '-') {
             p_data = p_arg + 2;
             switch (p_arg[1]) {
+            case 'A':
+                if (p_data[0] != 0)
+                    ADC_Device = p_data;
+                else
+                    printf("Invalid ADC device. Using default.\n");
+                break;
+
             case 'c':
                 number = strtol(p_data, NULL, 0);
                 if (number)
@@ -160,6 +184,13 @@ static void Interpret_Arguments(int argc, char *argv[])
                     printf("Invalid debug level. Using default.\n");
                 break;
 
+            case 'g':
+                if (p_data[0] != 0)
+                    GPIO_Chip = p_data;
+                else
+                    printf("Invalid GPIO chip. Using default.\n");
+                break;
+
             case 'h':
                 number = strtol(p_data, NULL, 0);
                 if ((number >= 0L) && (number <= 0xFFFFL))
@@ -178,6 +209,13 @@ static void Interpret_Arguments(int argc, char *argv[])
                         "Using default.\n");
                 break;
 
+            case 'P':
+                if (p_data[0] != 0)
+                    PWM_Chip = p_data;
+                else
+                    printf("Invalid PWM chip. Using default.\n");
+                break;
+
             case 'q':
                 number = strtol(p_data, NULL, 0);
                 BACnet_Initial_Query_Delay = number;
@@ -257,6 +295,26 @@ void receive_mstp(void)
 
 }
 
+static uint64_t startup_clock_us(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (uint64_t) now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+// records and logs the time since mark, and starts the next phase
+static void startup_phase_done(enum startup_phase phase, uint64_t * mark)
+{
+    uint64_t now = startup_clock_us();
+
+    Startup_Phase_Usec[phase] = (unsigned long) (now - *mark);
+    debug_printf(1, "MAIN: Startup %s took %lu us\n",
+        Startup_Phase_Name[phase], Startup_Phase_Usec[phase]);
+    *mark = now;
+}
+
 /* main execution loop */
 int main(int argc,              /* number of arguments entered at command line */
     char *argv[])
@@ -265,6 +323,8 @@ int main(int argc,              /* number of arguments entered at command line *
     time_t startup_delay_time = 0;      // number of seconds to wait before polling
     time_t t1 = 0, t2 = 0;      // used to tell the amount of time difference
     bool relax = false;         // relax if leisurely polling time or values
+    uint64_t startup_start = startup_clock_us();
+    uint64_t startup_mark = startup_start;
 
     // interpret the command line arguments and possibly exit
     Interpret_Arguments(argc, argv);
@@ -276,8 +336,10 @@ int main(int argc,              /* number of arguments entered at command line *
         BACnet_Device_Instance);
     debug_printf(2, "MAIN:      Vendor ID: %d\n",
         BACnet_Vendor_Identifier);
-    debug_printf(2, "MAIN:      APDU Timeout: %d seconds\n",
+    debug_printf(2, "MAIN:      APDU Timeout: %d ms\n",
         BACnet_APDU_Timeout);
+    debug_printf(2, "MAIN:      APDU Retries: %d\n",
+        BACnet_APDU_Retries);
     debug_printf(2, "MAIN:      802.2 Ethernet interface: %s (%s)\n",
         BACnet_Device_Interface,
         BACnet_Ethernet_Enable ? "enabled" : "disabled");
@@ -294,9 +356,9 @@ int main(int argc,              /* number of arguments entered at command line *
     debug_printf(2, "MAIN:      NPDU      : %4d bytes\n",
         sizeof(struct BACnet_NPDU));
     debug_printf(2,
-        "MAIN:      InvokeID  : %4d bytes * %d IDs = %d bytes\n",
-        sizeof(struct Invoke_Status_Struct), MAXINVOKEIDS,
-        MAXINVOKEIDS * sizeof(struct Invoke_Status_Struct));
+        "MAIN:      InvokeID  : %4d bytes * %d requests = %d bytes\n",
+        sizeof(struct Invoke_Status_Struct), MAXTRANSACTIONS,
+        MAXTRANSACTIONS * sizeof(struct Invoke_Status_Struct));
 
     invoke_id_init();
 
@@ -310,6 +372,7 @@ int main(int argc,              /* number of arguments entered at command line *
         inet_ntoa(BACnet_Device_IP_Address));
     get_local_ip_broadcast_address(BACnet_Device_Interface,
         &Local_IP_Broadcast_Address);
+    startup_phase_done(STARTUP_CONFIG, &startup_mark);
 
     /* Attempt to open the 802.2 socket */
     if (BACnet_Ethernet_Enable)
@@ -331,23 +394,27 @@ int main(int argc,              /* number of arguments entered at command line *
 
     /* Establish a signal handler for ctrl-c, SIGHUP and SIGTERM to provide clean bailout */
     signal_init();
+    startup_phase_done(STARTUP_SOCKETS, &startup_mark);
 
     /* Create local device entry before adding GPIO objects */
     device_add(BACnet_Device_Instance);
     
-    /* Initialize GPIO objects for Raspberry Pi */
-    // Cleanup any existing GPIO state before initialization
-    debug_printf(1, "MAIN: Performing GPIO cleanup before initialization\n");
-    system("python3 -c \"import RPi.GPIO as GPIO; GPIO.setmode(GPIO.BCM); GPIO.cleanup()\" 2>/dev/null");
-    system("python3 -c \"from gpiozero import Device; Device.pin_factory.reset()\" 2>/dev/null");
-    
-    gpio_objects_init(BACnet_Device_Instance);
+    /* Initialize GPIO objects for Raspberry Pi - any lines left claimed
+       by an earlier run are released through the GPIO backend */
+    if (gpio_objects_init(BACnet_Device_Instance) < 0) {
+        fprintf(stderr, "Unable to open the GPIO hardware\n");
+        exit(1);
+    }
+    startup_phase_done(STARTUP_OBJECTS, &startup_mark);
     
     debug_printf(3, "MAIN: Ready to go...\n\n");
     // epoch time in seconds
     t1 = time(NULL);
     /* send initial I-Am and Who-Is */
     send_iam(BACnet_Device_Instance, BACnet_Vendor_Identifier);
+    startup_phase_done(STARTUP_FIRST_IAM, &startup_mark);
+    debug_printf(1, "MAIN: First I-Am sent %lu us after start\n",
+        (unsigned long) (startup_mark - startup_start));
     /* send Who-Is to all devices (-1) on the network */
     // note: generally not a good network practice, unless you are a 
     // bacnet device browser, which we are.
@@ -357,7 +424,7 @@ int main(int argc,              /* number of arguments entered at command line *
 
     /* start endless main loop (ctrl-c is the way out) */
     while (1) {
-        /* Update GPIO input values from hardware */
+        /* Poll GPIO inputs that can't report edges */
         gpio_update_inputs(BACnet_Device_Instance);
         
         /* needed for coming select */
@@ -375,8 +442,13 @@ int main(int argc,              /* number of arguments entered at command line *
             select_timeout.tv_usec = 1000;
         }
 
-        /* cleanup outstanding invoke IDs */
+        /* wake in time to publish debounced GPIO inputs */
+        gpio_objects_timeout(&select_timeout);
+
+        /* retry or give up on requests that are due */
         invoke_id_cleanup();
+        /* and wake when the next one is */
+        invoke_id_timeout(&select_timeout);
 
         FD_ZERO(&read_fds);     /* clear the file handle set */
         max = 0;                /* reset max */
@@ -403,6 +475,8 @@ int main(int argc,              /* number of arguments entered at command line *
             if (max < http_sockfd)
                 max = http_sockfd;
         }
+        /* GPIO input line edge events */
+        max = gpio_objects_fd_set(&read_fds, max);
 
         /* check for activity on the file descriptors and process if there is */
         /* CLB -- In theory we can add a receive here for MSTP, considering the driver is
@@ -435,7 +509,11 @@ int main(int argc,              /* number of arguments entered at command line *
             // MS/TP socket has data waiting
             if ((mstp_sockfd >= 0) && (FD_ISSET(mstp_sockfd, &read_fds)))
                 receive_mstp();
+            // GPIO input lines have edges waiting
+            gpio_receive_events(BACnet_Device_Instance, &read_fds);
         }
+        /* drive outputs written during this pass - once each */
+        gpio_commit_outputs();
         // wait before polling
         if (BACnet_Initial_Query_Delay) {
             if (startup_delay_time < BACnet_Initial_Query_Delay) {
@@ -50,6 +50,11 @@ int check_online_status(void);
 
 /* query newly found devices for device object properties. */
 int query_new_device(void);
+/* the whole ObjectList of a device came in a reply of count objects */
+void query_object_list_received(struct BACnet_Device_Info *dev_ptr,
+    int count);
+/* a request to the device at src was refused */
+void query_object_list_refused(struct BACnet_Device_Address *src);
 
 /* returns valid BACnet properties for an object type */
 enum BACnetPropertyIdentifier *getobjectprops(enum BACnetObjectType
@@ -76,8 +81,14 @@ int send_npdu(int dest_device, unsigned char *apdu, int apdu_len);
 int send_npdu_address(struct BACnet_Device_Address *dest,
     unsigned char *apdu, int apdu_len);
 
+/* the network layer of a packet, common to every data link */
+int npdu_encode(uint8_t * pdu, struct BACnet_NPDU *npdu, uint8_t * apdu,
+    int apdu_len);
+
 //B/IP send function
 int send_bip(struct BACnet_NPDU *npdu, uint8_t * apdu, int apdu_len);
+/* sends a network layer frame from npdu_encode() to one address */
+int send_bip_frame(struct in_addr dest, uint8_t * pdu, int pdu_len);
 
 
 #endif
@@ -29,6 +29,7 @@
 #define DEFAULT_MTU 1514        /* max size of an Ethernet frame */
 #define MAX_APDU 480            /* size of maximum APDU in bytes */
 #define MAX_MAC_LEN 6           // length of hardware MAC address in bytes
+#define NPDU_HEADER_MAX 22      /* most bytes of NPCI in front of an APDU */
 
 #define BACNET_MAX_ID 4194303L  // last valid BACnet instance number
 #define BACNET_ARRAY_ALL (~0)
@@ -45,8 +46,10 @@
 //#define VENDORID 0    /* the BACnet Vendor ID that will be used (0 == ASHRAE) */
 
 /* limits */
-#define MAXINVOKEIDS 255        /* the maximum number of invoke IDs that can be in use at once (20-255) 
-                                   (this can be used to save memory) */
+#define MAXINVOKEIDS 255        /* the highest invoke ID - each peer has its own 0-255 space */
+#define MAXTRANSACTIONS 1024    /* the maximum number of requests that can be outstanding at once, 
+                                   over all peers (this can be used to save memory) */
+#define APDU_RETRIES_MAX 10     /* the most times a request can be sent again */
 
 /* debugging parameters */
 // #define DEBUG        /* if defined, additional debug messages will be outputted */
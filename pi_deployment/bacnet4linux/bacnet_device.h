@@ -31,9 +31,19 @@
 /* device record functions */
 int device_count(void);
 void device_record_remove(int device_record);
+void device_remove(int device_id);      // device instance number
 void device_init(void);
 struct BACnet_Device_Info *device_record(int device_index);
+// walks the devices in instance order - returns the device at the
+// cursor, or the one after it, NULL at the end
+struct BACnet_Device_Info *device_cursor_data(struct Keylist_Cursor
+    *cursor);
+struct BACnet_Device_Info *device_cursor_next(struct Keylist_Cursor
+    *cursor);
 int device_which_sent(struct BACnet_Device_Address *src_address);
+// sets the address a device sends from, keeping the lookup index current
+void device_set_address(struct BACnet_Device_Info *dev_ptr,
+    struct BACnet_Device_Address *src_address);
 struct BACnet_Device_Info *device_get(int device_id);   // device instance number
 // creates a new device, or inits an existing device
 struct BACnet_Device_Info *device_new(int device_id);   // device instance number
@@ -29,6 +29,9 @@
 //
 #include <string.h>
 #include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
 
 #include "bacnet_struct.h"
 #include "bacnet_object.h"
@@ -36,6 +39,9 @@
 #include "bacnet_text.h"
 #include "keylist.h"
 #include "key.h"
+#include "object_index.h"
+#include "slab.h"
+#include "intern.h"
 #include "debug.h"
 
 /* this function finds and returns the object from the device object list */
@@ -66,25 +72,270 @@ struct ObjectRef_Struct *object_get_by_index(struct BACnet_Device_Info
     return obj_ptr;
 }
 
+/* returns the object at the cursor */
+struct ObjectRef_Struct *object_cursor_data(struct BACnet_Device_Info
+    *dev_ptr, struct Keylist_Cursor *cursor)
+{
+    struct ObjectRef_Struct *obj_ptr = NULL;    // return value
+
+    if (dev_ptr && dev_ptr->object_list)
+        obj_ptr = Keylist_Cursor_Data(dev_ptr->object_list, cursor);
+
+    return obj_ptr;
+}
+
+/* moves the cursor on and returns the next object */
+struct ObjectRef_Struct *object_cursor_next(struct BACnet_Device_Info
+    *dev_ptr, struct Keylist_Cursor *cursor)
+{
+    struct ObjectRef_Struct *obj_ptr = NULL;    // return value
+
+    if (dev_ptr && dev_ptr->object_list)
+        obj_ptr = Keylist_Cursor_Next(dev_ptr->object_list, cursor);
+
+    return obj_ptr;
+}
+
 /* this function finds and returns the object from the device object list */
 struct ObjectRef_Struct *object_find(int device_id,
     enum BACnetObjectType type, int instance)
 {
-    struct BACnet_Device_Info *dev_ptr = NULL;
     struct ObjectRef_Struct *obj_ptr = NULL;    // return value 
-    KEY key = 0;
 
     debug_printf(5, "Object: Entered 'object_find'\n");
 
-    dev_ptr = device_get(device_id);
-    if (dev_ptr && dev_ptr->object_list) {
-        key = KEY_ENCODE(type, instance);
-        obj_ptr = Keylist_Data(dev_ptr->object_list, key);
+    // the object index mirrors every device object list
+    obj_ptr = object_index_find(device_id, type, instance);
+
+    return obj_ptr;
+}
+
+/* binary objects keep a pair of state texts where the others keep
+   their units */
+static bool object_has_states(enum BACnetObjectType type)
+{
+    return ((type == OBJECT_BINARY_INPUT) ||
+        (type == OBJECT_BINARY_OUTPUT) ||
+        (type == OBJECT_BINARY_VALUE) ||
+        (type == OBJECT_CALENDAR) || (type == OBJECT_SCHEDULE));
+}
+
+/* the state text pairs in use, shared by every object that has the
+   same texts.  Pair 0 is "Active" and "Inactive" and is never stored. */
+struct object_states {
+    uint32_t active;            /* interned text ids */
+    uint32_t inactive;
+    unsigned long references;   /* 0 if the pair is free */
+};
+
+static struct object_states *States = NULL;
+static unsigned States_Size = 0;        /* pairs 0 .. States_Size - 1 */
+
+/* returns the pair for the two interned texts, taking over their
+   references, or 0 if it cannot be kept */
+static unsigned object_states_id(uint32_t active, uint32_t inactive)
+{
+    struct object_states *states;
+    unsigned id, free_id = 0, size;
+
+    if (!active && !inactive)
+        return 0;
+    for (id = 1; id < States_Size; id++) {
+        if (States[id].references && (States[id].active == active) &&
+            (States[id].inactive == inactive)) {
+            States[id].references++;
+            intern_release_id(active);
+            intern_release_id(inactive);
+            return id;
+        }
+        if (!free_id && !States[id].references)
+            free_id = id;
+    }
+    if (!free_id) {
+        size = States_Size ? States_Size * 2 : 16;
+        if (size > OBJECT_UNITS_MAX + 1)
+            size = OBJECT_UNITS_MAX + 1;
+        states = (size > States_Size) ?
+            realloc(States, size * sizeof(*states)) : NULL;
+        if (!states) {
+            error_printf("Object: Unable to keep more state texts\n");
+            intern_release_id(active);
+            intern_release_id(inactive);
+            return 0;
+        }
+        memset(&states[States_Size], 0,
+            (size - States_Size) * sizeof(*states));
+        free_id = States_Size ? States_Size : 1;
+        States = states;
+        States_Size = size;
+    }
+    States[free_id].active = active;
+    States[free_id].inactive = inactive;
+    States[free_id].references = 1;
+
+    return free_id;
+}
+
+static void object_states_release(unsigned id)
+{
+    if (!id || (id >= States_Size) || !States[id].references)
+        return;
+    if (--States[id].references)
+        return;
+    intern_release_id(States[id].active);
+    intern_release_id(States[id].inactive);
+    States[id].active = 0;
+    States[id].inactive = 0;
+}
+
+/* the units or state pair half of the text word */
+static unsigned object_text_high(const struct ObjectRef_Struct *obj_ptr)
+{
+    return obj_ptr->text >> OBJECT_NAME_BITS;
+}
+
+static void object_set_text_high(struct ObjectRef_Struct *obj_ptr,
+    unsigned value)
+{
+    obj_ptr->text = (obj_ptr->text & OBJECT_NAME_MASK) |
+        (value << OBJECT_NAME_BITS);
+}
+
+const char *object_name(const struct ObjectRef_Struct *obj_ptr)
+{
+    return intern_text(obj_ptr->text & OBJECT_NAME_MASK);
+}
+
+void object_set_name(struct ObjectRef_Struct *obj_ptr, const char *name)
+{
+    uint32_t old = obj_ptr->text & OBJECT_NAME_MASK;
+    uint32_t id;
+
+    // take the new reference first, in case name is the old text
+    id = intern_id(name);
+    if (id > OBJECT_NAME_MASK) {
+        error_printf("Object: Too many names to keep \"%s\"\n", name);
+        intern_release_id(id);
+        id = 0;
+    }
+    obj_ptr->text = (obj_ptr->text & ~OBJECT_NAME_MASK) | id;
+    intern_release_id(old);
+}
+
+BACNET_ENGINEERING_UNITS object_units(const struct ObjectRef_Struct
+    *obj_ptr)
+{
+    if (object_has_states(object_type(obj_ptr)))
+        return UNITS_NO_UNITS;
+
+    return (BACNET_ENGINEERING_UNITS) object_text_high(obj_ptr);
+}
+
+void object_set_units(struct ObjectRef_Struct *obj_ptr,
+    BACNET_ENGINEERING_UNITS units)
+{
+    if (object_has_states(object_type(obj_ptr)))
+        return;
+    if ((unsigned) units > OBJECT_UNITS_MAX) {
+        debug_printf(2, "Object: Units %u kept as no units\n",
+            (unsigned) units);
+        units = UNITS_NO_UNITS;
     }
+    object_set_text_high(obj_ptr, units);
+}
+
+const char *object_active_text(const struct ObjectRef_Struct *obj_ptr)
+{
+    unsigned id = object_text_high(obj_ptr);
+    const char *text = NULL;
+
+    if (object_has_states(object_type(obj_ptr)) && id && (id < States_Size))
+        text = intern_text(States[id].active);
+
+    return text ? text : "Active";
+}
+
+const char *object_inactive_text(const struct ObjectRef_Struct *obj_ptr)
+{
+    unsigned id = object_text_high(obj_ptr);
+    const char *text = NULL;
+
+    if (object_has_states(object_type(obj_ptr)) && id && (id < States_Size))
+        text = intern_text(States[id].inactive);
+
+    return text ? text : "Inactive";
+}
+
+/* a NULL text keeps what the object has */
+void object_set_state_texts(struct ObjectRef_Struct *obj_ptr,
+    const char *active, const char *inactive)
+{
+    unsigned old;
+
+    if (!object_has_states(object_type(obj_ptr)))
+        return;
+    old = object_text_high(obj_ptr);
+    object_set_text_high(obj_ptr,
+        object_states_id(intern_id(active ? active :
+                object_active_text(obj_ptr)),
+            intern_id(inactive ? inactive :
+                object_inactive_text(obj_ptr))));
+    object_states_release(old);
+}
+
+/* COV times are kept as seconds on from when the first was set */
+static time_t Object_Time_Base = 0;
+
+time_t object_cov_time(const struct ObjectRef_Struct *obj_ptr)
+{
+    if (!obj_ptr->cov_stamp)
+        return 0;
+
+    return Object_Time_Base + obj_ptr->cov_stamp;
+}
+
+void object_set_cov_time(struct ObjectRef_Struct *obj_ptr, time_t t)
+{
+    if (!Object_Time_Base)
+        Object_Time_Base = t - 1;
+    if (t <= Object_Time_Base)
+        obj_ptr->cov_stamp = 1;
+    else if (t - Object_Time_Base > UINT32_MAX)
+        obj_ptr->cov_stamp = UINT32_MAX;
+    else
+        obj_ptr->cov_stamp = (uint32_t) (t - Object_Time_Base);
+}
+
+void object_release(struct ObjectRef_Struct *obj_ptr)
+{
+    intern_release_id(obj_ptr->text & OBJECT_NAME_MASK);
+    if (object_has_states(object_type(obj_ptr)))
+        object_states_release(object_text_high(obj_ptr));
+    obj_ptr->text = 0;
+}
+
+/* allocates a new object from the device's pool - it starts with no
+   name, and binary objects with the default state texts */
+static struct ObjectRef_Struct *object_create(struct BACnet_Device_Info
+    *dev_ptr, enum BACnetObjectType type, int instance)
+{
+    struct ObjectRef_Struct *obj_ptr;   // return value
+
+    obj_ptr = slab_alloc(&dev_ptr->object_pool);
+    if (obj_ptr)
+        obj_ptr->key = KEY_ENCODE(type, instance);
 
     return obj_ptr;
 }
 
+/* frees an object made by object_create that never reached a list */
+static void object_discard(struct BACnet_Device_Info *dev_ptr,
+    struct ObjectRef_Struct *obj_ptr)
+{
+    object_release(obj_ptr);
+    slab_free(&dev_ptr->object_pool, obj_ptr);
+}
+
 /* this function finds and returns the object from the device object list 
    or, if the object is not found, it creates it. */
 struct ObjectRef_Struct *object_new(int device_id,
@@ -107,26 +358,21 @@ struct ObjectRef_Struct *object_new(int device_id,
             debug_printf(3,
                 "Object: %s %d is not in ObjectList in Device %d.\n",
                 enum_to_text_object(type), instance, dev_ptr->device);
-            obj_ptr = calloc(1, sizeof(struct ObjectRef_Struct));
+            obj_ptr = object_create(dev_ptr, type, instance);
+            // an object the index can't find is as good as lost
+            if (obj_ptr &&
+                ((Keylist_Data_Add(dev_ptr->object_list, key,
+                            obj_ptr) < 0) ||
+                    !object_index_add(device_id, obj_ptr))) {
+                (void) Keylist_Data_Delete(dev_ptr->object_list, key);
+                object_discard(dev_ptr, obj_ptr);
+                obj_ptr = NULL;
+            }
             if (obj_ptr) {
-                // FIXME: type and instance are redundant if we are using
-                // the key (made from type and instance) as the storage index
-                obj_ptr->type = type;
-                obj_ptr->instance = instance;
-                if ((type == OBJECT_BINARY_INPUT) ||
-                    (type == OBJECT_BINARY_OUTPUT) ||
-                    (type == OBJECT_BINARY_VALUE) ||
-                    (type == OBJECT_CALENDAR)
-                    || (type == OBJECT_SCHEDULE)) {
-                    obj_ptr->units.states.active = strdup("Active");
-                    obj_ptr->units.states.inactive = strdup("Inactive");
-                }
-                (void) Keylist_Data_Add(dev_ptr->object_list, key,
-                    obj_ptr);
                 debug_printf(2,
                     "Object: Added %s %d to ObjectList in Device %d.\n",
-                    enum_to_text_object(obj_ptr->type), obj_ptr->instance,
-                    dev_ptr->device);
+                    enum_to_text_object(object_type(obj_ptr)),
+                    object_instance(obj_ptr), dev_ptr->device);
             } else {
                 debug_printf(1,
                     "Object: Failed to add %s %d to ObjectList in Device %d.\n",
@@ -135,14 +381,103 @@ struct ObjectRef_Struct *object_new(int device_id,
         } else {
             debug_printf(3,
                 "Object: %s %d already exists in ObjectList in Device %d.\n",
-                enum_to_text_object(obj_ptr->type), obj_ptr->instance,
-                dev_ptr->device);
+                enum_to_text_object(object_type(obj_ptr)),
+                object_instance(obj_ptr), dev_ptr->device);
         }
     }
 
     return obj_ptr;
 }
 
+static int object_key_compare(const void *a, const void *b)
+{
+    KEY key_a = *(const KEY *) a;
+    KEY key_b = *(const KEY *) b;
+
+    return (key_a > key_b) - (key_a < key_b);
+}
+
+/* adds a whole object list to the device in one merge, skipping the
+   objects it already has.  Returns the number of objects added, or -1
+   if the device is unknown or memory ran out. */
+int object_new_list(int device_id, const enum BACnetObjectType *types,
+    const int *instances, int count)
+{
+    struct BACnet_Device_Info *dev_ptr = NULL;
+    KEY *keys = NULL;           // the list, sorted
+    void **objects = NULL;      // new objects, in key order
+    int added = 0;              // return value
+    int i = 0;                  // counter
+
+    debug_printf(5, "Object: Entered 'object_new_list' for device %d\n",
+        device_id);
+
+    dev_ptr = device_get(device_id);
+    if (!dev_ptr || !dev_ptr->object_list || (count < 0))
+        return -1;
+    if (!count)
+        return 0;
+    keys = malloc((size_t) count * sizeof(KEY));
+    objects = malloc((size_t) count * sizeof(void *));
+    if (!keys || !objects) {
+        free(keys);
+        free(objects);
+        return -1;
+    }
+    for (i = 0; i < count; i++)
+        keys[i] = KEY_ENCODE(types[i], instances[i]);
+    qsort(keys, (size_t) count, sizeof(KEY), object_key_compare);
+    for (i = 0; i < count; i++) {
+        // once only, and only if it is new
+        if ((added && (keys[added - 1] == keys[i])) ||
+            Keylist_Data(dev_ptr->object_list, keys[i]))
+            continue;
+        objects[added] = object_create(dev_ptr, KEY_DECODE_TYPE(keys[i]),
+            KEY_DECODE_ID(keys[i]));
+        if (!objects[added])
+            break;
+        keys[added] = keys[i];
+        added++;
+    }
+    if ((i < count) ||
+        (Keylist_Data_Add_Batch(dev_ptr->object_list, keys, objects,
+                added) < 0)) {
+        debug_printf(1,
+            "Object: Failed to add %d objects to ObjectList in Device %d.\n",
+            count, dev_ptr->device);
+        while (added)
+            object_discard(dev_ptr, objects[--added]);
+        added = -1;
+    } else {
+        for (i = 0; i < added; i++) {
+            if (!object_index_add(device_id, objects[i]))
+                break;
+        }
+        // the whole batch goes if any of it can't be indexed
+        if (i < added) {
+            debug_printf(1,
+                "Object: Failed to index %d objects in Device %d.\n",
+                added, dev_ptr->device);
+            while (i--)
+                (void) object_index_remove(device_id,
+                    KEY_DECODE_TYPE(keys[i]), KEY_DECODE_ID(keys[i]));
+            for (i = 0; i < added; i++) {
+                (void) Keylist_Data_Delete(dev_ptr->object_list, keys[i]);
+                object_discard(dev_ptr, objects[i]);
+            }
+            added = -1;
+        } else {
+            debug_printf(2,
+                "Object: Added %d of %d objects to ObjectList in Device %d.\n",
+                added, count, dev_ptr->device);
+        }
+    }
+    free(keys);
+    free(objects);
+
+    return added;
+}
+
 int object_count(int device_id)
 {
     struct BACnet_Device_Info *dev_ptr = NULL;
@@ -178,7 +513,9 @@ int object_total_count(void)
 
 #ifdef TEST
 #include <assert.h>
+#include <stdio.h>
 #include <string.h>
+#include <time.h>
 
 #include "ctest.h"
 
@@ -201,61 +538,285 @@ void testObjectList(Test * pTest)
         obj_ptr = object_new(device_id, type, object_id);
         ct_test(pTest, obj_ptr != NULL);
         if (obj_ptr) {
-            obj_ptr->units.units = units;
+            object_set_units(obj_ptr, units);
             obj_ptr->value.real = real_number;
-            ct_test(pTest, obj_ptr->type == type);
-            ct_test(pTest, obj_ptr->instance == object_id);
+            ct_test(pTest, object_type(obj_ptr) == type);
+            ct_test(pTest, object_instance(obj_ptr) == object_id);
         }
         obj_ptr = object_new(device_id, type, object_id);
         ct_test(pTest, obj_ptr != NULL);
         if (obj_ptr) {
-            obj_ptr->units.units = units;
+            object_set_units(obj_ptr, units);
             obj_ptr->value.real = real_number;
-            ct_test(pTest, obj_ptr->type == type);
-            ct_test(pTest, obj_ptr->instance == object_id);
+            ct_test(pTest, object_type(obj_ptr) == type);
+            ct_test(pTest, object_instance(obj_ptr) == object_id);
         }
         obj_ptr = object_new(device_id, type, object_id2);
         ct_test(pTest, obj_ptr != NULL);
         if (obj_ptr) {
-            obj_ptr->units.units = units;
+            object_set_units(obj_ptr, units);
             obj_ptr->value.real = real_number;
-            ct_test(pTest, obj_ptr->type == type);
-            ct_test(pTest, obj_ptr->instance == object_id2);
+            ct_test(pTest, object_type(obj_ptr) == type);
+            ct_test(pTest, object_instance(obj_ptr) == object_id2);
         }
         obj_ptr = object_find(device_id, type, object_id);
         ct_test(pTest, obj_ptr != NULL);
         if (obj_ptr) {
-            ct_test(pTest, obj_ptr->units.units == units);
+            ct_test(pTest, object_units(obj_ptr) == units);
             ct_test(pTest, obj_ptr->value.real == real_number);
-            ct_test(pTest, obj_ptr->type == type);
-            ct_test(pTest, obj_ptr->instance == object_id);
+            ct_test(pTest, object_type(obj_ptr) == type);
+            ct_test(pTest, object_instance(obj_ptr) == object_id);
         }
         obj_ptr = object_find(device_id, type, object_id2);
         ct_test(pTest, obj_ptr != NULL);
         if (obj_ptr) {
-            ct_test(pTest, obj_ptr->units.units == units);
+            ct_test(pTest, object_units(obj_ptr) == units);
             ct_test(pTest, obj_ptr->value.real == real_number);
-            ct_test(pTest, obj_ptr->type == type);
-            ct_test(pTest, obj_ptr->instance == object_id2);
+            ct_test(pTest, object_type(obj_ptr) == type);
+            ct_test(pTest, object_instance(obj_ptr) == object_id2);
         }
         obj_ptr = object_new(device_id, type, object_id);
         ct_test(pTest, obj_ptr != NULL);
         if (obj_ptr) {
-            obj_ptr->units.units = units;
+            object_set_units(obj_ptr, units);
             obj_ptr->value.real = real_number;
-            ct_test(pTest, obj_ptr->type == type);
-            ct_test(pTest, obj_ptr->instance == object_id);
+            ct_test(pTest, object_type(obj_ptr) == type);
+            ct_test(pTest, object_instance(obj_ptr) == object_id);
         }
         obj_ptr = object_find(device_id, type, object_id);
         ct_test(pTest, obj_ptr != NULL);
         if (obj_ptr) {
-            ct_test(pTest, obj_ptr->units.units == units);
+            ct_test(pTest, object_units(obj_ptr) == units);
             ct_test(pTest, obj_ptr->value.real == real_number);
-            ct_test(pTest, obj_ptr->type == type);
-            ct_test(pTest, obj_ptr->instance == object_id);
+            ct_test(pTest, object_type(obj_ptr) == type);
+            ct_test(pTest, object_instance(obj_ptr) == object_id);
+        }
+    }
+    device_cleanup();
+
+    return;
+}
+
+// test the packed record behind the accessors
+void testObjectRecord(Test * pTest)
+{
+    struct ObjectRef_Struct *obj_ptr = NULL;
+    struct ObjectRef_Struct *other = NULL;
+    struct intern_stats stats;
+    int device_id = 42;
+    time_t now = time(NULL);
+
+    ct_test(pTest, sizeof(struct ObjectRef_Struct) == 16);
+    device_init();
+    ct_test(pTest, device_add(device_id) != NULL);
+    obj_ptr = object_new(device_id, OBJECT_ANALOG_INPUT, 4194303);
+    ct_test(pTest, obj_ptr != NULL);
+    if (obj_ptr) {
+        ct_test(pTest, object_type(obj_ptr) == OBJECT_ANALOG_INPUT);
+        ct_test(pTest, object_instance(obj_ptr) == 4194303);
+        ct_test(pTest, object_name(obj_ptr) == NULL);
+        ct_test(pTest, object_cov_time(obj_ptr) == 0);
+        // name and units share a word without touching each other
+        object_set_units(obj_ptr, UNITS_DEGREES_FAHRENHEIT);
+        object_set_name(obj_ptr, "Zone Temp");
+        ct_test(pTest, object_units(obj_ptr) == UNITS_DEGREES_FAHRENHEIT);
+        ct_test(pTest, strcmp(object_name(obj_ptr), "Zone Temp") == 0);
+        object_set_units(obj_ptr, UNITS_PERCENT);
+        ct_test(pTest, strcmp(object_name(obj_ptr), "Zone Temp") == 0);
+        ct_test(pTest, object_units(obj_ptr) == UNITS_PERCENT);
+        object_set_name(obj_ptr, object_name(obj_ptr));
+        ct_test(pTest, strcmp(object_name(obj_ptr), "Zone Temp") == 0);
+        object_set_cov_time(obj_ptr, now);
+        ct_test(pTest, object_cov_time(obj_ptr) == now);
+        object_set_cov_time(obj_ptr, now + 300);
+        ct_test(pTest, object_cov_time(obj_ptr) == now + 300);
+    }
+    obj_ptr = object_new(device_id, OBJECT_BINARY_OUTPUT, 1);
+    other = object_new(device_id, OBJECT_BINARY_INPUT, 1);
+    ct_test(pTest, obj_ptr && other);
+    if (obj_ptr && other) {
+        ct_test(pTest, strcmp(object_active_text(obj_ptr), "Active") == 0);
+        ct_test(pTest,
+            strcmp(object_inactive_text(obj_ptr), "Inactive") == 0);
+        object_set_state_texts(obj_ptr, "On", "Off");
+        object_set_state_texts(other, "On", NULL);
+        ct_test(pTest, strcmp(object_active_text(obj_ptr), "On") == 0);
+        ct_test(pTest, strcmp(object_inactive_text(obj_ptr), "Off") == 0);
+        ct_test(pTest, strcmp(object_active_text(other), "On") == 0);
+        ct_test(pTest,
+            strcmp(object_inactive_text(other), "Inactive") == 0);
+        object_set_state_texts(other, NULL, "Off");
+        // the same pair of texts is shared
+        ct_test(pTest, other->text == obj_ptr->text);
+        // binary objects have no units to set
+        object_set_units(other, UNITS_PERCENT);
+        ct_test(pTest, object_units(other) == UNITS_NO_UNITS);
+        ct_test(pTest, strcmp(object_active_text(other), "On") == 0);
+        object_set_name(other, "Fan Status");
+        ct_test(pTest, strcmp(object_inactive_text(other), "Off") == 0);
+    }
+    device_cleanup();
+    // every text went with the objects
+    intern_get_stats(&stats);
+    ct_test(pTest, stats.strings == 0);
+
+    return;
+}
+
+// a poll sweep sees each object once while discovery adds more
+void testObjectCursor(Test * pTest)
+{
+    struct BACnet_Device_Info *dev_ptr = NULL;
+    struct ObjectRef_Struct *obj_ptr = NULL;
+    struct Keylist_Cursor cursor = { 0 };
+    int device_id = 42;
+    int polled[64] = { 0 };
+    unsigned errors = 0;
+    int count = 0, i;
+
+    device_init();
+    dev_ptr = device_add(device_id);
+    ct_test(pTest, dev_ptr != NULL);
+    for (i = 0; i < 64; i += 2)
+        (void) object_new(device_id, OBJECT_ANALOG_INPUT, i);
+    for (obj_ptr = object_cursor_data(dev_ptr, &cursor); obj_ptr;
+        obj_ptr = object_cursor_next(dev_ptr, &cursor)) {
+        if (object_instance(obj_ptr) < 64)
+            polled[object_instance(obj_ptr)]++;
+        count++;
+        // every odd object turns up, before and after the cursor
+        if (object_instance(obj_ptr) == 32) {
+            for (i = 1; i < 64; i += 2)
+                (void) object_new(device_id, OBJECT_ANALOG_INPUT, i);
+        }
+    }
+    for (i = 0; i < 64; i++) {
+        if (polled[i] != ((i < 32) ? !(i & 1) : 1))
+            errors++;
+    }
+    ct_test(pTest, errors == 0);
+    ct_test(pTest, count == 16 + 32);
+    device_cleanup();
+
+    return;
+}
+
+// test adding a whole object list at once
+void testObjectListBatch(Test * pTest)
+{
+    struct ObjectRef_Struct *obj_ptr = NULL;    // temporary objectref
+    struct ObjectRef_Struct *existing = NULL;   // added one at a time
+    int device_id = 42;
+    enum BACnetObjectType types[] = { OBJECT_ANALOG_INPUT,
+        OBJECT_BINARY_OUTPUT, OBJECT_DEVICE, OBJECT_ANALOG_INPUT,
+        OBJECT_ANALOG_INPUT
+    };
+    int instances[] = { 7, 3, 42, 1, 7 };
+    int i;
+
+    device_init();
+    ct_test(pTest, object_new_list(device_id, types, instances, 5) == -1);
+    ct_test(pTest, device_add(device_id) != NULL);
+    existing = object_new(device_id, OBJECT_ANALOG_INPUT, 1);
+    ct_test(pTest, existing != NULL);
+    // AI 1 is already there and AI 7 is listed twice
+    ct_test(pTest, object_new_list(device_id, types, instances, 5) == 3);
+    ct_test(pTest, object_count(device_id) == 4);
+    ct_test(pTest, object_find(device_id, OBJECT_ANALOG_INPUT, 1) ==
+        existing);
+    for (i = 0; i < 5; i++) {
+        obj_ptr = object_find(device_id, types[i], instances[i]);
+        ct_test(pTest, obj_ptr != NULL);
+        if (obj_ptr) {
+            ct_test(pTest, object_type(obj_ptr) == types[i]);
+            ct_test(pTest, object_instance(obj_ptr) == instances[i]);
+        }
+    }
+    obj_ptr = object_find(device_id, OBJECT_BINARY_OUTPUT, 3);
+    ct_test(pTest, obj_ptr &&
+        (strcmp(object_active_text(obj_ptr), "Active") == 0));
+    ct_test(pTest, object_new_list(device_id, types, instances, 5) == 0);
+    ct_test(pTest, object_count(device_id) == 4);
+    device_cleanup();
+
+    return;
+}
+
+static double ObjectListElapsed(struct timespec *start)
+{
+    struct timespec end;
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    return (end.tv_sec - start->tv_sec) +
+        (end.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+// time point lookups on a large front end, through the device and
+// object keylists and through the object index
+void testObjectListLarge(Test * pTest)
+{
+    struct BACnet_Device_Info *dev_ptr = NULL;
+    struct ObjectRef_Struct *obj_ptr = NULL;
+    const int num_devices = 500;
+    const int num_objects = 100;
+    unsigned num_points = num_devices * num_objects;
+    unsigned errors = 0;
+    unsigned i, pass;
+    int device_id, instance;
+    struct timespec start;
+    double keylist_time, index_time;
+
+    device_init();
+    for (device_id = 0; device_id < num_devices; device_id++) {
+        if (!device_add(device_id))
+            errors++;
+        for (instance = 0; instance < num_objects; instance++) {
+            if (!object_new(device_id, OBJECT_ANALOG_INPUT, instance))
+                errors++;
         }
     }
+    ct_test(pTest, errors == 0);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (pass = 0; pass < 10; pass++) {
+        for (i = 0; i < num_points; i++) {
+            device_id = ((i * 7919) % num_points) / num_objects;
+            instance = ((i * 7919) % num_points) % num_objects;
+            dev_ptr = device_get(device_id);
+            obj_ptr = dev_ptr ? Keylist_Data(dev_ptr->object_list,
+                KEY_ENCODE(OBJECT_ANALOG_INPUT, instance)) : NULL;
+            if (!obj_ptr || (object_instance(obj_ptr) != instance))
+                errors++;
+        }
+    }
+    keylist_time = ObjectListElapsed(&start);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (pass = 0; pass < 10; pass++) {
+        for (i = 0; i < num_points; i++) {
+            device_id = ((i * 7919) % num_points) / num_objects;
+            instance = ((i * 7919) % num_points) % num_objects;
+            obj_ptr = object_find(device_id, OBJECT_ANALOG_INPUT, instance);
+            if (!obj_ptr || (object_instance(obj_ptr) != instance))
+                errors++;
+        }
+    }
+    index_time = ObjectListElapsed(&start);
+    ct_test(pTest, errors == 0);
+    ct_test(pTest, object_total_count() == (int) num_points);
+
+    // removing a device takes its points out of the index
+    device_record_remove(0);
+    ct_test(pTest, object_find(0, OBJECT_ANALOG_INPUT, 0) == NULL);
+    ct_test(pTest, object_find(1, OBJECT_ANALOG_INPUT, 0) != NULL);
+
+    printf("object list: %u points - keylists %5.1f M/s, "
+        "object index %5.1f M/s\n", num_points,
+        10 * num_points / keylist_time / 1e6,
+        10 * num_points / index_time / 1e6);
     device_cleanup();
+    ct_test(pTest, object_find(1, OBJECT_ANALOG_INPUT, 0) == NULL);
 
     return;
 }
@@ -271,6 +832,14 @@ int main(void)
     /* individual tests */
     rc = ct_addTestFunction(pTest, testObjectList);
     assert(rc);
+    rc = ct_addTestFunction(pTest, testObjectRecord);
+    assert(rc);
+    rc = ct_addTestFunction(pTest, testObjectCursor);
+    assert(rc);
+    rc = ct_addTestFunction(pTest, testObjectListBatch);
+    assert(rc);
+    rc = ct_addTestFunction(pTest, testObjectListLarge);
+    assert(rc);
 
     ct_setStream(pTest, stdout);
     ct_run(pTest);
@@ -26,6 +26,20 @@
 #ifndef BACNET_OBJECT_H
 #define BACNET_OBJECT_H
 
+#include <time.h>
+#include "bacnet_struct.h"
+
+/* the object text word - an interned name id in the low bits, and the
+   analog units or a binary state text pair in the high bits */
+#define OBJECT_NAME_BITS 20
+#define OBJECT_NAME_MASK ((1u << OBJECT_NAME_BITS) - 1)
+#define OBJECT_UNITS_MAX ((1u << (32 - OBJECT_NAME_BITS)) - 1)
+
+/* object identity comes from its key */
+#define object_type(obj_ptr) \
+    ((BACNET_OBJECT_TYPE) KEY_DECODE_TYPE((obj_ptr)->key))
+#define object_instance(obj_ptr) KEY_DECODE_ID((obj_ptr)->key)
+
 /* this function finds and returns the object from the device object list */
 struct ObjectRef_Struct *object_find(int device_id,
     enum BACnetObjectType type, int instance);
@@ -35,10 +49,42 @@ struct ObjectRef_Struct *object_find(int device_id,
 struct ObjectRef_Struct *object_new(int device_id,
     enum BACnetObjectType type, int instance);
 
+/* adds a whole object list to the device in one merge, skipping the
+   objects it already has.  Returns the number added, or -1. */
+int object_new_list(int device_id, const enum BACnetObjectType *types,
+    const int *instances, int count);
+
 struct ObjectRef_Struct *object_fetch_by_index(int device_id, int index);
 struct ObjectRef_Struct *object_get_by_index(struct BACnet_Device_Info
     *dev_ptr, int index);
 
+/* the name, or NULL if it has none */
+const char *object_name(const struct ObjectRef_Struct *obj_ptr);
+void object_set_name(struct ObjectRef_Struct *obj_ptr, const char *name);
+/* analog units - not kept for binary objects */
+BACNET_ENGINEERING_UNITS object_units(const struct ObjectRef_Struct
+    *obj_ptr);
+void object_set_units(struct ObjectRef_Struct *obj_ptr,
+    BACNET_ENGINEERING_UNITS units);
+/* binary state texts - "Active" and "Inactive" unless set */
+const char *object_active_text(const struct ObjectRef_Struct *obj_ptr);
+const char *object_inactive_text(const struct ObjectRef_Struct *obj_ptr);
+void object_set_state_texts(struct ObjectRef_Struct *obj_ptr,
+    const char *active, const char *inactive);
+/* when COV was last subscribed for, 0 if never */
+time_t object_cov_time(const struct ObjectRef_Struct *obj_ptr);
+void object_set_cov_time(struct ObjectRef_Struct *obj_ptr, time_t t);
+/* drops the texts the object holds, before its memory is freed */
+void object_release(struct ObjectRef_Struct *obj_ptr);
+
+/* walks the device's objects in key order, keeping its place while
+   objects are added and removed - returns the object at the cursor,
+   or the one after it, NULL at the end */
+struct ObjectRef_Struct *object_cursor_data(struct BACnet_Device_Info
+    *dev_ptr, struct Keylist_Cursor *cursor);
+struct ObjectRef_Struct *object_cursor_next(struct BACnet_Device_Info
+    *dev_ptr, struct Keylist_Cursor *cursor);
+
 int object_count(int device_id);
 int object_total_count(void);
 
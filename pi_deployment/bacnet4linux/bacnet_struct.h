@@ -40,6 +40,7 @@
 #include "bacnet_enum.h"
 #include "bacnet_const.h"
 #include "keylist.h"
+#include "slab.h"
 
 /* Structures */
 
@@ -99,10 +100,25 @@ struct BACnet_Device_Info {
     // local vars for operation
     time_t last_found;          /* time this device last responded */
     int prop_count;             /* which property we are gathering */
-    int object_index;           /* which object index we are gathering */
+    int object_index;           /* which ObjectList index we are gathering */
+    time_t object_list_asked;   /* when the whole ObjectList was asked
+                                   for, 0 if it has not been */
+    bool object_list_indexed;   /* the ObjectList is read an index at a
+                                   time, since it did not come whole */
+    struct Keylist_Cursor object_cursor;        /* the object being queried
+                                                   or polled */
     enum device_state state;    /* which step in the gathering process we are at */
     // stores the list of objects
     OS_Keylist object_list;     /* handle to list of interesting objects */
+    struct slab_pool object_pool;       /* where the objects are kept */
+    // how the device answers requests - see invoke_id.c
+    uint32_t srtt_us;           /* smoothed round trip time, 0 if not known */
+    uint32_t rttvar_us;         /* round trip time variation */
+    uint32_t rto_ms;            /* retry timeout, 0 for BACnet_APDU_Timeout */
+    uint32_t requests;          /* confirmed requests sent to it */
+    uint32_t replies;           /* answers to them */
+    uint32_t retries;           /* requests sent again after a timeout */
+    uint32_t failures;          /* requests that were never answered */
     // the device address
     struct BACnet_Device_Address src;
 };
@@ -115,24 +131,16 @@ union ObjectValue {
     int integer;                /* unsigned */
     int enumerated;             /* enumerated */
 };
-/* structure to hold binary active/inactive state names */
-struct BinaryStateNames_Struct {
-    char *active;
-    char *inactive;
-};
-/* union to hold analog units or binary states */
-union ObjectUnits_Union {
-    BACNET_ENGINEERING_UNITS units;     /* analog units */
-    struct BinaryStateNames_Struct states;      /* binary units */
-};
-/* structure to hold an object reference */
+/* structure to hold an object reference - 16 bytes, so that a large
+   front end fits in memory.  Use the accessors in bacnet_object.h
+   rather than the packed fields. */
 struct ObjectRef_Struct {
-    BACNET_OBJECT_TYPE type;    /* what type of object? */
-    int instance;               /*    the instance of this object */
-    char *name;                 /*    pointer to where the name of the object is stored */
+    KEY key;                    /* type and instance - KEY_ENCODE */
     union ObjectValue value;    /*  value this object currently has */
-    union ObjectUnits_Union units;      /*  analog units / binary states (20 chars) */
-    time_t last_subscribe_COV;  /* time of last subscribe COV */
+    uint32_t cov_stamp;         /* last subscribe COV, seconds on from the
+                                   object time base, 0 if never */
+    uint32_t text;              /* interned name id (OBJECT_NAME_BITS), and
+                                   analog units or binary state texts */
 };
 
 ///////////////////// End Object Reference ////////////////////////////////
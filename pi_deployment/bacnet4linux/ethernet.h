@@ -39,6 +39,7 @@ extern uint8_t Ethernet_MAC_Address[MAX_MAC_LEN];
 
 int ethernet_receive(int eth802_sockfd);
 int ethernet_send(struct BACnet_NPDU *npdu, uint8_t * apdu, int apdu_len);
+int ethernet_send_frame(const uint8_t * dest, uint8_t * pdu, int pdu_len);
 int ethernet_bind(struct sockaddr *eth_addr, char *interface_name);
 bool ethernet_valid(void);
 int ethernet_socket(void);
@@ -0,0 +1,84 @@
+/*####COPYRIGHTBEGIN####
+ -------------------------------------------
+ GPIO SPI ADC Header for BACnet4Linux - Raspberry Pi Integration
+ -------------------------------------------
+####COPYRIGHTEND####*/
+
+#ifndef GPIO_ADC_H
+#define GPIO_ADC_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// MCP3008 - 8 single ended channels, 10 bit conversions
+#define GPIO_ADC_CHANNELS 8
+#define GPIO_ADC_FULL_SCALE 1023
+// conversions averaged into each reading
+#define GPIO_ADC_DEFAULT_OVERSAMPLE 8
+#define GPIO_ADC_MAX_OVERSAMPLE 16
+// readings kept per channel for the moving average - a power of 2
+#define GPIO_ADC_RING_SIZE 16
+// how often every channel is sampled
+#define GPIO_ADC_PERIOD_MS 100
+// SPI clock - 1.35 MHz is the MCP3008 limit at 3.3 V
+#define GPIO_ADC_SPEED_HZ 1350000
+// bytes in one conversion frame
+#define GPIO_ADC_FRAME_SIZE 3
+// conversions in one burst - every channel at the most oversampling
+#define GPIO_ADC_MAX_FRAMES (GPIO_ADC_CHANNELS * GPIO_ADC_MAX_OVERSAMPLE)
+
+// an ADC channel - requested once at startup and held until cleanup
+struct gpio_adc_channel {
+    int channel;                /* input on the converter */
+    bool requested;             /* true while we hold the channel */
+    int oversample;             /* conversions averaged per reading */
+    float scale_low;            /* engineering value at a count of 0 */
+    float scale_high;           /* engineering value at full scale */
+    /* moving average of the last GPIO_ADC_RING_SIZE readings */
+    uint16_t ring[GPIO_ADC_RING_SIZE];  /* sum of oversample conversions */
+    unsigned ring_head;         /* next slot to fill */
+    unsigned ring_count;        /* slots filled, up to GPIO_ADC_RING_SIZE */
+    uint32_t ring_sum;          /* sum of the filled slots */
+    unsigned long conversions;  /* conversions read for this channel */
+};
+
+// counters for the burst sampler
+struct gpio_adc_stats {
+    unsigned long bursts;       /* bursts run */
+    unsigned long conversions;  /* conversions read, all channels */
+    unsigned long errors;       /* bursts that failed */
+    uint64_t burst_duration_ns; /* time taken by the last burst */
+};
+
+// operations provided by each ADC backend
+struct gpio_adc_ops {
+    const char *name;
+    int (*open) (const char *device);
+    void (*close) (void);
+    // clocks frames of GPIO_ADC_FRAME_SIZE bytes out of tx and into rx
+    // as one message, with chip select dropped between frames
+    int (*transfer) (const uint8_t * tx, uint8_t * rx, int frames);
+};
+
+// spidev backend (/dev/spidevB.C)
+extern const struct gpio_adc_ops gpio_adc_spidev_ops;
+// in-process simulated MCP3008 for tests and benchmarks
+extern const struct gpio_adc_ops gpio_adc_sim_ops;
+
+// device is a spidev name ("spidev0.0", "/dev/spidev0.0") or "sim"
+int gpio_adc_init(const char *device);
+const char *gpio_adc_name(void);
+struct gpio_adc_channel *gpio_adc_request(int channel, int oversample,
+    float scale_low, float scale_high);
+int gpio_adc_sample(void);
+float gpio_adc_raw(struct gpio_adc_channel *adc);
+float gpio_adc_value(struct gpio_adc_channel *adc);
+const struct gpio_adc_stats *gpio_adc_stats(void);
+void gpio_adc_cleanup(void);
+
+// simulated converter hooks
+void gpio_adc_sim_set(int channel, int count, int noise);
+unsigned long gpio_adc_sim_transfer_count(void);
+void gpio_adc_sim_reset(void);
+
+#endif /* GPIO_ADC_H */
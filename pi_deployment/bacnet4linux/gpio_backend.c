@@ -0,0 +1,703 @@
+/*
+ * GPIO Backend for BACnet4Linux
+ * Holds GPIO line handles open for the life of the daemon and
+ * dispatches reads and writes to the selected backend
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "debug.h"
+#include "gpio_backend.h"
+
+// the backend in use - selected once by gpio_backend_init()
+static const struct gpio_backend_ops *Backend = NULL;
+
+// one handle per line offset, so a lookup is just an index
+static struct gpio_line Lines[GPIO_MAX_LINES];
+
+// the inputs read together by gpio_backend_scan()
+static struct gpio_scan Scan;
+
+static void gpio_backend_reset_lines(void)
+{
+    int i;
+
+    for (i = 0; i < GPIO_MAX_LINES; i++) {
+        Lines[i].offset = i;
+        Lines[i].direction = GPIO_DIRECTION_INPUT;
+        Lines[i].requested = false;
+        Lines[i].fd = -1;
+        Lines[i].value = 0;
+        Lines[i].edges = false;
+        Lines[i].timestamp_ns = 0;
+        Lines[i].events = 0;
+        Lines[i].scan = NULL;
+        Lines[i].bit = 0;
+    }
+    memset(&Scan, 0, sizeof(Scan));
+    Scan.fd = -1;
+}
+
+// selects and opens the backend
+// the simulated chip is only used when asked for by name - a GPIO chip
+// that can't be opened is an error, not a reason to pretend
+int gpio_backend_init(const char *chip)
+{
+    if (Backend)
+        gpio_backend_cleanup();
+    gpio_backend_reset_lines();
+
+    if (chip && (strcmp(chip, "sim") == 0))
+        Backend = &gpio_sim_ops;
+    else
+        Backend = &gpio_cdev_ops;
+
+    if (Backend->open(chip) < 0) {
+        error_printf("GPIO: Unable to open %s backend on %s\n",
+            Backend->name, chip ? chip : "(null)");
+        Backend = NULL;
+        return -1;
+    }
+    debug_printf(1, "GPIO: Using %s backend\n", Backend->name);
+
+    return 0;
+}
+
+const char *gpio_backend_name(void)
+{
+    return Backend ? Backend->name : "none";
+}
+
+// returns the handle for the line, requesting it from the chip
+// the first time it is used.  Later calls return the held handle.
+struct gpio_line *gpio_backend_request(int offset,
+    enum gpio_direction direction, int initial_value)
+{
+    struct gpio_line *line;
+
+    if (!Backend || (offset < 0) || (offset >= GPIO_MAX_LINES))
+        return NULL;
+
+    line = &Lines[offset];
+    if (line->requested) {
+        if (line->direction == direction)
+            return line;
+        // direction changed - give it back and request it again
+        gpio_backend_release(line);
+    }
+
+    line->direction = direction;
+    line->edges = false;
+    line->value = initial_value ? 1 : 0;
+    if (Backend->request(line, line->value) < 0) {
+        error_printf("GPIO: Unable to request line %d as %s\n", offset,
+            direction == GPIO_DIRECTION_OUTPUT ? "output" : "input");
+        return NULL;
+    }
+    line->requested = true;
+    debug_printf(2, "GPIO: Holding line %d as %s\n", offset,
+        direction == GPIO_DIRECTION_OUTPUT ? "output" : "input");
+
+    return line;
+}
+
+// returns 0 or 1, or -1 on failure
+int gpio_backend_get(struct gpio_line *line)
+{
+    int value;
+
+    if (!Backend || !line || !line->requested)
+        return -1;
+
+    value = Backend->get(line);
+    if (value >= 0)
+        line->value = value;
+
+    return value;
+}
+
+// returns 0 on success, -1 on failure
+int gpio_backend_set(struct gpio_line *line, int value)
+{
+    int status;
+
+    if (!Backend || !line || !line->requested ||
+        (line->direction != GPIO_DIRECTION_OUTPUT))
+        return -1;
+
+    value = value ? 1 : 0;
+    status = Backend->set(line, value);
+    if (status == 0)
+        line->value = value;
+
+    return status;
+}
+
+// requests an input that reports rising and falling edges on its
+// file handle.  If the chip can't do edge detection the line is held
+// as a plain input and line->edges is left false so it gets polled.
+struct gpio_line *gpio_backend_request_edges(int offset)
+{
+    struct gpio_line *line;
+
+    if (!Backend || (offset < 0) || (offset >= GPIO_MAX_LINES))
+        return NULL;
+
+    line = &Lines[offset];
+    if (line->requested) {
+        if ((line->direction == GPIO_DIRECTION_INPUT) && line->edges)
+            return line;
+        gpio_backend_release(line);
+    }
+
+    line->direction = GPIO_DIRECTION_INPUT;
+    line->edges = true;
+    if (Backend->request(line, 0) < 0) {
+        debug_printf(1, "GPIO: No edge events on line %d - polling it\n",
+            offset);
+        line->edges = false;
+        return gpio_backend_request(offset, GPIO_DIRECTION_INPUT, 0);
+    }
+    line->requested = true;
+    // pick up the level the line is at before the first edge
+    (void) gpio_backend_get(line);
+    debug_printf(2, "GPIO: Holding line %d as input with edge events\n",
+        offset);
+
+    return line;
+}
+
+// returns the handle for the line if we hold it
+struct gpio_line *gpio_backend_line(int offset)
+{
+    if ((offset < 0) || (offset >= GPIO_MAX_LINES) ||
+        !Lines[offset].requested)
+        return NULL;
+
+    return &Lines[offset];
+}
+
+// adds the event handle of each edge driven line to the select set
+// and returns the updated max handle
+int gpio_backend_fd_set(fd_set * read_fds, int max)
+{
+    int i;
+
+    if (!Backend)
+        return max;
+    for (i = 0; i < GPIO_MAX_LINES; i++) {
+        if (Lines[i].requested && Lines[i].edges && (Lines[i].fd >= 0)) {
+            FD_SET(Lines[i].fd, read_fds);
+            if (max < Lines[i].fd)
+                max = Lines[i].fd;
+        }
+    }
+
+    return max;
+}
+
+// reads one waiting edge from the line
+// returns 1 if an edge was read, 0 if none are waiting, -1 on error
+int gpio_backend_read_event(struct gpio_line *line,
+    struct gpio_edge_event *event)
+{
+    int status;
+
+    if (!Backend || !line || !line->requested || !line->edges || !event)
+        return -1;
+
+    status = Backend->read_event(line, event);
+    if (status == 1) {
+        // a scan group shares one fd, so the edge may be for another line
+        if ((event->offset >= 0) && (event->offset < GPIO_MAX_LINES))
+            line = &Lines[event->offset];
+        line->value = event->value;
+        line->timestamp_ns = event->timestamp_ns;
+        line->events++;
+    }
+
+    return status;
+}
+
+static void gpio_backend_scan_release(struct gpio_scan *scan)
+{
+    int i;
+
+    if (scan->num_lines == 0)
+        return;
+    Backend->release_scan(scan);
+    for (i = 0; i < scan->num_lines; i++) {
+        scan->lines[i]->requested = false;
+        scan->lines[i]->edges = false;
+        scan->lines[i]->fd = -1;
+        scan->lines[i]->scan = NULL;
+        scan->lines[i]->bit = 0;
+    }
+    scan->num_lines = 0;
+    scan->fd = -1;
+}
+
+// holds the input lines in one request so they can be read together.
+// Edge events are asked for too; if the chip can't provide them the
+// group is held without and scanned only.  Any line in the list that
+// is already held on its own is given back first.
+struct gpio_scan *gpio_backend_scan_request(const int *offsets,
+    int num_lines)
+{
+    struct gpio_line *line;
+    int i;
+
+    if (!Backend || !offsets || (num_lines <= 0) ||
+        (num_lines > GPIO_MAX_LINES))
+        return NULL;
+    for (i = 0; i < num_lines; i++) {
+        if ((offsets[i] < 0) || (offsets[i] >= GPIO_MAX_LINES))
+            return NULL;
+    }
+
+    gpio_backend_scan_release(&Scan);
+    for (i = 0; i < num_lines; i++) {
+        line = &Lines[offsets[i]];
+        gpio_backend_release(line);
+        line->direction = GPIO_DIRECTION_INPUT;
+        line->scan = &Scan;
+        line->bit = i;
+        Scan.lines[i] = line;
+    }
+    Scan.num_lines = num_lines;
+    Scan.edges = true;
+    Scan.fd = -1;
+    if (Backend->request_scan(&Scan) < 0) {
+        debug_printf(1, "GPIO: No edge events on scanned inputs - "
+            "polling them\n");
+        Scan.edges = false;
+        if (Backend->request_scan(&Scan) < 0) {
+            error_printf("GPIO: Unable to request %d scanned inputs\n",
+                num_lines);
+            for (i = 0; i < num_lines; i++)
+                Scan.lines[i]->scan = NULL;
+            Scan.num_lines = 0;
+            return NULL;
+        }
+    }
+    for (i = 0; i < num_lines; i++) {
+        Scan.lines[i]->requested = true;
+        Scan.lines[i]->edges = Scan.edges;
+        Scan.lines[i]->fd = Scan.fd;
+    }
+    debug_printf(2, "GPIO: Holding %d inputs in one scan request%s\n",
+        num_lines, Scan.edges ? " with edge events" : "");
+    // pick up the levels the lines are at before the first edge
+    (void) gpio_backend_scan(&Scan);
+
+    return &Scan;
+}
+
+// reads every line of the scan group with one call
+// returns 0 on success, -1 on failure
+int gpio_backend_scan(struct gpio_scan *scan)
+{
+    struct timespec start, end;
+    uint64_t values = 0;
+    int i;
+
+    if (!Backend || !scan || (scan->num_lines == 0))
+        return -1;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    if (Backend->get_scan(scan, &values) < 0)
+        return -1;
+    for (i = 0; i < scan->num_lines; i++)
+        scan->lines[i]->value = (values >> i) & 1;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    scan->values = values;
+    scan->duration_ns = (uint64_t) (end.tv_sec - start.tv_sec) * 1000000000ULL
+        + end.tv_nsec - start.tv_nsec;
+    scan->count++;
+
+    return 0;
+}
+
+// frees lines another process left claimed so the requests that follow
+// succeed.  Lines we already hold are skipped.  Returns the number of
+// lines that were released.
+int gpio_backend_reclaim(const int *offsets, int num_lines)
+{
+    int reclaimed = 0;
+    int offset;
+    int i;
+
+    if (!Backend || !Backend->reclaim)
+        return 0;
+    for (i = 0; i < num_lines; i++) {
+        offset = offsets[i];
+        if ((offset < 0) || (offset >= GPIO_MAX_LINES) ||
+            Lines[offset].requested)
+            continue;
+        if (Backend->reclaim(offset) > 0) {
+            debug_printf(2, "GPIO: Reclaimed line %d\n", offset);
+            reclaimed++;
+        }
+    }
+
+    return reclaimed;
+}
+
+// releasing a line of the scan group releases the whole group
+void gpio_backend_release(struct gpio_line *line)
+{
+    if (Backend && line && line->scan) {
+        gpio_backend_scan_release(line->scan);
+    } else if (Backend && line && line->requested) {
+        Backend->release(line);
+        line->requested = false;
+        line->edges = false;
+        line->fd = -1;
+    }
+}
+
+// releases every held line and closes the chip
+void gpio_backend_cleanup(void)
+{
+    int i;
+
+    if (!Backend)
+        return;
+    for (i = 0; i < GPIO_MAX_LINES; i++)
+        gpio_backend_release(&Lines[i]);
+    Backend->close();
+    debug_printf(2, "GPIO: Released all lines (%s backend)\n",
+        Backend->name);
+    Backend = NULL;
+}
+
+#ifdef TEST
+#include <assert.h>
+#include <time.h>
+
+#include "ctest.h"
+#include "gpio_pwm.h"
+
+void testGpioBackendSim(Test * pTest)
+{
+    struct gpio_line *line;
+    struct gpio_line *line2;
+
+    ct_test(pTest, gpio_backend_init("sim") == 0);
+    ct_test(pTest, strcmp(gpio_backend_name(), "sim") == 0);
+    gpio_sim_reset();
+
+    // outputs are driven to their initial value when requested
+    line = gpio_backend_request(18, GPIO_DIRECTION_OUTPUT, 1);
+    ct_test(pTest, line != NULL);
+    ct_test(pTest, gpio_sim_get_output(18) == 1);
+    ct_test(pTest, gpio_backend_set(line, 0) == 0);
+    ct_test(pTest, gpio_sim_get_output(18) == 0);
+    ct_test(pTest, gpio_sim_write_count(18) == 1);
+
+    // the same handle comes back without a new request
+    line2 = gpio_backend_request(18, GPIO_DIRECTION_OUTPUT, 0);
+    ct_test(pTest, line2 == line);
+    ct_test(pTest, gpio_sim_write_count(18) == 1);
+
+    // inputs follow the simulated pin and can't be driven
+    line = gpio_backend_request(19, GPIO_DIRECTION_INPUT, 0);
+    ct_test(pTest, line != NULL);
+    ct_test(pTest, gpio_backend_get(line) == 0);
+    gpio_sim_set_input(19, 1);
+    ct_test(pTest, gpio_backend_get(line) == 1);
+    ct_test(pTest, gpio_backend_set(line, 0) == -1);
+
+    // out of range
+    ct_test(pTest, gpio_backend_request(GPIO_MAX_LINES,
+            GPIO_DIRECTION_INPUT, 0) == NULL);
+    ct_test(pTest, gpio_backend_request(-1,
+            GPIO_DIRECTION_INPUT, 0) == NULL);
+
+    gpio_backend_cleanup();
+    ct_test(pTest, gpio_backend_get(line) == -1);
+
+    // a chip that isn't there is not replaced by the simulated one
+    ct_test(pTest, gpio_backend_init("/dev/gpiochip-none") == -1);
+    ct_test(pTest, strcmp(gpio_backend_name(), "none") == 0);
+    ct_test(pTest, gpio_backend_request(18, GPIO_DIRECTION_OUTPUT,
+            0) == NULL);
+
+    return;
+}
+
+void testGpioBackendEdges(Test * pTest)
+{
+    struct gpio_line *line;
+    struct gpio_edge_event event;
+    fd_set read_fds;
+    struct timeval timeout;
+    int max;
+
+    ct_test(pTest, gpio_backend_init("sim") == 0);
+    gpio_sim_reset();
+    gpio_sim_set_input(19, 1);
+    line = gpio_backend_request_edges(19);
+    ct_test(pTest, line != NULL);
+    ct_test(pTest, line->edges);
+    ct_test(pTest, line->fd >= 0);
+    // the level before the first edge is read at request time
+    ct_test(pTest, line->value == 1);
+
+    // nothing waiting yet
+    ct_test(pTest, gpio_backend_read_event(line, &event) == 0);
+    FD_ZERO(&read_fds);
+    max = gpio_backend_fd_set(&read_fds, 0);
+    ct_test(pTest, max == line->fd);
+    timeout.tv_sec = 0;
+    timeout.tv_usec = 0;
+    ct_test(pTest, select(max + 1, &read_fds, NULL, NULL, &timeout) == 0);
+
+    // injected edges wake select and come back in order
+    ct_test(pTest, gpio_sim_inject_edge(19, 0, 1000) == 0);
+    ct_test(pTest, gpio_sim_inject_edge(19, 1, 2500) == 0);
+    FD_ZERO(&read_fds);
+    max = gpio_backend_fd_set(&read_fds, 0);
+    ct_test(pTest, select(max + 1, &read_fds, NULL, NULL, &timeout) == 1);
+    ct_test(pTest, FD_ISSET(line->fd, &read_fds));
+    ct_test(pTest, gpio_backend_read_event(line, &event) == 1);
+    ct_test(pTest, event.offset == 19);
+    ct_test(pTest, event.value == 0);
+    ct_test(pTest, event.timestamp_ns == 1000);
+    ct_test(pTest, gpio_backend_read_event(line, &event) == 1);
+    ct_test(pTest, event.value == 1);
+    ct_test(pTest, event.timestamp_ns == 2500);
+    ct_test(pTest, event.seqno == 2);
+    ct_test(pTest, gpio_backend_read_event(line, &event) == 0);
+    ct_test(pTest, line->value == 1);
+    ct_test(pTest, line->timestamp_ns == 2500);
+    ct_test(pTest, line->events == 2);
+
+    // changing the simulated level of an edge line makes an edge,
+    // setting the same level does not
+    gpio_sim_set_input(19, 1);
+    ct_test(pTest, gpio_backend_read_event(line, &event) == 0);
+    gpio_sim_set_input(19, 0);
+    ct_test(pTest, gpio_backend_read_event(line, &event) == 1);
+    ct_test(pTest, event.value == 0);
+    ct_test(pTest, event.timestamp_ns != 0);
+
+    // plain inputs have no event handle
+    line = gpio_backend_request(20, GPIO_DIRECTION_INPUT, 0);
+    ct_test(pTest, line != NULL);
+    ct_test(pTest, gpio_backend_read_event(line, &event) == -1);
+    ct_test(pTest, gpio_sim_inject_edge(20, 1, 0) == -1);
+
+    gpio_backend_cleanup();
+
+    return;
+}
+
+void testGpioBackendScan(Test * pTest)
+{
+    struct gpio_scan *scan;
+    struct gpio_line *line;
+    struct gpio_edge_event event;
+    int offsets[24];
+    unsigned long reads;
+    int i;
+
+    ct_test(pTest, gpio_backend_init("sim") == 0);
+    gpio_sim_reset();
+    for (i = 0; i < 24; i++) {
+        offsets[i] = i;
+        gpio_sim_set_input(i, i & 1);
+    }
+    // a line already held on its own joins the group
+    line = gpio_backend_request(5, GPIO_DIRECTION_INPUT, 0);
+    ct_test(pTest, line != NULL);
+    ct_test(pTest, line->scan == NULL);
+
+    scan = gpio_backend_scan_request(offsets, 24);
+    ct_test(pTest, scan != NULL);
+    ct_test(pTest, scan->num_lines == 24);
+    ct_test(pTest, scan->edges);
+    ct_test(pTest, scan->fd >= 0);
+    ct_test(pTest, line->scan == scan);
+    ct_test(pTest, line->fd == scan->fd);
+    ct_test(pTest, line->bit == 5);
+    // the initial scan picked up the levels
+    ct_test(pTest, scan->count == 1);
+    for (i = 0; i < 24; i++)
+        ct_test(pTest, scan->lines[i]->value == (i & 1));
+
+    // all 24 lines in one read
+    gpio_sim_set_input(2, 1);
+    gpio_sim_set_input(3, 0);
+    reads = gpio_sim_read_count();
+    ct_test(pTest, gpio_backend_scan(scan) == 0);
+    ct_test(pTest, gpio_sim_read_count() == reads + 1);
+    ct_test(pTest, gpio_backend_line(2)->value == 1);
+    ct_test(pTest, gpio_backend_line(3)->value == 0);
+    ct_test(pTest, (scan->values & 0x0C) == 0x04);
+    ct_test(pTest, scan->count == 2);
+
+    // edges for any line of the group arrive on the shared fd
+    line = gpio_backend_line(0);
+    while (gpio_backend_read_event(line, &event) == 1);
+    ct_test(pTest, gpio_sim_inject_edge(17, 0, 5000) == 0);
+    ct_test(pTest, gpio_backend_read_event(line, &event) == 1);
+    ct_test(pTest, event.offset == 17);
+    ct_test(pTest, gpio_backend_line(17)->value == 0);
+    ct_test(pTest, gpio_backend_line(17)->timestamp_ns == 5000);
+    ct_test(pTest, gpio_backend_line(0)->events == 0);
+
+    // a single line in the group can still be read on its own
+    gpio_sim_set_input(9, 0);
+    ct_test(pTest, gpio_backend_get(gpio_backend_line(9)) == 0);
+
+    // releasing one line gives back the group
+    gpio_backend_release(gpio_backend_line(4));
+    ct_test(pTest, scan->num_lines == 0);
+    ct_test(pTest, gpio_backend_line(4) == NULL);
+    ct_test(pTest, gpio_backend_line(23) == NULL);
+    ct_test(pTest, gpio_backend_scan(scan) == -1);
+
+    gpio_backend_cleanup();
+
+    return;
+}
+
+// time the held-handle write path against the simulated chip
+void testGpioBackendTiming(Test * pTest)
+{
+    struct gpio_line *line;
+    struct gpio_pwm_channel *pwm;
+    struct timespec start, end;
+    struct gpio_scan *scan;
+    const unsigned long num_writes = 1000000;
+    const unsigned long num_scans = 100000;
+    int offsets[24];
+    unsigned long reads;
+    unsigned long i;
+    double elapsed;
+
+    ct_test(pTest, gpio_backend_init("sim") == 0);
+    gpio_sim_reset();
+    line = gpio_backend_request(26, GPIO_DIRECTION_OUTPUT, 0);
+    ct_test(pTest, line != NULL);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (i = 0; i < num_writes; i++)
+        (void) gpio_backend_set(line, i & 1);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    elapsed = (end.tv_sec - start.tv_sec) +
+        (end.tv_nsec - start.tv_nsec) / 1e9;
+
+    ct_test(pTest, gpio_sim_write_count(26) == num_writes);
+    printf("gpio: %lu writes in %.3f s (%.0f ns per write)\n",
+        num_writes, elapsed, elapsed * 1e9 / num_writes);
+
+    // a 24 line scan against 24 single line reads
+    for (i = 0; i < 24; i++)
+        offsets[i] = i;
+    scan = gpio_backend_scan_request(offsets, 24);
+    ct_test(pTest, scan != NULL);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (i = 0; i < num_scans; i++)
+        (void) gpio_backend_scan(scan);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    elapsed = (end.tv_sec - start.tv_sec) +
+        (end.tv_nsec - start.tv_nsec) / 1e9;
+    printf("gpio: %lu scans of 24 lines in %.3f s (%.0f ns per scan)\n",
+        num_scans, elapsed, elapsed * 1e9 / num_scans);
+    reads = gpio_sim_read_count();
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (i = 0; i < num_scans * 24; i++)
+        (void) gpio_backend_get(scan->lines[i % 24]);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    elapsed = (end.tv_sec - start.tv_sec) +
+        (end.tv_nsec - start.tv_nsec) / 1e9;
+    ct_test(pTest, gpio_sim_read_count() == reads + num_scans * 24);
+    printf("gpio: %lu x 24 single line reads in %.3f s (%.0f ns per 24)\n",
+        num_scans, elapsed, elapsed * 1e9 / num_scans);
+    gpio_backend_cleanup();
+
+    // PWM duty writes - a new duty reaches the channel, the same one
+    // again is not written at all
+    ct_test(pTest, gpio_pwm_init("sim") == 0);
+    gpio_pwm_sim_reset();
+    pwm = gpio_pwm_request(2, GPIO_PWM_PERIOD_NS);
+    ct_test(pTest, pwm != NULL);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (i = 0; i < num_writes; i++)
+        (void) gpio_pwm_set_percent(pwm, (i & 1) ? 42.0f : 43.5f);
+    for (i = 0; i < num_writes; i++)
+        (void) gpio_pwm_set_percent(pwm, 42.0f);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    elapsed = (end.tv_sec - start.tv_sec) +
+        (end.tv_nsec - start.tv_nsec) / 1e9;
+    ct_test(pTest, gpio_pwm_sim_write_count(2) == num_writes);
+    printf("pwm: %lu duty writes, half unchanged, in %.3f s "
+        "(%.0f ns per write)\n", 2 * num_writes, elapsed,
+        elapsed * 1e9 / (2 * num_writes));
+    gpio_pwm_cleanup();
+
+    return;
+}
+
+void testGpioBackendReclaim(Test * pTest)
+{
+    int offsets[3] = { 17, 18, GPIO_MAX_LINES };
+    struct gpio_line *line;
+
+    ct_test(pTest, gpio_backend_init("sim") == 0);
+    gpio_sim_reset();
+    // a line left exported by another process can't be requested
+    gpio_sim_claim(18);
+    ct_test(pTest, gpio_backend_request(18, GPIO_DIRECTION_OUTPUT,
+            0) == NULL);
+    // only the claimed line is released - the rest are left alone
+    ct_test(pTest, gpio_backend_reclaim(offsets, 3) == 1);
+    line = gpio_backend_request(18, GPIO_DIRECTION_OUTPUT, 1);
+    ct_test(pTest, line != NULL);
+    ct_test(pTest, gpio_sim_get_output(18) == 1);
+    // lines we hold are never touched
+    gpio_sim_claim(18);
+    ct_test(pTest, gpio_backend_reclaim(offsets, 3) == 0);
+    ct_test(pTest, gpio_backend_set(line, 0) == 0);
+    gpio_backend_cleanup();
+    ct_test(pTest, gpio_backend_reclaim(offsets, 3) == 0);
+    gpio_sim_reset();
+
+    return;
+}
+
+#ifdef TEST_GPIO_BACKEND
+int main(void)
+{
+    Test *pTest;
+    bool rc;
+
+    pTest = ct_create("gpio backend", NULL);
+
+    /* individual tests */
+    rc = ct_addTestFunction(pTest, testGpioBackendSim);
+    assert(rc);
+    rc = ct_addTestFunction(pTest, testGpioBackendEdges);
+    assert(rc);
+    rc = ct_addTestFunction(pTest, testGpioBackendScan);
+    assert(rc);
+    rc = ct_addTestFunction(pTest, testGpioBackendTiming);
+    assert(rc);
+    rc = ct_addTestFunction(pTest, testGpioBackendReclaim);
+    assert(rc);
+
+    ct_setStream(pTest, stdout);
+    ct_run(pTest);
+    (void) ct_report(pTest);
+
+    ct_destroy(pTest);
+
+    return 0;
+}
+#endif                          /* TEST_GPIO_BACKEND */
+#endif                          /* TEST */
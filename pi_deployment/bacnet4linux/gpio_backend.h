@@ -0,0 +1,119 @@
+/*####COPYRIGHTBEGIN####
+ -------------------------------------------
+ GPIO Backend Header for BACnet4Linux - Raspberry Pi Integration
+ -------------------------------------------
+####COPYRIGHTEND####*/
+
+#ifndef GPIO_BACKEND_H
+#define GPIO_BACKEND_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <sys/select.h>
+
+// line offsets we can hold a handle for (BCM 0-63 on the Pi header chip)
+#define GPIO_MAX_LINES 64
+
+// consumer label shown by gpioinfo for lines we hold
+#define GPIO_CONSUMER "bacnet4linux"
+
+enum gpio_direction {
+    GPIO_DIRECTION_INPUT = 0,
+    GPIO_DIRECTION_OUTPUT = 1
+};
+
+// a line handle - requested once at startup and held until cleanup
+struct gpio_line {
+    int offset;                 /* line offset on the chip (BCM number) */
+    enum gpio_direction direction;
+    bool requested;             /* true while we hold the line */
+    int fd;                     /* line request file handle, -1 if none */
+    int value;                  /* last value read or driven */
+    bool edges;                 /* input reports edge events on fd */
+    uint64_t timestamp_ns;      /* kernel time of the last edge */
+    unsigned long events;       /* edges received */
+    struct gpio_scan *scan;     /* scan group holding the line, or NULL */
+    int bit;                    /* position of the line in its request */
+};
+
+// input lines held together in one line request so the whole group
+// is read with a single call.  Edges for every line in the group
+// arrive on the one shared fd.
+struct gpio_scan {
+    int num_lines;
+    struct gpio_line *lines[GPIO_MAX_LINES];
+    int fd;                     /* shared line request handle */
+    bool edges;                 /* lines report edge events on fd */
+    uint64_t values;            /* bit n is the level of lines[n] */
+    uint64_t duration_ns;       /* time taken by the last scan */
+    unsigned long count;        /* scans completed */
+};
+
+// an edge reported on a line event file handle
+struct gpio_edge_event {
+    int offset;                 /* line the edge happened on */
+    int value;                  /* level after the edge (1=rising) */
+    uint64_t timestamp_ns;      /* CLOCK_MONOTONIC, stamped by the kernel */
+    uint32_t seqno;             /* per line sequence number */
+};
+
+// operations provided by each backend
+struct gpio_backend_ops {
+    const char *name;
+    int (*open) (const char *chip);
+    void (*close) (void);
+    int (*request) (struct gpio_line * line, int initial_value);
+    void (*release) (struct gpio_line * line);
+    int (*get) (struct gpio_line * line);
+    int (*set) (struct gpio_line * line, int value);
+    // returns 1 if an event was read, 0 if none are waiting, -1 on error
+    int (*read_event) (struct gpio_line * line,
+        struct gpio_edge_event * event);
+    int (*request_scan) (struct gpio_scan * scan);
+    void (*release_scan) (struct gpio_scan * scan);
+    // fills values with bit n set for each high lines[n]
+    int (*get_scan) (struct gpio_scan * scan, uint64_t * values);
+    // frees a line left claimed by an earlier user of the chip.  Returns
+    // 1 if it was released, 0 if it was already free, -1 if it is held
+    // by something we can't release.
+    int (*reclaim) (int offset);
+};
+
+// native character device backend (/dev/gpiochipN, uAPI v2)
+extern const struct gpio_backend_ops gpio_cdev_ops;
+// in-process simulated chip for tests and benchmarks
+extern const struct gpio_backend_ops gpio_sim_ops;
+
+// chip is a device name or path ("gpiochip4", "/dev/gpiochip4")
+// or "sim" for the simulated chip
+int gpio_backend_init(const char *chip);
+const char *gpio_backend_name(void);
+struct gpio_line *gpio_backend_request(int offset,
+    enum gpio_direction direction, int initial_value);
+int gpio_backend_get(struct gpio_line *line);
+int gpio_backend_set(struct gpio_line *line, int value);
+void gpio_backend_release(struct gpio_line *line);
+void gpio_backend_cleanup(void);
+// edge driven inputs
+struct gpio_line *gpio_backend_request_edges(int offset);
+struct gpio_line *gpio_backend_line(int offset);
+int gpio_backend_fd_set(fd_set * read_fds, int max);
+int gpio_backend_read_event(struct gpio_line *line,
+    struct gpio_edge_event *event);
+// bulk input scan
+struct gpio_scan *gpio_backend_scan_request(const int *offsets,
+    int num_lines);
+int gpio_backend_scan(struct gpio_scan *scan);
+// startup - free lines a previous process left claimed
+int gpio_backend_reclaim(const int *offsets, int num_lines);
+
+// simulated chip hooks
+void gpio_sim_set_input(int offset, int value);
+int gpio_sim_inject_edge(int offset, int value, uint64_t timestamp_ns);
+int gpio_sim_get_output(int offset);
+unsigned long gpio_sim_write_count(int offset);
+unsigned long gpio_sim_read_count(void);
+void gpio_sim_claim(int offset);
+void gpio_sim_reset(void);
+
+#endif /* GPIO_BACKEND_H */
@@ -0,0 +1,332 @@
+/*
+ * GPIO character device backend for BACnet4Linux
+ * Talks to /dev/gpiochipN through the Linux GPIO uAPI (v2), the
+ * same interface libgpiod uses, without spawning any processes
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <dirent.h>
+#include <sys/ioctl.h>
+#include <linux/gpio.h>
+#include "debug.h"
+#include "gpio_backend.h"
+
+static int Chip_fd = -1;
+// chip label and line count, to find the chip under /sys/class/gpio
+static struct gpiochip_info Chip_Info;
+// first legacy sysfs GPIO number of the chip, -1 if not yet found
+static int Sysfs_Base = -1;
+
+static int cdev_open(const char *chip)
+{
+    char path[64];
+    struct gpiochip_info info;
+
+    if (!chip || !chip[0])
+        return -1;
+    // accept "gpiochip4" as well as "/dev/gpiochip4"
+    if (chip[0] == '/')
+        snprintf(path, sizeof(path), "%s", chip);
+    else
+        snprintf(path, sizeof(path), "/dev/%s", chip);
+
+    Chip_fd = open(path, O_RDWR | O_CLOEXEC);
+    if (Chip_fd < 0) {
+        debug_printf(1, "GPIO: Cannot open %s: %s\n", path,
+            strerror(errno));
+        return -1;
+    }
+    memset(&info, 0, sizeof(info));
+    if (ioctl(Chip_fd, GPIO_GET_CHIPINFO_IOCTL, &info) == 0)
+        debug_printf(1, "GPIO: Opened %s (%s, %u lines)\n", path,
+            info.label, info.lines);
+    Chip_Info = info;
+    Sysfs_Base = -1;
+
+    return 0;
+}
+
+static void cdev_close(void)
+{
+    if (Chip_fd >= 0) {
+        close(Chip_fd);
+        Chip_fd = -1;
+    }
+}
+
+static int cdev_request(struct gpio_line *line, int initial_value)
+{
+    struct gpio_v2_line_request req;
+
+    if (Chip_fd < 0)
+        return -1;
+
+    memset(&req, 0, sizeof(req));
+    req.offsets[0] = line->offset;
+    req.num_lines = 1;
+    strncpy(req.consumer, GPIO_CONSUMER, sizeof(req.consumer) - 1);
+    if (line->direction == GPIO_DIRECTION_OUTPUT) {
+        req.config.flags = GPIO_V2_LINE_FLAG_OUTPUT;
+        // drive the initial level as part of the request, no glitch
+        req.config.num_attrs = 1;
+        req.config.attrs[0].attr.id = GPIO_V2_LINE_ATTR_ID_OUTPUT_VALUES;
+        req.config.attrs[0].attr.values = initial_value ? 1 : 0;
+        req.config.attrs[0].mask = 1;
+    } else if (line->edges) {
+        // the kernel stamps each edge with CLOCK_MONOTONIC
+        req.config.flags = GPIO_V2_LINE_FLAG_INPUT |
+            GPIO_V2_LINE_FLAG_EDGE_RISING | GPIO_V2_LINE_FLAG_EDGE_FALLING;
+    } else {
+        req.config.flags = GPIO_V2_LINE_FLAG_INPUT;
+    }
+
+    if (ioctl(Chip_fd, GPIO_V2_GET_LINE_IOCTL, &req) < 0) {
+        debug_printf(1, "GPIO: Line %d request failed: %s\n",
+            line->offset, strerror(errno));
+        return -1;
+    }
+    line->fd = req.fd;
+    // edges are drained after select() says they are waiting
+    if (line->edges)
+        fcntl(line->fd, F_SETFL, fcntl(line->fd, F_GETFL) | O_NONBLOCK);
+
+    return 0;
+}
+
+static void cdev_release(struct gpio_line *line)
+{
+    if (line->fd >= 0) {
+        close(line->fd);
+        line->fd = -1;
+    }
+}
+
+static int cdev_get(struct gpio_line *line)
+{
+    struct gpio_v2_line_values values;
+
+    // the line may share its request with a scan group
+    values.bits = 0;
+    values.mask = 1ULL << line->bit;
+    if (ioctl(line->fd, GPIO_V2_LINE_GET_VALUES_IOCTL, &values) < 0) {
+        debug_printf(1, "GPIO: Line %d read failed: %s\n",
+            line->offset, strerror(errno));
+        return -1;
+    }
+
+    return (values.bits & values.mask) ? 1 : 0;
+}
+
+static int cdev_set(struct gpio_line *line, int value)
+{
+    struct gpio_v2_line_values values;
+
+    values.mask = 1ULL << line->bit;
+    values.bits = value ? values.mask : 0;
+    if (ioctl(line->fd, GPIO_V2_LINE_SET_VALUES_IOCTL, &values) < 0) {
+        debug_printf(1, "GPIO: Line %d write failed: %s\n",
+            line->offset, strerror(errno));
+        return -1;
+    }
+
+    return 0;
+}
+
+static int cdev_read_event(struct gpio_line *line,
+    struct gpio_edge_event *event)
+{
+    struct gpio_v2_line_event kernel_event;
+    ssize_t len;
+
+    len = read(line->fd, &kernel_event, sizeof(kernel_event));
+    if (len < 0) {
+        if ((errno == EAGAIN) || (errno == EWOULDBLOCK))
+            return 0;
+        debug_printf(1, "GPIO: Line %d event read failed: %s\n",
+            line->offset, strerror(errno));
+        return -1;
+    }
+    if (len != sizeof(kernel_event))
+        return -1;
+
+    event->offset = kernel_event.offset;
+    event->value = (kernel_event.id == GPIO_V2_LINE_EVENT_RISING_EDGE);
+    event->timestamp_ns = kernel_event.timestamp_ns;
+    event->seqno = kernel_event.line_seqno;
+
+    return 1;
+}
+
+// one request for every line in the group - reads and edge events for
+// all of them then go through the single fd the kernel hands back
+static int cdev_request_scan(struct gpio_scan *scan)
+{
+    struct gpio_v2_line_request req;
+    int i;
+
+    if ((Chip_fd < 0) || (scan->num_lines > GPIO_V2_LINES_MAX))
+        return -1;
+
+    memset(&req, 0, sizeof(req));
+    for (i = 0; i < scan->num_lines; i++)
+        req.offsets[i] = scan->lines[i]->offset;
+    req.num_lines = scan->num_lines;
+    strncpy(req.consumer, GPIO_CONSUMER, sizeof(req.consumer) - 1);
+    req.config.flags = GPIO_V2_LINE_FLAG_INPUT;
+    if (scan->edges)
+        req.config.flags |=
+            GPIO_V2_LINE_FLAG_EDGE_RISING | GPIO_V2_LINE_FLAG_EDGE_FALLING;
+
+    if (ioctl(Chip_fd, GPIO_V2_GET_LINE_IOCTL, &req) < 0) {
+        debug_printf(1, "GPIO: Scan request for %d lines failed: %s\n",
+            scan->num_lines, strerror(errno));
+        return -1;
+    }
+    scan->fd = req.fd;
+    if (scan->edges)
+        fcntl(scan->fd, F_SETFL, fcntl(scan->fd, F_GETFL) | O_NONBLOCK);
+
+    return 0;
+}
+
+static void cdev_release_scan(struct gpio_scan *scan)
+{
+    if (scan->fd >= 0) {
+        close(scan->fd);
+        scan->fd = -1;
+    }
+}
+
+static int cdev_get_scan(struct gpio_scan *scan, uint64_t * values)
+{
+    struct gpio_v2_line_values line_values;
+
+    line_values.bits = 0;
+    if (scan->num_lines >= 64)
+        line_values.mask = ~0ULL;
+    else
+        line_values.mask = (1ULL << scan->num_lines) - 1;
+    if (ioctl(scan->fd, GPIO_V2_LINE_GET_VALUES_IOCTL, &line_values) < 0) {
+        debug_printf(1, "GPIO: Scan of %d lines failed: %s\n",
+            scan->num_lines, strerror(errno));
+        return -1;
+    }
+    *values = line_values.bits;
+
+    return 0;
+}
+
+// reads a small sysfs attribute, trimming the newline
+static int cdev_sysfs_read(const char *dir, const char *name, char *value,
+    size_t size)
+{
+    char path[128];
+    ssize_t len;
+    int fd;
+
+    snprintf(path, sizeof(path), "/sys/class/gpio/%s/%s", dir, name);
+    fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return -1;
+    len = read(fd, value, size - 1);
+    close(fd);
+    if (len <= 0)
+        return -1;
+    if (value[len - 1] == '\n')
+        len--;
+    value[len] = '\0';
+
+    return 0;
+}
+
+// finds the sysfs GPIO number of line 0 by matching our chip's label
+// and size against /sys/class/gpio/gpiochipN
+static int cdev_sysfs_base(void)
+{
+    DIR *dir;
+    struct dirent *entry;
+    char value[GPIO_MAX_NAME_SIZE];
+
+    if (Sysfs_Base >= 0)
+        return Sysfs_Base;
+    dir = opendir("/sys/class/gpio");
+    if (!dir)
+        return -1;
+    while ((entry = readdir(dir)) != NULL) {
+        if (strncmp(entry->d_name, "gpiochip", 8) != 0)
+            continue;
+        if ((cdev_sysfs_read(entry->d_name, "label", value,
+                    sizeof(value)) < 0) ||
+            (strcmp(value, Chip_Info.label) != 0))
+            continue;
+        if ((cdev_sysfs_read(entry->d_name, "ngpio", value,
+                    sizeof(value)) < 0) ||
+            ((unsigned) atoi(value) != Chip_Info.lines))
+            continue;
+        if (cdev_sysfs_read(entry->d_name, "base", value,
+                sizeof(value)) == 0)
+            Sysfs_Base = atoi(value);
+        break;
+    }
+    closedir(dir);
+
+    return Sysfs_Base;
+}
+
+// RPi.GPIO and the sysfs tools leave lines exported with the consumer
+// "sysfs" - unexporting them is all the old python cleanup did
+static int cdev_reclaim(int offset)
+{
+    struct gpio_v2_line_info info;
+    char number[16];
+    int len;
+    int fd;
+    int rc;
+
+    if (Chip_fd < 0)
+        return -1;
+    memset(&info, 0, sizeof(info));
+    info.offset = offset;
+    if (ioctl(Chip_fd, GPIO_V2_GET_LINEINFO_IOCTL, &info) < 0)
+        return -1;
+    if (!(info.flags & GPIO_V2_LINE_FLAG_USED))
+        return 0;
+    if (strcmp(info.consumer, "sysfs") != 0) {
+        debug_printf(1, "GPIO: Line %d is held by \"%s\"\n", offset,
+            info.consumer);
+        return -1;
+    }
+    if (cdev_sysfs_base() < 0)
+        return -1;
+    fd = open("/sys/class/gpio/unexport", O_WRONLY | O_CLOEXEC);
+    if (fd < 0)
+        return -1;
+    len = snprintf(number, sizeof(number), "%d", Sysfs_Base + offset);
+    rc = (write(fd, number, len) == len) ? 1 : -1;
+    if (rc < 0)
+        debug_printf(1, "GPIO: Unable to unexport line %d: %s\n", offset,
+            strerror(errno));
+    close(fd);
+
+    return rc;
+}
+
+const struct gpio_backend_ops gpio_cdev_ops = {
+    "cdev",
+    cdev_open,
+    cdev_close,
+    cdev_request,
+    cdev_release,
+    cdev_get,
+    cdev_set,
+    cdev_read_event,
+    cdev_request_scan,
+    cdev_release_scan,
+    cdev_get_scan,
+    cdev_reclaim
+};
@@ -0,0 +1,148 @@
+/*
+ * GPIO Debounce for BACnet4Linux
+ * Filters contact bounce and short glitches on binary inputs using the
+ * edge timestamps from the kernel.  Each edge is O(1) - the filter
+ * only keeps the latest level and when the line went to it.
+ */
+
+#include <stdio.h>
+#include <time.h>
+#include "gpio_debounce.h"
+
+void gpio_debounce_init(struct gpio_debounce *filter, unsigned debounce_ms,
+    int level)
+{
+    filter->debounce_ns = (uint64_t) debounce_ms * 1000000ULL;
+    filter->published = level ? 1 : 0;
+    filter->candidate = filter->published;
+    filter->pending = false;
+    filter->since_ns = 0;
+    filter->glitches = 0;
+}
+
+// feeds an edge (or a scanned level) taken at timestamp_ns
+// returns true if the published level changed
+bool gpio_debounce_sample(struct gpio_debounce *filter, int level,
+    uint64_t timestamp_ns)
+{
+    level = level ? 1 : 0;
+    if (level == filter->candidate)
+        return false;
+
+    filter->candidate = level;
+    filter->since_ns = timestamp_ns;
+    if (level == filter->published) {
+        // back where it was before the change settled
+        filter->pending = false;
+        filter->glitches++;
+        return false;
+    }
+    if (filter->debounce_ns == 0) {
+        filter->published = level;
+        return true;
+    }
+    filter->pending = true;
+
+    return false;
+}
+
+// publishes the candidate once it has been stable long enough
+// returns true if the published level changed
+bool gpio_debounce_expire(struct gpio_debounce *filter, uint64_t now_ns)
+{
+    if (!filter->pending || (now_ns < filter->since_ns + filter->debounce_ns))
+        return false;
+
+    filter->pending = false;
+    filter->published = filter->candidate;
+
+    return true;
+}
+
+// when the pending level will be published, 0 if nothing is pending
+uint64_t gpio_debounce_deadline(struct gpio_debounce *filter)
+{
+    return filter->pending ? filter->since_ns + filter->debounce_ns : 0;
+}
+
+// CLOCK_MONOTONIC in ns - the clock the kernel stamps edges with
+uint64_t gpio_debounce_now(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (uint64_t) now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+#ifdef TEST
+#include <assert.h>
+
+#include "ctest.h"
+
+#define MS 1000000ULL
+
+void testGpioDebounce(Test * pTest)
+{
+    struct gpio_debounce filter;
+
+    gpio_debounce_init(&filter, 20, 0);
+    ct_test(pTest, filter.published == 0);
+    ct_test(pTest, gpio_debounce_deadline(&filter) == 0);
+
+    // a bounce shorter than the debounce time is dropped
+    ct_test(pTest, gpio_debounce_sample(&filter, 1, 100 * MS) == false);
+    ct_test(pTest, gpio_debounce_deadline(&filter) == 120 * MS);
+    ct_test(pTest, gpio_debounce_expire(&filter, 110 * MS) == false);
+    ct_test(pTest, gpio_debounce_sample(&filter, 0, 105 * MS) == false);
+    ct_test(pTest, filter.glitches == 1);
+    ct_test(pTest, gpio_debounce_expire(&filter, 200 * MS) == false);
+    ct_test(pTest, filter.published == 0);
+
+    // a burst of bounces restarts the window from the last edge
+    gpio_debounce_sample(&filter, 1, 300 * MS);
+    gpio_debounce_sample(&filter, 0, 302 * MS);
+    gpio_debounce_sample(&filter, 1, 305 * MS);
+    ct_test(pTest, filter.glitches == 2);
+    ct_test(pTest, gpio_debounce_expire(&filter, 322 * MS) == false);
+    ct_test(pTest, gpio_debounce_expire(&filter, 325 * MS) == true);
+    ct_test(pTest, filter.published == 1);
+    ct_test(pTest, gpio_debounce_deadline(&filter) == 0);
+
+    // repeated samples at the same level are not changes
+    ct_test(pTest, gpio_debounce_sample(&filter, 1, 400 * MS) == false);
+    ct_test(pTest, gpio_debounce_deadline(&filter) == 0);
+
+    // no filter - every change is published straight away
+    gpio_debounce_init(&filter, 0, 1);
+    ct_test(pTest, gpio_debounce_sample(&filter, 0, 1 * MS) == true);
+    ct_test(pTest, filter.published == 0);
+    ct_test(pTest, gpio_debounce_sample(&filter, 1, 1 * MS) == true);
+    ct_test(pTest, filter.published == 1);
+    ct_test(pTest, filter.glitches == 0);
+
+    return;
+}
+
+#ifdef TEST_GPIO_DEBOUNCE
+int main(void)
+{
+    Test *pTest;
+    bool rc;
+
+    pTest = ct_create("gpio debounce", NULL);
+
+    /* individual tests */
+    rc = ct_addTestFunction(pTest, testGpioDebounce);
+    assert(rc);
+
+    ct_setStream(pTest, stdout);
+    ct_run(pTest);
+    (void) ct_report(pTest);
+
+    ct_destroy(pTest);
+
+    return 0;
+}
+#endif                          /* TEST_GPIO_DEBOUNCE */
+#endif                          /* TEST */
@@ -0,0 +1,33 @@
+/*####COPYRIGHTBEGIN####
+ -------------------------------------------
+ GPIO Debounce Header for BACnet4Linux - Raspberry Pi Integration
+ -------------------------------------------
+####COPYRIGHTEND####*/
+
+#ifndef GPIO_DEBOUNCE_H
+#define GPIO_DEBOUNCE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// debounce and glitch filter for one input.  A new level is published
+// only after the line has held it for the debounce time; a bounce back
+// to the published level inside that window is dropped as a glitch.
+struct gpio_debounce {
+    uint64_t debounce_ns;       /* stable time required, 0 = no filter */
+    int published;              /* level the object shows */
+    int candidate;              /* latest level seen on the line */
+    bool pending;               /* candidate differs from published */
+    uint64_t since_ns;          /* when the line went to candidate */
+    unsigned long glitches;     /* changes dropped for being too short */
+};
+
+void gpio_debounce_init(struct gpio_debounce *filter, unsigned debounce_ms,
+    int level);
+bool gpio_debounce_sample(struct gpio_debounce *filter, int level,
+    uint64_t timestamp_ns);
+bool gpio_debounce_expire(struct gpio_debounce *filter, uint64_t now_ns);
+uint64_t gpio_debounce_deadline(struct gpio_debounce *filter);
+uint64_t gpio_debounce_now(void);
+
+#endif /* GPIO_DEBOUNCE_H */
@@ -0,0 +1,99 @@
+/*####COPYRIGHTBEGIN####
+ -------------------------------------------
+ GPIO I/O Thread Header for BACnet4Linux - Raspberry Pi Integration
+ -------------------------------------------
+####COPYRIGHTEND####*/
+
+#ifndef GPIO_IO_H
+#define GPIO_IO_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+
+struct gpio_pin;
+
+// commands an output queue can hold - a power of 2
+#define GPIO_IO_QUEUE_SIZE 64
+
+// an output write for the I/O thread
+struct gpio_io_command {
+    struct gpio_pin *pin;
+    float value;
+};
+
+// single producer, single consumer queue.  head is only written by the
+// producer and tail only by the consumer, so neither side takes a lock.
+struct gpio_io_queue {
+    _Atomic unsigned head;      /* next slot to fill */
+    _Atomic unsigned tail;      /* next slot to drain */
+    struct gpio_io_command commands[GPIO_IO_QUEUE_SIZE];
+};
+
+// sequence lock - one writer publishes, readers copy and retry if the
+// writer was part way through.  Readers never block the writer.
+struct gpio_seqlock {
+    _Atomic unsigned sequence;  /* odd while a write is in progress */
+};
+
+// input level published by the I/O thread
+struct gpio_io_input {
+    struct gpio_seqlock lock;
+    int level;
+    uint64_t timestamp_ns;
+};
+
+// analog reading published by the I/O thread
+struct gpio_io_analog {
+    struct gpio_seqlock lock;
+    float value;
+    uint64_t timestamp_ns;
+};
+
+// I/O thread counters, published as one snapshot
+struct gpio_io_stats {
+    unsigned long passes;       /* times the thread woke and ran */
+    unsigned long writes;       /* output writes that reached the hardware */
+    unsigned long write_errors;
+    unsigned long scans;        /* bulk input scans */
+    uint64_t scan_duration_ns;  /* time taken by the last scan */
+    unsigned long edges;        /* edge events read */
+    unsigned long glitches;     /* changes dropped by the debounce filters */
+    uint64_t max_busy_ns;       /* longest time spent on the hardware */
+    unsigned long adc_bursts;   /* analog input bursts */
+    unsigned long adc_conversions;
+    unsigned long adc_errors;
+    uint64_t adc_burst_ns;      /* time taken by the last burst */
+};
+
+void gpio_io_queue_init(struct gpio_io_queue *queue);
+bool gpio_io_queue_push(struct gpio_io_queue *queue,
+    const struct gpio_io_command *command);
+bool gpio_io_queue_pop(struct gpio_io_queue *queue,
+    struct gpio_io_command *command);
+
+void gpio_seqlock_init(struct gpio_seqlock *lock);
+void gpio_seqlock_write_begin(struct gpio_seqlock *lock);
+void gpio_seqlock_write_end(struct gpio_seqlock *lock);
+unsigned gpio_seqlock_read_begin(struct gpio_seqlock *lock);
+bool gpio_seqlock_read_retry(struct gpio_seqlock *lock, unsigned start);
+
+void gpio_io_input_publish(struct gpio_io_input *input, int level,
+    uint64_t timestamp_ns);
+int gpio_io_input_read(struct gpio_io_input *input, uint64_t *timestamp_ns);
+void gpio_io_analog_publish(struct gpio_io_analog *analog, float value,
+    uint64_t timestamp_ns);
+float gpio_io_analog_read(struct gpio_io_analog *analog,
+    uint64_t *timestamp_ns);
+void gpio_io_stats_publish(struct gpio_seqlock *lock,
+    struct gpio_io_stats *published, const struct gpio_io_stats *stats);
+void gpio_io_stats_read(struct gpio_seqlock *lock,
+    const struct gpio_io_stats *published, struct gpio_io_stats *stats);
+
+// wake pipes - a byte in the pipe wakes the thread selecting on it
+int gpio_io_wake_open(int fds[2]);
+void gpio_io_wake(int fds[2]);
+void gpio_io_wake_drain(int fds[2]);
+void gpio_io_wake_close(int fds[2]);
+
+#endif /* GPIO_IO_H */
@@ -7,19 +7,38 @@
 #ifndef GPIO_OBJECTS_H
 #define GPIO_OBJECTS_H
 
+#include <sys/select.h>
+#include <stdbool.h>
 #include "bacnet_struct.h"
 #include "bacnet_enum.h"
+#include "gpio_io.h"
+
+// Output commit stage counters
+struct gpio_commit_stats {
+    unsigned long staged;       /* writes staged for the hardware */
+    unsigned long coalesced;    /* replaced by a later write in the same pass */
+    unsigned long unchanged;    /* already at the value, not written */
+    unsigned long committed;    /* writes passed on to the hardware */
+    unsigned long deferred;     /* held a pass because the queue was full */
+};
 
 // Function prototypes
-void gpio_objects_init(int device_id);
+int gpio_objects_init(int device_id);
 void gpio_create_default_objects(int device_id);
 void gpio_create_objects_from_config(int device_id, const char *json_config);
 void gpio_update_inputs(int device_id);
-void gpio_objects_update_values(int device_id);
-int gpio_handle_read_property(struct BACnet_Device_Address *src, uint8_t invoke_id, 
-                             BACNET_OBJECT_TYPE object_type, uint32_t instance,
-                             BACNET_PROPERTY_ID property, 
-                             uint32_t array_index, uint16_t src_max_apdu);
+void gpio_objects_timeout(struct timeval *timeout);
+struct gpio_scan *gpio_objects_input_scan(void);
+unsigned long gpio_objects_glitch_count(void);
+void gpio_commit_outputs(void);
+const struct gpio_commit_stats *gpio_objects_commit_stats(void);
+void gpio_objects_io_stats(struct gpio_io_stats *stats);
+bool gpio_objects_io_thread(void);
+void gpio_objects_stop(void);
+int gpio_objects_fd_set(fd_set *read_fds, int max);
+void gpio_receive_events(int device_id, fd_set *read_fds);
+BACNET_RELIABILITY gpio_object_reliability(BACNET_OBJECT_TYPE object_type,
+    uint32_t instance);
 int gpio_objects_write_property(int object_type,
                                uint32_t instance, uint32_t property,
                                uint8_t tag, void *value, uint8_t priority);
@@ -0,0 +1,288 @@
+/*
+ * GPIO Pin Table for BACnet4Linux
+ * One entry per configured GPIO object - the pin, the held backend
+ * handle and the priority array.  Entries are found by object type and
+ * instance through a small open addressing hash, and by line offset for
+ * edge events, so no lookup walks the table.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "bacnet_struct.h"
+#include "bacnet_enum.h"
+#include "key.h"
+#include "debug.h"
+#include "gpio_pins.h"
+
+static struct gpio_pin Pins[GPIO_MAX_PINS];
+static int Pin_Count = 0;
+// Pins index + 1 in each slot, 0 if the slot is empty
+static uint8_t Pin_Hash[GPIO_PIN_HASH_SIZE];
+// Pins index + 1 for each line offset, 0 if no pin uses the line
+static uint8_t Pin_By_Line[GPIO_MAX_LINES];
+
+// spreads the object key over the slots - instances are usually close
+// together, so a multiplicative hash keeps them from clustering
+static unsigned gpio_pin_slot(BACNET_OBJECT_TYPE object_type,
+    uint32_t instance)
+{
+    uint32_t key = KEY_ENCODE(object_type, instance);
+
+    return (key * 2654435761U) >> 25;   /* top 7 bits - 128 slots */
+}
+
+void gpio_pins_init(void)
+{
+    memset(Pins, 0, sizeof(Pins));
+    memset(Pin_Hash, 0, sizeof(Pin_Hash));
+    memset(Pin_By_Line, 0, sizeof(Pin_By_Line));
+    Pin_Count = 0;
+}
+
+// returns the new entry, or NULL if the object is already in the table,
+// its line or PWM channel is already used, or the table is full
+struct gpio_pin *gpio_pin_add(BACNET_OBJECT_TYPE object_type,
+    uint32_t instance, int gpio_pin, int pwm_channel)
+{
+    struct gpio_pin *pin;
+    unsigned slot;
+    int i;
+
+    if (gpio_pin_find(object_type, instance)) {
+        debug_printf(1, "GPIO: Object type %d instance %u configured twice\n",
+            object_type, instance);
+        return NULL;
+    }
+    if (Pin_Count >= GPIO_MAX_PINS) {
+        error_printf("GPIO: Pin table full, type %d instance %u not served\n",
+            object_type, instance);
+        return NULL;
+    }
+    if ((gpio_pin >= 0) && (gpio_pin < GPIO_MAX_LINES) &&
+        Pin_By_Line[gpio_pin]) {
+        debug_printf(1, "GPIO: Pin %d already used by instance %u\n",
+            gpio_pin, Pins[Pin_By_Line[gpio_pin] - 1].instance);
+        return NULL;
+    }
+    // gpio_pwm_request hands back the held channel, so a second
+    // object on it would silently drive the same output
+    if (pwm_channel >= 0) {
+        for (i = 0; i < Pin_Count; i++) {
+            if (Pins[i].pwm_channel == pwm_channel) {
+                error_printf("GPIO: PWM channel %d already used by "
+                    "instance %u, instance %u not served\n", pwm_channel,
+                    Pins[i].instance, instance);
+                return NULL;
+            }
+        }
+    }
+
+    pin = &Pins[Pin_Count++];
+    memset(pin, 0, sizeof(*pin));
+    pin->object_type = object_type;
+    pin->instance = instance;
+    pin->gpio_pin = gpio_pin;
+    pin->pwm_channel = pwm_channel;
+    pin->scan_index = -1;
+    pin->adc_channel = -1;
+    gpio_debounce_init(&pin->filter, 0, 0);
+
+    // the table is never more than half full, so there is always a slot
+    slot = gpio_pin_slot(object_type, instance);
+    while (Pin_Hash[slot])
+        slot = (slot + 1) & (GPIO_PIN_HASH_SIZE - 1);
+    Pin_Hash[slot] = Pin_Count;
+    if ((gpio_pin >= 0) && (gpio_pin < GPIO_MAX_LINES))
+        Pin_By_Line[gpio_pin] = Pin_Count;
+
+    return pin;
+}
+
+struct gpio_pin *gpio_pin_find(BACNET_OBJECT_TYPE object_type,
+    uint32_t instance)
+{
+    struct gpio_pin *pin;
+    unsigned slot;
+
+    slot = gpio_pin_slot(object_type, instance);
+    while (Pin_Hash[slot]) {
+        pin = &Pins[Pin_Hash[slot] - 1];
+        if ((pin->object_type == object_type) && (pin->instance == instance))
+            return pin;
+        slot = (slot + 1) & (GPIO_PIN_HASH_SIZE - 1);
+    }
+
+    return NULL;
+}
+
+// the entry driving or reading a line offset, NULL if there is none
+struct gpio_pin *gpio_pin_from_line(int offset)
+{
+    if ((offset < 0) || (offset >= GPIO_MAX_LINES) || !Pin_By_Line[offset])
+        return NULL;
+
+    return &Pins[Pin_By_Line[offset] - 1];
+}
+
+int gpio_pin_count(void)
+{
+    return Pin_Count;
+}
+
+// entries in the order they were configured
+struct gpio_pin *gpio_pin_at(int index)
+{
+    if ((index < 0) || (index >= Pin_Count))
+        return NULL;
+
+    return &Pins[index];
+}
+
+bool gpio_pin_is_output(struct gpio_pin *pin)
+{
+    return pin && ((pin->object_type == OBJECT_BINARY_OUTPUT) ||
+        (pin->object_type == OBJECT_ANALOG_OUTPUT));
+}
+
+// returns true if the priority is NULL (or out of range)
+bool gpio_pin_priority_get(struct gpio_pin *pin, int priority,
+    union ObjectValue *value)
+{
+    if (!pin || (priority < 1) || (priority > BACNET_MAX_PRIORITY))
+        return true;
+    if (!(pin->priority.priorities_set & (1U << (priority - 1))))
+        return true;
+
+    *value = pin->priority.values[priority - 1];
+    return false;
+}
+
+bool gpio_pin_priority_set(struct gpio_pin *pin, int priority,
+    union ObjectValue value)
+{
+    if (!pin || (priority < 1) || (priority > BACNET_MAX_PRIORITY))
+        return false;
+
+    pin->priority.values[priority - 1] = value;
+    pin->priority.priorities_set |= (1U << (priority - 1));
+    return true;
+}
+
+bool gpio_pin_priority_relinquish(struct gpio_pin *pin, int priority)
+{
+    if (!pin || (priority < 1) || (priority > BACNET_MAX_PRIORITY))
+        return false;
+
+    pin->priority.priorities_set &= ~(1U << (priority - 1));
+    return true;
+}
+
+// the value of the highest commanded priority, or the relinquish default
+union ObjectValue gpio_pin_effective_value(struct gpio_pin *pin)
+{
+    // If out of service, return present value (not priority array)
+    if (pin->priority.out_of_service && pin->obj_ptr)
+        return pin->obj_ptr->value;
+
+    if (pin->priority.priorities_set)
+        return pin->priority.values[__builtin_ctz(pin->priority.
+                priorities_set)];
+
+    return pin->priority.relinquish_default;
+}
+
+#ifdef TEST
+#include <assert.h>
+
+#include "ctest.h"
+
+void testGpioPins(Test * pTest)
+{
+    struct gpio_pin *pin;
+    union ObjectValue value;
+    uint32_t instance;
+    int i;
+
+    gpio_pins_init();
+    ct_test(pTest, gpio_pin_count() == 0);
+    ct_test(pTest, gpio_pin_find(OBJECT_BINARY_OUTPUT, 4018) == NULL);
+
+    pin = gpio_pin_add(OBJECT_BINARY_OUTPUT, 4018, 18, -1);
+    ct_test(pTest, pin != NULL);
+    ct_test(pTest, gpio_pin_find(OBJECT_BINARY_OUTPUT, 4018) == pin);
+    ct_test(pTest, gpio_pin_from_line(18) == pin);
+    ct_test(pTest, gpio_pin_is_output(pin));
+    // same instance, different type is a different object
+    ct_test(pTest, gpio_pin_find(OBJECT_BINARY_INPUT, 4018) == NULL);
+    // an object or a line is only used once
+    ct_test(pTest, gpio_pin_add(OBJECT_BINARY_OUTPUT, 4018, 17, -1) == NULL);
+    ct_test(pTest, gpio_pin_add(OBJECT_BINARY_INPUT, 3018, 18, -1) == NULL);
+    pin = gpio_pin_add(OBJECT_ANALOG_OUTPUT, 2021, -1, 0);
+    ct_test(pTest, pin != NULL);
+    ct_test(pTest, pin->pwm_channel == 0);
+    // nor is a PWM channel
+    ct_test(pTest, gpio_pin_add(OBJECT_ANALOG_OUTPUT, 2022, -1, 0) == NULL);
+    ct_test(pTest, gpio_pin_count() == 2);
+
+    // fill the table - every entry can still be found
+    for (i = gpio_pin_count(); i < GPIO_MAX_PINS; i++) {
+        instance = 3000 + i;
+        ct_test(pTest, gpio_pin_add(OBJECT_BINARY_INPUT, instance,
+                (i + 20 < GPIO_MAX_LINES) ? i + 20 : -1, -1) != NULL);
+    }
+    ct_test(pTest, gpio_pin_add(OBJECT_BINARY_INPUT, 9999, -1, -1) == NULL);
+    for (i = 0; i < gpio_pin_count(); i++) {
+        pin = gpio_pin_at(i);
+        ct_test(pTest, gpio_pin_find(pin->object_type, pin->instance) == pin);
+    }
+    ct_test(pTest, gpio_pin_at(GPIO_MAX_PINS) == NULL);
+
+    // priority array - the lowest commanded priority wins
+    pin = gpio_pin_find(OBJECT_ANALOG_OUTPUT, 2021);
+    pin->priority.relinquish_default.real = 5.0;
+    value = gpio_pin_effective_value(pin);
+    ct_test(pTest, value.real == 5.0);
+    ct_test(pTest, gpio_pin_priority_get(pin, 8, &value) == true);
+    value.real = 40.0;
+    ct_test(pTest, gpio_pin_priority_set(pin, 16, value));
+    value.real = 80.0;
+    ct_test(pTest, gpio_pin_priority_set(pin, 8, value));
+    ct_test(pTest, gpio_pin_effective_value(pin).real == 80.0);
+    ct_test(pTest, gpio_pin_priority_get(pin, 16, &value) == false);
+    ct_test(pTest, value.real == 40.0);
+    gpio_pin_priority_relinquish(pin, 8);
+    ct_test(pTest, gpio_pin_effective_value(pin).real == 40.0);
+    gpio_pin_priority_relinquish(pin, 16);
+    ct_test(pTest, gpio_pin_effective_value(pin).real == 5.0);
+    // priorities above 8 need all 16 bits of the mask
+    value.real = 60.0;
+    gpio_pin_priority_set(pin, 12, value);
+    ct_test(pTest, gpio_pin_effective_value(pin).real == 60.0);
+    ct_test(pTest, gpio_pin_priority_set(pin, 0, value) == false);
+    ct_test(pTest, gpio_pin_priority_set(pin, 17, value) == false);
+
+    return;
+}
+
+#ifdef TEST_GPIO_PINS
+int main(void)
+{
+    Test *pTest;
+    bool rc;
+
+    pTest = ct_create("gpio pins", NULL);
+
+    /* individual tests */
+    rc = ct_addTestFunction(pTest, testGpioPins);
+    assert(rc);
+
+    ct_setStream(pTest, stdout);
+    ct_run(pTest);
+    (void) ct_report(pTest);
+
+    ct_destroy(pTest);
+
+    return 0;
+}
+#endif                          /* TEST_GPIO_PINS */
+#endif                          /* TEST */
@@ -0,0 +1,80 @@
+/*####COPYRIGHTBEGIN####
+ -------------------------------------------
+ GPIO Pin Table Header for BACnet4Linux - Raspberry Pi Integration
+ -------------------------------------------
+####COPYRIGHTEND####*/
+
+#ifndef GPIO_PINS_H
+#define GPIO_PINS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "bacnet_struct.h"
+#include "bacnet_enum.h"
+#include "gpio_backend.h"
+#include "gpio_pwm.h"
+#include "gpio_adc.h"
+#include "gpio_debounce.h"
+#include "gpio_io.h"
+
+// GPIO objects we can serve
+#define GPIO_MAX_PINS 64
+// lookup slots - a power of 2, at least twice GPIO_MAX_PINS
+#define GPIO_PIN_HASH_SIZE 128
+
+// Priority array support (16 priority levels as per BACnet standard)
+#define BACNET_MAX_PRIORITY 16
+#define BACNET_NO_PRIORITY 0
+
+// Priority array for each GPIO output object
+struct gpio_priority_array {
+    union ObjectValue values[BACNET_MAX_PRIORITY];
+    uint16_t priorities_set;    /* bit n set - priority n+1 is commanded */
+    union ObjectValue relinquish_default;
+    uint8_t out_of_service;
+};
+
+// one entry per GPIO object, built from gpio_pin_config.json at startup
+struct gpio_pin {
+    BACNET_OBJECT_TYPE object_type;
+    uint32_t instance;
+    int gpio_pin;               /* BCM line offset, -1 if none */
+    int pwm_channel;            /* pwmchip channel, -1 if none */
+    struct ObjectRef_Struct *obj_ptr;
+    struct gpio_line *line;     /* held line handle */
+    struct gpio_pwm_channel *pwm;       /* held PWM channel */
+    /* outputs */
+    struct gpio_priority_array priority;
+    float pending;              /* value staged by the latest write */
+    float committed;            /* value last driven to the hardware */
+    bool dirty;                 /* pending is waiting to be committed */
+    bool committed_valid;       /* committed holds what the pin is at */
+    /* inputs */
+    struct gpio_debounce filter;
+    int scan_index;             /* position in the bulk scan, -1 if none */
+    struct gpio_io_input input; /* filtered level from the I/O thread */
+    /* analog inputs */
+    int adc_channel;            /* converter channel, -1 if none */
+    struct gpio_adc_channel *adc;       /* held ADC channel */
+    struct gpio_io_analog analog;       /* averaged value from the I/O thread */
+};
+
+void gpio_pins_init(void);
+struct gpio_pin *gpio_pin_add(BACNET_OBJECT_TYPE object_type,
+    uint32_t instance, int gpio_pin, int pwm_channel);
+struct gpio_pin *gpio_pin_find(BACNET_OBJECT_TYPE object_type,
+    uint32_t instance);
+struct gpio_pin *gpio_pin_from_line(int offset);
+int gpio_pin_count(void);
+struct gpio_pin *gpio_pin_at(int index);
+bool gpio_pin_is_output(struct gpio_pin *pin);
+
+// priority array
+bool gpio_pin_priority_get(struct gpio_pin *pin, int priority,
+    union ObjectValue *value);
+bool gpio_pin_priority_set(struct gpio_pin *pin, int priority,
+    union ObjectValue value);
+bool gpio_pin_priority_relinquish(struct gpio_pin *pin, int priority);
+union ObjectValue gpio_pin_effective_value(struct gpio_pin *pin);
+
+#endif /* GPIO_PINS_H */
@@ -0,0 +1,58 @@
+/*####COPYRIGHTBEGIN####
+ -------------------------------------------
+ GPIO PWM Header for BACnet4Linux - Raspberry Pi Integration
+ -------------------------------------------
+####COPYRIGHTEND####*/
+
+#ifndef GPIO_PWM_H
+#define GPIO_PWM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// channels we can hold on one pwmchip
+#define GPIO_PWM_MAX_CHANNELS 8
+
+// default PWM period - 1 kHz suits both the RP1 PWM block and the
+// pwm-gpio overlay used for pins without a hardware PWM function
+#define GPIO_PWM_PERIOD_NS 1000000UL
+
+// a PWM channel - exported and enabled once, held until cleanup
+struct gpio_pwm_channel {
+    int channel;                /* channel number on the pwmchip */
+    bool requested;             /* true while we hold the channel */
+    int duty_fd;                /* open duty_cycle attribute, -1 if none */
+    unsigned long period_ns;
+    unsigned long duty_ns;      /* duty last written to the channel */
+    unsigned long writes;       /* duty writes that reached the channel */
+};
+
+// operations provided by each PWM backend
+struct gpio_pwm_ops {
+    const char *name;
+    int (*open) (const char *chip);
+    void (*close) (void);
+    int (*request) (struct gpio_pwm_channel * pwm);
+    void (*release) (struct gpio_pwm_channel * pwm);
+    int (*set_duty) (struct gpio_pwm_channel * pwm, unsigned long duty_ns);
+};
+
+// sysfs pwmchip backend (/sys/class/pwm/pwmchipN)
+extern const struct gpio_pwm_ops gpio_pwm_sysfs_ops;
+// in-process simulated PWM for tests and benchmarks
+extern const struct gpio_pwm_ops gpio_pwm_sim_ops;
+
+// chip is a pwmchip name ("pwmchip0") or "sim"
+int gpio_pwm_init(const char *chip);
+const char *gpio_pwm_name(void);
+struct gpio_pwm_channel *gpio_pwm_request(int channel,
+    unsigned long period_ns);
+int gpio_pwm_set_percent(struct gpio_pwm_channel *pwm, float percent);
+void gpio_pwm_cleanup(void);
+
+// simulated PWM hooks
+unsigned long gpio_pwm_sim_duty(int channel);
+unsigned long gpio_pwm_sim_write_count(int channel);
+void gpio_pwm_sim_reset(void);
+
+#endif /* GPIO_PWM_H */
@@ -0,0 +1,43 @@
+/*####COPYRIGHTBEGIN####
+ -------------------------------------------
+ Interned String Table Header for BACnet4Linux
+ -------------------------------------------
+####COPYRIGHTEND####*/
+
+#ifndef INTERN_H
+#define INTERN_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Object names and state texts repeat across a site ("Active", "On",
+// "Normal"...), so each distinct text is stored once and shared.  The
+// strings are reference counted and must not be written to.
+
+// smallest table - a power of 2
+#define INTERN_MIN_SLOTS 64
+// each distinct text also has a small id, for records that cannot
+// afford a pointer.  Id 0 is never used, so it can stand for no text.
+#define INTERN_MAX_IDS (1u << 20)
+
+struct intern_stats {
+    unsigned long strings;      /* distinct texts held */
+    unsigned long references;   /* texts handed out and not released */
+    size_t copy_bytes;          /* what a copy per reference would take */
+    size_t interned_bytes;      /* what the shared texts take */
+};
+
+// returns the shared copy of text with one more reference,
+// or NULL if text is NULL or memory ran out
+char *intern_string(const char *text);
+// drops a reference - the text is freed with its last one
+void intern_release(char *text);
+// points *field at the shared copy of text, releasing what was there
+void intern_assign(char **field, const char *text);
+// the same by id - intern_id returns 0 for NULL or if memory ran out
+uint32_t intern_id(const char *text);
+const char *intern_text(uint32_t id);
+void intern_release_id(uint32_t id);
+void intern_get_stats(struct intern_stats *stats);
+
+#endif /* INTERN_H */
@@ -32,195 +32,1220 @@
 #include "bacnet_const.h"
 #include "bacnet_struct.h"
 #include "bacnet_api.h"
+#include "bacnet_device.h"
 #include "ethernet.h"
 #include "invoke_id.h"
 #include "main.h"
 #include "net.h"
+#include "slab.h"
 
 extern int BACnet_APDU_Timeout;
+extern int BACnet_APDU_Retries;
 
-static struct Invoke_Status_Struct Invoke_Id[MAXINVOKEIDS + 1];
+/* the retry timeout of a device is learned from how long its replies
+   take, as TCP does (Jacobson and Karels) - a smoothed round trip time
+   and its variation, with the timeout the one plus four times the
+   other.  Only a request answered without a retry is timed, since a
+   reply to a retried one could be for either send.  Each retry waits
+   twice as long as the one before, and a request that runs out of
+   retries doubles the timeout of its device until the next reply. */
+#define INVOKE_RTO_MIN_MS 250
+#define INVOKE_RTO_MAX_MS 60000
 
-/* current status of this invoke ID */
-enum Invoke_Status invoke_id_status(int id)
+static struct Invoke_Status_Struct Invoke_Id[MAXTRANSACTIONS];
+
+/* the free request records, oldest first */
+static uint16_t Free_Id[MAXTRANSACTIONS];
+static int Free_Head = 0;       /* next record to hand out */
+static int Free_Count = 0;      /* records in the free list */
+static int In_Use_High_Water = 0;       /* most requests in use at once */
+/* where the search for a free ID in a peer's space starts - it moves on
+   with every ID handed out, so that an ID is not used again for a peer
+   soon after a late reply could still arrive for it */
+static int Next_Id = 0;
+
+/* the records in use, in an open addressing hash by peer and invoke ID,
+   kept no more than half full - a slot holds a record number, or -1 */
+#define TRANSACTION_SLOTS (MAXTRANSACTIONS * 2)
+#define TRANSACTION_MASK (TRANSACTION_SLOTS - 1)
+static int Transaction_Slot[TRANSACTION_SLOTS];
+
+/* the encoded frames kept for a retry, in pools of a few sizes so a
+   frame takes about the room it needs - the largest holds a full APDU */
+#define FRAME_CLASSES 4
+#define FRAME_SMALLEST 64
+#define FRAME_SLAB_BYTES 4096
+static struct slab_pool Frame_Pool[FRAME_CLASSES];
+static struct slab_stats Frame_Slab_Stats[FRAME_CLASSES] = {
+    {"Frames 64"}, {"Frames 128"}, {"Frames 256"}, {"Frames 512"}
+};
+static bool Frame_Pools_Ready = false;
+
+/* the requests waiting on a reply, in a binary min-heap by deadline -
+   the children of slot k are 2k and 2k+1, and slot 1 is due first */
+static uint16_t Timer_Heap[MAXTRANSACTIONS + 1];
+static int Timer_Count = 0;
+
+/* monotonic time in ns - request deadlines ignore wall clock steps */
+static uint64_t invoke_id_now(void)
 {
-    enum Invoke_Status status = INVOKE_STATUS_NOACTIVITY;
+    struct timespec now;
 
-    if (id <= MAXINVOKEIDS)
-        status = Invoke_Id[id].status;
+    clock_gettime(CLOCK_MONOTONIC, &now);
 
-    return status;
+    return (uint64_t) now.tv_sec * 1000000000ULL + now.tv_nsec;
 }
-void invoke_id_set_status(int id, enum Invoke_Status status)
+
+/* the timeout in ms that a request to this device starts with - the
+   APDU timeout, which is kept in milliseconds, until a reply has been
+   timed */
+int invoke_id_device_timeout(struct BACnet_Device_Info *dev_ptr)
 {
-    if (id <= MAXINVOKEIDS)
-        Invoke_Id[id].status = status;
+    if (dev_ptr && dev_ptr->rto_ms)
+        return dev_ptr->rto_ms;
+
+    return BACnet_APDU_Timeout > 0 ? BACnet_APDU_Timeout : 0;
 }
 
-/* time that the request was sent */
-time_t invoke_id_time_sent(int id)
+/* how long in ms a try of a request to this device waits for a reply */
+static uint64_t invoke_id_try_ms(struct BACnet_Device_Info *dev_ptr,
+    int tries)
 {
-    time_t time_sent = 0;
+    uint64_t timeout_ms, limit_ms;
 
-    if (id <= MAXINVOKEIDS)
-        time_sent = Invoke_Id[id].time_sent;
+    timeout_ms = invoke_id_device_timeout(dev_ptr);
+    /* backing off stops at the most a timeout can be */
+    limit_ms = (timeout_ms > INVOKE_RTO_MAX_MS) ? timeout_ms :
+        INVOKE_RTO_MAX_MS;
+    while (tries-- > 0) {
+        timeout_ms <<= 1;
+        if (timeout_ms >= limit_ms)
+            return limit_ms;
+    }
 
-    return time_sent;
+    return timeout_ms;
 }
-void invoke_id_set_time_sent(int id, time_t time_sent)
+
+/* how long in ms a request to this device can wait, over all its
+   tries, before it has failed */
+int invoke_id_device_lifetime(struct BACnet_Device_Info *dev_ptr)
 {
-    if (id <= MAXINVOKEIDS)
-        Invoke_Id[id].time_sent = time_sent;
+    uint64_t lifetime_ms = 0;
+    int tries;
+
+    for (tries = 0; tries <= BACnet_APDU_Retries; tries++)
+        lifetime_ms += invoke_id_try_ms(dev_ptr, tries);
+    if (lifetime_ms > INT32_MAX)
+        lifetime_ms = INT32_MAX;
+
+    return lifetime_ms;
 }
 
-/* NPDU that was sent */
-struct BACnet_NPDU *invoke_id_npdu(int id)
+/* how long the current try of this request waits for a reply */
+static uint64_t invoke_id_timeout_ns(int t)
 {
-    struct BACnet_NPDU *npdu = NULL;
+    return invoke_id_try_ms(device_get(Invoke_Id[t].device),
+        Invoke_Id[t].tries) * 1000000ULL;
+}
 
-    if (id <= MAXINVOKEIDS)
-        npdu = &Invoke_Id[id].npdu;
+/* takes in the round trip time of a request to this device */
+static void invoke_id_rtt_sample(struct BACnet_Device_Info *dev_ptr,
+    uint64_t rtt_ns)
+{
+    uint32_t rtt_us, delta_us;
+    uint64_t rto_ms;
 
-    return npdu;
+    rtt_us = rtt_ns / 1000;
+    if (rtt_us < 1)
+        rtt_us = 1;
+    if (rtt_us > 1000u * INVOKE_RTO_MAX_MS)
+        rtt_us = 1000u * INVOKE_RTO_MAX_MS;
+    if (!dev_ptr->srtt_us) {
+        dev_ptr->srtt_us = rtt_us;
+        dev_ptr->rttvar_us = rtt_us / 2;
+    } else {
+        delta_us = (dev_ptr->srtt_us > rtt_us) ?
+            dev_ptr->srtt_us - rtt_us : rtt_us - dev_ptr->srtt_us;
+        dev_ptr->rttvar_us = (3 * (uint64_t) dev_ptr->rttvar_us +
+            delta_us) / 4;
+        dev_ptr->srtt_us = (7 * (uint64_t) dev_ptr->srtt_us + rtt_us) / 8;
+    }
+    rto_ms = ((uint64_t) dev_ptr->srtt_us + 4 * (uint64_t)
+        dev_ptr->rttvar_us + 999) / 1000;
+    if (rto_ms < INVOKE_RTO_MIN_MS)
+        rto_ms = INVOKE_RTO_MIN_MS;
+    if (rto_ms > INVOKE_RTO_MAX_MS)
+        rto_ms = INVOKE_RTO_MAX_MS;
+    dev_ptr->rto_ms = rto_ms;
 }
 
-/* returns the next available Invoke ID for use */
-/* but does not change the status of that invoke ID */
-int invoke_id(void)
+/* the smallest frame pool that holds len bytes, or -1 */
+static int frame_class(int len)
 {
-    int i;
-    static int lastID = 0;      /* the ID that was used for the last request */
+    int size_class;
 
-    debug_printf(5, "invoke-id: Entered 'get_invoke_id'\n");
+    for (size_class = 0; size_class < FRAME_CLASSES; size_class++) {
+        if (len <= (FRAME_SMALLEST << size_class))
+            return size_class;
+    }
 
-    for (i = (lastID + 1); i <= MAXINVOKEIDS; i++) {    /* from 'lastID' to end */
-        if (Invoke_Id[i].status == INVOKE_STATUS_NOACTIVITY) {  /* this Invoke ID is not in use */
-            lastID = i;
-            return i;           /* return it */
-        }
+    return -1;
+}
+
+static void frame_free(int t)
+{
+    if (Invoke_Id[t].frame) {
+        slab_free(&Frame_Pool[Invoke_Id[t].frame_class],
+            Invoke_Id[t].frame);
+        Invoke_Id[t].frame = NULL;
+    }
+    Invoke_Id[t].frame_len = 0;
+}
+
+/* the peer that a reply came from */
+static void peer_from_src(struct Invoke_Peer *peer,
+    struct BACnet_Device_Address *src)
+{
+    memset(peer, 0, sizeof(*peer));
+    memcpy(peer->mac, src->mac, MAX_MAC_LEN);
+    peer->ip = src->ip;
+    if (src->net == -1)
+        peer->net = -1;
+    else {
+        memcpy(peer->adr, src->adr, MAX_MAC_LEN);
+        peer->net = src->net;
+    }
+}
+
+/* the peer that a request is going to */
+static void peer_from_npdu(struct Invoke_Peer *peer,
+    struct BACnet_NPDU *npdu)
+{
+    memset(peer, 0, sizeof(*peer));
+    memcpy(peer->mac, npdu->dest.mac, MAX_MAC_LEN);
+    peer->ip = npdu->dest.ip;
+    if (!npdu->dest_present)
+        peer->net = -1;
+    else {
+        memcpy(peer->adr, npdu->dest.adr, MAX_MAC_LEN);
+        peer->net = npdu->dest.net;
     }
-    for (i = 0; i < lastID; i++) {      /* from beginning to 'lastID' */
-        /* this Invoke ID is not in use */
-        if (Invoke_Id[i].status == INVOKE_STATUS_NOACTIVITY) {
-            lastID = i;
-            return i;           /* return it */
+}
+
+/* the peer for a log message - its B/IP address, or its MAC */
+static char *peer_name(struct Invoke_Peer *peer)
+{
+    if (peer->ip.s_addr)
+        return inet_ntoa(peer->ip);
+
+    return hwaddrtoa(peer->mac);
+}
+
+/* FNV-1a over the peer and the ID */
+static unsigned transaction_hash(const struct Invoke_Peer *peer, int id)
+{
+    const uint8_t *bytes = (const uint8_t *) peer;
+    uint32_t hash = 2166136261u;
+    size_t i;
+
+    for (i = 0; i < sizeof(*peer); i++) {
+        hash ^= bytes[i];
+        hash *= 16777619u;
+    }
+    hash ^= (uint8_t) id;
+    hash *= 16777619u;
+
+    return hash;
+}
+
+/* finds the slot holding this request, or the empty slot that ends
+   its run */
+static unsigned transaction_probe(const struct Invoke_Peer *peer, int id)
+{
+    unsigned slot = transaction_hash(peer, id) & TRANSACTION_MASK;
+    int t;
+
+    while ((t = Transaction_Slot[slot]) != -1) {
+        if ((Invoke_Id[t].invoke_id == id) &&
+            (memcmp(&Invoke_Id[t].peer, peer, sizeof(*peer)) == 0))
+            break;
+        slot = (slot + 1) & TRANSACTION_MASK;
+    }
+
+    return slot;
+}
+
+/* the record for this request, or -1 if there is none */
+static int transaction_find(const struct Invoke_Peer *peer, int id)
+{
+    if ((id < 0) || (id > MAXINVOKEIDS))
+        return -1;
+
+    return Transaction_Slot[transaction_probe(peer, id)];
+}
+
+static void transaction_unhash(int t)
+{
+    unsigned hole, slot, home;
+
+    hole = transaction_probe(&Invoke_Id[t].peer, Invoke_Id[t].invoke_id);
+    if (Transaction_Slot[hole] != t)
+        return;
+    Transaction_Slot[hole] = -1;
+    /* pull back any later entry of the run that the hole now cuts off
+       from its home slot */
+    for (slot = (hole + 1) & TRANSACTION_MASK;
+        Transaction_Slot[slot] != -1;
+        slot = (slot + 1) & TRANSACTION_MASK) {
+        home = transaction_hash(&Invoke_Id[Transaction_Slot[slot]].peer,
+            Invoke_Id[Transaction_Slot[slot]].invoke_id) &
+            TRANSACTION_MASK;
+        if (((slot - home) & TRANSACTION_MASK) >=
+            ((slot - hole) & TRANSACTION_MASK)) {
+            Transaction_Slot[hole] = Transaction_Slot[slot];
+            Transaction_Slot[slot] = -1;
+            hole = slot;
         }
     }
-    return -1;
 }
 
-/* checks that all Invoke IDs are available for use */
-/* this is used to slow down network requests to a sub-Linux pace :) */
-int invoke_id_in_use(void)
+static void timer_place(int slot, int t)
+{
+    Timer_Heap[slot] = (uint16_t) t;
+    Invoke_Id[t].timer_slot = slot;
+}
+
+/* moves the request in slot up or down until the heap is in order */
+static void timer_fix(int slot)
 {
+    int t = Timer_Heap[slot];
+    uint64_t deadline = Invoke_Id[t].deadline;
+    int child;
+
+    while ((slot > 1) &&
+        (Invoke_Id[Timer_Heap[slot / 2]].deadline > deadline)) {
+        timer_place(slot, Timer_Heap[slot / 2]);
+        slot /= 2;
+    }
+    while ((child = slot * 2) <= Timer_Count) {
+        if ((child < Timer_Count) &&
+            (Invoke_Id[Timer_Heap[child + 1]].deadline <
+                Invoke_Id[Timer_Heap[child]].deadline))
+            child++;
+        if (Invoke_Id[Timer_Heap[child]].deadline >= deadline)
+            break;
+        timer_place(slot, Timer_Heap[child]);
+        slot = child;
+    }
+    timer_place(slot, t);
+}
+
+/* (re)arms the deadline for this request */
+static void timer_set(int t, uint64_t deadline)
+{
+    Invoke_Id[t].deadline = deadline;
+    if (!Invoke_Id[t].timer_slot) {
+        Timer_Count++;
+        timer_place(Timer_Count, t);
+    }
+    timer_fix(Invoke_Id[t].timer_slot);
+}
+
+static void timer_cancel(int t)
+{
+    int slot = Invoke_Id[t].timer_slot;
+
+    if (!slot)
+        return;
+    Invoke_Id[t].timer_slot = 0;
+    if (slot != Timer_Count) {
+        timer_place(slot, Timer_Heap[Timer_Count]);
+        Timer_Count--;
+        timer_fix(slot);
+    } else
+        Timer_Count--;
+}
+
+/* puts one request record back to a sane state */
+static void transaction_reset(int t)
+{
+    /* back on the free list, once only */
+    if (Invoke_Id[t].in_use) {
+        transaction_unhash(t);
+        Invoke_Id[t].in_use = false;
+        Free_Id[(Free_Head + Free_Count) % MAXTRANSACTIONS] = (uint16_t) t;
+        Free_Count++;
+    }
+    timer_cancel(t);
+    Invoke_Id[t].status = INVOKE_STATUS_NOACTIVITY;     /* default unused state */
+    Invoke_Id[t].time_sent = 0; /* the epoch */
+    Invoke_Id[t].device = -1;
+    Invoke_Id[t].tries = 0;
+    frame_free(t);
+}
+
+/* the record for the request with this ID that a reply from src
+   answers, or -1 */
+static int transaction_src(struct BACnet_Device_Address *src, int id)
+{
+    struct Invoke_Peer peer;
+
+    if (!src)
+        return -1;
+    peer_from_src(&peer, src);
+
+    return transaction_find(&peer, id);
+}
+
+/* current status of this invoke ID */
+enum Invoke_Status invoke_id_status(struct BACnet_Device_Address *src,
+    int id)
+{
+    enum Invoke_Status status = INVOKE_STATUS_NOACTIVITY;
+    int t = transaction_src(src, id);
+
+    if (t >= 0)
+        status = Invoke_Id[t].status;
+
+    return status;
+}
+void invoke_id_set_status(struct BACnet_Device_Address *src, int id,
+    enum Invoke_Status status)
+{
+    int t = transaction_src(src, id);
+
+    if (t >= 0)
+        Invoke_Id[t].status = status;
+}
+
+/* time that the request was sent */
+time_t invoke_id_time_sent(struct BACnet_Device_Address *src, int id)
+{
+    time_t time_sent = 0;
+    int t = transaction_src(src, id);
+
+    if (t >= 0)
+        time_sent = Invoke_Id[t].time_sent;
+
+    return time_sent;
+}
+void invoke_id_set_time_sent(struct BACnet_Device_Address *src, int id,
+    time_t time_sent)
+{
+    int t = transaction_src(src, id);
+
+    if (t >= 0)
+        Invoke_Id[t].time_sent = time_sent;
+}
+
+/* returns the next available Invoke ID for a request to the */
+/* destination of this NPDU, or -1 if none is free - either every */
+/* ID of that peer or every request record is in use.  The ID */
+/* stays in use until invoke_id_reset() */
+int invoke_id(struct BACnet_NPDU *npdu)
+{
+    struct Invoke_Peer peer;
+    unsigned slot = 0;
+    int t, id = -1;
     int i;
-    int in_use_count = 0;
 
-    debug_printf(5, "invoke-id: Entered 'verify_invoke_ids'\n");
+    debug_printf(5, "invoke-id: Entered 'get_invoke_id'\n");
 
-    /* entire range */
+    if (!npdu || !Free_Count)
+        return -1;
+    peer_from_npdu(&peer, npdu);
     for (i = 0; i <= MAXINVOKEIDS; i++) {
-        /* this Invoke ID is in use */
-        if (Invoke_Id[i].status != INVOKE_STATUS_NOACTIVITY)
-            in_use_count++;
+        id = (Next_Id + i) % (MAXINVOKEIDS + 1);
+        slot = transaction_probe(&peer, id);
+        if (Transaction_Slot[slot] == -1)
+            break;
     }
+    if (i > MAXINVOKEIDS)
+        return -1;
+    Next_Id = (id + 1) % (MAXINVOKEIDS + 1);
+    t = Free_Id[Free_Head];
+    Free_Head = (Free_Head + 1) % MAXTRANSACTIONS;
+    Free_Count--;
+    Invoke_Id[t].in_use = true;
+    Invoke_Id[t].peer = peer;
+    Invoke_Id[t].invoke_id = (uint8_t) id;
+    Transaction_Slot[slot] = t;
+    if (invoke_id_in_use() > In_Use_High_Water)
+        In_Use_High_Water = invoke_id_in_use();
+
+    return id;
+}
+
+/* the number of requests in use, over all peers */
+/* this is used to slow down network requests to a sub-Linux pace :) */
+int invoke_id_in_use(void)
+{
+    return MAXTRANSACTIONS - Free_Count;
+}
 
-    return in_use_count;
+/* the most requests that have been in use at once */
+int invoke_id_high_water(void)
+{
+    return In_Use_High_Water;
 }
 
-/* function to reset one invoke ID to a sane state */
-void invoke_id_reset(int invokeID)
+/* function to reset the request that a reply from src with this */
+/* invoke ID answers */
+void invoke_id_reset(struct BACnet_Device_Address *src, int invokeID)
 {
+    struct BACnet_Device_Info *dev_ptr;
+    int t;
+
     debug_printf(9, "invoke-id: Entered 'reset_invoke_id'\n");
 
-    if ((invokeID >= 0) && (invokeID <= MAXINVOKEIDS)) {        /* valid ID */
-        Invoke_Id[invokeID].status = INVOKE_STATUS_NOACTIVITY;  /* default unused state */
-        Invoke_Id[invokeID].time_sent = 0;      /* the epoch */
-        memset(&Invoke_Id[invokeID].npdu, '\0',
-            sizeof(struct BACnet_NPDU));
-    }
+    t = transaction_src(src, invokeID);
+    if (t >= 0) {
+        /* the request was answered */
+        dev_ptr = device_get(Invoke_Id[t].device);
+        if (dev_ptr && (Invoke_Id[t].status != INVOKE_STATUS_NOACTIVITY)) {
+            dev_ptr->replies++;
+            if (!Invoke_Id[t].tries)
+                invoke_id_rtt_sample(dev_ptr,
+                    invoke_id_now() - Invoke_Id[t].first_sent);
+        }
+        transaction_reset(t);
+    } else
+        debug_printf(3, "invoke-id: no request with Invoke ID %d "
+            "for this peer\n", invokeID);
 }
 
 /* function to clean up all outstanding invoke IDs */
-/* this is continually called from main() */
+/* this is continually called from main() - only the requests that */
+/* are due are looked at */
 void invoke_id_cleanup(void)
 {
     int i;
-    time_t t;
-    static time_t last_cleanup = 0;
-    struct BACnet_NPDU *npdu;
-    uint8_t *apdu;
-    int apdu_len;
+    uint64_t now;
+    struct BACnet_Device_Info *dev_ptr;
 
     debug_printf(9, "invoke-id: Entered 'cleanup_invoke_ids'\n");
 
-    t = time(NULL);             /* get current time */
-    if (t != last_cleanup) {    /* ensures this doesn't run faster than once a second */
-        last_cleanup = t;       /* right now */
-        for (i = 0; i <= MAXINVOKEIDS; i++) {   /* loop thru invoke ID structure */
-            if ((Invoke_Id[i].status == INVOKE_STATUS_SENT) &&
-                ((t - Invoke_Id[i].time_sent) >= BACnet_APDU_Timeout)) {
-                /* this ID has been in "sent" for more than the APDU timeout */
-                /* should retry this send */
-
-                debug_printf(1, "invoke-id: #%d timed out. Retrying...\n",
-                    i);
-                npdu = &Invoke_Id[i].npdu;
-                apdu = &Invoke_Id[i].apdu[0];
-                apdu_len = Invoke_Id[i].apdu_len;
-
-                /* send 802.2 packet */
-                if (memcmp(npdu->dest.mac, Ethernet_Empty_MAC,
-                        sizeof(npdu->dest.mac)) != 0) {
-                    debug_printf(3,
-                        "invoke-id: sending b/eth packet to %s\n",
-                        hwaddrtoa(npdu->dest.mac));
-                    ethernet_send(npdu, apdu, apdu_len);
-                }
-                if (npdu->dest.ip.s_addr > 0) {
-                    debug_printf(3,
-                        "invoke-id: sending bip packet to %s\n",
-                        inet_ntoa(npdu->dest.ip));
-                    /* send b/ip packet */
-                    send_bip(npdu, apdu, apdu_len);
-                }
-                Invoke_Id[i].time_sent = t;
-                Invoke_Id[i].status = INVOKE_STATUS_RESENT;
-            } else if ((Invoke_Id[i].status == INVOKE_STATUS_RESENT) &&
-                ((t - Invoke_Id[i].time_sent) >= BACnet_APDU_Timeout)) {
-                error_printf
-                    ("invoke-id: Request with Invoke ID %d has failed.\n",
-                    i);
-                invoke_id_reset(i);     /* give up */
+    now = invoke_id_now();
+    while (Timer_Count && (Invoke_Id[Timer_Heap[1]].deadline <= now)) {
+        i = Timer_Heap[1];
+        dev_ptr = device_get(Invoke_Id[i].device);
+        if (((Invoke_Id[i].status == INVOKE_STATUS_SENT) ||
+                (Invoke_Id[i].status == INVOKE_STATUS_RESENT)) &&
+            (Invoke_Id[i].tries < BACnet_APDU_Retries)) {
+            /* this ID has been waiting for more than its timeout */
+            /* should retry this send */
+
+            debug_printf(1, "invoke-id: #%d to %s timed out. Retrying...\n",
+                Invoke_Id[i].invoke_id, peer_name(&Invoke_Id[i].peer));
+            /* send 802.2 packet */
+            if (memcmp(Invoke_Id[i].peer.mac, Ethernet_Empty_MAC,
+                    MAX_MAC_LEN) != 0) {
+                debug_printf(3,
+                    "invoke-id: sending b/eth packet to %s\n",
+                    hwaddrtoa(Invoke_Id[i].peer.mac));
+                ethernet_send_frame(Invoke_Id[i].peer.mac,
+                    Invoke_Id[i].frame, Invoke_Id[i].frame_len);
             }
-        }
+            if (Invoke_Id[i].peer.ip.s_addr > 0) {
+                debug_printf(3,
+                    "invoke-id: sending bip packet to %s\n",
+                    inet_ntoa(Invoke_Id[i].peer.ip));
+                /* send b/ip packet */
+                send_bip_frame(Invoke_Id[i].peer.ip, Invoke_Id[i].frame,
+                    Invoke_Id[i].frame_len);
+            }
+            Invoke_Id[i].time_sent = time(NULL);
+            Invoke_Id[i].status = INVOKE_STATUS_RESENT;
+            Invoke_Id[i].tries++;
+            if (dev_ptr)
+                dev_ptr->retries++;
+            timer_set(i, now + invoke_id_timeout_ns(i));
+        } else if ((Invoke_Id[i].status == INVOKE_STATUS_SENT) ||
+            (Invoke_Id[i].status == INVOKE_STATUS_RESENT)) {
+            error_printf
+                ("invoke-id: Request with Invoke ID %d to %s has failed.\n",
+                Invoke_Id[i].invoke_id, peer_name(&Invoke_Id[i].peer));
+            if (dev_ptr) {
+                dev_ptr->failures++;
+                /* back off until the device answers again */
+                dev_ptr->rto_ms = invoke_id_device_timeout(dev_ptr) * 2;
+                if (dev_ptr->rto_ms > INVOKE_RTO_MAX_MS)
+                    dev_ptr->rto_ms = INVOKE_RTO_MAX_MS;
+            }
+            transaction_reset(i);       /* give up */
+        } else
+            timer_cancel(i);
+    }
+}
+/* shortens a select() timeout to the next request deadline */
+void invoke_id_timeout(struct timeval *timeout)
+{
+    uint64_t now, wait_us;
+
+    if (!Timer_Count)
+        return;
+    now = invoke_id_now();
+    wait_us = (Invoke_Id[Timer_Heap[1]].deadline > now) ?
+        (Invoke_Id[Timer_Heap[1]].deadline - now + 999) / 1000 : 0;
+    if (wait_us < (uint64_t) timeout->tv_sec * 1000000 + timeout->tv_usec) {
+        timeout->tv_sec = wait_us / 1000000;
+        timeout->tv_usec = wait_us % 1000000;
     }
 }
 
-void invoke_id_send_npdu(int id, struct BACnet_NPDU *npdu, uint8_t * apdu,
-    int apdu_len)
+/* keeps the request going out with an Invoke ID from invoke_id() */
+/* returns 0, or -1 if it can't be kept - the ID is given back then, */
+/* and the request must not be sent */
+int invoke_id_send_npdu(int id, int device, struct BACnet_NPDU *npdu,
+    uint8_t * apdu, int apdu_len)
 {
+    struct Invoke_Peer peer;
+    struct BACnet_Device_Info *dev_ptr;
     time_t time_sent;
+    int size_class;
+    int t;
 
-    if (npdu && (id <= MAXINVOKEIDS)) {
-        memcpy(&Invoke_Id[id].npdu, npdu, sizeof(Invoke_Id[id].npdu));
-        memcpy(&Invoke_Id[id].apdu, apdu, sizeof(Invoke_Id[id].apdu));
-        Invoke_Id[id].apdu_len = apdu_len;
-        Invoke_Id[id].status = INVOKE_STATUS_SENT;
-        time_sent = time(NULL);
-        Invoke_Id[id].time_sent = time_sent;
+    if (!npdu)
+        return -1;
+    /* the request that invoke_id() handed this ID out for */
+    peer_from_npdu(&peer, npdu);
+    t = transaction_find(&peer, id);
+    if (t < 0)
+        return -1;
+    /* keep the frame as it goes out, so that a retry only sends it */
+    frame_free(t);
+    size_class = frame_class(NPDU_HEADER_MAX + apdu_len);
+    if (size_class >= 0)
+        Invoke_Id[t].frame = slab_alloc(&Frame_Pool[size_class]);
+    if (!Invoke_Id[t].frame) {
+        error_printf("invoke-id: unable to keep request with "
+            "Invoke ID %d - not sent\n", id);
+        transaction_reset(t);
+        return -1;
     }
+    Invoke_Id[t].frame_class = size_class;
+    Invoke_Id[t].frame_len = npdu_encode(Invoke_Id[t].frame, npdu, apdu,
+        apdu_len);
+    Invoke_Id[t].status = INVOKE_STATUS_SENT;
+    time_sent = time(NULL);
+    Invoke_Id[t].time_sent = time_sent;
+    /* the device it is timed against */
+    Invoke_Id[t].device = device;
+    dev_ptr = device_get(Invoke_Id[t].device);
+    if (dev_ptr)
+        dev_ptr->requests++;
+    Invoke_Id[t].tries = 0;
+    Invoke_Id[t].first_sent = invoke_id_now();
+    timer_set(t, Invoke_Id[t].first_sent + invoke_id_timeout_ns(t));
 
-    return;
+    return 0;
 }
 
 
 void invoke_id_init(void)
 {
     int i;                      // counter 
+    /* the frame pools, emptied if this is a restart */
+    for (i = 0; i < FRAME_CLASSES; i++) {
+        if (Frame_Pools_Ready)
+            slab_pool_release(&Frame_Pool[i]);
+        slab_pool_init(&Frame_Pool[i], &Frame_Slab_Stats[i],
+            FRAME_SMALLEST << i, FRAME_SLAB_BYTES / (FRAME_SMALLEST << i));
+    }
+    Frame_Pools_Ready = true;
     /* initialize Invoke ID structure */
-    for (i = 0; i < MAXINVOKEIDS; i++)
-        invoke_id_reset(i);     /* one invoke ID */
+    Free_Head = 0;
+    Free_Count = 0;
+    In_Use_High_Water = 0;
+    Next_Id = 0;
+    Timer_Count = 0;
+    for (i = 0; i < TRANSACTION_SLOTS; i++)
+        Transaction_Slot[i] = -1;
+    for (i = 0; i < MAXTRANSACTIONS; i++) {
+        Invoke_Id[i].in_use = false;
+        Invoke_Id[i].timer_slot = 0;
+        Invoke_Id[i].frame = NULL;
+        Free_Id[Free_Count++] = (uint16_t) i;
+        transaction_reset(i);   /* one request */
+    }
+}
+
+#ifdef TEST
+#include <assert.h>
+
+#include "ctest.h"
+
+/* is the deadline heap in order, and does every request know its slot? */
+static bool testTimerHeapValid(void)
+{
+    int slot;
+
+    for (slot = 1; slot <= Timer_Count; slot++) {
+        if (Invoke_Id[Timer_Heap[slot]].timer_slot != slot)
+            return false;
+        if ((slot > 1) && (Invoke_Id[Timer_Heap[slot / 2]].deadline >
+                Invoke_Id[Timer_Heap[slot]].deadline))
+            return false;
+    }
+
+    return true;
+}
+
+/* takes every request off the heap, due first, and checks the order */
+static int testTimerDrain(Test * pTest)
+{
+    uint64_t last = 0;
+    int count = 0;
+    int t;
+
+    while (Timer_Count) {
+        t = Timer_Heap[1];
+        ct_test(pTest, Invoke_Id[t].deadline >= last);
+        last = Invoke_Id[t].deadline;
+        timer_cancel(t);
+        ct_test(pTest, Invoke_Id[t].timer_slot == 0);
+        count++;
+    }
+
+    return count;
+}
+
+void testInvokeIdTimers(Test * pTest)
+{
+    const int count = 100;
+    uint32_t seed = 12345;
+    int errors = 0;
+    int t;
+
+    invoke_id_init();
+    ct_test(pTest, Timer_Count == 0);
+
+    /* deadlines in no order, some the same */
+    for (t = 0; t < count; t++) {
+        seed = seed * 1103515245u + 12345u;
+        timer_set(t, 1000 + (seed >> 16) % 50);
+        if (!testTimerHeapValid())
+            errors++;
+    }
+    ct_test(pTest, errors == 0);
+    ct_test(pTest, Timer_Count == count);
+    ct_test(pTest, testTimerDrain(pTest) == count);
+
+    /* cancelling from the middle of the heap */
+    for (t = 0; t < count; t++)
+        timer_set(t, 5000 - t * 7 % 101);
+    for (t = 0; t < count; t += 3) {
+        timer_cancel(t);
+        if (!testTimerHeapValid())
+            errors++;
+    }
+    ct_test(pTest, errors == 0);
+    ct_test(pTest, Timer_Count == count - (count + 2) / 3);
+    /* cancelling twice does nothing */
+    timer_cancel(0);
+    ct_test(pTest, Timer_Count == count - (count + 2) / 3);
+
+    /* re-arming moves a request, but does not add it again */
+    timer_set(1, 1);
+    ct_test(pTest, Timer_Heap[1] == 1);
+    timer_set(1, 100000);
+    ct_test(pTest, Timer_Heap[1] != 1);
+    ct_test(pTest, Invoke_Id[1].timer_slot > Timer_Count / 2);
+    for (t = 1; t < count; t += 3) {
+        timer_set(t, 4000 + t);
+        if (!testTimerHeapValid())
+            errors++;
+    }
+    ct_test(pTest, errors == 0);
+    ct_test(pTest, Timer_Count == count - (count + 2) / 3);
+    ct_test(pTest, testTimerDrain(pTest) == count - (count + 2) / 3);
+
+    invoke_id_init();
+
+    return;
+}
+
+void testInvokeIdTimeout(Test * pTest)
+{
+    struct timeval timeout;
+    uint64_t now;
+
+    invoke_id_init();
+
+    /* nothing waiting leaves the timeout alone */
+    timeout.tv_sec = 1;
+    timeout.tv_usec = 0;
+    invoke_id_timeout(&timeout);
+    ct_test(pTest, (timeout.tv_sec == 1) && (timeout.tv_usec == 0));
+
+    /* a deadline before the timeout shortens it */
+    now = invoke_id_now();
+    timer_set(0, now + 50000000ULL);
+    timeout.tv_sec = 1;
+    timeout.tv_usec = 0;
+    invoke_id_timeout(&timeout);
+    ct_test(pTest, timeout.tv_sec == 0);
+    ct_test(pTest, (timeout.tv_usec > 40000) && (timeout.tv_usec <= 50000));
+
+    /* a deadline after the timeout does not */
+    timeout.tv_sec = 0;
+    timeout.tv_usec = 10000;
+    invoke_id_timeout(&timeout);
+    ct_test(pTest, (timeout.tv_sec == 0) && (timeout.tv_usec == 10000));
+
+    /* the first deadline counts, and one that has passed is due now */
+    timer_set(1, now - 1000000ULL);
+    timeout.tv_sec = 1;
+    timeout.tv_usec = 0;
+    invoke_id_timeout(&timeout);
+    ct_test(pTest, (timeout.tv_sec == 0) && (timeout.tv_usec == 0));
+
+    invoke_id_init();
+
+    return;
+}
+
+/* a request to, and a reply from, B/IP controller n on our network -
+   no 802.2 MAC, only an IP address */
+static void testPeer(int n, struct BACnet_NPDU *npdu,
+    struct BACnet_Device_Address *src)
+{
+    memset(npdu, 0, sizeof(*npdu));
+    npdu->version = 1;
+    npdu->dest.ip.s_addr = htonl(0xC0A83400 + 10 + n);
+    memset(src, 0, sizeof(*src));
+    src->ip = npdu->dest.ip;
+    src->net = -1;
+}
+
+/* can every request in use be found under its peer and ID? */
+static bool testTransactionsFound(void)
+{
+    int t;
+
+    for (t = 0; t < MAXTRANSACTIONS; t++) {
+        if (Invoke_Id[t].in_use &&
+            (transaction_find(&Invoke_Id[t].peer,
+                    Invoke_Id[t].invoke_id) != t))
+            return false;
+    }
+
+    return true;
+}
+
+void testInvokeIdPeers(Test * pTest)
+{
+    struct BACnet_NPDU npdu[2];
+    struct BACnet_Device_Address src[2];
+    bool seen[2][MAXINVOKEIDS + 1];
+    uint8_t apdu[4] = { 0x00, 0x00, 0x00, 0x0C };       /* read property */
+    int i, p, id;
+
+    invoke_id_init();
+    testPeer(0, &npdu[0], &src[0]);
+    testPeer(1, &npdu[1], &src[1]);
+
+    /* two controllers with the same ID at once */
+    id = invoke_id(&npdu[0]);
+    ct_test(pTest, id == 0);
+    Next_Id = id;
+    ct_test(pTest, invoke_id(&npdu[1]) == id);
+    ct_test(pTest, invoke_id_in_use() == 2);
+    ct_test(pTest, invoke_id_send_npdu(id, -1, &npdu[0], apdu,
+            sizeof(apdu)) == 0);
+    ct_test(pTest, invoke_id_status(&src[0], id) == INVOKE_STATUS_SENT);
+    ct_test(pTest, invoke_id_status(&src[1], id) ==
+        INVOKE_STATUS_NOACTIVITY);
+    /* a reply from one only answers its own request */
+    invoke_id_reset(&src[1], id);
+    ct_test(pTest, invoke_id_in_use() == 1);
+    ct_test(pTest, invoke_id_status(&src[0], id) == INVOKE_STATUS_SENT);
+    invoke_id_reset(&src[1], id);
+    ct_test(pTest, invoke_id_in_use() == 1);
+    invoke_id_reset(&src[0], id);
+    ct_test(pTest, invoke_id_in_use() == 0);
+    /* a request too big for any frame pool isn't kept - the ID goes */
+    /* back and the caller must not send it */
+    id = invoke_id(&npdu[0]);
+    ct_test(pTest, id >= 0);
+    ct_test(pTest, invoke_id_in_use() == 1);
+    ct_test(pTest, invoke_id_send_npdu(id, -1, &npdu[0], apdu,
+            FRAME_SMALLEST << FRAME_CLASSES) == -1);
+    ct_test(pTest, invoke_id_in_use() == 0);
+    ct_test(pTest, invoke_id_status(&src[0], id) ==
+        INVOKE_STATUS_NOACTIVITY);
+
+    /* each controller has every ID */
+    memset(seen, 0, sizeof(seen));
+    for (p = 0; p < 2; p++) {
+        for (i = 0; i <= MAXINVOKEIDS; i++) {
+            id = invoke_id(&npdu[p]);
+            if ((id >= 0) && !seen[p][id])
+                seen[p][id] = true;
+            else
+                break;
+        }
+        ct_test(pTest, i == MAXINVOKEIDS + 1);
+    }
+    /* the first is out of IDs, and a third controller is not */
+    ct_test(pTest, invoke_id(&npdu[0]) == -1);
+    ct_test(pTest, invoke_id(&npdu[1]) == -1);
+    testPeer(2, &npdu[1], &src[1]);
+    ct_test(pTest, invoke_id(&npdu[1]) >= 0);
+    /* a freed ID is handed out again to its own controller only */
+    invoke_id_reset(&src[0], 77);
+    testPeer(1, &npdu[1], &src[1]);
+    ct_test(pTest, invoke_id(&npdu[1]) == -1);
+    ct_test(pTest, invoke_id(&npdu[0]) == 77);
+    ct_test(pTest, testTransactionsFound());
+
+    invoke_id_init();
+
+    return;
+}
+
+void testInvokeIdExhausted(Test * pTest)
+{
+    struct BACnet_NPDU npdu;
+    struct BACnet_Device_Address src;
+    int count = 0;
+    int n;
+
+    invoke_id_init();
+    /* more controllers than the records can serve */
+    for (n = 0; n < MAXTRANSACTIONS / (MAXINVOKEIDS + 1) + 1; n++) {
+        testPeer(n, &npdu, &src);
+        while (invoke_id(&npdu) >= 0)
+            count++;
+    }
+    ct_test(pTest, count == MAXTRANSACTIONS);
+    ct_test(pTest, invoke_id_in_use() == MAXTRANSACTIONS);
+    ct_test(pTest, invoke_id_high_water() == MAXTRANSACTIONS);
+    ct_test(pTest, testTransactionsFound());
+    /* a controller that has used none of its IDs gets none either */
+    testPeer(n, &npdu, &src);
+    ct_test(pTest, invoke_id(&npdu) == -1);
+    /* until a request is answered */
+    testPeer(0, &npdu, &src);
+    invoke_id_reset(&src, 5);
+    testPeer(n, &npdu, &src);
+    ct_test(pTest, invoke_id(&npdu) >= 0);
+    ct_test(pTest, invoke_id_in_use() == MAXTRANSACTIONS);
+
+    invoke_id_init();
+
+    return;
+}
+
+void testInvokeIdUnhash(Test * pTest)
+{
+    struct BACnet_NPDU npdu;
+    struct BACnet_Device_Address src;
+    uint32_t seed = 4321;
+    int errors = 0;
+    int count = 0;
+    int n, t;
+    unsigned slot;
+
+    invoke_id_init();
+    /* fill the hash to its limit, so the runs are long */
+    for (n = 0; n < 4; n++) {
+        testPeer(n, &npdu, &src);
+        while (invoke_id(&npdu) >= 0)
+            count++;
+    }
+    ct_test(pTest, count == MAXTRANSACTIONS);
+
+    /* delete from the middle of a run of at least three */
+    for (slot = 1; slot < TRANSACTION_SLOTS - 1; slot++) {
+        if ((Transaction_Slot[slot - 1] != -1) &&
+            (Transaction_Slot[slot] != -1) &&
+            (Transaction_Slot[slot + 1] != -1))
+            break;
+    }
+    ct_test(pTest, slot < TRANSACTION_SLOTS - 1);
+    t = Transaction_Slot[slot];
+    transaction_reset(t);
+    count--;
+    ct_test(pTest, transaction_find(&Invoke_Id[t].peer,
+            Invoke_Id[t].invoke_id) == -1);
+    ct_test(pTest, testTransactionsFound());
+
+    /* and from anywhere, until it is empty */
+    while (count) {
+        seed = seed * 1103515245u + 12345u;
+        t = (seed >> 8) % MAXTRANSACTIONS;
+        if (!Invoke_Id[t].in_use)
+            continue;
+        transaction_reset(t);
+        count--;
+        if ((transaction_find(&Invoke_Id[t].peer,
+                    Invoke_Id[t].invoke_id) != -1) ||
+            !testTransactionsFound())
+            errors++;
+    }
+    ct_test(pTest, errors == 0);
+    ct_test(pTest, invoke_id_in_use() == 0);
+    for (slot = 0; slot < TRANSACTION_SLOTS; slot++) {
+        if (Transaction_Slot[slot] != -1)
+            errors++;
+    }
+    ct_test(pTest, errors == 0);
+
+    invoke_id_init();
+
+    return;
+}
+
+void testInvokeIdRtt(Test * pTest)
+{
+    struct BACnet_Device_Info dev;
+
+    /* the first sample sets the mean, and half of it the variance */
+    memset(&dev, 0, sizeof(dev));
+    invoke_id_rtt_sample(&dev, 100000000ULL);   /* 100ms */
+    ct_test(pTest, dev.srtt_us == 100000);
+    ct_test(pTest, dev.rttvar_us == 50000);
+    ct_test(pTest, dev.rto_ms == 300);
+    /* then the mean moves 1/8 and the variance 1/4 of the way */
+    invoke_id_rtt_sample(&dev, 100000000ULL);
+    ct_test(pTest, dev.srtt_us == 100000);
+    ct_test(pTest, dev.rttvar_us == 37500);
+    ct_test(pTest, dev.rto_ms == 250);
+    invoke_id_rtt_sample(&dev, 200000000ULL);
+    ct_test(pTest, dev.srtt_us == 112500);
+    ct_test(pTest, dev.rttvar_us == 53125);
+    ct_test(pTest, dev.rto_ms == 325);
+
+    /* a fast device does not get less than the least timeout */
+    memset(&dev, 0, sizeof(dev));
+    invoke_id_rtt_sample(&dev, 20000000ULL);
+    ct_test(pTest, dev.srtt_us == 20000);
+    ct_test(pTest, dev.rttvar_us == 10000);
+    ct_test(pTest, dev.rto_ms == INVOKE_RTO_MIN_MS);
+    /* nor does an instant reply leave the mean at zero */
+    memset(&dev, 0, sizeof(dev));
+    invoke_id_rtt_sample(&dev, 0);
+    ct_test(pTest, dev.srtt_us == 1);
+    ct_test(pTest, dev.rto_ms == INVOKE_RTO_MIN_MS);
+
+    /* a slow device does not get more than the most */
+    memset(&dev, 0, sizeof(dev));
+    invoke_id_rtt_sample(&dev, 30000000000ULL);
+    ct_test(pTest, dev.srtt_us == 30000000);
+    ct_test(pTest, dev.rttvar_us == 15000000);
+    ct_test(pTest, dev.rto_ms == INVOKE_RTO_MAX_MS);
+    memset(&dev, 0, sizeof(dev));
+    invoke_id_rtt_sample(&dev, 100000000000ULL);
+    ct_test(pTest, dev.srtt_us == 1000u * INVOKE_RTO_MAX_MS);
+    ct_test(pTest, dev.rto_ms == INVOKE_RTO_MAX_MS);
+
+    return;
+}
+
+/* sends a request to device instance 1000 + n at B/IP controller n, and
+   returns the record that keeps it */
+static int testRequest(int n, struct BACnet_Device_Address *src)
+{
+    struct BACnet_NPDU npdu;
+    uint8_t apdu[4] = { 0x00, 0x00, 0x00, 0x0C };       /* read property */
+    int id;
+
+    testPeer(n, &npdu, src);
+    id = invoke_id(&npdu);
+    if (id < 0)
+        return -1;
+    invoke_id_send_npdu(id, 1000 + n, &npdu, apdu, sizeof(apdu));
+
+    return transaction_src(src, id);
+}
+
+/* makes a request due now, and lets the cleanup deal with it */
+static void testExpire(int t)
+{
+    timer_set(t, 0);
+    invoke_id_cleanup();
+}
+
+void testInvokeIdBackoff(Test * pTest)
+{
+    struct BACnet_Device_Info *dev_ptr;
+    struct BACnet_Device_Address src;
+    uint32_t srtt_us, rttvar_us;
+    int i, t;
+
+    device_init();
+    invoke_id_init();
+    dev_ptr = device_add(1000);
+    ct_test(pTest, dev_ptr != NULL);
+    if (!dev_ptr)
+        return;
+
+    /* the timeout doubles with each try, up to the most */
+    t = testRequest(0, &src);
+    ct_test(pTest, t >= 0);
+    ct_test(pTest, Invoke_Id[t].device == 1000);
+    dev_ptr->rto_ms = 1000;
+    for (i = 0; i < 6; i++) {
+        Invoke_Id[t].tries = i;
+        ct_test(pTest, invoke_id_timeout_ns(t) ==
+            (1000ULL << i) * 1000000ULL);
+    }
+    Invoke_Id[t].tries = 6;
+    ct_test(pTest,
+        invoke_id_timeout_ns(t) == INVOKE_RTO_MAX_MS * 1000000ULL);
+    /* until a reply is timed, the APDU timeout is used */
+    dev_ptr->rto_ms = 0;
+    Invoke_Id[t].tries = 1;
+    ct_test(pTest, invoke_id_timeout_ns(t) ==
+        2ULL * BACnet_APDU_Timeout * 1000000ULL);
+    /* and one that is already longer than the most is not doubled */
+    BACnet_APDU_Timeout = 90000;
+    ct_test(pTest, invoke_id_timeout_ns(t) == 90000 * 1000000ULL);
+    BACnet_APDU_Timeout = 10000;
+    /* a request to an unknown device uses the APDU timeout too */
+    Invoke_Id[t].device = -1;
+    Invoke_Id[t].tries = 0;
+    ct_test(pTest, invoke_id_timeout_ns(t) ==
+        (uint64_t) BACnet_APDU_Timeout * 1000000ULL);
+    transaction_reset(t);
+    /* a request fails after all of its tries have timed out */
+    dev_ptr->rto_ms = 1000;
+    ct_test(pTest, invoke_id_device_lifetime(dev_ptr) ==
+        1000 + 2000 + 4000 + 8000);
+    BACnet_APDU_Retries = 7;
+    ct_test(pTest, invoke_id_device_lifetime(dev_ptr) ==
+        1000 + 2000 + 4000 + 8000 + 16000 + 32000 + 60000 + 60000);
+    BACnet_APDU_Retries = 3;
+    dev_ptr->rto_ms = 0;
+    ct_test(pTest, invoke_id_device_lifetime(NULL) ==
+        10000 + 20000 + 40000 + INVOKE_RTO_MAX_MS);
+
+    /* a reply to the first try is timed */
+    t = testRequest(0, &src);
+    ct_test(pTest, dev_ptr->requests == 2);
+    invoke_id_reset(&src, Invoke_Id[t].invoke_id);
+    ct_test(pTest, dev_ptr->replies == 1);
+    ct_test(pTest, dev_ptr->srtt_us > 0);
+    ct_test(pTest, dev_ptr->rto_ms == INVOKE_RTO_MIN_MS);
+    /* but not a reply after a retry, which could be to either try */
+    srtt_us = dev_ptr->srtt_us;
+    rttvar_us = dev_ptr->rttvar_us;
+    t = testRequest(0, &src);
+    testExpire(t);
+    ct_test(pTest, Invoke_Id[t].tries == 1);
+    ct_test(pTest, Invoke_Id[t].status == INVOKE_STATUS_RESENT);
+    ct_test(pTest, dev_ptr->retries == 1);
+    invoke_id_reset(&src, Invoke_Id[t].invoke_id);
+    ct_test(pTest, dev_ptr->replies == 2);
+    ct_test(pTest, dev_ptr->srtt_us == srtt_us);
+    ct_test(pTest, dev_ptr->rttvar_us == rttvar_us);
+    ct_test(pTest, invoke_id_in_use() == 0);
+
+    /* a request is tried again until it runs out of retries */
+    dev_ptr->rto_ms = 1000;
+    t = testRequest(0, &src);
+    for (i = 1; i <= BACnet_APDU_Retries; i++) {
+        testExpire(t);
+        ct_test(pTest, Invoke_Id[t].in_use);
+        ct_test(pTest, Invoke_Id[t].tries == i);
+        /* each try waits for its own timeout again */
+        ct_test(pTest, Invoke_Id[t].deadline > invoke_id_now());
+    }
+    ct_test(pTest, dev_ptr->retries == 1 + BACnet_APDU_Retries);
+    /* then it fails, and the device timeout doubles */
+    testExpire(t);
+    ct_test(pTest, !Invoke_Id[t].in_use);
+    ct_test(pTest, dev_ptr->failures == 1);
+    ct_test(pTest, dev_ptr->rto_ms == 2000);
+    ct_test(pTest, invoke_id_in_use() == 0);
+    /* up to the most */
+    dev_ptr->rto_ms = 40000;
+    t = testRequest(0, &src);
+    for (i = 0; i <= BACnet_APDU_Retries; i++)
+        testExpire(t);
+    ct_test(pTest, dev_ptr->failures == 2);
+    ct_test(pTest, dev_ptr->rto_ms == INVOKE_RTO_MAX_MS);
+    /* an untimed device backs off from the APDU timeout */
+    dev_ptr->rto_ms = 0;
+    t = testRequest(0, &src);
+    for (i = 0; i <= BACnet_APDU_Retries; i++)
+        testExpire(t);
+    ct_test(pTest, dev_ptr->failures == 3);
+    ct_test(pTest, dev_ptr->rto_ms == 2 * BACnet_APDU_Timeout);
+    ct_test(pTest, invoke_id_in_use() == 0);
+
+    invoke_id_init();
+    device_cleanup();
+
+    return;
+}
+
+#ifdef TEST_INVOKE_ID
+/* the settings and data links that are not linked into the test */
+int BACnet_APDU_Timeout = 10000;
+int BACnet_APDU_Retries = 3;
+uint8_t Ethernet_Empty_MAC[MAX_MAC_LEN] = { 0 };
+uint8_t Ethernet_MAC_Address[MAX_MAC_LEN] = { 0 };
+struct in_addr BACnet_Device_IP_Address = { 0 };
+
+int ethernet_send_frame(const uint8_t * dest, uint8_t * pdu, int pdu_len)
+{
+    (void) dest;
+    (void) pdu;
+    (void) pdu_len;
+
+    return 1;
+}
+
+int send_bip_frame(struct in_addr dest, uint8_t * pdu, int pdu_len)
+{
+    (void) dest;
+    (void) pdu;
+    (void) pdu_len;
+
+    return 1;
+}
+
+char *hwaddrtoa(unsigned char *hwaddr)
+{
+    (void) hwaddr;
+
+    return "";
+}
+
+int main(void)
+{
+    Test *pTest;
+    bool rc;
+
+    pTest = ct_create("invoke id", NULL);
+
+    /* individual tests */
+    rc = ct_addTestFunction(pTest, testInvokeIdTimers);
+    assert(rc);
+    rc = ct_addTestFunction(pTest, testInvokeIdTimeout);
+    assert(rc);
+    rc = ct_addTestFunction(pTest, testInvokeIdPeers);
+    assert(rc);
+    rc = ct_addTestFunction(pTest, testInvokeIdExhausted);
+    assert(rc);
+    rc = ct_addTestFunction(pTest, testInvokeIdUnhash);
+    assert(rc);
+    rc = ct_addTestFunction(pTest, testInvokeIdRtt);
+    assert(rc);
+    rc = ct_addTestFunction(pTest, testInvokeIdBackoff);
+    assert(rc);
+
+    ct_setStream(pTest, stdout);
+    ct_run(pTest);
+    (void) ct_report(pTest);
+
+    ct_destroy(pTest);
+
+    return 0;
 }
+#endif                          /* TEST_INVOKE_ID */
+#endif                          /* TEST */
 
 /* end of invoke_id.c */
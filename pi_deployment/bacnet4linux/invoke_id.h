@@ -39,28 +39,59 @@ enum Invoke_Status {
     INVOKE_STATUS_NOANSWER = 4
 };
 
+/* the peer a request went to - a device on our own network is known */
+/* by its 802.2 MAC or its B/IP address, a routed one by the router's */
+/* and its network and address too */
+struct Invoke_Peer {
+    uint8_t mac[MAX_MAC_LEN];   /* 802.2 MAC, empty for B/IP */
+    uint8_t adr[MAX_MAC_LEN];
+    int net;                    /* -1 for a device on our own network */
+    struct in_addr ip;          /* B/IP address, 0 for 802.2 */
+};
+
+/* one outstanding request, found by its peer and invoke ID */
 struct Invoke_Status_Struct {
     enum Invoke_Status status;  /* current status of this invoke ID */
+    bool in_use;                /* handed out by invoke_id() and not reset */
+    uint8_t invoke_id;          /* the ID in that peer's space */
+    uint8_t frame_class;        /* the pool that frame came from */
+    uint8_t tries;              /* times the request has been sent again */
+    uint16_t frame_len;         /* bytes in frame */
+    struct Invoke_Peer peer;    /* where the request went */
+    int device;                 /* the device it went to, -1 if not known */
     time_t time_sent;           /* time that the request was sent */
-    struct BACnet_NPDU npdu;    /* NPDU that was sent */
-    uint8_t apdu[MAX_APDU];
-    int apdu_len;
+    uint64_t first_sent;        /* monotonic ns of the first send */
+    uint64_t deadline;          /* monotonic ns when this try times out */
+    int timer_slot;             /* place in the deadline heap, 0 if none */
+    uint8_t *frame;             /* the encoded NPDU, sent again on a retry */
 };
 
-/* invoke ID functions */
+/* invoke ID functions - a request is known by the peer it went to */
+/* and its invoke ID, and every peer has its own 0-255 space */
 void invoke_id_init(void);
-int invoke_id(void);
+int invoke_id(struct BACnet_NPDU *npdu);
 int invoke_id_in_use(void);
-void invoke_id_reset(int invokeID);
+int invoke_id_high_water(void);
+void invoke_id_reset(struct BACnet_Device_Address *src, int invokeID);
 void invoke_id_cleanup(void);
+/* shortens a select() timeout to the next request deadline */
+void invoke_id_timeout(struct timeval *timeout);
+/* the timeout in ms that a request to this device starts with */
+int invoke_id_device_timeout(struct BACnet_Device_Info *dev_ptr);
+/* how long in ms a request to this device waits before it fails */
+int invoke_id_device_lifetime(struct BACnet_Device_Info *dev_ptr);
 
-enum Invoke_Status invoke_id_status(int id);
-time_t invoke_id_time_sent(int id);
-struct BACnet_NPDU *invoke_id_npdu();
+enum Invoke_Status invoke_id_status(struct BACnet_Device_Address *src,
+    int id);
+time_t invoke_id_time_sent(struct BACnet_Device_Address *src, int id);
 
-void invoke_id_set_status(int id, enum Invoke_Status status);
-void invoke_id_set_time_sent(int id, time_t time_sent);
-void invoke_id_send_npdu(int id, struct BACnet_NPDU *npdu, uint8_t * apdu,
-    int apdu_len);
+void invoke_id_set_status(struct BACnet_Device_Address *src, int id,
+    enum Invoke_Status status);
+void invoke_id_set_time_sent(struct BACnet_Device_Address *src, int id,
+    time_t time_sent);
+/* keeps a request that went to device instance device, -1 if not known */
+/* returns -1 if it can't be kept, and the request must not be sent */
+int invoke_id_send_npdu(int id, int device, struct BACnet_NPDU *npdu,
+    uint8_t * apdu, int apdu_len);
 
 #endif
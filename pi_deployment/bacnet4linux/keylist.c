@@ -38,10 +38,22 @@
 // It stores a pointer to data, which you must
 // malloc and free on your own, or just use
 // static data
+// The keys and the data pointers are held in two parallel arrays,
+// so a search reads only the dense array of keys.
 
 #include <stdlib.h>
+#include <string.h>
 
 #include "keylist.h"            // check for valid prototypes
+#include "slab.h"
+
+// smallest arrays we keep
+#define KEYLIST_MIN_SIZE 8
+// list heads carved out of each slab
+#define KEYLIST_SLAB_RECORDS 64
+// entries copied by a rebuild of the read index for the price of one
+// plain search
+#define KEYLIST_INDEX_COST 16
 
 #ifndef FALSE
 #define FALSE 0
@@ -55,56 +67,72 @@
 // Generic node routines
 /////////////////////////////////////////////////////////////////////
 
-// grab memory for a node
-static struct Keylist_Node *NodeCreate(void)
-{
-    return calloc(1, sizeof(struct Keylist_Node));
-}
+// list heads come from a pool, since every device has a list
+static struct slab_pool Keylist_Pool;
+static struct slab_stats Keylist_Slab_Stats = { "Keylists" };
 
 // grab memory for a list
 static struct Keylist *KeylistCreate(void)
 {
-    return calloc(1, sizeof(struct Keylist));
+    if (!Keylist_Pool.object_size)
+        slab_pool_init(&Keylist_Pool, &Keylist_Slab_Stats,
+            sizeof(struct Keylist), KEYLIST_SLAB_RECORDS);
+
+    return slab_alloc(&Keylist_Pool);
 }
 
-// check to see if the array is big enough for an addition
-// or is too big when we are deleting and we can shrink
+// move the keys and data into arrays that hold new_size entries
+// returns TRUE if success, FALSE if failed
+static int ArrayResize(OS_Keylist list, int new_size)
+{
+    KEY *new_keys;              // new array of keys
+    void **new_data;            // new array of data
+
+    // size is never more than either array holds.  If the data array
+    // fails to follow the keys, a grown keys array is just left bigger
+    // than size, and a shrunk one is still covered by the old data array.
+    new_keys = realloc(list->keys, (size_t) new_size * sizeof(KEY));
+    if (!new_keys)
+        return FALSE;
+    list->keys = new_keys;
+    new_data = realloc(list->data, (size_t) new_size * sizeof(void *));
+    if (!new_data) {
+        if (new_size < list->size)
+            list->size = new_size;
+        return FALSE;
+    }
+    list->data = new_data;
+    list->size = new_size;
+
+    return TRUE;
+}
+
+// check to see if the arrays are big enough for an addition
+// or are too big when we are deleting and we can shrink
+// The arrays double when they are full and halve once they are down to a
+// quarter full, so a long run of adds costs O(1) each and adds and
+// deletes around one size don't keep reallocating.
 // returns TRUE if success, FALSE if failed
 static int CheckArraySize(OS_Keylist list)
 {
     int new_size = 0;           // set it up so that no size change is the default
-    const int chunk = 8;        // minimum number of nodes to allocate memory for
-    struct Keylist_Node **new_array;    // new array of nodes, if needed
-    int i;                      // counter
     if (!list)
         return FALSE;
 
     // indicates the need for more memory allocation
     if (list->count == list->size)
-        new_size = list->size + chunk;
+        new_size = list->size ? list->size * 2 : KEYLIST_MIN_SIZE;
 
     // allow for shrinking memory
-    else if ((list->size > chunk) && (list->count < (list->size - chunk)))
-        new_size = list->size - chunk;
-    if (new_size) {
+    else if ((list->size > KEYLIST_MIN_SIZE) &&
+        (list->count <= list->size / 4))
+        new_size = list->size / 2;
 
-        // Allocate more room for node pointer array
-        new_array = calloc((size_t) new_size, sizeof(new_array));
-
-        // See if we got the memory we wanted
-        if (!new_array)
-            return FALSE;
+    // See if we got the memory we wanted - not getting
+    // a smaller array is no problem
+    if (new_size && !ArrayResize(list, new_size))
+        return (new_size < list->size) ? TRUE : FALSE;
 
-        // copy the nodes from the old array to the new array
-        if (list->array) {
-            for (i = 0; i < list->count; i++) {
-                new_array[i] = list->array[i];
-            }
-            free(list->array);
-        }
-        list->array = new_array;
-        list->size = new_size;
-    }
     return TRUE;
 }
 
@@ -117,26 +145,24 @@ static int CheckArraySize(OS_Keylist list)
 // allowing the ability to find where an key should go into the list.
 static int FindIndex(OS_Keylist list, KEY key, int *pIndex)
 {
-    struct Keylist_Node *node;  // holds the new node
+    const KEY *keys;            // the sorted keys
     int left = 0;               // the left branch of tree, beginning of list
     int right = 0;              // the right branch on the tree, end of list
     int index = 0;              // our current search place in the array
     KEY current_key = 0;        // place holder for current node key
     int status = FALSE;         // return value
-    if (!list || !list->array || !list->count) {
+    if (!list || !list->keys || !list->count) {
         *pIndex = 0;
         return (FALSE);
     }
+    keys = list->keys;
     right = list->count - 1;
     // assume that the list is sorted
     do {
 
         // A binary search
         index = (left + right) / 2;
-        node = list->array[index];
-        if (!node)
-            break;
-        current_key = node->key;
+        current_key = keys[index];
         if (key < current_key)
             right = index - 1;
 
@@ -162,15 +188,90 @@ static int FindIndex(OS_Keylist list, KEY key, int *pIndex)
 }
 
 
+// copy the sorted list into the index in Eytzinger order - the
+// children of index entry k are 2k and 2k+1, so an in-order walk
+// of that tree visits the sorted keys in turn
+// returns the next sorted position to place
+static int IndexFill(OS_Keylist list, int position, int k)
+{
+    if (k <= list->count) {
+        position = IndexFill(list, position, 2 * k);
+        list->index_keys[k] = list->keys[position];
+        list->index_data[k] = list->data[position];
+        position++;
+        position = IndexFill(list, position, 2 * k + 1);
+    }
+
+    return position;
+}
+
+// bring the index up to date with the list
+// A rebuild costs a pass over the list, so after a change the lookups
+// use the plain search until enough of them have been made to pay for
+// it - adds that each follow a lookup, as discovery does, never
+// trigger a rebuild.
+// returns TRUE if the index can be used
+static int IndexBuild(OS_Keylist list)
+{
+    int new_size;               // entries needed, plus the unused 0
+    KEY *new_keys;
+    void **new_data;
+
+    if (list->index_valid)
+        return TRUE;
+    list->index_stale_reads++;
+    if (list->index_stale_reads < list->count / KEYLIST_INDEX_COST)
+        return FALSE;
+    new_size = list->count + 1;
+    if (new_size > list->index_size) {
+        // follow the list arrays so the index grows as seldom as they do
+        new_size = list->size + 1;
+        new_keys = realloc(list->index_keys, (size_t) new_size * sizeof(KEY));
+        if (!new_keys)
+            return FALSE;
+        list->index_keys = new_keys;
+        new_data = realloc(list->index_data,
+            (size_t) new_size * sizeof(void *));
+        if (!new_data)
+            return FALSE;
+        list->index_data = new_data;
+        list->index_size = new_size;
+    }
+    (void) IndexFill(list, 0, 1);
+    list->index_valid = TRUE;
+    list->index_stale_reads = 0;
+
+    return TRUE;
+}
+
+// find the data for a key using the index
+// The descent has no data dependent branch, and the block of
+// descendants a few levels down is fetched ahead of time.
+static void *IndexFind(OS_Keylist list, KEY key)
+{
+    const KEY *keys = list->index_keys;
+    int count = list->count;
+    unsigned k = 1;             // current index entry
+
+    while (k <= (unsigned) count) {
+        __builtin_prefetch(&keys[k * 16]);
+        k = 2 * k + (keys[k] < key);
+    }
+    // undo the right turns after the last left one - that is the
+    // first entry not less than the key
+    k >>= __builtin_ffs((int) ~k);
+
+    return (k && (keys[k] == key)) ? list->index_data[k] : NULL;
+}
+
+
 /////////////////////////////////////////////////////////////////////
 // list data functions
 /////////////////////////////////////////////////////////////////////
 // inserts a node into its sorted position
 int Keylist_Data_Add(OS_Keylist list, KEY key, void *data)
 {
-    struct Keylist_Node *node;  // holds the new node
     int index = -1;             // return value
-    int i;                      // counts through the array
 
     if (list && CheckArraySize(list)) {
         // figure out where to put the new node
@@ -185,39 +286,112 @@ int Keylist_Data_Add(OS_Keylist list, KEY key, void *data)
                 index = list->count;
 
             // Move all the items up to make room for the new one
-            for (i = list->count; i > index; i--) {
-                list->array[i] = list->array[i - 1];
-            }
+            memmove(&list->keys[index + 1], &list->keys[index],
+                (size_t) (list->count - index) * sizeof(list->keys[0]));
+            memmove(&list->data[index + 1], &list->data[index],
+                (size_t) (list->count - index) * sizeof(list->data[0]));
         }
 
         else {
             index = 0;
         }
 
-        // create and add the node
-        node = NodeCreate();
-        if (node) {
-            list->count++;
-            node->key = key;
-            node->data = data;
-            list->array[index] = node;
-        }
+        // add the node
+        list->keys[index] = key;
+        list->data[index] = data;
+        list->count++;
+        list->index_valid = FALSE;
+        list->index_stale_reads = 0;
     }
     return index;
 }
 
+// one entry of a batch being added
+struct Keylist_Pair {
+    KEY key;
+    void *data;
+    int order;                  // position in the batch
+};
+
+// sort a batch by key - equal keys go latest first, which is where
+// adding them one at a time would leave them
+static int PairCompare(const void *a, const void *b)
+{
+    const struct Keylist_Pair *pair_a = a;
+    const struct Keylist_Pair *pair_b = b;
+
+    if (pair_a->key != pair_b->key)
+        return (pair_a->key < pair_b->key) ? -1 : 1;
+
+    return pair_b->order - pair_a->order;
+}
+
+// inserts many nodes at once - the batch is sorted and merged into
+// the list in one pass, rather than shifting the tail for each node
+// returns the number of nodes added, or -1 if the list is unchanged
+int Keylist_Data_Add_Batch(OS_Keylist list, const KEY * keys,
+    void **data, int count)
+{
+    struct Keylist_Pair *pairs; // the batch, sorted
+    int new_size;               // array size that holds the batch
+    int i, j, k;                // list, batch and merged positions
+
+    if (!list || !keys || !data || (count < 0))
+        return -1;
+    if (!count)
+        return 0;
+    pairs = malloc((size_t) count * sizeof(*pairs));
+    if (!pairs)
+        return -1;
+    for (j = 0; j < count; j++) {
+        pairs[j].key = keys[j];
+        pairs[j].data = data[j];
+        pairs[j].order = j;
+    }
+    qsort(pairs, (size_t) count, sizeof(*pairs), PairCompare);
+
+    // grow by doubling, as single adds would have
+    new_size = list->size ? list->size : KEYLIST_MIN_SIZE;
+    while (new_size < list->count + count)
+        new_size *= 2;
+    if ((new_size != list->size) && !ArrayResize(list, new_size)) {
+        free(pairs);
+        return -1;
+    }
+
+    // merge from the top down so nothing is moved twice - batch
+    // nodes go ahead of nodes already in the list with the same key,
+    // as single adds do
+    i = list->count - 1;
+    j = count - 1;
+    for (k = list->count + count - 1; j >= 0; k--) {
+        if ((i >= 0) && (list->keys[i] >= pairs[j].key)) {
+            list->keys[k] = list->keys[i];
+            list->data[k] = list->data[i];
+            i--;
+        } else {
+            list->keys[k] = pairs[j].key;
+            list->data[k] = pairs[j].data;
+            j--;
+        }
+    }
+    list->count += count;
+    list->index_valid = FALSE;
+    list->index_stale_reads = 0;
+    free(pairs);
+
+    return count;
+}
+
 // deletes a node specified by its index
 // returns the data from the node
 void *Keylist_Data_Delete_By_Index(OS_Keylist list, int index)
 {
-    struct Keylist_Node *node;
     void *data = NULL;
 
-    if (list && list->array && list->count &&
+    if (list && list->keys && list->count &&
         (index >= 0) && (index < list->count)) {
-        node = list->array[index];
-        if (node)
-            data = node->data;
+        data = list->data[index];
 
         // move the nodes to account for the deleted one
         if (list->count == 1) {
@@ -231,15 +405,16 @@ void *Keylist_Data_Delete_By_Index(OS_Keylist list, int index)
         }
         // Move all the nodes down one
         else {
-            int i;              // counter
-            int count = list->count - 1;
-            for (i = index; i < count; i++) {
-                list->array[i] = list->array[i + 1];
-            }
+            memmove(&list->keys[index], &list->keys[index + 1],
+                (size_t) (list->count - index - 1) *
+                sizeof(list->keys[0]));
+            memmove(&list->data[index], &list->data[index + 1],
+                (size_t) (list->count - index - 1) *
+                sizeof(list->data[0]));
         }
         list->count--;
-        if (node)
-            free(node);
+        list->index_valid = FALSE;
+        list->index_stale_reads = 0;
 
         // potentially reduce the size of the array
         (void) CheckArraySize(list);
@@ -280,41 +455,39 @@ void *Keylist_Data_Pop(OS_Keylist list)
 // returns the data from the node specified by key
 void *Keylist_Data(OS_Keylist list, KEY key)
 {
-    struct Keylist_Node *node = NULL;
+    void *data = NULL;          // return value
     int index = 0;              // used to look up the index of node
 
-    if (list && list->array && list->count) {
-        if (FindIndex(list, key, &index))
-            node = list->array[index];
+    if (list && list->keys && list->count) {
+        if (list->index_enabled && IndexBuild(list))
+            data = IndexFind(list, key);
+        else if (FindIndex(list, key, &index))
+            data = list->data[index];
     }
 
-    return node ? node->data : NULL;
+    return data;
 }
 
 // returns the data specified by key
 void *Keylist_Data_Index(OS_Keylist list, int index)
 {
-    struct Keylist_Node *node = NULL;
+    void *data = NULL;          // return value
 
-    if (list && list->array && list->count &&
+    if (list && list->data && list->count &&
         (index >= 0) && (index < list->count))
-        node = list->array[index];
+        data = list->data[index];
 
-    return node ? node->data : NULL;
+    return data;
 }
 
 // return the key at the given index
 KEY Keylist_Key(OS_Keylist list, int index)
 {
     KEY key = 0;                // return value
-    struct Keylist_Node *node;
 
-    if (list && list->array && list->count &&
-        (index >= 0) && (index < list->count)) {
-        node = list->array[index];
-        if (node)
-            key = node->key;
-    }
+    if (list && list->keys && list->count &&
+        (index >= 0) && (index < list->count))
+        key = list->keys[index];
 
     return key;
 }
@@ -341,6 +514,68 @@ int Keylist_Count(OS_Keylist list)
     return list->count;
 }
 
+// puts the cursor back at the start of the list
+void Keylist_Cursor_Reset(struct Keylist_Cursor *cursor)
+{
+    cursor->key = 0;
+    cursor->done = FALSE;
+}
+
+// returns the data from the first node whose key is not below the
+// cursor, and settles the cursor on that key
+void *Keylist_Cursor_Data(OS_Keylist list, struct Keylist_Cursor *cursor)
+{
+    int index = 0;              // first node at or after the cursor
+
+    if (!list || !list->count || cursor->done)
+        return NULL;
+    if (FindIndex(list, cursor->key, &index)) {
+        // the first of any duplicates
+        while (index && (list->keys[index - 1] == cursor->key))
+            index--;
+    }
+    if (index >= list->count)
+        return NULL;
+    cursor->key = list->keys[index];
+
+    return list->data[index];
+}
+
+// moves the cursor past the node it is on
+void *Keylist_Cursor_Next(OS_Keylist list, struct Keylist_Cursor *cursor)
+{
+    if (!Keylist_Cursor_Data(list, cursor))
+        return NULL;
+    if (cursor->key == (KEY) ~0u) {
+        cursor->done = TRUE;
+        return NULL;
+    }
+    cursor->key++;
+
+    return Keylist_Cursor_Data(list, cursor);
+}
+
+// turns the read index on or off for lists that are mostly read
+void Keylist_Index_Enable(OS_Keylist list, int enable)
+{
+    if (list) {
+        list->index_enabled = enable ? TRUE : FALSE;
+        list->index_valid = FALSE;
+        list->index_stale_reads = 0;
+        if (!enable) {
+            if (list->index_keys)
+                free(list->index_keys);
+            if (list->index_data)
+                free(list->index_data);
+            list->index_keys = NULL;
+            list->index_data = NULL;
+            list->index_size = 0;
+        }
+    }
+
+    return;
+}
+
 /////////////////////////////////////////////////////////////////////
 // Public List functions
 /////////////////////////////////////////////////////////////////////
@@ -361,13 +596,14 @@ OS_Keylist Keylist_Create(void)
 void Keylist_Delete(OS_Keylist list)    // list number to be deleted
 {
     if (list) {
-        // clean out the list
-        while (list->count) {
-            (void) Keylist_Data_Delete_By_Index(list, 0);
-        }
-        if (list->array)
-            free(list->array);
-        free(list);
+        // the nodes live in the arrays, so there is nothing
+        // to free one at a time
+        if (list->keys)
+            free(list->keys);
+        if (list->data)
+            free(list->data);
+        Keylist_Index_Enable(list, FALSE);
+        slab_free(&Keylist_Pool, list);
     }
 
     return;
@@ -375,7 +611,8 @@ void Keylist_Delete(OS_Keylist list)    // list number to be deleted
 
 #ifdef TEST
 #include <assert.h>
-#include <string.h>
+#include <stdio.h>
+#include <time.h>
 
 #include "ctest.h"
 
@@ -651,37 +888,359 @@ void testKeyListDataIndex(Test * pTest)
     return;
 }
 
-// test access of a lot of entries
-void testKeyListLarge(Test * pTest)
+// test the array growing and shrinking
+void testKeyListSize(Test * pTest)
 {
     int data1 = 42;
-    int *data;
     OS_Keylist list;
     KEY key;
-    int index;
-    const unsigned num_keys = 1024 * 16;
+    int size;
 
     list = Keylist_Create();
-    if (!list)
-        return;
+    ct_test(pTest, list != NULL);
+    ct_test(pTest, list->size == KEYLIST_MIN_SIZE);
+
+    for (key = 0; key < KEYLIST_MIN_SIZE; key++)
+        (void) Keylist_Data_Add(list, key, &data1);
+    ct_test(pTest, list->size == KEYLIST_MIN_SIZE);
+    (void) Keylist_Data_Add(list, key, &data1);
+    size = list->size;
+    ct_test(pTest, size == KEYLIST_MIN_SIZE * 2);
+
+    // adding and deleting around the boundary leaves the array alone
+    for (key = 0; key < 100; key++) {
+        (void) Keylist_Data_Pop(list);
+        (void) Keylist_Data_Add(list, KEYLIST_MIN_SIZE, &data1);
+    }
+    ct_test(pTest, list->size == size);
+    ct_test(pTest, Keylist_Count(list) == KEYLIST_MIN_SIZE + 1);
+
+    // it only shrinks once it is down to a quarter full
+    while (Keylist_Count(list) > size / 4 + 1)
+        (void) Keylist_Data_Pop(list);
+    ct_test(pTest, list->size == size);
+    (void) Keylist_Data_Pop(list);
+    ct_test(pTest, list->size == size / 2);
+    while (Keylist_Data_Pop(list));
+    ct_test(pTest, list->size == KEYLIST_MIN_SIZE);
+
+    Keylist_Delete(list);
+
+    return;
+}
 
-    for (key = 0; key < num_keys; key++) {
-        index = Keylist_Data_Add(list, key, &data1);
+// test the read index against the plain search
+void testKeyListIndex(Test * pTest)
+{
+    int values[70];
+    OS_Keylist list;
+    KEY key;
+    int count, i, pass;
+    unsigned errors = 0;
+    int *data;
 
+    // every tree shape from empty up to a few levels deep
+    for (count = 0; count < 70; count++) {
+        list = Keylist_Create();
+        ct_test(pTest, list != NULL);
+        for (i = 0; i < count; i++)
+            (void) Keylist_Data_Add(list, 3 * i + 1, &values[i]);
+        Keylist_Index_Enable(list, TRUE);
+        // keys in the list, and the gaps either side of each
+        for (pass = 0; pass < 2; pass++) {
+            for (key = 0; key < (KEY) (3 * count + 1); key++) {
+                data = Keylist_Data(list, key);
+                if ((key % 3) == 1) {
+                    if (data != &values[key / 3])
+                        errors++;
+                } else if (data)
+                    errors++;
+            }
+        }
+        if (count)
+            ct_test(pTest, list->index_valid);
+        // a change is picked up by later lookups
+        if (count > 1) {
+            (void) Keylist_Data_Delete(list, 1);
+            if (Keylist_Data(list, 1))
+                errors++;
+            (void) Keylist_Data_Add(list, 3 * count + 1, &values[0]);
+            for (pass = 0; pass < 2; pass++) {
+                for (key = 0; key < (KEY) (3 * count + 3); key++) {
+                    data = Keylist_Data(list, key);
+                    if (key == 1) {
+                        if (data)
+                            errors++;
+                    } else if (key == (KEY) (3 * count + 1)) {
+                        if (data != &values[0])
+                            errors++;
+                    } else if ((key % 3) == 1) {
+                        if (data != &values[key / 3])
+                            errors++;
+                    } else if (data)
+                        errors++;
+                }
+            }
+        }
+        Keylist_Index_Enable(list, FALSE);
+        ct_test(pTest, list->index_keys == NULL);
+        if ((count > 1) && (Keylist_Data(list, 4) != &values[1]))
+            errors++;
+        Keylist_Delete(list);
     }
-    for (key = 0; key < num_keys; key++) {
-        data = Keylist_Data(list, key);
-        ct_test(pTest, *data == data1);
+    ct_test(pTest, errors == 0);
+
+    return;
+}
+
+// test walking a list by key while it changes
+void testKeyListCursor(Test * pTest)
+{
+    int values[100];
+    struct Keylist_Cursor cursor = { 0 };
+    OS_Keylist list;
+    KEY visited[200];
+    int *data;
+    int count = 0, i;
+    unsigned errors = 0;
+
+    list = Keylist_Create();
+    ct_test(pTest, list != NULL);
+    ct_test(pTest, Keylist_Cursor_Data(list, &cursor) == NULL);
+    ct_test(pTest, Keylist_Cursor_Next(list, &cursor) == NULL);
+    for (i = 0; i < 100; i += 2)
+        (void) Keylist_Data_Add(list, 10 * i, &values[i]);
+    // a walk sees each node once while nodes come and go around it
+    for (data = Keylist_Cursor_Data(list, &cursor); data;
+        data = Keylist_Cursor_Next(list, &cursor)) {
+        if (count < 200)
+            visited[count++] = cursor.key;
+        if (data != &values[cursor.key / 10])
+            errors++;
+        if (cursor.key == 200) {
+            // behind the cursor, ahead of it, and the next node
+            (void) Keylist_Data_Delete(list, 0);
+            (void) Keylist_Data_Add(list, 110, &values[11]);
+            (void) Keylist_Data_Add(list, 510, &values[51]);
+            (void) Keylist_Data_Delete(list, 220);
+        }
     }
-    for (index = 0; index < num_keys; index++) {
-        data = Keylist_Data_Index(list, index);
-        ct_test(pTest, *data == data1);
+    ct_test(pTest, errors == 0);
+    // 0 to 200, then 240 to 980 and the one added at 510
+    ct_test(pTest, count == 11 + 38 + 1);
+    for (i = 1; i < count; i++) {
+        if (visited[i] <= visited[i - 1])
+            errors++;
     }
+    ct_test(pTest, errors == 0);
+    ct_test(pTest, Keylist_Cursor_Next(list, &cursor) == NULL);
+    Keylist_Cursor_Reset(&cursor);
+    ct_test(pTest, Keylist_Cursor_Data(list, &cursor) == &values[2]);
+    ct_test(pTest, cursor.key == 20);
+
+    // the node at the cursor going away moves it to the next one
+    ct_test(pTest, Keylist_Data_Delete(list, 20) == &values[2]);
+    ct_test(pTest, Keylist_Cursor_Data(list, &cursor) == &values[4]);
+
+    // duplicates are passed together, and the last key ends the walk
+    (void) Keylist_Data_Add(list, 40, &values[5]);
+    ct_test(pTest, Keylist_Cursor_Data(list, &cursor) != NULL);
+    ct_test(pTest, Keylist_Cursor_Next(list, &cursor) == &values[6]);
+    (void) Keylist_Data_Add(list, (KEY) ~0u, &values[99]);
+    cursor.key = 990;
+    ct_test(pTest, Keylist_Cursor_Data(list, &cursor) == &values[99]);
+    ct_test(pTest, Keylist_Cursor_Next(list, &cursor) == NULL);
+    ct_test(pTest, Keylist_Cursor_Data(list, &cursor) == NULL);
     Keylist_Delete(list);
 
     return;
 }
 
+static double KeyListElapsed(struct timespec *start)
+{
+    struct timespec end;
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    return (end.tv_sec - start->tv_sec) +
+        (end.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+// test adding a batch, and time it against single adds
+void testKeyListBatch(Test * pTest)
+{
+    char *data1 = "Joshua";
+    char *data2 = "Anna";
+    char *data3 = "Mary";
+    KEY batch_keys[] = { 25, 5, 35, 0, 15, 50 };
+    void *batch_data[6];
+    OS_Keylist list, single;
+    KEY *keys;
+    void **data;
+    int values[4];
+    int index, n;
+    unsigned num_keys, i, errors;
+    struct timespec start;
+    double single_time, batch_time;
+
+    list = Keylist_Create();
+    ct_test(pTest, list != NULL);
+    for (index = 0; index < 4; index++)
+        (void) Keylist_Data_Add(list, 10 * index, &values[index]);
+    for (index = 0; index < 6; index++)
+        batch_data[index] = &values[0];
+    // the batch's key 0 carries its own data so the two can be told apart
+    batch_data[3] = data1;
+    ct_test(pTest, Keylist_Data_Add_Batch(list, batch_keys, batch_data,
+            6) == 6);
+    ct_test(pTest, Keylist_Count(list) == 10);
+    for (index = 1; index < 10; index++)
+        ct_test(pTest, Keylist_Key(list, index - 1) <=
+            Keylist_Key(list, index));
+    ct_test(pTest, Keylist_Data(list, 20) == &values[2]);
+    ct_test(pTest, Keylist_Data(list, 35) == &values[0]);
+    // an equal key goes ahead of the one already there
+    ct_test(pTest, Keylist_Key(list, 0) == 0);
+    ct_test(pTest, Keylist_Key(list, 1) == 0);
+    ct_test(pTest, Keylist_Data_Index(list, 0) == data1);
+    ct_test(pTest, Keylist_Data_Index(list, 1) == &values[0]);
+    ct_test(pTest, Keylist_Data_Add_Batch(list, batch_keys, batch_data,
+            0) == 0);
+    ct_test(pTest, Keylist_Data_Add_Batch(NULL, batch_keys, batch_data,
+            1) == -1);
+    Keylist_Delete(list);
+
+    // equal keys in a batch come out as they would added one by one
+    list = Keylist_Create();
+    batch_keys[0] = batch_keys[1] = batch_keys[2] = 0;
+    batch_data[0] = data1;
+    batch_data[1] = data2;
+    batch_data[2] = data3;
+    ct_test(pTest, Keylist_Data_Add_Batch(list, batch_keys, batch_data,
+            3) == 3);
+    ct_test(pTest, Keylist_Data_Pop(list) == data1);
+    ct_test(pTest, Keylist_Data_Pop(list) == data2);
+    ct_test(pTest, Keylist_Data_Pop(list) == data3);
+    Keylist_Delete(list);
+
+    // keys in scrambled order, as an object list may arrive
+    for (n = 0; n < 2; n++) {
+        num_keys = n ? 30000 : 10000;
+        keys = malloc(num_keys * sizeof(KEY));
+        data = malloc(num_keys * sizeof(void *));
+        if (!keys || !data)
+            return;
+        for (i = 0; i < num_keys; i++) {
+            keys[i] = (KEY) (((unsigned long long) i * 7919) % num_keys);
+            data[i] = &values[keys[i] % 4];
+        }
+        single = Keylist_Create();
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (i = 0; i < num_keys; i++)
+            (void) Keylist_Data_Add(single, keys[i], data[i]);
+        single_time = KeyListElapsed(&start);
+        list = Keylist_Create();
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        ct_test(pTest, Keylist_Data_Add_Batch(list, keys, data,
+                (int) num_keys) == (int) num_keys);
+        batch_time = KeyListElapsed(&start);
+        errors = 0;
+        for (i = 0; i < num_keys; i++) {
+            if ((Keylist_Key(list, i) != i) ||
+                (Keylist_Data_Index(list, i) !=
+                    Keylist_Data_Index(single, i)))
+                errors++;
+        }
+        ct_test(pTest, errors == 0);
+        printf("keylist: %7u keys - scrambled add %5.1f M/s, "
+            "batch %5.1f M/s\n", num_keys,
+            num_keys / single_time / 1e6, num_keys / batch_time / 1e6);
+        Keylist_Delete(single);
+        Keylist_Delete(list);
+        free(keys);
+        free(data);
+    }
+
+    return;
+}
+
+// test access of a lot of entries, and time it
+void testKeyListLarge(Test * pTest)
+{
+    int data1 = 42;
+    int *data;
+    OS_Keylist list;
+    KEY key;
+    int index;
+    const unsigned num_keys_list[] = { 10000, 100000, 1000000 };
+    unsigned num_keys;
+    unsigned errors;
+    unsigned i, n;
+    struct timespec start;
+    double insert_time, lookup_time, index_time, delete_time;
+
+    for (n = 0; n < sizeof(num_keys_list) / sizeof(num_keys_list[0]); n++) {
+        num_keys = num_keys_list[n];
+        list = Keylist_Create();
+        if (!list)
+            return;
+
+        errors = 0;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (key = 0; key < num_keys; key++) {
+            index = Keylist_Data_Add(list, key, &data1);
+            if (index != (int) key)
+                errors++;
+        }
+        insert_time = KeyListElapsed(&start);
+        ct_test(pTest, Keylist_Count(list) == (int) num_keys);
+
+        // look the keys up out of order - 7919 is prime, so this
+        // visits every key once
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (i = 0; i < num_keys; i++) {
+            key = (KEY) (((unsigned long long) i * 7919) % num_keys);
+            data = Keylist_Data(list, key);
+            if (!data || (*data != data1))
+                errors++;
+        }
+        lookup_time = KeyListElapsed(&start);
+        // and again through the read index, counting its build
+        Keylist_Index_Enable(list, TRUE);
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (i = 0; i < num_keys; i++) {
+            key = (KEY) (((unsigned long long) i * 7919) % num_keys);
+            data = Keylist_Data(list, key);
+            if (!data || (*data != data1))
+                errors++;
+        }
+        index_time = KeyListElapsed(&start);
+        for (index = 0; index < (int) num_keys; index++) {
+            data = Keylist_Data_Index(list, index);
+            if (!data || (*data != data1))
+                errors++;
+        }
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (key = num_keys; key > 0; key--) {
+            if (Keylist_Data_Delete(list, key - 1) != &data1)
+                errors++;
+        }
+        delete_time = KeyListElapsed(&start);
+        ct_test(pTest, errors == 0);
+        ct_test(pTest, Keylist_Count(list) == 0);
+        ct_test(pTest, list->size == KEYLIST_MIN_SIZE);
+
+        printf("keylist: %7u keys - insert %5.1f M/s, lookup %5.1f M/s, "
+            "indexed %5.1f M/s, delete %5.1f M/s\n", num_keys,
+            num_keys / insert_time / 1e6, num_keys / lookup_time / 1e6,
+            num_keys / index_time / 1e6, num_keys / delete_time / 1e6);
+        Keylist_Delete(list);
+    }
+
+    return;
+}
+
 #ifdef TEST_KEYLIST
 int main(void)
 {
@@ -701,6 +1260,14 @@ int main(void)
     assert(rc);
     rc = ct_addTestFunction(pTest, testKeyListDataIndex);
     assert(rc);
+    rc = ct_addTestFunction(pTest, testKeyListSize);
+    assert(rc);
+    rc = ct_addTestFunction(pTest, testKeyListIndex);
+    assert(rc);
+    rc = ct_addTestFunction(pTest, testKeyListCursor);
+    assert(rc);
+    rc = ct_addTestFunction(pTest, testKeyListBatch);
+    assert(rc);
     rc = ct_addTestFunction(pTest, testKeyListLarge);
     assert(rc);
 
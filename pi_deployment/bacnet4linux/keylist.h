@@ -0,0 +1,142 @@
+/*####COPYRIGHTBEGIN####
+ -------------------------------------------
+ Copyright (C) 2003 Steve Karg
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to
+ The Free Software Foundation, Inc.
+ 59 Temple Place - Suite 330
+ Boston, MA  02111-1307, USA.
+
+ As a special exception, if other files instantiate templates or
+ use macros or inline functions from this file, or you compile
+ this file and link it with other works to produce a work based
+ on this file, this file does not by itself cause the resulting
+ work to be covered by the GNU General Public License. However
+ the source code for this file must still be made available in
+ accordance with section (3) of the GNU General Public License.
+
+ This exception does not invalidate any other reasons why a work
+ based on this file might be covered by the GNU General Public
+ License.
+ -------------------------------------------
+####COPYRIGHTEND####*/
+#ifndef KEYLIST_H
+#define KEYLIST_H
+
+#include "key.h"
+
+// This is a key sorted list data library that
+// uses a key or index to access the data.
+// If the keys are duplicated, they can be accessed
+// like a FIFO or FILO list.
+
+// The keys and the data pointers are kept in two parallel arrays,
+// so a search only walks the keys.
+struct Keylist {
+    KEY *keys;                  // sorted keys
+    void **data;                // data stored with keys[i]
+    int count;                  // number of entries in this list
+    int size;                   // number of entries the arrays can hold
+    // optional read index - a copy of the list in Eytzinger (breadth
+    // first tree) order, rebuilt by the first lookup after a change
+    KEY *index_keys;            // keys, 1 based
+    void **index_data;          // data stored with index_keys[i]
+    int index_size;             // number of entries the index can hold
+    int index_enabled;          // lookups by key use the index
+    int index_valid;            // the index matches keys and data
+    int index_stale_reads;      // lookups made since the list changed
+};
+typedef struct Keylist *OS_Keylist;
+
+// a place in a list that holds while nodes are added and deleted -
+// it keeps a key rather than an index.  A zeroed cursor is at the
+// start of the list.
+struct Keylist_Cursor {
+    KEY key;                    // the node at the cursor has this key or
+                                // the next one up
+    int done;                   // moved past the last possible key
+};
+
+// returns head of the list or NULL on failure.
+OS_Keylist Keylist_Create(void);
+
+// delete specified list
+// note: you should pop all the nodes off the list first.
+void Keylist_Delete(OS_Keylist list);
+
+// inserts a node into its sorted position
+// returns the index where it was added
+int Keylist_Data_Add(OS_Keylist list, KEY key, void *data);
+
+// inserts many nodes at once, sorted and merged in one pass
+// returns the number of nodes added, or -1 if the list is unchanged
+int Keylist_Data_Add_Batch(OS_Keylist list, const KEY * keys,
+    void **data, int count);
+
+// deletes a node specified by its key
+// returns the data from the node
+void *Keylist_Data_Delete(OS_Keylist list, KEY key);
+
+// deletes a node specified by its index
+// returns the data from the node
+void *Keylist_Data_Delete_By_Index(OS_Keylist list, int index);
+
+// returns the data from last node, and removes it from the list
+void *Keylist_Data_Pop(OS_Keylist list);
+
+// returns the data from the node specified by key
+void *Keylist_Data(OS_Keylist list, KEY key);
+
+// returns the data from the node specified by index
+void *Keylist_Data_Index(OS_Keylist list, int index);
+
+// return the key at the given index
+KEY Keylist_Key(OS_Keylist list, int index);
+
+// returns the next empty key from the list
+KEY Keylist_Next_Empty_Key(OS_Keylist list, KEY key);
+
+// returns the number of items in the list
+int Keylist_Count(OS_Keylist list);
+
+// puts the cursor back at the start of the list
+void Keylist_Cursor_Reset(struct Keylist_Cursor *cursor);
+// returns the data from the node at the cursor and settles the cursor
+// on its key, or NULL at the end of the list
+void *Keylist_Cursor_Data(OS_Keylist list, struct Keylist_Cursor *cursor);
+// moves the cursor past its node, and returns the data from the next
+// one or NULL at the end of the list.  Nodes with the same key are
+// passed together.
+void *Keylist_Cursor_Next(OS_Keylist list, struct Keylist_Cursor *cursor);
+
+// turns the read index on or off for lists that are mostly read.
+// Lookups by key then walk a few predictable cache lines; with
+// duplicate keys they return the first one.
+void Keylist_Index_Enable(OS_Keylist list, int enable);
+
+#ifdef TEST
+#include "ctest.h"
+void testKeyListFIFO(Test * pTest);
+void testKeyListFILO(Test * pTest);
+void testKeyListDataKey(Test * pTest);
+void testKeyListDataIndex(Test * pTest);
+void testKeyListSize(Test * pTest);
+void testKeyListIndex(Test * pTest);
+void testKeyListCursor(Test * pTest);
+void testKeyListBatch(Test * pTest);
+void testKeyListLarge(Test * pTest);
+void testKeySample(Test * pTest);
+#endif
+
+#endif
@@ -48,11 +48,29 @@ extern int BACnet_Time_Sync_Seconds;
 // initial polling delay is how long to wait to begin 
 // querying new devices (in seconds, 0=disable query)
 extern int BACnet_Initial_Query_Delay;
+// GPIO chip that holds the Raspberry Pi header lines
+extern char *GPIO_Chip;
+// pwmchip that drives the analog outputs
+extern char *PWM_Chip;
+// SPI device of the MCP3008 that reads the analog inputs
+extern char *ADC_Device;
 // my local device data - MAC address
 extern struct in_addr BACnet_Device_IP_Address;
 // stores the local IP broadcast address which varies depending on subnet
 extern struct in_addr Local_IP_Broadcast_Address;
 
+// startup phases, timed from the start of main() to the first I-Am
+enum startup_phase {
+    STARTUP_CONFIG,             /* command line, device cache, interfaces */
+    STARTUP_SOCKETS,
+    STARTUP_OBJECTS,            /* local device and GPIO objects */
+    STARTUP_FIRST_IAM,
+    MAX_STARTUP_PHASES
+};
+// how long each phase took (microseconds)
+extern unsigned long Startup_Phase_Usec[MAX_STARTUP_PHASES];
+extern const char *Startup_Phase_Name[MAX_STARTUP_PHASES];
+
 //  filenames for save/restore operations
 extern char *readFile;
 extern char *writeFile;
@@ -0,0 +1,31 @@
+/*####COPYRIGHTBEGIN####
+ -------------------------------------------
+ Object Index Header for BACnet4Linux
+ -------------------------------------------
+####COPYRIGHTEND####*/
+
+#ifndef OBJECT_INDEX_H
+#define OBJECT_INDEX_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "bacnet_struct.h"
+#include "bacnet_enum.h"
+
+// one table of every object we know, keyed on the (device, type,
+// instance) triple.  It mirrors the device object lists, so a point is
+// found with one hash probe rather than a search of the device list
+// and then of the device's object list.
+
+// smallest table - a power of 2
+#define OBJECT_INDEX_MIN_SLOTS 64
+
+bool object_index_add(int device_id, struct ObjectRef_Struct *obj_ptr);
+struct ObjectRef_Struct *object_index_find(int device_id,
+    enum BACnetObjectType type, int instance);
+bool object_index_remove(int device_id, enum BACnetObjectType type,
+    int instance);
+int object_index_count(void);
+void object_index_cleanup(void);
+
+#endif /* OBJECT_INDEX_H */
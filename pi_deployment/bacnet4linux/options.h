@@ -36,8 +36,10 @@
 // common global configuration options
 // the device instance that this will be (0-4194303)
 extern int BACnet_Device_Instance;
-// APDU timeout (for retries) in seconds 
+// APDU timeout (for retries) in milliseconds
 extern int BACnet_APDU_Timeout;
+// times a request is sent again before it fails
+extern int BACnet_APDU_Retries;
 // the BACnet Vendor ID that will be used (0 == ASHRAE)
 // Note: ASHRAE maintains the list of Vendor Ids - see them for one.
 extern int BACnet_Vendor_Identifier;
@@ -50,32 +50,33 @@ static time_t device_request_present_value(struct BACnet_Device_Info
 
 
     t = time(NULL);             /* find current time */
-    obj_ptr = object_get_by_index(dev_ptr, dev_ptr->object_index);
+    obj_ptr = object_cursor_data(dev_ptr, &dev_ptr->object_cursor);
     if (obj_ptr) {
-        dev_ptr->object_index++;
+        (void) object_cursor_next(dev_ptr, &dev_ptr->object_cursor);
         /* time to request a new present-value */
-        delta_time = t - obj_ptr->last_subscribe_COV;
+        delta_time = t - object_cov_time(obj_ptr);
         if (delta_time > BACnet_COV_Lifetime) {
-            if ((obj_ptr->type == OBJECT_ANALOG_VALUE)
-                || (obj_ptr->type == OBJECT_ANALOG_INPUT)
-                || (obj_ptr->type == OBJECT_ANALOG_OUTPUT)
-                || (obj_ptr->type == OBJECT_BINARY_VALUE)
-                || (obj_ptr->type == OBJECT_BINARY_INPUT)
-                || (obj_ptr->type == OBJECT_BINARY_OUTPUT)) {
+            if ((object_type(obj_ptr) == OBJECT_ANALOG_VALUE)
+                || (object_type(obj_ptr) == OBJECT_ANALOG_INPUT)
+                || (object_type(obj_ptr) == OBJECT_ANALOG_OUTPUT)
+                || (object_type(obj_ptr) == OBJECT_BINARY_VALUE)
+                || (object_type(obj_ptr) == OBJECT_BINARY_INPUT)
+                || (object_type(obj_ptr) == OBJECT_BINARY_OUTPUT)) {
                 debug_printf(3,
                     "QND: Requesting Device %d present-value for %s %d\n",
                     dev_ptr->device,
-                    enum_to_text_object(obj_ptr->type), obj_ptr->instance);
+                    enum_to_text_object(object_type(obj_ptr)),
+                    object_instance(obj_ptr));
                 read_property(dev_ptr->device,
-                    obj_ptr->type, obj_ptr->instance,
+                    object_type(obj_ptr), object_instance(obj_ptr),
                     PROP_PRESENT_VALUE, -1 /* array index */ );
                 /* set the time */
-                obj_ptr->last_subscribe_COV = t;
+                object_set_cov_time(obj_ptr, t);
             }
         }
     } else {
         // start over, and wait for timeout
-        dev_ptr->object_index = 0;
+        Keylist_Cursor_Reset(&dev_ptr->object_cursor);
     }
 
     return delta_time;
@@ -89,31 +90,32 @@ static time_t device_subscribe_cov(struct BACnet_Device_Info *dev_ptr)
     time_t t;                   /* time_h storage for time */
 
     t = time(NULL);             /* find current time */
-    obj_ptr = object_get_by_index(dev_ptr, dev_ptr->object_index);
+    obj_ptr = object_cursor_data(dev_ptr, &dev_ptr->object_cursor);
     if (obj_ptr) {
-        dev_ptr->object_index++;
+        (void) object_cursor_next(dev_ptr, &dev_ptr->object_cursor);
         /* time to re-subscribe (or never subscribed) */
-        delta_time = t - obj_ptr->last_subscribe_COV;
+        delta_time = t - object_cov_time(obj_ptr);
         if (delta_time > BACnet_COV_Lifetime) {
-            if ((obj_ptr->type == OBJECT_ANALOG_VALUE)
-                || (obj_ptr->type == OBJECT_ANALOG_INPUT)
-                || (obj_ptr->type == OBJECT_ANALOG_OUTPUT)
-                || (obj_ptr->type == OBJECT_BINARY_VALUE)
-                || (obj_ptr->type == OBJECT_BINARY_INPUT)
-                || (obj_ptr->type == OBJECT_BINARY_OUTPUT)) {
+            if ((object_type(obj_ptr) == OBJECT_ANALOG_VALUE)
+                || (object_type(obj_ptr) == OBJECT_ANALOG_INPUT)
+                || (object_type(obj_ptr) == OBJECT_ANALOG_OUTPUT)
+                || (object_type(obj_ptr) == OBJECT_BINARY_VALUE)
+                || (object_type(obj_ptr) == OBJECT_BINARY_INPUT)
+                || (object_type(obj_ptr) == OBJECT_BINARY_OUTPUT)) {
                 debug_printf(3,
                     "QND: Requesting Device %d subscribe for %s %d\n",
                     dev_ptr->device,
-                    enum_to_text_object(obj_ptr->type), obj_ptr->instance);
+                    enum_to_text_object(object_type(obj_ptr)),
+                    object_instance(obj_ptr));
                 subscribe_cov(dev_ptr->device,
-                    obj_ptr->type, obj_ptr->instance);
+                    object_type(obj_ptr), object_instance(obj_ptr));
                 /* set the time */
-                obj_ptr->last_subscribe_COV = t;
+                object_set_cov_time(obj_ptr, t);
             }
         }
     } else {
         // start over, and wait for timeout
-        dev_ptr->object_index = 0;
+        Keylist_Cursor_Reset(&dev_ptr->object_cursor);
     }
 
     return delta_time;
@@ -161,19 +163,21 @@ static void query_object_list_properties(struct BACnet_Device_Info
     enum BACnetPropertyIdentifier property;     /* pointer to an array of properties */
 
     if (dev_ptr) {
-        obj_ptr = object_get_by_index(dev_ptr, dev_ptr->object_index);
+        obj_ptr = object_cursor_data(dev_ptr, &dev_ptr->object_cursor);
         if (obj_ptr) {
-            property_list_ptr = getobjectprops(obj_ptr->type);
+            property_list_ptr = getobjectprops(object_type(obj_ptr));
             if (property_list_ptr) {
                 property = *(property_list_ptr + dev_ptr->prop_count);
                 if (property != PROP_NO_PROPERTY) {
                     query_object_property(dev_ptr->device,
-                        obj_ptr->type, obj_ptr->instance, property);
+                        object_type(obj_ptr), object_instance(obj_ptr),
+                        property);
                     dev_ptr->prop_count++;
                 } else {
                     // last property, go to next object
                     dev_ptr->prop_count = 0;
-                    dev_ptr->object_index++;
+                    (void) object_cursor_next(dev_ptr,
+                        &dev_ptr->object_cursor);
                 }
             } else {
                 // internal error?
@@ -187,7 +191,7 @@ static void query_object_list_properties(struct BACnet_Device_Info
             else
                 dev_ptr->state = DEVICE_STATE_REQUEST_PRESENT_VALUE;
             // housekeeping
-            dev_ptr->object_index = 0;
+            Keylist_Cursor_Reset(&dev_ptr->object_cursor);
             dev_ptr->prop_count = 0;
         }
     }
@@ -195,11 +199,73 @@ static void query_object_list_properties(struct BACnet_Device_Info
     return;
 }
 
+/* moves on from reading the ObjectList to its objects' properties */
+static void query_object_list_done(struct BACnet_Device_Info *dev_ptr)
+{
+    dev_ptr->object_index = 0;
+    dev_ptr->object_list_asked = 0;
+    dev_ptr->object_list_indexed = false;
+    dev_ptr->state = DEVICE_STATE_QUERY_OBJECT_LIST_PROPERTIES;
+}
+
+/* reads the ObjectList an index at a time from now on */
+static void query_object_list_indexed(struct BACnet_Device_Info *dev_ptr)
+{
+    debug_printf(2,
+        "query: Device %d ObjectList did not come whole - "
+        "reading it an index at a time\n", dev_ptr->device);
+    dev_ptr->object_index = 1;
+    dev_ptr->object_list_indexed = true;
+}
+
+void query_object_list_received(struct BACnet_Device_Info *dev_ptr,
+    int count)
+{
+    if (!dev_ptr || (dev_ptr->state != DEVICE_STATE_QUERY_OBJECT_LIST) ||
+        dev_ptr->object_list_indexed)
+        return;
+    /* a reply cut short is read again an index at a time */
+    if (count < dev_ptr->true_num_objects)
+        query_object_list_indexed(dev_ptr);
+    else
+        query_object_list_done(dev_ptr);
+}
+
+void query_object_list_refused(struct BACnet_Device_Address *src)
+{
+    struct BACnet_Device_Info *dev_ptr;
+
+    dev_ptr = device_get(device_which_sent(src));
+    /* most likely the whole ObjectList did not fit in a reply */
+    if (dev_ptr && (dev_ptr->state == DEVICE_STATE_QUERY_OBJECT_LIST) &&
+        dev_ptr->object_list_asked && !dev_ptr->object_list_indexed)
+        query_object_list_indexed(dev_ptr);
+}
+
 /* query the ObjectList - adds objects to our object list */
+/* the whole list is asked for in one request, and read an index at */
+/* a time only if it does not come back that way */
 static void query_device_object_list(struct BACnet_Device_Info *dev_ptr)
 {
+    time_t t;
+
     if (!dev_ptr)
         return;
+    if (!dev_ptr->object_list_indexed) {
+        t = time(NULL);
+        if (!dev_ptr->object_list_asked) {
+            debug_printf(3, "query: Requesting Device %d ObjectList\n",
+                dev_ptr->device);
+            read_property(dev_ptr->device, OBJECT_DEVICE,
+                dev_ptr->device, PROP_OBJECT_LIST, -1
+                /* array index -1=the whole array */
+                );
+            dev_ptr->object_list_asked = t;
+        } else if ((t - dev_ptr->object_list_asked) * 1000 >
+            invoke_id_device_lifetime(dev_ptr))
+            query_object_list_indexed(dev_ptr);
+        return;
+    }
     if (dev_ptr->true_num_objects) {
         /* find the true number of objects in the device */
         debug_printf(3,
@@ -210,10 +276,8 @@ static void query_device_object_list(struct BACnet_Device_Info *dev_ptr)
             dev_ptr->device, PROP_OBJECT_LIST, dev_ptr->object_index);
         dev_ptr->object_index++;
         // finished with all the properties?
-        if (dev_ptr->object_index >= dev_ptr->true_num_objects) {
-            dev_ptr->object_index = 0;
-            dev_ptr->state = DEVICE_STATE_QUERY_OBJECT_LIST_PROPERTIES;
-        }
+        if (dev_ptr->object_index > dev_ptr->true_num_objects)
+            query_object_list_done(dev_ptr);
     }
 
     return;
@@ -237,6 +301,9 @@ static void query_device_properties(struct BACnet_Device_Info *dev_ptr)
         } else {
             dev_ptr->prop_count = 0;
             dev_ptr->object_index = 0;
+            dev_ptr->object_list_asked = 0;
+            dev_ptr->object_list_indexed = false;
+            Keylist_Cursor_Reset(&dev_ptr->object_cursor);
             dev_ptr->state = DEVICE_STATE_QUERY_OBJECT_LIST;
         }
     } else {
@@ -251,7 +318,8 @@ static void query_device_properties(struct BACnet_Device_Info *dev_ptr)
 /* 1. following receive of I-Am... */
 /*       ...the object list in the device object is asked for */
 /* 2. following receive of ObjectList array size... */
-/*      ...the ObjectList array is asked for one at a time */
+/*      ...the whole ObjectList array is asked for, or if it does */
+/*      not fit in a reply, one index at a time */
 /* 3. following receive of complete ObjectList... */
 /*      ...the object properties are asked for */
 /* 4. following receive of object properties... */
@@ -269,6 +337,7 @@ static time_t query_device(struct BACnet_Device_Info *dev_ptr)
     case DEVICE_STATE_INIT:
         dev_ptr->state = DEVICE_STATE_QUERY_DEVICE_PROPERTIES;
         dev_ptr->object_index = 0;
+        Keylist_Cursor_Reset(&dev_ptr->object_cursor);
         dev_ptr->prop_count = 0;
         dev_ptr->true_num_objects = 0;
         break;
@@ -316,17 +385,22 @@ bool query_busy_status(void)
             switch (dev_ptr->state) {
             case DEVICE_STATE_INIT:
             case DEVICE_STATE_QUERY_DEVICE_PROPERTIES:
-            case DEVICE_STATE_QUERY_OBJECT_LIST:
             case DEVICE_STATE_QUERY_OBJECT_LIST_PROPERTIES:
                 relax = false;
                 break;
+            case DEVICE_STATE_QUERY_OBJECT_LIST:
+                // the reply to the whole ObjectList wakes us
+                if (!dev_ptr->object_list_asked ||
+                    dev_ptr->object_list_indexed)
+                    relax = false;
+                break;
             case DEVICE_STATE_SUBSCRIBE_COV:
             case DEVICE_STATE_REQUEST_PRESENT_VALUE:
                 obj_ptr =
-                    object_get_by_index(dev_ptr, dev_ptr->object_index);
+                    object_cursor_data(dev_ptr, &dev_ptr->object_cursor);
                 if (obj_ptr) {
                     t = time(NULL);
-                    delta_time = t - obj_ptr->last_subscribe_COV;
+                    delta_time = t - object_cov_time(obj_ptr);
                     if (delta_time >= BACnet_COV_Lifetime)
                         relax = false;
                 }
@@ -345,14 +419,17 @@ bool query_busy_status(void)
 
 int query_new_device(void)
 {
-    static int device_index = 0;        // work only one device per call
+    // work only one device per call
+    static struct Keylist_Cursor device_cursor = { 0 };
     struct BACnet_Device_Info *dev_ptr = NULL;
-    bool relax = false;
+    bool relax = true;
 
     if (device_count() > 0) {   /* some devices to check */
-        /* all Invoke IDs are available */
+        /* an Invoke ID is available - otherwise nothing can be sent */
+        /* until a reply or a timeout frees one, and both of those */
+        /* wake the main loop */
         if (invoke_id_in_use() < BACnet_Invoke_Ids) {
-            dev_ptr = device_record(device_index);
+            dev_ptr = device_cursor_data(&device_cursor);
             if (dev_ptr) {
                 // don't query myself 
                 // maybe later when I get all my device props working
@@ -361,10 +438,10 @@ int query_new_device(void)
                 // query the device
                 query_device(dev_ptr);
                 // get ready for next time 
-                device_index++;
+                (void) device_cursor_next(&device_cursor);
             } else {
                 // start over
-                device_index = 0;
+                Keylist_Cursor_Reset(&device_cursor);
             }
             relax = query_busy_status();
         }
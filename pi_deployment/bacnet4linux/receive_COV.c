@@ -71,7 +71,7 @@ int receive_COV(uint8_t * apdu, int apdu_len,
 
         debug_printf(3, "RCOV: Object %d %s %d (%s) \n\tnew value is: ",
             who_sent, enum_to_text_object(object),
-            instance, obj_ptr->name);
+            instance, object_name(obj_ptr));
 
         /* time remaining one byte < 256 */
         if (apdu[14] == 0x39) {
@@ -97,9 +97,9 @@ int receive_COV(uint8_t * apdu, int apdu_len,
             if (apdu[20 + offset] == 0x91) {
                 obj_ptr->value.binary = apdu[21 + offset];
                 if (obj_ptr->value.binary == BINARY_INACTIVE)
-                    debug_printf(3, "%s ", obj_ptr->units.states.inactive);
+                    debug_printf(3, "%s ", object_inactive_text(obj_ptr));
                 else
-                    debug_printf(3, "%s ", obj_ptr->units.states.active);
+                    debug_printf(3, "%s ", object_active_text(obj_ptr));
             }
         }
         debug_printf(3, "\n\t%ds remaining in subscription\n",
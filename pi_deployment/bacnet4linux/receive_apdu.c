@@ -212,7 +212,7 @@ int receive_apdu(uint8_t * apdu, int apdu_len,
             "receive-apdu: %s\n",
             enum_to_text_service_confirmed(service_choice));
         /* return this invoke ID to the pool (no further action is needed) */
-        invoke_id_reset(invoke_id);
+        invoke_id_reset(src, invoke_id);
         break;
     case PDU_TYPE_COMPLEX_ACK:
         debug_printf(3,
@@ -221,7 +221,7 @@ int receive_apdu(uint8_t * apdu, int apdu_len,
         invoke_id = apdu[1];    /* the original Invoke ID */
         debug_printf(3, "receive-apdu:    %d = invoke_id\n",
             (int) invoke_id);
-        invoke_id_reset(invoke_id);     /* return this invoke ID to the pool (no further action is needed) */
+        invoke_id_reset(src, invoke_id);        /* return this invoke ID to the pool (no further action is needed) */
 
         if (segmented_message) {
             seq_number = apdu[2];
@@ -260,7 +260,7 @@ int receive_apdu(uint8_t * apdu, int apdu_len,
         debug_printf(4, "receive-apdu:    %d = actual window size\n",
             window_size);
         /* return this invoke ID to the pool (no further action is needed) */
-        invoke_id_reset(invoke_id);
+        invoke_id_reset(src, invoke_id);
         break;
     case PDU_TYPE_ERROR:
         // Error-PDU
@@ -270,10 +270,11 @@ int receive_apdu(uint8_t * apdu, int apdu_len,
         // error-choice [3] BACnetConfirmedServiceChoice
         // error [4] BACnet-Error
         invoke_id = apdu[1];    /* the original Invoke ID */
-        invoke_id_reset(invoke_id);     /* return this invoke ID to the pool (no further action is needed) */
+        invoke_id_reset(src, invoke_id);        /* return this invoke ID to the pool (no further action is needed) */
         debug_printf(3,
             "receive-apdu:    %04X .... = PDU Type:  BACnet_Error_PDU\n",
             PDU_type);
+        query_object_list_refused(src);
         break;
     case PDU_TYPE_REJECT:
         // Reject-PDU
@@ -282,9 +283,10 @@ int receive_apdu(uint8_t * apdu, int apdu_len,
         // original-invoke_id [2] Unsigned 0-255
         // reject reason [3] enumeration
         invoke_id = apdu[1];    /* the original Invoke ID */
-        invoke_id_reset(invoke_id);     /* return this invoke ID to the pool (no further action is needed) */
+        invoke_id_reset(src, invoke_id);        /* return this invoke ID to the pool (no further action is needed) */
         debug_printf(3, "receive-apdu: PDU_TYPE_REJECT: %s\n",
             enum_to_text_reject_reason(apdu[2]));
+        query_object_list_refused(src);
         break;
     case PDU_TYPE_ABORT:
         // Abort-PDU
@@ -294,9 +296,10 @@ int receive_apdu(uint8_t * apdu, int apdu_len,
         // original-invoke_id [3] Unsigned 0-255
         // abort reason [4] enumeration
         invoke_id = apdu[1];    /* the original Invoke ID */
-        invoke_id_reset(invoke_id);     /* return this invoke ID to the pool (no further action is needed) */
+        invoke_id_reset(src, invoke_id);        /* return this invoke ID to the pool (no further action is needed) */
         debug_printf(3, "receive-apdu: PDU_TYPE_ABORT: %s\n",
             enum_to_text_abort_reason(apdu[2]));
+        query_object_list_refused(src);
         break;
     }
 
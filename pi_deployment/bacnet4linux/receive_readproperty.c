@@ -46,6 +46,7 @@
 #include "options.h"
 #include "version.h"
 #include "gpio_objects.h"
+#include "gpio_pins.h"
 #include "bacnet_object.h"
 
 // Status flag bit positions (standard BACnet)
@@ -59,7 +60,8 @@ extern int BACnet_Time_Sync_Seconds;
 extern int BACnet_COV_Support;
 
 // External priority array access functions (from receive_writeproperty.c)
-extern bool get_priority_value(uint32_t instance, int priority, union ObjectValue *value);
+extern bool get_priority_value(int object_type, uint32_t instance, int priority,
+    union ObjectValue *value);
 
 // Function to encode object property values, including GPIO objects
 int encode_object_property_value(uint8_t * apdu, 
@@ -76,8 +78,7 @@ int encode_object_property_value(uint8_t * apdu,
     }
     
     // Handle GPIO objects with special properties (priority-array, relinquish-default)
-    if (((object_type == OBJECT_BINARY_OUTPUT && (instance == 4018 || instance == 4026)) ||
-         (object_type == OBJECT_ANALOG_OUTPUT && instance == 2021)) &&
+    if (gpio_pin_is_output(gpio_pin_find(object_type, instance)) &&
         (property == PROP_PRIORITY_ARRAY || property == PROP_RELINQUISH_DEFAULT)) {
         
         if (property == PROP_PRIORITY_ARRAY) {
@@ -89,7 +90,7 @@ int encode_object_property_value(uint8_t * apdu,
                 // Encode 16 priority levels with actual values from write handler
                 for (int i = 1; i <= 16; i++) {
                     union ObjectValue pri_value;
-                    bool is_null = get_priority_value(instance, i, &pri_value);
+                    bool is_null = get_priority_value(object_type, instance, i, &pri_value);
                     
                     if (is_null) {
                         apdu[apdu_len++] = 0x00; // NULL tag
@@ -107,7 +108,7 @@ int encode_object_property_value(uint8_t * apdu,
             } else if (array_index >= 1 && array_index <= 16) {
                 // Return specific priority level
                 union ObjectValue pri_value;
-                bool is_null = get_priority_value(instance, array_index, &pri_value);
+                bool is_null = get_priority_value(object_type, instance, array_index, &pri_value);
                 
                 if (is_null) {
                     apdu[0] = 0x00; // NULL tag
@@ -125,11 +126,7 @@ int encode_object_property_value(uint8_t * apdu,
         
         if (property == PROP_RELINQUISH_DEFAULT) {
             // Return relinquish default value
-            if (object_type == OBJECT_BINARY_OUTPUT) {
-                apdu_len += encode_tagged_enumerated(&apdu[0], 0); // INACTIVE
-            } else {
-                apdu_len += encode_tagged_real(&apdu[0], 0.0f); // 0.0
-            }
+            apdu_len += gpio_encode_relinquish_default(&apdu[0], object_type, instance);
             return apdu_len;
         }
     }
@@ -141,7 +138,7 @@ int encode_object_property_value(uint8_t * apdu,
             break;
         case PROP_OBJECT_NAME:
             apdu_len = encode_tagged_character_string(&apdu[0], 
-                obj_ptr->name ? obj_ptr->name : "Unnamed Object");
+                object_name(obj_ptr) ? object_name(obj_ptr) : "Unnamed Object");
             break;
         case PROP_OBJECT_TYPE:
             apdu_len = encode_tagged_enumerated(&apdu[0], object_type);
@@ -158,12 +155,18 @@ int encode_object_property_value(uint8_t * apdu,
                 BACNET_BIT_STRING bit_string;
                 bitstring_init(&bit_string);
                 bitstring_set_bit(&bit_string, STATUS_FLAG_IN_ALARM, false);
-                bitstring_set_bit(&bit_string, STATUS_FLAG_FAULT, false);
+                bitstring_set_bit(&bit_string, STATUS_FLAG_FAULT,
+                    gpio_object_reliability(object_type, instance) !=
+                    RELIABILITY_NO_FAULT_DETECTED);
                 bitstring_set_bit(&bit_string, STATUS_FLAG_OVERRIDDEN, false);
                 bitstring_set_bit(&bit_string, STATUS_FLAG_OUT_OF_SERVICE, false);
                 apdu_len = encode_tagged_bitstring(&apdu[0], &bit_string);
             }
             break;
+        case PROP_RELIABILITY:
+            apdu_len = encode_tagged_enumerated(&apdu[0],
+                gpio_object_reliability(object_type, instance));
+            break;
         case PROP_OUT_OF_SERVICE:
             apdu_len = encode_tagged_enumerated(&apdu[0], 0); // Not out of service
             break;
@@ -171,19 +174,19 @@ int encode_object_property_value(uint8_t * apdu,
             if (object_type == OBJECT_BINARY_INPUT || object_type == OBJECT_BINARY_OUTPUT) {
                 apdu_len = encode_tagged_enumerated(&apdu[0], 95); // No units
             } else {
-                apdu_len = encode_tagged_enumerated(&apdu[0], 62); // Degrees Celsius
+                apdu_len = encode_tagged_enumerated(&apdu[0], object_units(obj_ptr));
             }
             break;
         case PROP_ACTIVE_TEXT:
             if (object_type == OBJECT_BINARY_INPUT || object_type == OBJECT_BINARY_OUTPUT) {
                 apdu_len = encode_tagged_character_string(&apdu[0], 
-                    obj_ptr->units.states.active ? obj_ptr->units.states.active : "Active");
+                    object_active_text(obj_ptr));
             }
             break;
         case PROP_INACTIVE_TEXT:
             if (object_type == OBJECT_BINARY_INPUT || object_type == OBJECT_BINARY_OUTPUT) {
                 apdu_len = encode_tagged_character_string(&apdu[0], 
-                    obj_ptr->units.states.inactive ? obj_ptr->units.states.inactive : "Inactive");
+                    object_inactive_text(obj_ptr));
             }
             break;
         default:
@@ -204,6 +207,7 @@ int encode_device_property(uint8_t * apdu,
     time_t t;                   /* seconds since epoch time */
     struct tm *my_tm;           // local date and time
     BACNET_BIT_STRING bit_string;
+    struct gpio_pin *pin;
     int i = 0;
 
     switch (property) {
@@ -317,21 +321,15 @@ int encode_device_property(uint8_t * apdu,
         apdu_len = encode_tagged_bitstring(&apdu[0], &bit_string);
         break;
     case PROP_OBJECT_LIST:
+        // The device followed by every GPIO object in the pin table
         if (array_index == 0)
-            apdu_len = encode_tagged_unsigned(&apdu[0], 6); // Device + 5 GPIO objects
+            apdu_len = encode_tagged_unsigned(&apdu[0], 1 + gpio_pin_count());
         else if (array_index == 1)
             apdu_len = encode_tagged_object_id(&apdu[0], OBJECT_DEVICE,
                 BACnet_Device_Instance);
-        else if (array_index == 2)
-            apdu_len = encode_tagged_object_id(&apdu[0], OBJECT_BINARY_OUTPUT, 4018);
-        else if (array_index == 3)
-            apdu_len = encode_tagged_object_id(&apdu[0], OBJECT_BINARY_INPUT, 3019);
-        else if (array_index == 4)
-            apdu_len = encode_tagged_object_id(&apdu[0], OBJECT_ANALOG_INPUT, 1020);
-        else if (array_index == 5)
-            apdu_len = encode_tagged_object_id(&apdu[0], OBJECT_ANALOG_OUTPUT, 2021);
-        else if (array_index == 6)
-            apdu_len = encode_tagged_object_id(&apdu[0], OBJECT_BINARY_OUTPUT, 4026);
+        else if ((pin = gpio_pin_at(array_index - 2)) != NULL)
+            apdu_len = encode_tagged_object_id(&apdu[0], pin->object_type,
+                pin->instance);
         break;
     case PROP_MAX_APDU_LENGTH_ACCEPTED:
         apdu_len = encode_tagged_unsigned(&apdu[0], MAX_APDU);
@@ -341,11 +339,11 @@ int encode_device_property(uint8_t * apdu,
         break;
     case PROP_APDU_TIMEOUT:
         apdu_len =
-            encode_tagged_unsigned(&apdu[0], BACnet_APDU_Timeout * 1000);
+            encode_tagged_unsigned(&apdu[0], BACnet_APDU_Timeout);
         break;
     case PROP_NUMBER_OF_APDU_RETRIES:
-        /* to change this, edit invoke_id.c */
-        apdu_len = encode_tagged_unsigned(&apdu[0], 1);
+        apdu_len =
+            encode_tagged_unsigned(&apdu[0], BACnet_APDU_Retries);
         break;
     default:
         break;
@@ -36,8 +36,12 @@
 #include "bacnet_text.h"
 #include "bacdcode.h"
 #include "invoke_id.h"
+#include "intern.h"
 #include "debug.h"
 
+/* object identifiers that fit in one reply */
+#define MAX_OBJECT_LIST_IDS (MAX_APDU / 5)
+
 int receive_readpropertyACK(uint8_t * service_request, int service_len,
     struct BACnet_Device_Address *src)
 {
@@ -56,6 +60,10 @@ int receive_readpropertyACK(uint8_t * service_request, int service_len,
     float real_value = 0.0;
     uint32_t enum_value = 0;
     uint32_t unsigned_value = 0;
+    enum BACnetObjectType list_types[MAX_OBJECT_LIST_IDS];
+    int list_instances[MAX_OBJECT_LIST_IDS];
+    int list_count = 0;
+    int list_total = 0;
 
     debug_printf(5, "read-property-ack: Entered\n");
     /* which BACnet address? */
@@ -160,8 +168,10 @@ int receive_readpropertyACK(uint8_t * service_request, int service_len,
                 if (obj_ptr) {
                     obj_ptr->value.real = real_value;
                     debug_printf(3, "RP[float]: Device %d %s %d %s=%f\n",
-                        who_sent, enum_to_text_object(obj_ptr->type),
-                        obj_ptr->instance, enum_to_text_property(property),
+                        who_sent,
+                        enum_to_text_object(object_type(obj_ptr)),
+                        object_instance(obj_ptr),
+                        enum_to_text_property(property),
                         obj_ptr->value.real);
                 }
             }
@@ -180,29 +190,21 @@ int receive_readpropertyACK(uint8_t * service_request, int service_len,
             // load the string into object storage
             if (property == PROP_OBJECT_NAME) {
                 if (object == OBJECT_DEVICE) {
-                    if (dev_ptr->device_name)
-                        free(dev_ptr->device_name);
-                    dev_ptr->device_name = strdup(temp_string);
+                    intern_assign(&dev_ptr->device_name, temp_string);
                 }
                 obj_ptr = object_find(who_sent, object, instance);
                 if (obj_ptr) {
-                    if (obj_ptr->name)
-                        free(obj_ptr->name);
-                    obj_ptr->name = strdup(temp_string);
+                    object_set_name(obj_ptr, temp_string);
                 }
             } else if (property == PROP_ACTIVE_TEXT) {
                 obj_ptr = object_find(who_sent, object, instance);
                 if (obj_ptr) {
-                    if (obj_ptr->units.states.active)
-                        free(obj_ptr->units.states.active);
-                    obj_ptr->units.states.active = strdup(temp_string);
+                    object_set_state_texts(obj_ptr, temp_string, NULL);
                 }
             } else if (property == PROP_INACTIVE_TEXT) {
                 obj_ptr = object_find(who_sent, object, instance);
                 if (obj_ptr) {
-                    if (obj_ptr->units.states.inactive)
-                        free(obj_ptr->units.states.inactive);
-                    obj_ptr->units.states.inactive = strdup(temp_string);
+                    object_set_state_texts(obj_ptr, NULL, temp_string);
                 }
             }
             /* some other string property */
@@ -224,11 +226,13 @@ int receive_readpropertyACK(uint8_t * service_request, int service_len,
                 /* find and change the object */
                 obj_ptr = object_find(who_sent, object, instance);
                 if (obj_ptr) {
-                    obj_ptr->units.units = enum_value;
+                    object_set_units(obj_ptr, enum_value);
                     debug_printf(3, "RP[enum]: Device %d %s %d %s=%s\n",
-                        who_sent, enum_to_text_object(obj_ptr->type),
-                        obj_ptr->instance, enum_to_text_property(property),
-                        enum_to_text_units(obj_ptr->units.units));
+                        who_sent,
+                        enum_to_text_object(object_type(obj_ptr)),
+                        object_instance(obj_ptr),
+                        enum_to_text_property(property),
+                        enum_to_text_units(object_units(obj_ptr)));
                 }
             } else if (property == PROP_PRESENT_VALUE) {
                 /* find and change the object */
@@ -236,8 +240,10 @@ int receive_readpropertyACK(uint8_t * service_request, int service_len,
                 if (obj_ptr) {
                     obj_ptr->value.binary = enum_value;
                     debug_printf(3, "RP[enum]: Device %d %s %d %s=%s\n",
-                        who_sent, enum_to_text_object(obj_ptr->type),
-                        obj_ptr->instance, enum_to_text_property(property),
+                        who_sent,
+                        enum_to_text_object(object_type(obj_ptr)),
+                        object_instance(obj_ptr),
+                        enum_to_text_property(property),
                         obj_ptr->value.binary ? "ACTIVE" : "INACTIVE");
                 }
             } else
@@ -271,6 +277,42 @@ int receive_readpropertyACK(uint8_t * service_request, int service_len,
                             who_sent, enum_to_text_object(obj2), inst2);
                 }
             }
+            /* the whole ObjectList in one reply - merge it in one go */
+            else if ((property == PROP_OBJECT_LIST) &&
+                (object == OBJECT_DEVICE) &&
+                (array_index == BACNET_ARRAY_ALL)) {
+                list_count = 0;
+                list_total = 0;
+                for (;;) {
+                    offset += decode_object_id(&service_request[offset],
+                        &obj2, &inst2);
+                    list_total++;
+                    /* only known BACnet standard objects */
+                    if (obj2 < OBJECT_RESERVED_0) {
+                        list_types[list_count] = obj2;
+                        list_instances[list_count] = inst2;
+                        list_count++;
+                    }
+                    if ((offset >= service_len) ||
+                        (list_count >= MAX_OBJECT_LIST_IDS) ||
+                        decode_is_closing_tag_number(&service_request
+                            [offset], 3))
+                        break;
+                    offset += decode_tag_number_and_value(&service_request
+                        [offset], &tag_number, &len_value_type);
+                    if (tag_number != BACNET_APPLICATION_TAG_OBJECT_ID)
+                        break;
+                }
+                debug_printf(2,
+                    "RP: Device %d sent ObjectList with %d objects.\n",
+                    who_sent, list_count);
+                if (object_new_list(who_sent, list_types, list_instances,
+                        list_count) < 0)
+                    debug_printf(2,
+                        "RP: Device %d ObjectList unable to add %d objects.\n",
+                        who_sent, list_count);
+                query_object_list_received(dev_ptr, list_total);
+            }
             break;
         default:
             break;
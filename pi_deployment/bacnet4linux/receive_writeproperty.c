@@ -29,6 +29,7 @@
 //
 #include "os.h"
 #include <unistd.h>
+#include <math.h>
 #include "bacnet_struct.h"
 #include "bacnet_enum.h"
 #include "bacnet_const.h"
@@ -42,97 +43,18 @@
 #include "options.h"
 #include "version.h"
 #include "gpio_objects.h"
-
-// Use simpler approach - store in relinquish_defaults only and fix read function
-// extern struct gpio_priority_array gpio_priorities[5];
+#include "gpio_pins.h"
 #include "bacnet_object.h"
 
-// Forward declaration
-static void gpio_write_pin(uint32_t instance, float value);
-
 // from main.c
 extern int BACnet_Device_Instance;
 
-// Priority array storage for GPIO output objects
-static union ObjectValue priority_arrays[3][16]; // For instances 4018, 4026, 2021
-static bool priority_null[3][16] = {{true}}; // Track which priorities are NULL (initialize all to true)
-union ObjectValue relinquish_defaults[5]; // Default values when all priorities are NULL (make global)
-static bool arrays_initialized = false;
-
-// Map instance to priority array index
-static int get_priority_index(uint32_t instance) {
-    switch (instance) {
-        case 4018: return 0; // Test LED
-        case 4026: return 1; // Main Relay
-        case 2021: return 2; // Fan Control
-        default: return -1;
-    }
-}
-
-// Calculate effective present-value from priority array
-static union ObjectValue calculate_effective_value(int object_type, uint32_t instance) {
-    union ObjectValue effective_value;
-    int pri_idx = get_priority_index(instance);
-    
-    if (pri_idx < 0) {
-        // Not a GPIO object, return default
-        if (object_type == OBJECT_BINARY_OUTPUT) {
-            effective_value.enumerated = 0;
-        } else {
-            effective_value.real = 0.0f;
-        }
-        return effective_value;
-    }
-    
-    // Find highest priority (lowest number) that's not NULL
-    for (int i = 0; i < 16; i++) {
-        if (!priority_null[pri_idx][i]) {
-            debug_printf(3, "WRP: Effective value from priority %d\n", i + 1);
-            return priority_arrays[pri_idx][i];
-        }
-    }
-    
-    // All priorities are NULL, use relinquish-default
-    debug_printf(3, "WRP: Using relinquish-default (all priorities NULL)\n");
-    return relinquish_defaults[pri_idx];
-}
-
-// Initialize priority arrays - call this once at startup
-static void initialize_priority_arrays(void) {
-    if (arrays_initialized) return;
-    
-    // Initialize all priorities to NULL
-    for (int obj = 0; obj < 3; obj++) {
-        for (int pri = 0; pri < 16; pri++) {
-            priority_null[obj][pri] = true;
-            priority_arrays[obj][pri].enumerated = 0; // Default value
-        }
-    }
-    
-    // Initialize relinquish defaults
-    relinquish_defaults[0].enumerated = 0; // BO4018 default INACTIVE
-    relinquish_defaults[1].enumerated = 0; // BO4026 default INACTIVE  
-    relinquish_defaults[2].real = 0.0;     // AO2021 default 0%
-    
-    arrays_initialized = true;
-    debug_printf(2, "WRP: Priority arrays and relinquish defaults initialized\n");
-}
-
 // External function to get priority value (called from read property handler)
-bool get_priority_value(uint32_t instance, int priority, union ObjectValue *value) {
-    initialize_priority_arrays();
-    
-    int pri_idx = get_priority_index(instance);
-    if (pri_idx < 0 || priority < 1 || priority > 16) {
-        return true; // Invalid - return as NULL
-    }
-    
-    if (priority_null[pri_idx][priority - 1]) {
-        return true; // NULL value
-    }
-    
-    *value = priority_arrays[pri_idx][priority - 1];
-    return false; // Not NULL
+bool get_priority_value(int object_type, uint32_t instance, int priority,
+    union ObjectValue *value)
+{
+    return gpio_pin_priority_get(gpio_pin_find(object_type, instance),
+        priority, value);
 }
 
 // Integrated write property function for all objects including GPIO
@@ -140,6 +62,7 @@ int write_object_property_value(int object_type, uint32_t instance,
     uint32_t property, uint8_t tag, void *value, uint8_t priority)
 {
     struct ObjectRef_Struct *obj_ptr;
+    struct gpio_pin *pin;
     
     debug_printf(2, "WRP: Integrated write for object type %d instance %u property %d priority %u\n",
         object_type, instance, property, priority);
@@ -153,23 +76,16 @@ int write_object_property_value(int object_type, uint32_t instance,
     }
     
     debug_printf(2, "WRP: Found object %s, writing property %d at priority %u\n", 
-        obj_ptr->name ? obj_ptr->name : "unnamed", property, priority);
+        object_name(obj_ptr) ? object_name(obj_ptr) : "unnamed", property, priority);
     
-    // Initialize priority arrays on first use
-    initialize_priority_arrays();
+    // GPIO outputs carry a priority array in the pin table
+    pin = gpio_pin_find(object_type, instance);
     
     // Handle present-value property with priority array logic
     if (property == PROP_PRESENT_VALUE) {
         // Check if this is a GPIO output object (supports priority arrays)
-        if ((object_type == OBJECT_BINARY_OUTPUT && (instance == 4018 || instance == 4026)) ||
-            (object_type == OBJECT_ANALOG_OUTPUT && instance == 2021)) {
-            
-            // Priority-based write for GPIO output objects
-            int pri_idx = get_priority_index(instance);
-            if (pri_idx < 0) {
-                debug_printf(1, "WRP: Invalid GPIO instance %u\n", instance);
-                return -3;
-            }
+        if (gpio_pin_is_output(pin)) {
+            union ObjectValue pri_value;
             
             // Validate priority (1-16)
             if (priority < 1 || priority > 16) {
@@ -180,18 +96,18 @@ int write_object_property_value(int object_type, uint32_t instance,
             // Store value in priority array or handle NULL write
             if (tag == BACNET_APPLICATION_TAG_NULL) {
                 // NULL write - relinquish this priority
-                priority_null[pri_idx][priority - 1] = true;
+                gpio_pin_priority_relinquish(pin, priority);
                 debug_printf(1, "WRP: Relinquished priority %u for %s %u\n", 
                     priority, (object_type == OBJECT_BINARY_OUTPUT) ? "Binary Output" : "Analog Output", instance);
                     
             } else if (object_type == OBJECT_BINARY_OUTPUT) {
                 if (tag == BACNET_APPLICATION_TAG_ENUMERATED) {
                     uint32_t enum_value = *(uint32_t*)value;
-                    priority_arrays[pri_idx][priority - 1].enumerated = (enum_value != 0) ? 1 : 0;
-                    priority_null[pri_idx][priority - 1] = false;
+                    pri_value.enumerated = (enum_value != 0) ? 1 : 0;
+                    gpio_pin_priority_set(pin, priority, pri_value);
                     
                     debug_printf(1, "WRP: Set priority %u to %s for Binary Output %u\n", 
-                        priority, priority_arrays[pri_idx][priority - 1].enumerated ? "ACTIVE" : "INACTIVE", instance);
+                        priority, pri_value.enumerated ? "ACTIVE" : "INACTIVE", instance);
                 } else {
                     debug_printf(1, "WRP: Invalid data type %d for Binary Output\n", tag);
                     return -3;
@@ -199,8 +115,8 @@ int write_object_property_value(int object_type, uint32_t instance,
             } else if (object_type == OBJECT_ANALOG_OUTPUT) {
                 if (tag == BACNET_APPLICATION_TAG_REAL) {
                     float real_value = *(float*)value;
-                    priority_arrays[pri_idx][priority - 1].real = real_value;
-                    priority_null[pri_idx][priority - 1] = false;
+                    pri_value.real = real_value;
+                    gpio_pin_priority_set(pin, priority, pri_value);
                     
                     debug_printf(1, "WRP: Set priority %u to %.2f for Analog Output %u\n", 
                         priority, real_value, instance);
@@ -211,7 +127,7 @@ int write_object_property_value(int object_type, uint32_t instance,
             }
             
             // Calculate effective present-value from priority array
-            union ObjectValue effective = calculate_effective_value(object_type, instance);
+            union ObjectValue effective = gpio_pin_effective_value(pin);
             obj_ptr->value = effective;
             
             // Update the actual GPIO pin through GPIO objects handler
@@ -262,29 +178,22 @@ int write_object_property_value(int object_type, uint32_t instance,
         
     } else if (property == PROP_RELINQUISH_DEFAULT) {
         // Handle relinquish-default property writes for GPIO output objects  
-        if ((object_type == OBJECT_BINARY_OUTPUT && (instance == 4018 || instance == 4026)) ||
-            (object_type == OBJECT_ANALOG_OUTPUT && instance == 2021)) {
+        if (gpio_pin_is_output(pin)) {
             
             // Set relinquish default and recalculate effective value
             if (object_type == OBJECT_BINARY_OUTPUT) {
                 if (tag == BACNET_APPLICATION_TAG_ENUMERATED) {
                     uint32_t enum_value = *(uint32_t*)value;
                     
-                    // Store in relinquish_defaults array - will fix read function separately
-                    if (instance == 4018) {
-                        relinquish_defaults[0].enumerated = (enum_value != 0) ? 1 : 0;
-                        debug_printf(1, "WRP: Set relinquish-default for Binary Output 4018 to %s (value=%u)\n", 
-                            (enum_value != 0) ? "ACTIVE" : "INACTIVE", relinquish_defaults[0].enumerated);
-                    } else if (instance == 4026) {
-                        relinquish_defaults[1].enumerated = (enum_value != 0) ? 1 : 0;
-                        debug_printf(1, "WRP: Set relinquish-default for Binary Output 4026 to %s (value=%u)\n", 
-                            (enum_value != 0) ? "ACTIVE" : "INACTIVE", relinquish_defaults[1].enumerated);
-                    }
+                    pin->priority.relinquish_default.enumerated = (enum_value != 0) ? 1 : 0;
+                    debug_printf(1, "WRP: Set relinquish-default for Binary Output %u to %s\n", 
+                        instance, pin->priority.relinquish_default.enumerated ? "ACTIVE" : "INACTIVE");
                     
                     // Recalculate effective value and update GPIO
-                    union ObjectValue effective = calculate_effective_value(object_type, instance);
+                    union ObjectValue effective = gpio_pin_effective_value(pin);
                     obj_ptr->value = effective;
-                    gpio_write_pin(instance, effective.enumerated);
+                    gpio_objects_write_property(object_type, instance, PROP_PRESENT_VALUE,
+                        BACNET_APPLICATION_TAG_ENUMERATED, &effective.enumerated, 16);
                     
                     return 0;
                 } else {
@@ -295,16 +204,16 @@ int write_object_property_value(int object_type, uint32_t instance,
                 if (tag == BACNET_APPLICATION_TAG_REAL) {
                     float real_value = *(float*)value;
                     
-                    // Store in relinquish_defaults array
-                    relinquish_defaults[2].real = real_value;
+                    pin->priority.relinquish_default.real = real_value;
                     
-                    debug_printf(1, "WRP: Set relinquish-default for Analog Output %u to %.2f (value=%.2f)\n", 
-                        instance, real_value, relinquish_defaults[2].real);
+                    debug_printf(1, "WRP: Set relinquish-default for Analog Output %u to %.2f\n", 
+                        instance, real_value);
                     
                     // Recalculate effective value and update GPIO
-                    union ObjectValue effective = calculate_effective_value(object_type, instance);
+                    union ObjectValue effective = gpio_pin_effective_value(pin);
                     obj_ptr->value = effective;
-                    gpio_write_pin(instance, effective.real);
+                    gpio_objects_write_property(object_type, instance, PROP_PRESENT_VALUE,
+                        BACNET_APPLICATION_TAG_REAL, &effective.real, 16);
                     
                     return 0;
                 } else {
@@ -326,62 +235,6 @@ int write_object_property_value(int object_type, uint32_t instance,
     return -1; // Default error return
 }
 
-// Helper function to write to actual GPIO pin
-static void gpio_write_pin(uint32_t instance, float value)
-{
-    // Map BACnet instance to GPIO pin number
-    int gpio_pin = -1;
-    
-    switch (instance) {
-        case 4018: gpio_pin = 18; break;  // Test LED
-        case 4026: gpio_pin = 26; break;  // Main Relay
-        case 2021: gpio_pin = 21; break;  // Fan Control (PWM)
-        default:
-            debug_printf(1, "WRP: Unknown instance %u for write\n", instance);
-            return;
-    }
-    
-    debug_printf(2, "WRP: Setting GPIO pin %d to %.2f\n", gpio_pin, value);
-    
-    // For binary outputs: value > 0.5 = HIGH (3.3V), <= 0.5 = LOW (0V)
-    int digital_value = (value > 0.5) ? 1 : 0;
-    
-    debug_printf(1, "WRP: *** ATTEMPTING GPIO CONTROL - Pin %d, Value %d ***\n", gpio_pin, digital_value);
-    
-    // Use multi-method Python GPIO control for Pi 5 compatibility
-    char command[256];
-
-    int status;
-    
-    // Method 1: Try gpiozero with cleanup (preferred for Pi 5)
-    snprintf(command, sizeof(command), 
-        "python3 -c \"from gpiozero import Device, LED; Device.pin_factory.reset(); led=LED(%d); led.%s(); print('SUCCESS')\" 2>/dev/null",
-        gpio_pin, digital_value ? "on" : "off");
-    
-    debug_printf(1, "WRP: Trying gpiozero method with cleanup for GPIO %d\n", gpio_pin);
-    status = system(command);
-    if (status == 0) {
-        debug_printf(1, "WRP: *** SUCCESS - GPIO %d controlled via gpiozero ***\n", gpio_pin);
-        return;
-    }
-    debug_printf(1, "WRP: gpiozero failed (status %d)\n", status);
-    
-    // Method 2: Try RPi.GPIO with pin-specific cleanup
-    snprintf(command, sizeof(command), 
-        "python3 -c \"import RPi.GPIO as GPIO; GPIO.setmode(GPIO.BCM); GPIO.cleanup(%d); GPIO.setup(%d, GPIO.OUT); GPIO.output(%d, %d); print('SUCCESS')\" 2>/dev/null",
-        gpio_pin, gpio_pin, gpio_pin, digital_value);
-    
-    debug_printf(1, "WRP: Trying RPi.GPIO method with pin cleanup for GPIO %d\n", gpio_pin);
-    status = system(command);
-    if (status == 0) {
-        debug_printf(1, "WRP: *** SUCCESS - GPIO %d controlled via RPi.GPIO ***\n", gpio_pin);
-        return;
-    }
-    debug_printf(1, "WRP: RPi.GPIO failed (status %d)\n", status);
-    
-    debug_printf(1, "WRP: *** FAILED - All GPIO control methods unsuccessful for pin %d ***\n", gpio_pin);
-}
-
 // Simple ACK response for successful writes
 static void send_simple_ack(struct BACnet_Device_Address *dest, 
     uint8_t invoke_id, uint8_t service_choice)
@@ -525,6 +378,12 @@ int receive_writeproperty(uint8_t * service_request,
             len = decode_real(&service_request[offset], &real_value);
             offset += len;
             debug_printf(2, "WRP: Decoded real value %.2f\n", real_value);
+            // a NaN or an infinity can't be driven to an output
+            if (!isfinite(real_value)) {
+                send_error_response(src, invoke_id, SERVICE_CONFIRMED_WRITE_PROPERTY,
+                    ERROR_CLASS_PROPERTY, ERROR_CODE_VALUE_OUT_OF_RANGE);
+                return -1;
+            }
                 
         } else {
             debug_printf(1, "WRP: Unsupported value type %d\n", tag_number);
@@ -27,24 +27,75 @@
 
 #include "os.h"
 #include "bacnet_struct.h"
+#include "bacnet_api.h"
 #include "debug.h"
 #include "main.h"
 #include "options.h"
 
+/* the BVLL header in front of the NPDU */
+#define BVLL_HEADER_LEN 4
+
+/* sends the BVLL header and the encoded NPDU behind it as one datagram */
+static int send_bip_mtu(struct in_addr dest, uint8_t * bvll, uint8_t * pdu,
+    int pdu_len)
+{
+    struct sockaddr_in bip_dest;
+    struct iovec iov[2];
+    struct msghdr msg;
+    int mtu_len = BVLL_HEADER_LEN + pdu_len;
+    int bytes_sent = 0;
+    int status = 1;             // return value
+
+    /* load the destination IP address into the structure */
+    if (dest.s_addr > 0) {
+        memset(&bip_dest, 0, sizeof(bip_dest));
+        bip_dest.sin_family = AF_INET;
+        bip_dest.sin_addr.s_addr = dest.s_addr;
+        bip_dest.sin_port = htons(BACnet_UDP_Port);     /* port to send to */
+    } else {
+        error_printf
+            ("send_bip: Panic!: No destination IP address given!\n");
+        return 0;
+    }
+    // put the total length here
+    bvll[2] = (int) (mtu_len / 256);    /* upper 8 bits */
+    bvll[3] = mtu_len - bvll[2] * 256;  /* lower 8 bits */
+    debug_printf(4, "send_bip: sending to %s\n",
+        inet_ntoa(bip_dest.sin_addr));
+    debug_dump_data(4, bvll, BVLL_HEADER_LEN);
+    debug_dump_data(4, pdu, pdu_len);
+    iov[0].iov_base = bvll;
+    iov[0].iov_len = BVLL_HEADER_LEN;
+    iov[1].iov_base = pdu;
+    iov[1].iov_len = pdu_len;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_name = &bip_dest;
+    msg.msg_namelen = sizeof(bip_dest);
+    msg.msg_iov = iov;
+    msg.msg_iovlen = 2;
+    bytes_sent = sendmsg(bip_sockfd, &msg, 0);
+    if (bytes_sent < 0) {
+        perror("BIP");
+        error_printf
+            ("send_bip: An error occurred sending %d bytes via BACnet/IP",
+            bytes_sent);
+        status = 0;
+    }
+
+    return status;
+}
+
 // for some reason, with dynamic memory, we get scrambled output
 // Use alloc memory...
 // #define SEND_BIP_DYN_MEM
 int send_bip(struct BACnet_NPDU *npdu, uint8_t * apdu, int apdu_len)
 {
-    struct sockaddr_in bip_dest;
 #ifdef SEND_BIP_DYN_MEM
     uint8_t *mtu = NULL;
 #else
     static uint8_t mtu[DEFAULT_MTU] = { 0 };    // FIXME: not thread safe
 #endif
-    int mtu_len = 0;
-    int i = 0;
-    int bytes_sent = 0;
+    int pdu_len = 0;
     int status = 1;             // return value
 
     /* Make sure the socket is open */
@@ -56,17 +107,6 @@ int send_bip(struct BACnet_NPDU *npdu, uint8_t * apdu, int apdu_len)
     debug_printf(2, "send_bip: dest.ip=%s:%4X\n", inet_ntoa(npdu->dest.ip),
         BACnet_UDP_Port);
 
-    /* load the destination IP address into the structure */
-    if (npdu->dest.ip.s_addr > 0) {
-        bip_dest.sin_family = AF_INET;
-        bip_dest.sin_addr.s_addr = npdu->dest.ip.s_addr;
-        bip_dest.sin_port = htons(BACnet_UDP_Port);     /* port to send to */
-    } else {
-        error_printf
-            ("send_bip: Panic!: No destination IP address given!\n");
-        return 0;
-    }
-
 #ifdef SEND_BIP_DYN_MEM
     mtu = calloc(1, DEFAULT_MTU);
     if (!mtu) {
@@ -81,74 +121,9 @@ int send_bip(struct BACnet_NPDU *npdu, uint8_t * apdu, int apdu_len)
         mtu[1] = 0x0A;          /* Original-Unicast-NPDU */
     mtu[2] = 0x00;              /* upper length byte */
     mtu[3] = 0x00;              // lower length byte - filled later...
-    mtu_len = 4;
-    mtu[mtu_len] = npdu->version;       /* NPDU... Version */
-    mtu_len++;
-    mtu[mtu_len] = npdu->control_byte;  /* Control Byte */
-    mtu_len++;
-    //FIXME
-    //Correctly fill in the buffer
-    if (npdu->dest_present) {
-        mtu[mtu_len] = (int) (npdu->dest.net / 256);    /* upper 8 bits */
-        mtu[mtu_len + 1] = npdu->dest.net - mtu[mtu_len] * 256; /* lower 8 bits */
-        mtu[mtu_len + 2] = npdu->dest.len;
-        mtu_len += 3;
-        if (npdu->dest.len == 6) {      /* dest.adr is present for ethernet */
-            for (i = 0; i < 6; i++) {   /* 6 chunks of mac */
-                mtu[mtu_len] = npdu->dest.adr[i];
-                mtu_len++;
-            }
-        } else if (npdu->dest.len == 1) {       /* dest.adr is present for arcnet, ms/tp */
-            mtu[mtu_len] = npdu->dest.adr[0];
-            mtu_len++;
-        }
-    }
-    if (npdu->src_present) {
-        /* upper 8 bits */
-        mtu[mtu_len] = (int) (npdu->src.net / 256);
-        /* lower 8 bits */
-        mtu[mtu_len + 1] = npdu->src.net - mtu[mtu_len] * 256;
-        mtu[mtu_len + 2] = npdu->src.len;
-        mtu_len += 3;
-        /* dest.adr is present for ethernet */
-        if (npdu->src.len == 6) {
-            /* 6 chunks of mac */
-            for (i = 0; i < 6; i++) {
-                mtu[mtu_len] = npdu->src.adr[i];
-                mtu_len++;
-            }
-        }
-    }
-    /* hop count */
-    if (npdu->dest_present) {
-        mtu[mtu_len] = 0xFF;
-        mtu_len++;
-    }
-    /* there is a network message, not an APDU */
-    if (npdu->network_message) {
-        mtu[mtu_len] = npdu->message_type;
-        mtu_len++;
-    }
-    /* at this point only the APDU is remaining */
-    memcpy(&mtu[mtu_len], apdu, apdu_len);
-    mtu_len += apdu_len;
-    // put the total length here
-    mtu[2] = (int) (mtu_len / 256);     /* upper 8 bits */
-    mtu[3] = mtu_len - mtu[2] * 256;    /* lower 8 bits */
-    debug_printf(4, "send_bip: sending to %s\n",
-        inet_ntoa(bip_dest.sin_addr));
-    debug_dump_data(4, mtu, mtu_len);
-    bytes_sent = sendto(bip_sockfd,
-        &mtu, mtu_len,
-        0, (struct sockaddr *) &bip_dest, sizeof(struct sockaddr));
-    //bytes_sent = sendto( bip_sockfd, &buf, 6 /* buf length */, 0, &bip_dest, sizeof(bip_dest));
-    if (bytes_sent < 0) {
-        perror("BIP");
-        error_printf
-            ("send_bip: An error occurred sending %d bytes via BACnet/IP",
-            bytes_sent);
-        status = 0;
-    }
+    pdu_len = npdu_encode(&mtu[BVLL_HEADER_LEN], npdu, apdu, apdu_len);
+    status = send_bip_mtu(npdu->dest.ip, mtu, &mtu[BVLL_HEADER_LEN],
+        pdu_len);
 #ifdef SEND_BIP_DYN_MEM
     free(mtu);
 #endif
@@ -156,4 +131,21 @@ int send_bip(struct BACnet_NPDU *npdu, uint8_t * apdu, int apdu_len)
     return status;
 }
 
+/* sends a frame that npdu_encode() made earlier - a retry of a */
+/* request - straight from where it is kept, without encoding it again */
+int send_bip_frame(struct in_addr dest, uint8_t * pdu, int pdu_len)
+{
+    uint8_t bvll[BVLL_HEADER_LEN];
+
+    /* Make sure the socket is open */
+    if (bip_sockfd < 0) {
+        debug_printf(4, "send_bip: IP socket is invalid!\n");
+        return 0;
+    }
+    bvll[0] = 0x81;
+    bvll[1] = 0x0A;             /* Original-Unicast-NPDU */
+
+    return send_bip_mtu(dest, bvll, pdu, pdu_len);
+}
+
 /* end of send_bip.c */
@@ -112,7 +112,8 @@ static uint8_t get_max_seg_max_apdu(int max_segs, int max_apdu)
 }
 
 /* function that creates an NPDU ready to be sent from the APDU */
-static int send_npdu_raw(struct BACnet_NPDU *npdu,
+/* dest_device is the device instance it goes to, -1 if not known */
+static int send_npdu_raw(int dest_device, struct BACnet_NPDU *npdu,
     unsigned char *apdu, int apdu_len)
 {
     int eth_rv = 0;
@@ -132,7 +133,7 @@ static int send_npdu_raw(struct BACnet_NPDU *npdu,
         npdu->src_present * 8 + npdu->expecting_reply * 4;
     /* a reply is expected (Invoke ID is needed) */
     if (npdu->expecting_reply) {
-        invokeID = invoke_id();
+        invokeID = invoke_id(npdu);
         /* that's no good */
         if (invokeID < 0) {
             npdu_free(npdu);
@@ -142,7 +143,14 @@ static int send_npdu_raw(struct BACnet_NPDU *npdu,
         /* max APDU accepted in response */
         apdu[1] = get_max_seg_max_apdu(0, MAX_APDU);
         apdu[2] = invokeID;
-        invoke_id_send_npdu(invokeID, npdu, apdu, apdu_len);
+        /* an untracked request would let its ID be reused while the */
+        /* reply is still on the way */
+        if (invoke_id_send_npdu(invokeID, dest_device, npdu, apdu,
+                apdu_len) < 0) {
+            npdu_free(npdu);
+            error_printf("send_npdu: request not sent!\n");
+            return 0;
+        }
         debug_printf(3, "send_npdu: Adding Invoke ID %d for %s\n",
             invokeID, hwaddrtoa(npdu->dest.mac));
     }
@@ -226,7 +234,7 @@ int send_npdu_address(struct BACnet_Device_Address *dest,
             npdu->src.net, npdu->src.len, hwaddrtoa(npdu->src.adr));
     }
 
-    return (send_npdu_raw(npdu, apdu, apdu_len));
+    return (send_npdu_raw(-1, npdu, apdu, apdu_len));
 }
 
 /* function that creates an NPDU ready to be sent from the APDU */
@@ -317,7 +325,7 @@ int send_npdu(int dest_device, unsigned char *apdu, int apdu_len)
             return 0;           /* that's no good */
         }
     }
-    rv = send_npdu_raw(npdu, apdu, apdu_len);
+    rv = send_npdu_raw(dev_ptr ? dest_device : -1, npdu, apdu, apdu_len);
     npdu_free(npdu);
     return rv;
 }
@@ -28,6 +28,10 @@
 #include "debug.h"
 #include "main.h"
 #include "ethernet.h"
+#include "gpio_backend.h"
+#include "gpio_pwm.h"
+#include "gpio_adc.h"
+#include "gpio_objects.h"
 
 // from html.c
 extern void html_cleanup(void);
@@ -42,6 +46,12 @@ static void sig_int(int signo)
     debug_printf(2, "sig_int: Freeing memory...\n");
     device_cleanup();
 
+    debug_printf(2, "sig_int: Releasing GPIO lines\n");
+    gpio_objects_stop();
+    gpio_backend_cleanup();
+    gpio_pwm_cleanup();
+    gpio_adc_cleanup();
+
     debug_printf(2, "sig_int: Closing 802.2 socket\n");
     ethernet_cleanup();
 
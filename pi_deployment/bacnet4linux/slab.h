@@ -0,0 +1,59 @@
+/*####COPYRIGHTBEGIN####
+ -------------------------------------------
+ Slab Pool Header for BACnet4Linux
+ -------------------------------------------
+####COPYRIGHTEND####*/
+
+#ifndef SLAB_H
+#define SLAB_H
+
+#include <stddef.h>
+#include <stdbool.h>
+
+// pool memory is handed out on this boundary
+#define SLAB_ALIGN 16
+// pools that share a slab_stats - shown on the status page
+#define SLAB_MAX_STATS 12
+
+// totals for every pool of one kind of record
+struct slab_stats {
+    const char *name;
+    size_t object_size;         /* bytes per record, after alignment */
+    unsigned long allocs;       /* records handed out */
+    unsigned long frees;        /* records given back, one by one or in bulk */
+    unsigned long in_use;       /* records handed out and not given back */
+    unsigned long high_water;   /* most records in use at once */
+    unsigned long capacity;     /* records the slabs can hold */
+    unsigned long slabs;        /* slabs held */
+    bool registered;
+};
+
+struct slab;
+
+// a pool of fixed size records, carved out of slabs of slab_objects
+// records.  Freed records go on a free list and are handed out again
+// first; the slabs themselves are only returned by slab_pool_release.
+struct slab_pool {
+    size_t object_size;         /* bytes per record, after alignment */
+    unsigned slab_objects;      /* records per slab */
+    void *free_list;            /* freed records, linked through themselves */
+    struct slab *slabs;         /* slabs held by this pool */
+    unsigned long in_use;       /* records handed out by this pool */
+    unsigned long capacity;     /* records the slabs can hold */
+    unsigned long slab_count;   /* slabs held by this pool */
+    struct slab_stats *stats;   /* totals shared with pools of the same kind */
+};
+
+void slab_pool_init(struct slab_pool *pool, struct slab_stats *stats,
+    size_t object_size, unsigned slab_objects);
+// returns a zeroed record, or NULL if memory ran out
+void *slab_alloc(struct slab_pool *pool);
+void slab_free(struct slab_pool *pool, void *record);
+// gives back every record and slab of the pool at once
+void slab_pool_release(struct slab_pool *pool);
+
+// registered statistics, for the status page
+int slab_stats_count(void);
+const struct slab_stats *slab_stats_at(int index);
+
+#endif /* SLAB_H */